@@ -41,6 +41,7 @@
 #include "osi/include/hash_map_utils.h"
 #include "osi/include/osi.h"
 #include "osi/include/socket_utils/sockets.h"
+#include "udrv/include/uipc_ring.h"
 
 #include "audio_hearing_aid_hw/include/audio_hearing_aid_hw.h"
 
@@ -134,6 +135,7 @@ struct ha_stream_common {
   std::recursive_mutex* mutex;  // See note below on mutex acquisition order.
   int ctrl_fd;
   int audio_fd;
+  bluetooth::uipc::SharedRings* rings;  // Audio rings, if the stack has them
   size_t buffer_sz;
   struct ha_config cfg;
   ha_state_t state;
@@ -357,6 +359,52 @@ static int skt_disconnect(int fd) {
   return 0;
 }
 
+/* The audio goes over shared memory rings when the stack offers them on the
+ * audio socket, and over the socket itself otherwise. */
+static void audio_connect_rings(struct ha_stream_common* common) {
+  common->rings =
+      bluetooth::uipc::ConnectSharedRings(
+          common->audio_fd, bluetooth::uipc::kRingNegotiationTimeoutMs)
+          .release();
+  INFO("audio over %s", common->rings ? "shared memory rings" : "socket");
+}
+
+static void audio_disconnect(struct ha_stream_common* common) {
+  if (common->rings != NULL) {
+    common->rings->Shutdown();
+    delete common->rings;
+    common->rings = NULL;
+  }
+  skt_disconnect(common->audio_fd);
+  common->audio_fd = AUDIO_SKT_DISCONNECTED;
+}
+
+static int audio_write(struct ha_stream_common* common, const void* p,
+                       size_t len) {
+  if (common->rings == NULL) return skt_write(common->audio_fd, p, len);
+
+  ts_log("ring_write", len, NULL);
+
+  size_t sent = common->rings->Upstream().Write((const uint8_t*)p, len,
+                                                SOCK_SEND_TIMEOUT_MS);
+  if (sent < len) {
+    WARN("write timeout exceeded, sent %zu bytes", sent);
+    return -1;
+  }
+  return (int)sent;
+}
+
+static int audio_read(struct ha_stream_common* common, void* p, size_t len) {
+  if (common->rings == NULL) return skt_read(common->audio_fd, p, len);
+
+  ts_log("ring_read", len, NULL);
+
+  bluetooth::uipc::Ring& ring = common->rings->Downstream();
+  size_t read = ring.Read((uint8_t*)p, len, SOCK_RECV_TIMEOUT_MS);
+  if (read == 0 && ring.IsShutdown()) return -1;
+  return (int)read;
+}
+
 /*****************************************************************************
  *
  *  AUDIO CONTROL PATH
@@ -807,6 +855,7 @@ static void ha_stream_common_init(struct ha_stream_common* common) {
 
   common->ctrl_fd = AUDIO_SKT_DISCONNECTED;
   common->audio_fd = AUDIO_SKT_DISCONNECTED;
+  common->rings = NULL;
   common->state = AUDIO_HA_STATE_STOPPED;
 
   /* manages max capacity of socket pipe */
@@ -842,6 +891,7 @@ static int start_audio_datapath(struct ha_stream_common* common) {
       ERROR("Audiopath start failed - error opening data socket");
       goto error;
     }
+    audio_connect_rings(common);
   }
   common->state = (ha_state_t)AUDIO_HA_STATE_STARTED;
   return 0;
@@ -869,8 +919,7 @@ static int stop_audio_datapath(struct ha_stream_common* common) {
   common->state = (ha_state_t)AUDIO_HA_STATE_STOPPED;
 
   /* disconnect audio path */
-  skt_disconnect(common->audio_fd);
-  common->audio_fd = AUDIO_SKT_DISCONNECTED;
+  audio_disconnect(common);
 
   return 0;
 }
@@ -889,9 +938,7 @@ static int suspend_audio_datapath(struct ha_stream_common* common,
     common->state = AUDIO_HA_STATE_SUSPENDED;
 
   /* disconnect audio path */
-  skt_disconnect(common->audio_fd);
-
-  common->audio_fd = AUDIO_SKT_DISCONNECTED;
+  audio_disconnect(common);
 
   return 0;
 }
@@ -942,12 +989,11 @@ static ssize_t out_write(struct audio_stream_out* stream, const void* buffer,
   }
 
   lock.unlock();
-  sent = skt_write(out->common.audio_fd, buffer, write_bytes);
+  sent = audio_write(&out->common, buffer, write_bytes);
   lock.lock();
 
   if (sent == -1) {
-    skt_disconnect(out->common.audio_fd);
-    out->common.audio_fd = AUDIO_SKT_DISCONNECTED;
+    audio_disconnect(&out->common);
     if ((out->common.state != AUDIO_HA_STATE_SUSPENDED) &&
         (out->common.state != AUDIO_HA_STATE_STOPPING)) {
       out->common.state = AUDIO_HA_STATE_STOPPED;
@@ -1492,11 +1538,10 @@ static ssize_t in_read(struct audio_stream_in* stream, void* buffer,
   }
 
   lock.unlock();
-  read = skt_read(in->common.audio_fd, buffer, bytes);
+  read = audio_read(&in->common, buffer, bytes);
   lock.lock();
   if (read == -1) {
-    skt_disconnect(in->common.audio_fd);
-    in->common.audio_fd = AUDIO_SKT_DISCONNECTED;
+    audio_disconnect(&in->common);
     if ((in->common.state != AUDIO_HA_STATE_SUSPENDED) &&
         (in->common.state != AUDIO_HA_STATE_STOPPING)) {
       in->common.state = AUDIO_HA_STATE_STOPPED;
@@ -1266,9 +1266,16 @@ class HearingAidImpl : public HearingAid {
       return;
     }
 
-    std::vector<uint16_t> chan_left;
-    std::vector<uint16_t> chan_right;
+    // TODO: make those buffers static and global to prevent constant
+    // reallocations
+    // TODO: this should basically fit the encoded data, tune the size later
+    // TODO: instead of a magic number, we need to figure out the correct
+    // buffer size
+    std::vector<uint8_t> encoded_data_left;
+    std::vector<uint8_t> encoded_data_right;
     if (left == nullptr || right == nullptr) {
+      std::vector<int16_t> chan_mono;
+      chan_mono.reserve(num_samples);
       for (int i = 0; i < num_samples; i++) {
         const uint8_t* sample = data.data() + i * 4;
 
@@ -1278,39 +1285,38 @@ class HearingAidImpl : public HearingAid {
         int16_t right = (int16_t)((*(sample + 1) << 8) + *sample) >> 1;
 
         uint16_t mono_data = (int16_t)(((uint32_t)left + (uint32_t)right) >> 1);
-        chan_left.push_back(mono_data);
-        chan_right.push_back(mono_data);
+        chan_mono.push_back(mono_data);
       }
-    } else {
-      for (int i = 0; i < num_samples; i++) {
-        const uint8_t* sample = data.data() + i * 4;
 
-        uint16_t left = (int16_t)((*(sample + 1) << 8) + *sample) >> 1;
-        chan_left.push_back(left);
-
-        sample += 2;
-        uint16_t right = (int16_t)((*(sample + 1) << 8) + *sample) >> 1;
-        chan_right.push_back(right);
+      auto& encoded_data = left ? encoded_data_left : encoded_data_right;
+      encoded_data.resize(4000);
+      int encoded_size =
+          g722_encode(left ? encoder_state_left : encoder_state_right,
+                      encoded_data.data(), chan_mono.data(), chan_mono.size());
+      encoded_data.resize(encoded_size);
+    } else {
+      // Both sides are encoded in one pass over the interleaved samples
+      std::vector<int16_t> chan_both;
+      chan_both.reserve(num_samples * 2);
+      for (int i = 0; i < num_samples * 2; i++) {
+        const uint8_t* sample = data.data() + i * 2;
+        chan_both.push_back((int16_t)((*(sample + 1) << 8) + *sample) >> 1);
       }
+
+      encoded_data_left.resize(4000);
+      encoded_data_right.resize(4000);
+      int encoded_size = g722_encode_stereo(
+          encoder_state_left, encoder_state_right, encoded_data_left.data(),
+          encoded_data_right.data(), chan_both.data(), num_samples);
+      encoded_data_left.resize(encoded_size);
+      encoded_data_right.resize(encoded_size);
     }
 
     // TODO: monural, binarual check
 
     // divide encoded data into packets, add header, send.
 
-    // TODO: make those buffers static and global to prevent constant
-    // reallocations
-    // TODO: this should basically fit the encoded data, tune the size later
-    std::vector<uint8_t> encoded_data_left;
     if (left) {
-      // TODO: instead of a magic number, we need to figure out the correct
-      // buffer size
-      encoded_data_left.resize(4000);
-      int encoded_size =
-          g722_encode(encoder_state_left, encoded_data_left.data(),
-                      (const int16_t*)chan_left.data(), chan_left.size());
-      encoded_data_left.resize(encoded_size);
-
       uint16_t cid = GAP_ConnGetL2CAPCid(left->gap_handle);
       uint16_t packets_in_chans = L2CA_FlushChannel(cid, L2CAP_FLUSH_CHANS_GET);
       if (packets_in_chans) {
@@ -1335,16 +1341,7 @@ class HearingAidImpl : public HearingAid {
       check_and_do_rssi_read(left);
     }
 
-    std::vector<uint8_t> encoded_data_right;
     if (right) {
-      // TODO: instead of a magic number, we need to figure out the correct
-      // buffer size
-      encoded_data_right.resize(4000);
-      int encoded_size =
-          g722_encode(encoder_state_right, encoded_data_right.data(),
-                      (const int16_t*)chan_right.data(), chan_right.size());
-      encoded_data_right.resize(encoded_size);
-
       uint16_t cid = GAP_ConnGetL2CAPCid(right->gap_handle);
       uint16_t packets_in_chans = L2CA_FlushChannel(cid, L2CAP_FLUSH_CHANS_GET);
       if (packets_in_chans) {
@@ -202,7 +202,7 @@ void hearing_aid_recv_ctrl_data() {
         ctrl_ack_status = HEARING_AID_CTRL_ACK_FAILURE;
       } else {
         UIPC_Open(*uipc_hearing_aid, UIPC_CH_ID_AV_AUDIO, hearing_aid_data_cb,
-                  HEARING_AID_DATA_PATH);
+                  HEARING_AID_DATA_PATH, true /* offer_rings */);
       }
       hearing_aid_send_ack(ctrl_ack_status);
       break;
@@ -446,5 +446,17 @@ void HearingAidAudioSource::DebugDump(int fd) {
                        1000
                  : 0)
          << std::endl;
+
+  tUIPC_RING_STATS ring_stats;
+  if (uipc_hearing_aid != nullptr &&
+      UIPC_Ioctl(*uipc_hearing_aid, UIPC_CH_ID_AV_AUDIO, UIPC_GET_RING_STATS,
+                 &ring_stats)) {
+    const bluetooth::uipc::RingStats& rx = ring_stats.upstream;
+    stream << "    Audio ring fill in bytes (size/now/max/ave)             : "
+           << rx.size << " / " << rx.fill << " / " << rx.max_fill << " / "
+           << rx.avg_fill
+           << "\n    Audio ring counts (underruns/overruns)                  : "
+           << rx.underruns << " / " << rx.overruns << std::endl;
+  }
   dprintf(fd, "%s", stream.str().c_str());
 }
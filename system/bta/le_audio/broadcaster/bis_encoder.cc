@@ -0,0 +1,132 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bta/le_audio/broadcaster/bis_encoder.h"
+
+#include <algorithm>
+
+#include "common/time_util.h"
+#include "osi/include/allocator.h"
+#include "osi/include/log.h"
+#include "stack/include/btm_iso_api_types.h"
+
+using bluetooth::hci::iso_manager::kIsoSduOffset;
+
+namespace le_audio {
+namespace broadcaster {
+
+void BisEncoder::Configure(uint8_t num_bis, int dt_us, int sr_hz,
+                           uint16_t sdu_size, size_t num_threads) {
+  const auto encoder_bytes = lc3_encoder_size(dt_us, sr_hz);
+
+  encoders_.clear();
+  encoders_mem_.clear();
+  while (encoders_.size() < num_bis) {
+    encoders_mem_.emplace_back(malloc(encoder_bytes), &std::free);
+    encoders_.emplace_back(
+        lc3_setup_encoder(dt_us, sr_hz, 0, encoders_mem_.back().get()));
+  }
+
+  if (NumThreads() != num_threads) {
+    workers_.reset();
+    if (num_threads) workers_ = std::make_unique<CodecWorkerPool>(num_threads);
+  }
+
+  jobs_.resize(num_bis);
+  stats_.assign(num_bis, BisStats());
+  latency_.Reset();
+  dt_us_ = dt_us;
+  frame_samples_ = lc3_frame_samples(dt_us, sr_hz);
+  sdu_size_ = sdu_size;
+}
+
+void BisEncoder::RunJob(size_t index, void* context) {
+  Job& job = static_cast<Job*>(context)[index];
+  job.status = lc3_encode(job.encoder, LC3_PCM_FORMAT_S16, job.pcm, job.stride,
+                          job.nbytes, job.out);
+  job.done_us = bluetooth::common::time_get_os_boottime_us();
+}
+
+void BisEncoder::Encode(const std::vector<uint8_t>& data, uint64_t arrival_us,
+                        std::vector<BT_HDR*>& sdus) {
+  const uint8_t num_bis = encoders_.size();
+  if (data.size() < num_bis * frame_samples_ * sizeof(int16_t)) {
+    LOG_ERROR("Missing samples. Data size: %zu", data.size());
+    sdus.clear();
+    return;
+  }
+  sdus.resize(num_bis);
+
+  for (uint8_t bis = 0; bis < num_bis; bis++) {
+    BT_HDR* p_sdu =
+        (BT_HDR*)osi_malloc(sizeof(BT_HDR) + kIsoSduOffset + sdu_size_);
+    p_sdu->offset = kIsoSduOffset;
+    p_sdu->len = sdu_size_;
+    p_sdu->event = 0;
+    p_sdu->layer_specific = 0;
+    sdus[bis] = p_sdu;
+
+    /* Samples of all the channels are interleaved */
+    jobs_[bis] = {
+        .encoder = encoders_[bis],
+        .pcm = (const int16_t*)data.data() + bis,
+        .stride = num_bis,
+        .out = p_sdu->data + p_sdu->offset,
+        .nbytes = sdu_size_,
+    };
+  }
+
+  if (workers_ && num_bis > 1) {
+    workers_->Run(num_bis, RunJob, jobs_.data());
+  } else {
+    for (uint8_t bis = 0; bis < num_bis; bis++) RunJob(bis, jobs_.data());
+  }
+
+  uint64_t frame_us = 0;
+  for (uint8_t bis = 0; bis < num_bis; bis++) {
+    const Job& job = jobs_[bis];
+    /* The clock is monotonic, but the caller may stamp the arrival after the
+     * fact */
+    const uint64_t latency_us =
+        job.done_us > arrival_us ? job.done_us - arrival_us : 0;
+    BisStats& stats = stats_[bis];
+
+    stats.sdus++;
+    frame_us = std::max(frame_us, latency_us);
+    if (latency_us > (uint64_t)dt_us_) stats.late_sdus++;
+
+    if (job.status != 0) {
+      LOG_ERROR("Encoding error=%d", job.status);
+      stats.missed_sdus++;
+      osi_free(sdus[bis]);
+      sdus[bis] = nullptr;
+    }
+  }
+  latency_.Add(frame_us);
+}
+
+void BisEncoder::Dump(std::stringstream& stream) const {
+  stream << "    LC3 encoder threads: " << NumThreads() + 1
+         << ", frame latency: " << latency_.ToString() << "\n";
+  for (size_t bis = 0; bis < stats_.size(); bis++) {
+    stream << "      BIS #" << bis << " SDUs: " << stats_[bis].sdus
+           << ", late: " << stats_[bis].late_sdus
+           << ", missed: " << stats_[bis].missed_sdus << "\n";
+  }
+}
+
+}  // namespace broadcaster
+}  // namespace le_audio
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include "bta/le_audio/codec_worker_pool.h"
+#include "embdrv/lc3/include/lc3.h"
+#include "stack/include/bt_hdr.h"
+
+namespace le_audio {
+namespace broadcaster {
+
+/* Encodes the audio of all the BISes of a broadcast, one LC3 channel per BIS,
+ * spreading the channels over a fixed pool of worker threads. Each channel is
+ * encoded straight into the ISO SDU handed to the ISO manager.
+ *
+ * Every frame is due one SDU interval after its PCM samples arrived. SDUs done
+ * after that are counted as late but still sent, it is up to the controller to
+ * flush what it cannot transmit in time. Only the SDUs which could not be
+ * encoded are dropped, and counted as missed.
+ */
+class BisEncoder {
+ public:
+  struct BisStats {
+    uint64_t sdus = 0;
+    uint64_t late_sdus = 0;
+    uint64_t missed_sdus = 0;
+  };
+
+  BisEncoder() = default;
+  BisEncoder(const BisEncoder&) = delete;
+  BisEncoder& operator=(const BisEncoder&) = delete;
+
+  /* Sets up |num_bis| 16 bit PCM encoders and |num_threads| worker threads on
+   * top of the calling one. Statistics are reset. */
+  void Configure(uint8_t num_bis, int dt_us, int sr_hz, uint16_t sdu_size,
+                 size_t num_threads);
+
+  /* Encodes one frame of interleaved PCM samples, one channel per BIS, which
+   * arrived at |arrival_us| on the boottime clock. The returned SDUs are owned
+   * by the caller; missed ones are null. */
+  void Encode(const std::vector<uint8_t>& data, uint64_t arrival_us,
+              std::vector<BT_HDR*>& sdus);
+
+  uint8_t NumBis() const { return encoders_.size(); }
+  size_t NumThreads() const { return workers_ ? workers_->NumThreads() : 0; }
+  const std::vector<BisStats>& GetStats() const { return stats_; }
+
+  void Dump(std::stringstream& stream) const;
+
+ private:
+  struct Job {
+    lc3_encoder_t encoder;
+    const int16_t* pcm;
+    int stride;
+    uint8_t* out;
+    int nbytes;
+    uint64_t done_us;
+    int status;
+  };
+
+  static void RunJob(size_t index, void* context);
+
+  std::vector<lc3_encoder_t> encoders_;
+  std::vector<std::unique_ptr<void, decltype(&std::free)>> encoders_mem_;
+  std::vector<Job> jobs_;
+  std::vector<BisStats> stats_;
+  std::unique_ptr<CodecWorkerPool> workers_;
+  CodecLatencyStats latency_;
+
+  int dt_us_ = 0;
+  size_t frame_samples_ = 0;
+  uint16_t sdu_size_ = 0;
+};
+
+}  // namespace broadcaster
+}  // namespace le_audio
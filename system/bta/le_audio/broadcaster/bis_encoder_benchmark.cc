@@ -0,0 +1,98 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "bta/le_audio/broadcaster/bis_encoder.h"
+#include "common/time_util.h"
+#include "osi/include/allocator.h"
+
+using ::benchmark::State;
+using le_audio::broadcaster::BisEncoder;
+
+namespace {
+
+// 48_2 broadcast audio: 48 kHz, 10 ms frames of 100 octets per BIS
+constexpr int kDataIntervalUs = 10000;
+constexpr int kSampleRateHz = 48000;
+constexpr uint16_t kSduSize = 100;
+constexpr size_t kFrameSamples = 480;
+
+// Encodes the frames of a broadcast with range(0) BISes, with range(1)
+// worker threads on top of the calling one, and hands the SDUs over as the
+// broadcaster does.
+void BM_BisEncode(State& state) {
+  const uint8_t num_bis = state.range(0);
+  const size_t num_threads = state.range(1);
+
+  BisEncoder encoder;
+  encoder.Configure(num_bis, kDataIntervalUs, kSampleRateHz, kSduSize,
+                    num_threads);
+
+  // A tone which differs per BIS, so that the encoders do some real work
+  std::vector<uint8_t> data(num_bis * kFrameSamples * sizeof(int16_t));
+  int16_t* samples = (int16_t*)data.data();
+  for (size_t i = 0; i < kFrameSamples; i++) {
+    for (uint8_t bis = 0; bis < num_bis; bis++) {
+      samples[i * num_bis + bis] =
+          8000 * std::sin(2 * M_PI * 440 * (bis + 1) * i / kSampleRateHz);
+    }
+  }
+
+  std::vector<BT_HDR*> sdus;
+  for (auto _ : state) {
+    encoder.Encode(data, bluetooth::common::time_get_os_boottime_us(), sdus);
+    for (auto p_sdu : sdus) osi_free(p_sdu);
+  }
+
+  uint64_t late_sdus = 0;
+  uint64_t missed_sdus = 0;
+  for (auto const& stats : encoder.GetStats()) {
+    late_sdus += stats.late_sdus;
+    missed_sdus += stats.missed_sdus;
+  }
+  state.SetItemsProcessed(state.iterations() * num_bis);
+  state.counters["late_sdus"] = late_sdus;
+  state.counters["missed_sdus"] = missed_sdus;
+  // Share of the SDU interval the frame takes to encode
+  state.counters["interval_load"] = ::benchmark::Counter(
+      state.iterations() * kDataIntervalUs * 1e-6,
+      ::benchmark::Counter::kIsRate | ::benchmark::Counter::kInvert);
+}
+
+void BisAndThreads(::benchmark::internal::Benchmark* benchmark) {
+  for (int num_bis = 1; num_bis <= 8; num_bis++) {
+    benchmark->Args({num_bis, 0});
+    if (num_bis > 1) benchmark->Args({num_bis, std::min(num_bis - 1, 3)});
+  }
+}
+
+BENCHMARK(BM_BisEncode)->Apply(BisAndThreads)->UseRealTime();
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bta/le_audio/broadcaster/bis_encoder.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+#include "common/time_util.h"
+#include "osi/include/allocator.h"
+#include "stack/include/btm_iso_api_types.h"
+
+using bluetooth::hci::iso_manager::kIsoSduOffset;
+using le_audio::broadcaster::BisEncoder;
+
+namespace {
+
+constexpr int kDataIntervalUs = 10000;
+constexpr int kSampleRateHz = 48000;
+constexpr uint16_t kSduSize = 100;
+constexpr size_t kFrameSamples = 480;
+
+uint64_t Now() { return bluetooth::common::time_get_os_boottime_us(); }
+
+class BisEncoderTest : public ::testing::TestWithParam<size_t> {
+ protected:
+  void TearDown() override {
+    for (auto p_sdu : sdus_) osi_free(p_sdu);
+  }
+
+  BisEncoder encoder_;
+  std::vector<BT_HDR*> sdus_;
+};
+
+TEST_P(BisEncoderTest, EncodesEveryBis) {
+  const size_t num_threads = GetParam();
+  for (uint8_t num_bis : {1, 2, 4, 8}) {
+    encoder_.Configure(num_bis, kDataIntervalUs, kSampleRateHz, kSduSize,
+                       num_threads);
+    ASSERT_EQ(encoder_.NumBis(), num_bis);
+    ASSERT_EQ(encoder_.NumThreads(), num_threads);
+
+    std::vector<uint8_t> data(num_bis * kFrameSamples * sizeof(int16_t), 0);
+    encoder_.Encode(data, Now(), sdus_);
+
+    ASSERT_EQ(sdus_.size(), num_bis);
+    for (auto& p_sdu : sdus_) {
+      ASSERT_NE(p_sdu, nullptr);
+      ASSERT_EQ(p_sdu->offset, kIsoSduOffset);
+      ASSERT_EQ(p_sdu->len, kSduSize);
+      osi_free_and_reset((void**)&p_sdu);
+    }
+
+    auto const& stats = encoder_.GetStats();
+    ASSERT_EQ(stats.size(), num_bis);
+    for (auto const& bis_stats : stats) {
+      ASSERT_EQ(bis_stats.sdus, 1u);
+      ASSERT_EQ(bis_stats.missed_sdus, 0u);
+    }
+  }
+}
+
+TEST_P(BisEncoderTest, SameAudioSameSdus) {
+  encoder_.Configure(2, kDataIntervalUs, kSampleRateHz, kSduSize, GetParam());
+
+  // Both channels carry the same samples
+  std::vector<uint8_t> data(2 * kFrameSamples * sizeof(int16_t));
+  for (size_t i = 0; i < data.size(); i += 4) {
+    data[i] = data[i + 2] = i / 4;
+  }
+  encoder_.Encode(data, Now(), sdus_);
+
+  ASSERT_EQ(sdus_.size(), 2u);
+  ASSERT_EQ(memcmp(sdus_[0]->data + sdus_[0]->offset,
+                   sdus_[1]->data + sdus_[1]->offset, kSduSize),
+            0);
+}
+
+TEST_P(BisEncoderTest, LateSdusAreSent) {
+  encoder_.Configure(2, kDataIntervalUs, kSampleRateHz, kSduSize, GetParam());
+
+  std::vector<uint8_t> data(2 * kFrameSamples * sizeof(int16_t), 0);
+  // Samples which arrived three SDU intervals ago
+  encoder_.Encode(data, Now() - 3 * kDataIntervalUs, sdus_);
+
+  ASSERT_EQ(sdus_.size(), 2u);
+  for (auto p_sdu : sdus_) ASSERT_NE(p_sdu, nullptr);
+  for (auto const& bis_stats : encoder_.GetStats()) {
+    ASSERT_EQ(bis_stats.sdus, 1u);
+    ASSERT_EQ(bis_stats.late_sdus, 1u);
+    ASSERT_EQ(bis_stats.missed_sdus, 0u);
+  }
+}
+
+TEST_P(BisEncoderTest, MissingSamples) {
+  encoder_.Configure(2, kDataIntervalUs, kSampleRateHz, kSduSize, GetParam());
+
+  std::vector<uint8_t> data(kFrameSamples * sizeof(int16_t), 0);
+  encoder_.Encode(data, Now(), sdus_);
+
+  ASSERT_TRUE(sdus_.empty());
+}
+
+INSTANTIATE_TEST_SUITE_P(EncoderThreads, BisEncoderTest,
+                         ::testing::Values(0, 1, 3));
+
+}  // namespace
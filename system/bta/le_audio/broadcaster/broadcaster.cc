@@ -17,15 +17,21 @@
 
 #include <base/bind.h>
 
+#include <algorithm>
+#include <thread>
+
 #include "bta/include/bta_le_audio_api.h"
 #include "bta/include/bta_le_audio_broadcaster_api.h"
+#include "bta/le_audio/broadcaster/bis_encoder.h"
 #include "bta/le_audio/broadcaster/state_machine.h"
 #include "bta/le_audio/le_audio_types.h"
 #include "bta/le_audio/le_audio_utils.h"
+#include "common/time_util.h"
 #include "device/include/controller.h"
 #include "embdrv/lc3/include/lc3.h"
 #include "gd/common/strings.h"
 #include "internal_include/stack_config.h"
+#include "osi/include/allocator.h"
 #include "osi/include/log.h"
 #include "osi/include/properties.h"
 #include "stack/include/btm_api_types.h"
@@ -42,6 +48,7 @@ using le_audio::CodecManager;
 using le_audio::LeAudioCodecConfiguration;
 using le_audio::LeAudioSourceAudioHalClient;
 using le_audio::broadcaster::BigConfig;
+using le_audio::broadcaster::BisEncoder;
 using le_audio::broadcaster::BroadcastCodecWrapper;
 using le_audio::broadcaster::BroadcastQosConfig;
 using le_audio::broadcaster::BroadcastStateMachine;
@@ -603,6 +610,7 @@ class LeAudioBroadcasterImpl : public LeAudioBroadcaster, public BigCallbacks {
     std::stringstream stream;
 
     stream << "    Number of broadcasts: " << broadcasts_.size() << "\n";
+    audio_receiver_.Dump(stream);
     for (auto& broadcast_pair : broadcasts_) {
       auto& broadcast = broadcast_pair.second;
       if (broadcast) stream << *broadcast;
@@ -738,28 +746,33 @@ class LeAudioBroadcasterImpl : public LeAudioBroadcaster, public BigCallbacks {
         return;
       }
 
-      if (enc_audio_buffers_.size() != codec_wrapper_.GetNumChannels()) {
-        enc_audio_buffers_.resize(codec_wrapper_.GetNumChannels());
-      }
-
-      const int dt_us = codec_wrapper_.GetDataIntervalUs();
-      const int sr_hz = codec_wrapper_.GetSampleRate();
-      const auto encoder_bytes = lc3_encoder_size(dt_us, sr_hz);
-      const auto channel_bytes = codec_wrapper_.GetMaxSduSizePerChannel();
+      const auto num_channels = codec_wrapper_.GetNumChannels();
 
       /* TODO: We should act smart and reuse current configurations */
-      encoders_.clear();
-      encoders_mem_.clear();
-      while (encoders_.size() < codec_wrapper_.GetNumChannels()) {
-        auto& encoder_buf = enc_audio_buffers_.at(encoders_.size());
-        encoder_buf.resize(channel_bytes);
-
-        encoders_mem_.emplace_back(malloc(encoder_bytes), &std::free);
-        encoders_.emplace_back(
-            lc3_setup_encoder(dt_us, sr_hz, 0, encoders_mem_.back().get()));
+      bis_encoder_.Configure(num_channels, codec_wrapper_.GetDataIntervalUs(),
+                             codec_wrapper_.GetSampleRate(),
+                             codec_wrapper_.GetMaxSduSizePerChannel(),
+                             GetNumEncoderThreads(num_channels));
+    }
+
+    /* BISes are encoded on the calling thread only, unless parallel encoding
+     * is enabled. It then uses up to one worker thread per additional BIS,
+     * unless set otherwise */
+    static size_t GetNumEncoderThreads(uint8_t num_channels) {
+      if (!osi_property_get_bool(kParallelEncodeProp, false)) return 0;
+
+      int32_t num_threads = osi_property_get_int32(kEncoderThreadsProp, -1);
+      if (num_threads >= 0) {
+        return std::min<size_t>(num_threads, kMaxEncoderThreads);
       }
+
+      size_t num_cpus = std::max(1u, std::thread::hardware_concurrency());
+      size_t num_threads_needed = std::max(1u, (unsigned)num_channels) - 1;
+      return std::min({num_threads_needed, num_cpus - 1, kMaxEncoderThreads});
     }
 
+    void Dump(std::stringstream& stream) const { bis_encoder_.Dump(stream); }
+
     const BroadcastCodecWrapper& getCurrentCodecConfig(void) const {
       return codec_wrapper_;
     }
@@ -768,23 +781,11 @@ class LeAudioBroadcasterImpl : public LeAudioBroadcaster, public BigCallbacks {
       codec_wrapper_ = config;
     }
 
-    void encodeLc3Channel(lc3_encoder_t encoder,
-                          std::vector<uint8_t>& out_buffer,
-                          const std::vector<uint8_t>& data,
-                          int initial_channel_offset, int pitch_samples,
-                          int num_channels) {
-      auto encoder_status =
-          lc3_encode(encoder, LC3_PCM_FORMAT_S16,
-                     (int16_t*)(data.data() + initial_channel_offset),
-                     pitch_samples, out_buffer.size(), out_buffer.data());
-      if (encoder_status != 0) {
-        LOG_ERROR("Encoding error=%d", encoder_status);
-      }
-    }
-
+    /* Hands the SDUs over to the ISO manager when |last_receiver| is set,
+     * sends copies of them otherwise */
     static void sendBroadcastData(
         const std::unique_ptr<BroadcastStateMachine>& broadcast,
-        std::vector<std::vector<uint8_t>>& encoded_channels) {
+        std::vector<BT_HDR*>& sdus, bool last_receiver) {
       auto const& config = broadcast->GetBigConfig();
       if (config == std::nullopt) {
         LOG_ERROR(
@@ -795,44 +796,62 @@ class LeAudioBroadcasterImpl : public LeAudioBroadcaster, public BigCallbacks {
         return;
       }
 
-      if (config->connection_handles.size() < encoded_channels.size()) {
+      if (config->connection_handles.size() < sdus.size()) {
         LOG_ERROR("Not enough BIS'es to broadcast all channels!");
         return;
       }
 
-      for (uint8_t chan = 0; chan < encoded_channels.size(); ++chan) {
-        IsoManager::GetInstance()->SendIsoData(config->connection_handles[chan],
-                                               encoded_channels[chan].data(),
-                                               encoded_channels[chan].size());
+      for (uint8_t chan = 0; chan < sdus.size(); ++chan) {
+        BT_HDR* p_sdu = sdus[chan];
+        /* Missed the deadline */
+        if (p_sdu == nullptr) continue;
+
+        if (last_receiver) {
+          sdus[chan] = nullptr;
+        } else {
+          size_t sdu_bytes = sizeof(BT_HDR) + p_sdu->offset + p_sdu->len;
+          p_sdu = (BT_HDR*)osi_malloc(sdu_bytes);
+          memcpy(p_sdu, sdus[chan], sdu_bytes);
+        }
+        IsoManager::GetInstance()->SendIsoSdu(config->connection_handles[chan],
+                                              p_sdu);
       }
     }
 
     virtual void OnAudioDataReady(const std::vector<uint8_t>& data) override {
       if (!instance) return;
 
-      LOG_VERBOSE("Received %zu bytes.", data.size());
+      /* The HAL client hands the frames over as soon as it has read them */
+      const uint64_t arrival_us = bluetooth::common::time_get_os_boottime_us();
 
-      /* Constants for the channel data configuration */
-      const auto num_channels = codec_wrapper_.GetNumChannels();
-      const auto bytes_per_sample = (codec_wrapper_.GetBitsPerSample() / 8);
+      LOG_VERBOSE("Received %zu bytes.", data.size());
 
       /* Prepare encoded data for all channels */
-      for (uint8_t chan = 0; chan < num_channels; ++chan) {
-        /* TODO: Use encoder agnostic wrapper */
-        encodeLc3Channel(encoders_[chan], enc_audio_buffers_[chan], data,
-                         chan * bytes_per_sample, num_channels, num_channels);
-      }
+      bis_encoder_.Encode(data, arrival_us, bis_sdus_);
 
       /* Currently there is no way to broadcast multiple distinct streams.
        * We just receive all system sounds mixed into a one stream and each
        * broadcast gets the same data.
        */
-      for (auto& broadcast_pair : instance->broadcasts_) {
+      auto is_receiving = [](const auto& broadcast_pair) {
         auto& broadcast = broadcast_pair.second;
-        if ((broadcast->GetState() ==
-             BroadcastStateMachine::State::STREAMING) &&
-            !broadcast->IsMuted())
-          sendBroadcastData(broadcast, enc_audio_buffers_);
+        return (broadcast->GetState() ==
+                BroadcastStateMachine::State::STREAMING) &&
+               !broadcast->IsMuted();
+      };
+      auto num_receivers = std::count_if(instance->broadcasts_.begin(),
+                                         instance->broadcasts_.end(),
+                                         is_receiving);
+      for (auto& broadcast_pair : instance->broadcasts_) {
+        if (is_receiving(broadcast_pair))
+          sendBroadcastData(broadcast_pair.second, bis_sdus_,
+                            --num_receivers == 0);
+      }
+
+      /* SDUs nobody took */
+      for (auto& p_sdu : bis_sdus_) {
+        if (p_sdu) osi_free(p_sdu);
+        p_sdu = nullptr;
       }
       LOG_VERBOSE("All data sent.");
     }
@@ -882,10 +901,15 @@ class LeAudioBroadcasterImpl : public LeAudioBroadcaster, public BigCallbacks {
     }
 
    private:
+    static constexpr char kParallelEncodeProp[] =
+        "persist.bluetooth.leaudio.parallel_encode";
+    static constexpr char kEncoderThreadsProp[] =
+        "persist.bluetooth.leaudio.broadcaster.encoder_threads";
+    static constexpr size_t kMaxEncoderThreads = 3;
+
     BroadcastCodecWrapper codec_wrapper_;
-    std::vector<lc3_encoder_t> encoders_;
-    std::vector<std::unique_ptr<void, decltype(&std::free)>> encoders_mem_;
-    std::vector<std::vector<uint8_t>> enc_audio_buffers_;
+    BisEncoder bis_encoder_;
+    std::vector<BT_HDR*> bis_sdus_;
   } audio_receiver_;
 
   bluetooth::le_audio::LeAudioBroadcasterCallbacks* callbacks_;
@@ -34,6 +34,7 @@
 #include "btm_iso_api.h"
 #include "client_parser.h"
 #include "codec_manager.h"
+#include "codec_worker_pool.h"
 #include "common/time_util.h"
 #include "content_control_id_keeper.h"
 #include "device/include/controller.h"
@@ -46,6 +47,7 @@
 #include "le_audio_types.h"
 #include "le_audio_utils.h"
 #include "metrics_collector.h"
+#include "osi/include/allocator.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
 #include "osi/include/properties.h"
@@ -63,6 +65,7 @@ using bluetooth::hci::IsoManager;
 using bluetooth::hci::iso_manager::cig_create_cmpl_evt;
 using bluetooth::hci::iso_manager::cig_remove_cmpl_evt;
 using bluetooth::hci::iso_manager::CigCallbacks;
+using bluetooth::hci::iso_manager::kIsoSduOffset;
 using bluetooth::le_audio::ConnectionState;
 using bluetooth::le_audio::GroupNodeStatus;
 using bluetooth::le_audio::GroupStatus;
@@ -178,6 +181,36 @@ inline lc3_pcm_format bits_to_lc3_bits(uint8_t bits_per_sample) {
 
 class LeAudioClientImpl;
 LeAudioClientImpl* instance;
+
+/* Encoding of one audio channel of a frame, which can run on a codec worker */
+struct Lc3EncodeJob {
+  lc3_encoder_t encoder;
+  lc3_pcm_format bits_per_sample;
+  const uint8_t* pcm;
+  int stride;
+  int nbytes;
+  uint8_t* out;
+};
+
+void RunLc3EncodeJob(size_t index, void* context) {
+  Lc3EncodeJob* job = static_cast<Lc3EncodeJob*>(context) + index;
+  int err = lc3_encode(job->encoder, job->bits_per_sample, job->pcm,
+                       job->stride, job->nbytes, job->out);
+  if (err < 0) {
+    LOG(ERROR) << " error while encoding, error code: " << +err;
+  }
+}
+
+/* SDU of |len| bytes to be encoded in place and handed over to the ISO
+ * manager as it is */
+BT_HDR* AllocateIsoSdu(uint16_t len) {
+  BT_HDR* p_sdu = (BT_HDR*)osi_malloc(sizeof(BT_HDR) + kIsoSduOffset + len);
+  p_sdu->offset = kIsoSduOffset;
+  p_sdu->len = len;
+  p_sdu->event = 0;
+  p_sdu->layer_specific = 0;
+  return p_sdu;
+}
 LeAudioSourceAudioHalClient::Callbacks* audioSinkReceiver;
 LeAudioSinkAudioHalClient::Callbacks* audioSourceReceiver;
 CigCallbacks* stateMachineHciCallbacks;
@@ -2508,9 +2541,8 @@ class LeAudioClientImpl : public LeAudioClient {
   }
 
   // mix stero signal into mono
-  std::vector<uint8_t> mono_blend(const std::vector<uint8_t>& buf,
-                                  int bytes_per_sample, size_t frames) {
-    std::vector<uint8_t> mono_out;
+  void mono_blend(const std::vector<uint8_t>& buf, int bytes_per_sample,
+                  size_t frames, std::vector<uint8_t>& mono_out) {
     mono_out.resize(frames * bytes_per_sample);
 
     if (bytes_per_sample == 2) {
@@ -2536,7 +2568,19 @@ class LeAudioClientImpl : public LeAudioClient {
     } else {
       LOG_ERROR("Don't know how to mono blend that %d!", bytes_per_sample);
     }
-    return mono_out;
+  }
+
+  /* Encodes the channels of a frame, in parallel when codec workers are
+   * enabled */
+  void EncodeLc3Channels(Lc3EncodeJob* jobs, size_t num_jobs) {
+    uint64_t start_us = bluetooth::common::time_get_os_boottime_us();
+    if (lc3_codec_workers_ && num_jobs > 1) {
+      lc3_codec_workers_->Run(num_jobs, RunLc3EncodeJob, jobs);
+    } else {
+      for (size_t i = 0; i < num_jobs; i++) RunLc3EncodeJob(i, jobs);
+    }
+    lc3_encode_latency_.Add(bluetooth::common::time_get_os_boottime_us() -
+                            start_us);
   }
 
   void PrepareAndSendToTwoCises(
@@ -2572,41 +2616,51 @@ class LeAudioClientImpl : public LeAudioClient {
       return;
     }
 
-    std::vector<uint8_t> chan_left_enc(byte_count, 0);
-    std::vector<uint8_t> chan_right_enc(byte_count, 0);
-
     bool mono = (left_cis_handle == 0) || (right_cis_handle == 0);
 
-    if (!mono) {
-      lc3_encode(lc3_encoder_left, bits_per_sample, data.data(), 2,
-                 chan_left_enc.size(), chan_left_enc.data());
-      lc3_encode(lc3_encoder_right, bits_per_sample,
-                 data.data() + bytes_per_sample, 2, chan_right_enc.size(),
-                 chan_right_enc.data());
-    } else {
-      std::vector<uint8_t> mono = mono_blend(
-          data, bytes_per_sample, number_of_required_samples_per_channel);
-      if (left_cis_handle) {
-        lc3_encode(lc3_encoder_left, bits_per_sample, mono.data(), 1,
-                   chan_left_enc.size(), chan_left_enc.data());
-      }
-
-      if (right_cis_handle) {
-        lc3_encode(lc3_encoder_right, bits_per_sample, mono.data(), 1,
-                   chan_right_enc.size(), chan_right_enc.data());
-      }
-    }
+    /* Channels are encoded straight into the SDUs sent to the controller */
+    BT_HDR* left_sdu = left_cis_handle ? AllocateIsoSdu(byte_count) : nullptr;
+    BT_HDR* right_sdu = right_cis_handle ? AllocateIsoSdu(byte_count) : nullptr;
+
+    Lc3EncodeJob jobs[2];
+    size_t num_jobs = 0;
+    const uint8_t* left_pcm = data.data();
+    const uint8_t* right_pcm = data.data() + bytes_per_sample;
+    int stride = 2;
+
+    if (mono) {
+      mono_blend(data, bytes_per_sample, number_of_required_samples_per_channel,
+                 lc3_mono_pcm_);
+      left_pcm = right_pcm = lc3_mono_pcm_.data();
+      stride = 1;
+    }
+
+    if (left_sdu) {
+      jobs[num_jobs++] = {lc3_encoder_left,
+                          bits_per_sample,
+                          left_pcm,
+                          stride,
+                          byte_count,
+                          left_sdu->data + left_sdu->offset};
+    }
+    if (right_sdu) {
+      jobs[num_jobs++] = {lc3_encoder_right,
+                          bits_per_sample,
+                          right_pcm,
+                          stride,
+                          byte_count,
+                          right_sdu->data + right_sdu->offset};
+    }
+    EncodeLc3Channels(jobs, num_jobs);
 
     DLOG(INFO) << __func__ << " left_cis_handle: " << +left_cis_handle
                << " right_cis_handle: " << right_cis_handle;
     /* Send data to the controller */
     if (left_cis_handle)
-      IsoManager::GetInstance()->SendIsoData(
-          left_cis_handle, chan_left_enc.data(), chan_left_enc.size());
+      IsoManager::GetInstance()->SendIsoSdu(left_cis_handle, left_sdu);
 
     if (right_cis_handle)
-      IsoManager::GetInstance()->SendIsoData(
-          right_cis_handle, chan_right_enc.data(), chan_right_enc.size());
+      IsoManager::GetInstance()->SendIsoSdu(right_cis_handle, right_sdu);
   }
 
   void PrepareAndSendToSingleCis(
@@ -2630,31 +2684,32 @@ class LeAudioClientImpl : public LeAudioClient {
       LOG(ERROR) << __func__ << "Missing samples";
       return;
     }
-    std::vector<uint8_t> chan_encoded(num_channels * byte_count, 0);
+    /* Channels are encoded straight into the SDU sent to the controller */
+    BT_HDR* sdu = AllocateIsoSdu(num_channels * byte_count);
+    uint8_t* chan_encoded = sdu->data + sdu->offset;
 
     if (num_channels == 1) {
       /* Since we always get two channels from framework, lets make it mono here
        */
-      std::vector<uint8_t> mono = mono_blend(
-          data, bytes_per_sample, number_of_required_samples_per_channel);
-
-      auto err = lc3_encode(lc3_encoder_left, bits_per_sample, mono.data(), 1,
-                            byte_count, chan_encoded.data());
+      mono_blend(data, bytes_per_sample, number_of_required_samples_per_channel,
+                 lc3_mono_pcm_);
 
-      if (err < 0) {
-        LOG(ERROR) << " error while encoding, error code: " << +err;
-      }
+      Lc3EncodeJob job = {lc3_encoder_left, bits_per_sample,
+                          lc3_mono_pcm_.data(), 1,
+                          byte_count,       chan_encoded};
+      EncodeLc3Channels(&job, 1);
     } else {
-      lc3_encode(lc3_encoder_left, bits_per_sample, (const int16_t*)data.data(),
-                 2, byte_count, chan_encoded.data());
-      lc3_encode(lc3_encoder_right, bits_per_sample,
-                 (const int16_t*)data.data() + 1, 2, byte_count,
-                 chan_encoded.data() + byte_count);
+      Lc3EncodeJob jobs[2] = {
+          {lc3_encoder_left, bits_per_sample, data.data(), 2, byte_count,
+           chan_encoded},
+          {lc3_encoder_right, bits_per_sample, data.data() + bytes_per_sample,
+           2, byte_count, chan_encoded + byte_count},
+      };
+      EncodeLc3Channels(jobs, 2);
     }
 
     /* Send data to the controller */
-    IsoManager::GetInstance()->SendIsoData(cis_handle, chan_encoded.data(),
-                                           chan_encoded.size());
+    IsoManager::GetInstance()->SendIsoSdu(cis_handle, sdu);
   }
 
   const struct le_audio::stream_configuration* GetStreamSinkConfiguration(
@@ -2768,7 +2823,10 @@ class LeAudioClientImpl : public LeAudioClient {
       return;
     }
 
-    std::vector<int16_t> pcm_data_decoded(pcm_size, 0);
+    /* Decoded into a buffer kept across frames, which is swapped with the
+     * cached channel data rather than copied */
+    std::vector<int16_t>& pcm_data_decoded = lc3_decoded_pcm_;
+    pcm_data_decoded.assign(pcm_size, 0);
 
     int err = 0;
 
@@ -2783,8 +2841,11 @@ class LeAudioClientImpl : public LeAudioClient {
     lc3_decoder_t decoder_to_use =
         is_left ? lc3_decoder_left : lc3_decoder_right;
 
+    uint64_t start_us = bluetooth::common::time_get_os_boottime_us();
     err = lc3_decode(decoder_to_use, data, size, bits_per_sample,
                      pcm_data_decoded.data(), 1 /* pitch */);
+    lc3_decode_latency_.Add(bluetooth::common::time_get_os_boottime_us() -
+                            start_us);
 
     if (err < 0) {
       LOG(ERROR) << " bad decoding parameters: " << static_cast<int>(err);
@@ -2805,7 +2866,7 @@ class LeAudioClientImpl : public LeAudioClient {
     if (cached_channel_timestamp_ == 0 && cached_channel_data_.empty()) {
       /* First packet received, cache it. We need both channel data to send it
        * to AF. */
-      cached_channel_data_ = pcm_data_decoded;
+      cached_channel_data_.swap(pcm_data_decoded);
       cached_channel_timestamp_ = timestamp;
       cached_channel_is_left_ = is_left;
       return;
@@ -2842,7 +2903,7 @@ class LeAudioClientImpl : public LeAudioClient {
                           &cached_channel_data_);
       }
 
-      cached_channel_data_ = pcm_data_decoded;
+      cached_channel_data_.swap(pcm_data_decoded);
       cached_channel_timestamp_ = timestamp;
       cached_channel_is_left_ = is_left;
       return;
@@ -2861,7 +2922,7 @@ class LeAudioClientImpl : public LeAudioClient {
     }
 
     /* Cache the data in case 2nd channel connects */
-    cached_channel_data_ = pcm_data_decoded;
+    cached_channel_data_.swap(pcm_data_decoded);
     cached_channel_timestamp_ = timestamp;
     cached_channel_is_left_ = is_left;
   }
@@ -2892,7 +2953,8 @@ class LeAudioClientImpl : public LeAudioClient {
        * Here we handle stream without checking bt_got_stereo flag.
        */
       const size_t mono_size = left ? left->size() : right->size();
-      std::vector<uint16_t> mixed(mono_size * 2);
+      std::vector<uint16_t>& mixed = af_mixed_pcm_;
+      mixed.resize(mono_size * 2);
 
       for (size_t i = 0; i < mono_size; i++) {
         mixed[2 * i] = left ? (*left)[i] : (*right)[i];
@@ -2959,6 +3021,14 @@ class LeAudioClientImpl : public LeAudioClient {
           lc3_setup_encoder(dt_us, sr_hz, af_hz, lc3_encoder_left_mem);
       lc3_encoder_right =
           lc3_setup_encoder(dt_us, sr_hz, af_hz, lc3_encoder_right_mem);
+
+      /* Left and right channels are encoded at once, one of them on the
+       * worker */
+      if (!lc3_codec_workers_ &&
+          osi_property_get_bool(kParallelEncodeProp, false)) {
+        lc3_codec_workers_ = std::make_unique<le_audio::CodecWorkerPool>(1);
+      }
+      lc3_encode_latency_.Reset();
     }
 
     le_audio_source_hal_client_->UpdateRemoteDelay(remote_delay_ms);
@@ -3024,6 +3094,7 @@ class LeAudioClientImpl : public LeAudioClient {
           lc3_setup_decoder(dt_us, sr_hz, af_hz, lc3_decoder_left_mem);
       lc3_decoder_right =
           lc3_setup_decoder(dt_us, sr_hz, af_hz, lc3_decoder_right_mem);
+      lc3_decode_latency_.Reset();
     }
     le_audio_sink_hal_client_->UpdateRemoteDelay(remote_delay_ms);
     le_audio_sink_hal_client_->ConfirmStreamingRequest();
@@ -3039,6 +3110,7 @@ class LeAudioClientImpl : public LeAudioClient {
   void SuspendAudio(void) {
     CancelStreamingRequest();
 
+    lc3_codec_workers_.reset();
     if (lc3_encoder_left_mem) {
       free(lc3_encoder_left_mem);
       lc3_encoder_left_mem = nullptr;
@@ -3120,6 +3192,10 @@ class LeAudioClientImpl : public LeAudioClient {
       dprintf(fd, ", %d ms", static_cast<int>(t));
     }
     dprintf(fd, "\n");
+    dprintf(fd, "    LC3 encode latency: %s\n",
+            lc3_encode_latency_.ToString().c_str());
+    dprintf(fd, "    LC3 decode latency: %s\n",
+            lc3_decode_latency_.ToString().c_str());
     printCurrentStreamConfiguration(fd);
     dprintf(fd, "  ----------------\n ");
     dprintf(fd, "  LE Audio Groups:\n");
@@ -4420,13 +4496,24 @@ class LeAudioClientImpl : public LeAudioClient {
   lc3_decoder_t lc3_decoder_left;
   lc3_decoder_t lc3_decoder_right;
 
-  std::vector<uint8_t> encoded_data;
+  /* Codec scratch buffers, kept across frames not to allocate on the audio
+   * path */
+  std::vector<uint8_t> lc3_mono_pcm_;
+  std::vector<int16_t> lc3_decoded_pcm_;
+  std::vector<uint16_t> af_mixed_pcm_;
+
+  std::unique_ptr<le_audio::CodecWorkerPool> lc3_codec_workers_;
+  le_audio::CodecLatencyStats lc3_encode_latency_;
+  le_audio::CodecLatencyStats lc3_decode_latency_;
+
   std::unique_ptr<LeAudioSourceAudioHalClient> le_audio_source_hal_client_;
   std::unique_ptr<LeAudioSinkAudioHalClient> le_audio_sink_hal_client_;
   static constexpr uint64_t kAudioSuspentKeepIsoAliveTimeoutMs = 5000;
   static constexpr uint64_t kAudioDisableTimeoutMs = 3000;
   static constexpr char kAudioSuspentKeepIsoAliveTimeoutMsProp[] =
       "persist.bluetooth.leaudio.audio.suspend.timeoutms";
+  static constexpr char kParallelEncodeProp[] =
+      "persist.bluetooth.leaudio.parallel_encode";
   alarm_t* close_vbc_timeout_;
   alarm_t* suspend_timeout_;
   alarm_t* disable_timer_;
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "codec_worker_pool.h"
+
+#include <algorithm>
+#include <sstream>
+
+namespace le_audio {
+
+CodecWorkerPool::CodecWorkerPool(size_t num_threads) {
+  for (size_t i = 0; i < num_threads; i++) {
+    threads_.emplace_back(&CodecWorkerPool::WorkerMain, this);
+  }
+}
+
+CodecWorkerPool::~CodecWorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+  }
+  work_cv_.notify_all();
+  for (auto& thread : threads_) thread.join();
+}
+
+void CodecWorkerPool::Run(size_t count, Job job, void* context) {
+  if (count == 0) return;
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  job_ = job;
+  context_ = context;
+  count_ = count;
+  next_ = 0;
+  unfinished_ = count;
+  batch_++;
+  if (count > 1) work_cv_.notify_all();
+
+  RunPendingJobs(lock);
+  done_cv_.wait(lock, [this] { return unfinished_ == 0; });
+}
+
+void CodecWorkerPool::RunPendingJobs(std::unique_lock<std::mutex>& lock) {
+  while (next_ < count_) {
+    size_t index = next_++;
+    Job job = job_;
+    void* context = context_;
+
+    lock.unlock();
+    job(index, context);
+    lock.lock();
+
+    if (--unfinished_ == 0) done_cv_.notify_one();
+  }
+}
+
+void CodecWorkerPool::WorkerMain() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  uint64_t last_batch = batch_;
+  while (true) {
+    work_cv_.wait(lock, [this, last_batch] {
+      return shutdown_ || batch_ != last_batch;
+    });
+    if (shutdown_) return;
+
+    last_batch = batch_;
+    RunPendingJobs(lock);
+  }
+}
+
+uint32_t CodecLatencyStats::Percentile(unsigned percent) const {
+  size_t count = std::min<uint64_t>(num_samples_, samples_.size());
+  if (count == 0) return 0;
+
+  std::array<uint32_t, kMaxSamples> sorted;
+  std::copy(samples_.begin(), samples_.begin() + count, sorted.begin());
+  size_t rank = std::min(count - 1, (count * percent) / 100);
+  std::nth_element(sorted.begin(), sorted.begin() + rank,
+                   sorted.begin() + count);
+  return sorted[rank];
+}
+
+std::string CodecLatencyStats::ToString() const {
+  std::stringstream stream;
+  stream << "frames: " << num_samples_;
+  if (num_samples_ != 0) {
+    stream << ", p50: " << Percentile(50) << " us, p90: " << Percentile(90)
+           << " us, p99: " << Percentile(99)
+           << " us, max: " << Percentile(100) << " us";
+  }
+  return stream.str();
+}
+
+}  // namespace le_audio
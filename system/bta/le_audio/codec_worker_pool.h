@@ -0,0 +1,98 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace le_audio {
+
+/* Runs the per channel codec work of an audio frame on the calling thread and
+ * a few worker threads at once. Jobs are plain function pointers with a
+ * context, so that running them does not allocate on the audio path.
+ */
+class CodecWorkerPool {
+ public:
+  using Job = void (*)(size_t index, void* context);
+
+  /* Starts |num_threads| worker threads, on top of the calling thread */
+  explicit CodecWorkerPool(size_t num_threads);
+  ~CodecWorkerPool();
+
+  CodecWorkerPool(const CodecWorkerPool&) = delete;
+  CodecWorkerPool& operator=(const CodecWorkerPool&) = delete;
+
+  /* Runs job(i, context) for each i in [0, count) and returns once all of
+   * them are done */
+  void Run(size_t count, Job job, void* context);
+
+  size_t NumThreads() const { return threads_.size(); }
+
+ private:
+  void WorkerMain();
+  /* Runs jobs of the current batch until none is left. Called and returns
+   * with |mutex_| held. */
+  void RunPendingJobs(std::unique_lock<std::mutex>& lock);
+
+  std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  std::vector<std::thread> threads_;
+
+  Job job_ = nullptr;
+  void* context_ = nullptr;
+  size_t count_ = 0;
+  size_t next_ = 0;
+  size_t unfinished_ = 0;
+  uint64_t batch_ = 0;
+  bool shutdown_ = false;
+};
+
+/* Latency of the last frames processed by a codec, for dumpsys */
+class CodecLatencyStats {
+ public:
+  void Add(uint64_t latency_us) {
+    samples_[num_samples_ % samples_.size()] =
+        static_cast<uint32_t>(std::min<uint64_t>(latency_us, UINT32_MAX));
+    num_samples_++;
+  }
+
+  void Reset() { num_samples_ = 0; }
+
+  uint64_t NumSamples() const { return num_samples_; }
+
+  /* Returns the |percent| percentile of the latencies kept, in us */
+  uint32_t Percentile(unsigned percent) const;
+
+  /* Frame count and p50/p90/p99/max latency, e.g. for dumpsys */
+  std::string ToString() const;
+
+ private:
+  static constexpr size_t kMaxSamples = 1000;
+
+  std::array<uint32_t, kMaxSamples> samples_;
+  uint64_t num_samples_ = 0;
+};
+
+}  // namespace le_audio
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "codec_worker_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace le_audio {
+
+namespace {
+
+struct CountingJobs {
+  std::vector<std::atomic<int>> runs;
+  std::atomic<int> on_worker{0};
+  std::thread::id caller;
+
+  explicit CountingJobs(size_t count) : runs(count) {}
+};
+
+void CountRun(size_t index, void* context) {
+  auto* jobs = static_cast<CountingJobs*>(context);
+  jobs->runs[index]++;
+  if (std::this_thread::get_id() != jobs->caller) jobs->on_worker++;
+}
+
+}  // namespace
+
+TEST(CodecWorkerPoolTest, RunsEveryJobOnce) {
+  CodecWorkerPool pool(1);
+  ASSERT_EQ(pool.NumThreads(), 1u);
+
+  for (size_t count : {1, 2, 5, 16}) {
+    CountingJobs jobs(count);
+    jobs.caller = std::this_thread::get_id();
+    pool.Run(count, CountRun, &jobs);
+    for (size_t i = 0; i < count; i++) {
+      ASSERT_EQ(jobs.runs[i], 1) << "count: " << count << " job: " << i;
+    }
+  }
+}
+
+TEST(CodecWorkerPoolTest, RunsManyBatches) {
+  CodecWorkerPool pool(2);
+  CountingJobs jobs(2);
+  jobs.caller = std::this_thread::get_id();
+
+  for (int i = 0; i < 1000; i++) pool.Run(2, CountRun, &jobs);
+
+  ASSERT_EQ(jobs.runs[0], 1000);
+  ASSERT_EQ(jobs.runs[1], 1000);
+}
+
+TEST(CodecWorkerPoolTest, RunsOnCallerWithoutWorkers) {
+  CodecWorkerPool pool(0);
+  CountingJobs jobs(3);
+  jobs.caller = std::this_thread::get_id();
+
+  pool.Run(3, CountRun, &jobs);
+
+  ASSERT_EQ(jobs.runs[0], 1);
+  ASSERT_EQ(jobs.runs[1], 1);
+  ASSERT_EQ(jobs.runs[2], 1);
+  ASSERT_EQ(jobs.on_worker, 0);
+}
+
+TEST(CodecLatencyStatsTest, Percentiles) {
+  CodecLatencyStats stats;
+  ASSERT_EQ(stats.Percentile(50), 0u);
+  ASSERT_EQ(stats.ToString(), "frames: 0");
+
+  for (uint64_t latency = 100; latency > 0; latency--) stats.Add(latency);
+
+  ASSERT_EQ(stats.NumSamples(), 100u);
+  ASSERT_EQ(stats.Percentile(0), 1u);
+  ASSERT_EQ(stats.Percentile(50), 51u);
+  ASSERT_EQ(stats.Percentile(99), 100u);
+  ASSERT_EQ(stats.Percentile(100), 100u);
+  ASSERT_EQ(stats.ToString(),
+            "frames: 100, p50: 51 us, p90: 91 us, p99: 100 us, max: 100 us");
+
+  stats.Reset();
+  ASSERT_EQ(stats.NumSamples(), 0u);
+}
+
+TEST(CodecLatencyStatsTest, KeepsLastFrames) {
+  CodecLatencyStats stats;
+
+  for (int i = 0; i < 1000; i++) stats.Add(5000);
+  for (int i = 0; i < 1000; i++) stats.Add(10);
+
+  ASSERT_EQ(stats.NumSamples(), 2000u);
+  ASSERT_EQ(stats.Percentile(100), 10u);
+}
+
+}  // namespace le_audio
@@ -29,6 +29,7 @@
 #include "btif_storage.h"
 #include "btm_iso_api.h"
 #include "btm_iso_api_types.h"
+#include "common/time_util.h"
 #include "device/include/controller.h"
 #include "gd/common/strings.h"
 #include "le_audio_set_configuration_provider.h"
@@ -1909,12 +1910,107 @@ bool LeAudioDeviceGroup::IsConfigurationSupported(
   return false;
 }
 
+/* FNV-1a hash of the content of the PAC records */
+static uint64_t HashPacs(const types::PublishedAudioCapabilities& pacs) {
+  uint64_t hash = 0xcbf29ce484222325;
+  auto add = [&hash](const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) hash = (hash ^ data[i]) * 0x100000001b3;
+  };
+  auto add_u16 = [&add](uint16_t value) {
+    uint8_t bytes[] = {(uint8_t)value, (uint8_t)(value >> 8)};
+    add(bytes, sizeof(bytes));
+  };
+
+  for (const auto& [handles, records] : pacs) {
+    add_u16(records.size());
+    for (const auto& record : records) {
+      add(&record.codec_id.coding_format, 1);
+      add_u16(record.codec_id.vendor_company_id);
+      add_u16(record.codec_id.vendor_codec_id);
+      add_u16(record.codec_spec_caps.Size());
+      for (const auto& [type, value] : record.codec_spec_caps.Values()) {
+        add(&type, 1);
+        add_u16(value.size());
+        add(value.data(), value.size());
+      }
+      add_u16(record.metadata.size());
+      add(record.metadata.data(), record.metadata.size());
+    }
+  }
+
+  return hash;
+}
+
+std::vector<uint64_t> LeAudioDeviceGroup::GetConfigurationCacheKey(
+    LeAudioContextType context_type,
+    const set_configurations::AudioSetConfigurations* confs) {
+  std::vector<uint64_t> key = {
+      reinterpret_cast<uintptr_t>(confs),
+      static_cast<uint64_t>(context_type),
+      snk_audio_locations_.to_ulong(),
+  };
+
+  for (const auto& device_iter : leAudioDevices_) {
+    auto device = device_iter.lock();
+    if (!device) {
+      key.push_back(0);
+      continue;
+    }
+
+    uint64_t address = 0;
+    for (auto byte : device->address_.address) address = (address << 8) | byte;
+    bool connected = (device->conn_id_ != GATT_INVALID_CONN_ID);
+    key.push_back(address | (uint64_t)connected << 48);
+    key.push_back(
+        device->GetAvailableContexts().value() |
+        (uint64_t)device->GetAseCount(types::kLeAudioDirectionSink) << 16 |
+        (uint64_t)device->GetAseCount(types::kLeAudioDirectionSource) << 32);
+    key.push_back(device->snk_audio_locations_.to_ulong() |
+                  (uint64_t)device->src_audio_locations_.to_ulong() << 32);
+    key.push_back(HashPacs(device->snk_pacs_));
+    key.push_back(HashPacs(device->src_pacs_));
+  }
+
+  return key;
+}
+
 const set_configurations::AudioSetConfiguration*
 LeAudioDeviceGroup::FindFirstSupportedConfiguration(
     LeAudioContextType context_type) {
   const set_configurations::AudioSetConfigurations* confs =
       AudioSetConfigurationProvider::Get()->GetConfigurations(context_type);
 
+  uint64_t start_us = bluetooth::common::time_get_os_boottime_us();
+  auto key = GetConfigurationCacheKey(context_type, confs);
+
+  auto cached = configuration_cache_.find(context_type);
+  if (cached != configuration_cache_.end() && cached->second.key == key) {
+    configuration_cache_stats_.hits++;
+    configuration_cache_stats_.hit_us +=
+        bluetooth::common::time_get_os_boottime_us() - start_us;
+    LOG_DEBUG("context type: %s, cached: %s",
+              bluetooth::common::ToString(context_type).c_str(),
+              cached->second.conf ? cached->second.conf->name.c_str()
+                                  : "none");
+    return cached->second.conf;
+  }
+
+  auto conf = MatchConfiguration(context_type, confs);
+
+  uint64_t elapsed_us = bluetooth::common::time_get_os_boottime_us() - start_us;
+  configuration_cache_stats_.misses++;
+  configuration_cache_stats_.miss_us += elapsed_us;
+  configuration_cache_stats_.max_miss_us =
+      std::max(configuration_cache_stats_.max_miss_us, elapsed_us);
+  configuration_cache_[context_type] = {std::move(key), conf};
+
+  return conf;
+}
+
+const set_configurations::AudioSetConfiguration*
+LeAudioDeviceGroup::MatchConfiguration(
+    LeAudioContextType context_type,
+    const set_configurations::AudioSetConfigurations* confs) {
   LOG_DEBUG("context type: %s,  number of connected devices: %d",
             bluetooth::common::ToString(context_type).c_str(),
             +NumOfConnected());
@@ -2057,6 +2153,21 @@ void LeAudioDeviceGroup::Dump(int fd, int active_group_id) {
          << "      num of sources(connected): "
          << stream_conf.source_num_of_devices << "("
          << stream_conf.source_streams.size() << ")\n"
+         << "      configuration cache hits(misses): "
+         << configuration_cache_stats_.hits << "("
+         << configuration_cache_stats_.misses << "), hit rate: "
+         << (configuration_cache_stats_.hits * 100 /
+             std::max<uint64_t>(1, configuration_cache_stats_.hits +
+                                       configuration_cache_stats_.misses))
+         << "%\n"
+         << "      configuration selection avg us hit(miss): "
+         << (configuration_cache_stats_.hit_us /
+             std::max<uint64_t>(1, configuration_cache_stats_.hits))
+         << "("
+         << (configuration_cache_stats_.miss_us /
+             std::max<uint64_t>(1, configuration_cache_stats_.misses))
+         << "), max us miss: " << configuration_cache_stats_.max_miss_us
+         << "\n"
          << "      allocated CISes: " << static_cast<int>(cises_.size());
 
   if (cises_.size() > 0) {
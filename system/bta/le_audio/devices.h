@@ -383,6 +383,12 @@ class LeAudioDeviceGroup {
 
   const set_configurations::AudioSetConfiguration*
   FindFirstSupportedConfiguration(types::LeAudioContextType context_type);
+  const set_configurations::AudioSetConfiguration* MatchConfiguration(
+      types::LeAudioContextType context_type,
+      const set_configurations::AudioSetConfigurations* confs);
+  std::vector<uint64_t> GetConfigurationCacheKey(
+      types::LeAudioContextType context_type,
+      const set_configurations::AudioSetConfigurations* confs);
   bool ConfigureAses(
       const set_configurations::AudioSetConfiguration* audio_set_conf,
       types::LeAudioContextType context_type,
@@ -416,6 +422,27 @@ class LeAudioDeviceGroup {
            const set_configurations::AudioSetConfiguration*>
       available_context_to_configuration_map;
 
+  /* Memoized FindFirstSupportedConfiguration() results. An entry is only
+   * used while everything the match depends on - the candidate
+   * configurations, the group members, their connection state, available
+   * contexts, audio locations, ASEs and PACs - is the same as when it was
+   * made, which makes PAC, location and availability changes invalidate it.
+   */
+  struct ConfigurationCacheEntry {
+    std::vector<uint64_t> key;
+    const set_configurations::AudioSetConfiguration* conf;
+  };
+  std::map<types::LeAudioContextType, ConfigurationCacheEntry>
+      configuration_cache_;
+
+  struct ConfigurationCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t hit_us = 0;
+    uint64_t miss_us = 0;
+    uint64_t max_miss_us = 0;
+  } configuration_cache_stats_;
+
   types::AseState target_state_;
   types::AseState current_state_;
   std::vector<std::weak_ptr<LeAudioDevice>> leAudioDevices_;
@@ -836,6 +836,43 @@ TEST_F(LeAudioAseConfigurationTest, test_mono_speaker_media) {
                             direction_to_verify);
 }
 
+TEST_F(LeAudioAseConfigurationTest, test_configuration_cache_invalidation) {
+  LeAudioDevice* mono_speaker = AddTestDevice(1, 0);
+
+  /* mono, change location as by default it is stereo */
+  mono_speaker->snk_audio_locations_ =
+      ::le_audio::codec_spec_conf::kLeAudioLocationFrontLeft;
+  group_->ReloadAudioLocations();
+
+  /* Without PACs there is nothing to configure, on each try */
+  AudioContexts media(LeAudioContextType::MEDIA);
+  ASSERT_FALSE(group_->UpdateAudioContextTypeAvailability(media));
+  ASSERT_FALSE(group_->UpdateAudioContextTypeAvailability(media));
+
+  /* New PACs are taken into account */
+  PublishedAudioCapabilitiesBuilder snk_pac_builder;
+  for (const auto* conf :
+       *::le_audio::AudioSetConfigurationProvider::Get()->GetConfigurations(
+           LeAudioContextType::MEDIA)) {
+    for (const auto& entry : conf->confs) {
+      if (entry.direction != kLeAudioDirectionSink) continue;
+      snk_pac_builder.Add(entry.codec,
+                          kLeAudioCodecLC3ChannelCountSingleChannel);
+    }
+  }
+  mono_speaker->snk_pacs_ = snk_pac_builder.Get();
+  ASSERT_TRUE(group_->UpdateAudioContextTypeAvailability(media));
+  ASSERT_TRUE(group_->GetAvailableContexts().test(LeAudioContextType::MEDIA));
+  ASSERT_FALSE(group_->UpdateAudioContextTypeAvailability(media));
+
+  /* So is a change of the device available contexts */
+  mono_speaker->SetAvailableContexts(
+      AudioContexts(LeAudioContextType::RINGTONE),
+      AudioContexts(LeAudioContextType::RINGTONE));
+  ASSERT_TRUE(group_->UpdateAudioContextTypeAvailability(media));
+  ASSERT_FALSE(group_->GetAvailableContexts().test(LeAudioContextType::MEDIA));
+}
+
 TEST_F(LeAudioAseConfigurationTest, test_bounded_headphones_ringtone) {
   LeAudioDevice* bounded_headphones = AddTestDevice(2, 0);
   TestGroupAseConfigurationData data(
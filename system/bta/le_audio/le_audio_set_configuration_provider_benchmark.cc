@@ -0,0 +1,145 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <unistd.h>
+
+#include <climits>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "bta/le_audio/le_audio_set_configuration_provider.h"
+#include "bta/le_audio/le_audio_types.h"
+
+using ::benchmark::State;
+using le_audio::AudioSetConfigurationProvider;
+
+namespace {
+
+constexpr const char* kSourceFiles[] = {
+    "audio_set_configurations.bfbs",
+    "audio_set_configurations.json",
+    "audio_set_scenarios.bfbs",
+    "audio_set_scenarios.json",
+};
+constexpr const char* kBinaryFiles[] = {
+    "audio_set_configurations.bin",
+    "audio_set_scenarios.bin",
+};
+
+// The provider reads its files from the working directory on host. Each
+// variant gets a directory of its own with links to the files it may use,
+// so that the JSON one does not find the binaries.
+class ProviderDirectory {
+ public:
+  explicit ProviderDirectory(bool binary) {
+    char cwd[PATH_MAX];
+    if (getcwd(cwd, sizeof(cwd)) == nullptr) return;
+    data_dir_ = cwd;
+
+    char dir[] = "/tmp/le_audio_set_configs_XXXXXX";
+    if (mkdtemp(dir) == nullptr) return;
+    dir_ = dir;
+
+    for (auto file : kSourceFiles) Link(file);
+    if (binary) {
+      for (auto file : kBinaryFiles) Link(file);
+    }
+    ok_ = chdir(dir_.c_str()) == 0;
+  }
+
+  ~ProviderDirectory() {
+    if (dir_.empty()) return;
+    [[maybe_unused]] int ret = chdir(data_dir_.c_str());
+    for (auto const& link : links_) unlink(link.c_str());
+    rmdir(dir_.c_str());
+  }
+
+  bool ok() const { return ok_; }
+
+ private:
+  void Link(const char* file) {
+    std::string link = dir_ + "/" + file;
+    if (symlink((data_dir_ + "/" + file).c_str(), link.c_str()) == 0) {
+      links_.push_back(link);
+    }
+  }
+
+  std::string data_dir_;
+  std::string dir_;
+  std::vector<std::string> links_;
+  bool ok_ = false;
+};
+
+// Time to the provider being ready, with range(0) == 1 mapping the binaries
+// compiled at build time and range(0) == 0 parsing the JSON sources.
+void BM_Initialize(State& state) {
+  ProviderDirectory dir(state.range(0));
+  if (!dir.ok()) {
+    state.SkipWithError("Cannot set up the configuration files");
+    return;
+  }
+
+  for (auto _ : state) {
+    AudioSetConfigurationProvider::Initialize();
+    state.PauseTiming();
+    AudioSetConfigurationProvider::Cleanup();
+    state.ResumeTiming();
+  }
+}
+
+// Same, followed by the configurations of every context type being asked
+// for, which is when they are built.
+void BM_InitializeAndGetAll(State& state) {
+  ProviderDirectory dir(state.range(0));
+  if (!dir.ok()) {
+    state.SkipWithError("Cannot set up the configuration files");
+    return;
+  }
+
+  for (auto _ : state) {
+    AudioSetConfigurationProvider::Initialize();
+    for (auto context : le_audio::types::kLeAudioContextAllTypesArray) {
+      ::benchmark::DoNotOptimize(
+          AudioSetConfigurationProvider::Get()->GetConfigurations(context));
+    }
+    state.PauseTiming();
+    AudioSetConfigurationProvider::Cleanup();
+    state.ResumeTiming();
+  }
+}
+
+BENCHMARK(BM_Initialize)
+    ->ArgName("binary")
+    ->Arg(0)
+    ->Arg(1)
+    ->Unit(::benchmark::kMicrosecond);
+BENCHMARK(BM_InitializeAndGetAll)
+    ->ArgName("binary")
+    ->Arg(0)
+    ->Arg(1)
+    ->Unit(::benchmark::kMicrosecond);
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
@@ -15,8 +15,15 @@
  *
  */
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <mutex>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 
 #include "audio_set_configurations_generated.h"
 #include "audio_set_scenarios_generated.h"
@@ -38,31 +45,122 @@ using le_audio::types::LeAudioContextType;
 namespace le_audio {
 using ::le_audio::CodecManager;
 
+/* The flatbuffers are compiled from JSON to binary at build time. The schema
+ * and the JSON source are only parsed if the binary is missing or invalid. */
+struct FlatBufferFiles {
+  const char* schema;
+  const char* content;
+  const char* binary;
+};
+
 #ifdef OS_ANDROID
-static const std::vector<
-    std::pair<const char* /*schema*/, const char* /*content*/>>
-    kLeAudioSetConfigs = {
-        {"/apex/com.android.btservices/etc/bluetooth/le_audio/"
-         "audio_set_configurations.bfbs",
-         "/apex/com.android.btservices/etc/bluetooth/le_audio/"
-         "audio_set_configurations.json"}};
-static const std::vector<
-    std::pair<const char* /*schema*/, const char* /*content*/>>
-    kLeAudioSetScenarios = {{"/apex/com.android.btservices/etc/bluetooth/"
-                             "le_audio/audio_set_scenarios.bfbs",
-                             "/apex/com.android.btservices/etc/bluetooth/"
-                             "le_audio/audio_set_scenarios.json"}};
+static const std::vector<FlatBufferFiles> kLeAudioSetConfigs = {
+    {"/apex/com.android.btservices/etc/bluetooth/le_audio/"
+     "audio_set_configurations.bfbs",
+     "/apex/com.android.btservices/etc/bluetooth/le_audio/"
+     "audio_set_configurations.json",
+     "/apex/com.android.btservices/etc/bluetooth/le_audio/"
+     "audio_set_configurations.bin"}};
+static const std::vector<FlatBufferFiles> kLeAudioSetScenarios = {
+    {"/apex/com.android.btservices/etc/bluetooth/le_audio/"
+     "audio_set_scenarios.bfbs",
+     "/apex/com.android.btservices/etc/bluetooth/le_audio/"
+     "audio_set_scenarios.json",
+     "/apex/com.android.btservices/etc/bluetooth/le_audio/"
+     "audio_set_scenarios.bin"}};
 #else
-static const std::vector<
-    std::pair<const char* /*schema*/, const char* /*content*/>>
-    kLeAudioSetConfigs = {
-        {"audio_set_configurations.bfbs", "audio_set_configurations.json"}};
-static const std::vector<
-    std::pair<const char* /*schema*/, const char* /*content*/>>
-    kLeAudioSetScenarios = {
-        {"audio_set_scenarios.bfbs", "audio_set_scenarios.json"}};
+static const std::vector<FlatBufferFiles> kLeAudioSetConfigs = {
+    {"audio_set_configurations.bfbs", "audio_set_configurations.json",
+     "audio_set_configurations.bin"}};
+static const std::vector<FlatBufferFiles> kLeAudioSetScenarios = {
+    {"audio_set_scenarios.bfbs", "audio_set_scenarios.json",
+     "audio_set_scenarios.bin"}};
 #endif
 
+/* Flatbuffer data, either mapped from a binary file or parsed from JSON */
+class FlatBufferContent {
+ public:
+  ~FlatBufferContent() {
+    if (IsMapped()) munmap(const_cast<uint8_t*>(data_), size_);
+  }
+
+  static std::unique_ptr<FlatBufferContent> Map(const char* binary_file) {
+    int fd = open(binary_file, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return nullptr;
+
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+      data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+
+    if (data == MAP_FAILED) {
+      LOG_ERROR(": Unable to map %s", binary_file);
+      return nullptr;
+    }
+    return std::unique_ptr<FlatBufferContent>(
+        new FlatBufferContent(static_cast<const uint8_t*>(data), st.st_size));
+  }
+
+  static std::unique_ptr<FlatBufferContent> Parse(const char* schema_file,
+                                                  const char* content_file) {
+    flatbuffers::Parser parser;
+    std::string schema_binary_content;
+    if (!flatbuffers::LoadFile(schema_file, true, &schema_binary_content))
+      return nullptr;
+
+    /* Load the binary schema */
+    if (!parser.Deserialize((uint8_t*)schema_binary_content.c_str(),
+                            schema_binary_content.length()))
+      return nullptr;
+
+    /* Load the content from JSON */
+    std::string json_content;
+    if (!flatbuffers::LoadFile(content_file, false, &json_content))
+      return nullptr;
+
+    /* Parse */
+    if (!parser.Parse(json_content.c_str())) return nullptr;
+
+    return std::unique_ptr<FlatBufferContent>(
+        new FlatBufferContent(parser.builder_.Release()));
+  }
+
+  const uint8_t* Data() const { return data_; }
+  size_t Size() const { return size_; }
+  bool IsMapped() const { return buffer_.data() == nullptr; }
+
+ private:
+  FlatBufferContent(const uint8_t* data, size_t size)
+      : data_(data), size_(size) {}
+  explicit FlatBufferContent(flatbuffers::DetachedBuffer buffer)
+      : buffer_(std::move(buffer)),
+        data_(buffer_.data()),
+        size_(buffer_.size()) {}
+
+  flatbuffers::DetachedBuffer buffer_;
+  const uint8_t* data_;
+  size_t size_;
+};
+
+static std::unique_ptr<FlatBufferContent> LoadFlatBuffer(
+    const FlatBufferFiles& files, bool (*verify)(flatbuffers::Verifier&)) {
+  auto content = FlatBufferContent::Map(files.binary);
+  if (content) {
+    flatbuffers::Verifier verifier(content->Data(), content->Size());
+    if (verify(verifier)) return content;
+    LOG_ERROR(": Invalid content in %s", files.binary);
+  } else {
+    LOG_WARN(": No binary %s, parsing %s", files.binary, files.content);
+  }
+  return FlatBufferContent::Parse(files.schema, files.content);
+}
+
+static std::string_view StringViewFromFlat(const flatbuffers::String* str) {
+  return std::string_view(str->c_str(), str->size());
+}
+
 /** Provides a set configurations for the given context type */
 struct AudioSetConfigurationProviderJson {
   static constexpr auto kDefaultScenario = "Media";
@@ -72,6 +170,21 @@ struct AudioSetConfigurationProviderJson {
                ": Unable to load le audio set configuration files.");
   }
 
+  bool IsMapped() const {
+    for (auto const& content : config_contents_) {
+      if (!content.content->IsMapped()) return false;
+    }
+    for (auto const& content : scenario_contents_) {
+      if (!content->IsMapped()) return false;
+    }
+    return true;
+  }
+
+  std::pair<size_t, size_t> GetConfigurationCounts() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return {configurations_.size(), flat_configurations_.size()};
+  }
+
   /* Use the same scenario configurations for different contexts to avoid
    * internal reconfiguration and handover that produces time gap. When using
    * the same scenario for different contexts, quality and configuration remains
@@ -129,17 +242,18 @@ struct AudioSetConfigurationProviderJson {
   }
 
   const AudioSetConfigurations* GetConfigurationsByContextType(
-      LeAudioContextType context_type) const {
-    if (context_configurations_.count(context_type))
-      return &context_configurations_.at(context_type);
+      LeAudioContextType context_type) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (context_scenarios_.count(context_type))
+      return GetContextConfigurations(context_type);
 
     LOG_WARN(": No predefined scenario for the context %d was found.",
              (int)context_type);
 
     auto [it_begin, it_end] = ScenarioToContextTypes(kDefaultScenario);
-    if (it_begin != it_end) {
+    if (it_begin != it_end && context_scenarios_.count(it_begin->second)) {
       LOG_WARN(": Using '%s' scenario by default.", kDefaultScenario);
-      return &context_configurations_.at(it_begin->second);
+      return GetContextConfigurations(it_begin->second);
     }
 
     LOG_ERROR(
@@ -150,6 +264,36 @@ struct AudioSetConfigurationProviderJson {
   };
 
  private:
+  /* Content of a configurations file, with its QoS and codec configurations
+   * indexed by name */
+  struct ConfigurationsContent {
+    std::unique_ptr<FlatBufferContent> content;
+    std::unordered_map<std::string_view,
+                       const bluetooth::le_audio::QosConfiguration*>
+        qos_cfgs;
+    std::unordered_map<std::string_view,
+                       const bluetooth::le_audio::CodecConfiguration*>
+        codec_cfgs;
+  };
+
+  std::vector<ConfigurationsContent> config_contents_;
+  std::vector<std::unique_ptr<FlatBufferContent>> scenario_contents_;
+
+  /* Flat configurations by name, with the index of their content */
+  std::unordered_map<
+      std::string_view,
+      std::pair<const bluetooth::le_audio::AudioSetConfiguration*, size_t>>
+      flat_configurations_;
+
+  /* Flat scenario of each context type */
+  std::map<::le_audio::types::LeAudioContextType,
+           const bluetooth::le_audio::AudioSetScenario*>
+      context_scenarios_;
+
+  /* The structs below are only built once a context type is asked for, as
+   * most of the configurations are never used by a given device. */
+  std::mutex mutex_;
+
   /* Codec configurations */
   std::map<std::string, const AudioSetConfiguration> configurations_;
 
@@ -299,8 +443,7 @@ struct AudioSetConfigurationProviderJson {
 
   AudioSetConfiguration AudioSetConfigurationFromFlat(
       const bluetooth::le_audio::AudioSetConfiguration* flat_cfg,
-      std::vector<const bluetooth::le_audio::CodecConfiguration*>* codec_cfgs,
-      std::vector<const bluetooth::le_audio::QosConfiguration*>* qos_cfgs) {
+      const ConfigurationsContent& content) {
     ASSERT_LOG(flat_cfg != nullptr, "flat_cfg cannot be null");
     std::string codec_config_key = flat_cfg->codec_config_name()->str();
     auto* qos_config_key_array = flat_cfg->qos_config_name();
@@ -326,20 +469,12 @@ struct AudioSetConfigurationProviderJson {
              qos_source_key.c_str());
 
     const bluetooth::le_audio::QosConfiguration* qos_sink_cfg = nullptr;
-    for (auto i = qos_cfgs->begin(); i != qos_cfgs->end(); ++i) {
-      if ((*i)->name()->str() == qos_sink_key) {
-        qos_sink_cfg = *i;
-        break;
-      }
-    }
+    auto qos_it = content.qos_cfgs.find(qos_sink_key);
+    if (qos_it != content.qos_cfgs.end()) qos_sink_cfg = qos_it->second;
 
     const bluetooth::le_audio::QosConfiguration* qos_source_cfg = nullptr;
-    for (auto i = qos_cfgs->begin(); i != qos_cfgs->end(); ++i) {
-      if ((*i)->name()->str() == qos_source_key) {
-        qos_source_cfg = *i;
-        break;
-      }
-    }
+    qos_it = content.qos_cfgs.find(qos_source_key);
+    if (qos_it != content.qos_cfgs.end()) qos_source_cfg = qos_it->second;
 
     QosConfigSetting qos_sink;
     if (qos_sink_cfg != nullptr) {
@@ -360,12 +495,8 @@ struct AudioSetConfigurationProviderJson {
     }
 
     const bluetooth::le_audio::CodecConfiguration* codec_cfg = nullptr;
-    for (auto i = codec_cfgs->begin(); i != codec_cfgs->end(); ++i) {
-      if ((*i)->name()->str() == codec_config_key) {
-        codec_cfg = *i;
-        break;
-      }
-    }
+    auto codec_it = content.codec_cfgs.find(codec_config_key);
+    if (codec_it != content.codec_cfgs.end()) codec_cfg = codec_it->second;
 
     std::vector<SetConfiguration> subconfigs;
     if (codec_cfg != nullptr && codec_cfg->subconfigurations()) {
@@ -392,33 +523,14 @@ struct AudioSetConfigurationProviderJson {
     return AudioSetConfiguration({flat_cfg->name()->c_str(), subconfigs});
   }
 
-  bool LoadConfigurationsFromFiles(const char* schema_file,
-                                   const char* content_file) {
-    flatbuffers::Parser configurations_parser_;
-    std::string configurations_schema_binary_content;
-    bool ok = flatbuffers::LoadFile(schema_file, true,
-                                    &configurations_schema_binary_content);
-    if (!ok) return ok;
-
-    /* Load the binary schema */
-    ok = configurations_parser_.Deserialize(
-        (uint8_t*)configurations_schema_binary_content.c_str(),
-        configurations_schema_binary_content.length());
-    if (!ok) return ok;
-
-    /* Load the content from JSON */
-    std::string configurations_json_content;
-    ok = flatbuffers::LoadFile(content_file, false,
-                               &configurations_json_content);
-    if (!ok) return ok;
-
-    /* Parse */
-    ok = configurations_parser_.Parse(configurations_json_content.c_str());
-    if (!ok) return ok;
+  bool LoadConfigurations(const FlatBufferFiles& files) {
+    auto content = LoadFlatBuffer(
+        files, bluetooth::le_audio::VerifyAudioSetConfigurationsBuffer);
+    if (!content) return false;
 
-    /* Import from flatbuffers */
-    auto configurations_root = bluetooth::le_audio::GetAudioSetConfigurations(
-        configurations_parser_.builder_.GetBufferPointer());
+    /* Index the flatbuffers, which are only imported on demand */
+    auto configurations_root =
+        bluetooth::le_audio::GetAudioSetConfigurations(content->Data());
     if (!configurations_root) return false;
 
     auto flat_qos_configs = configurations_root->qos_configurations();
@@ -426,9 +538,10 @@ struct AudioSetConfigurationProviderJson {
       return false;
 
     LOG_DEBUG(": Updating %d qos config entries.", flat_qos_configs->size());
-    std::vector<const bluetooth::le_audio::QosConfiguration*> qos_cfgs;
+    ConfigurationsContent configurations_content;
     for (auto const& flat_qos_cfg : *flat_qos_configs) {
-      qos_cfgs.push_back(flat_qos_cfg);
+      configurations_content.qos_cfgs.emplace(
+          StringViewFromFlat(flat_qos_cfg->name()), flat_qos_cfg);
     }
 
     auto flat_codec_configs = configurations_root->codec_configurations();
@@ -437,9 +550,9 @@ struct AudioSetConfigurationProviderJson {
 
     LOG_DEBUG(": Updating %d codec config entries.",
               flat_codec_configs->size());
-    std::vector<const bluetooth::le_audio::CodecConfiguration*> codec_cfgs;
     for (auto const& flat_codec_cfg : *flat_codec_configs) {
-      codec_cfgs.push_back(flat_codec_cfg);
+      configurations_content.codec_cfgs.emplace(
+          StringViewFromFlat(flat_codec_cfg->name()), flat_codec_cfg);
     }
 
     auto flat_configs = configurations_root->configurations();
@@ -447,55 +560,65 @@ struct AudioSetConfigurationProviderJson {
 
     LOG_DEBUG(": Updating %d config entries.", flat_configs->size());
     for (auto const& flat_cfg : *flat_configs) {
-      configurations_.insert(
-          {flat_cfg->name()->str(),
-           AudioSetConfigurationFromFlat(flat_cfg, &codec_cfgs, &qos_cfgs)});
+      flat_configurations_.emplace(
+          StringViewFromFlat(flat_cfg->name()),
+          std::make_pair(flat_cfg, config_contents_.size()));
     }
 
+    configurations_content.content = std::move(content);
+    config_contents_.push_back(std::move(configurations_content));
     return true;
   }
 
+  const AudioSetConfiguration* GetConfiguration(const std::string& name) {
+    auto it = configurations_.find(name);
+    if (it != configurations_.end()) return &it->second;
+
+    auto flat_it = flat_configurations_.find(name);
+    if (flat_it == flat_configurations_.end()) return nullptr;
+
+    auto [flat_cfg, content_index] = flat_it->second;
+    return &configurations_
+                .emplace(name, AudioSetConfigurationFromFlat(
+                                   flat_cfg, config_contents_[content_index]))
+                .first->second;
+  }
+
   AudioSetConfigurations AudioSetConfigurationsFromFlatScenario(
       const bluetooth::le_audio::AudioSetScenario* const flat_scenario) {
     AudioSetConfigurations items;
     if (!flat_scenario->configurations()) return items;
 
     for (auto config_name : *flat_scenario->configurations()) {
-      if (configurations_.count(config_name->str()) == 0) continue;
+      auto cfg = GetConfiguration(config_name->str());
+      if (cfg == nullptr) continue;
 
-      auto& cfg = configurations_.at(config_name->str());
-      items.push_back(&cfg);
+      items.push_back(cfg);
     }
 
     return items;
   }
 
-  bool LoadScenariosFromFiles(const char* schema_file,
-                              const char* content_file) {
-    flatbuffers::Parser scenarios_parser_;
-    std::string scenarios_schema_binary_content;
-    bool ok = flatbuffers::LoadFile(schema_file, true,
-                                    &scenarios_schema_binary_content);
-    if (!ok) return ok;
-
-    /* Load the binary schema */
-    ok = scenarios_parser_.Deserialize(
-        (uint8_t*)scenarios_schema_binary_content.c_str(),
-        scenarios_schema_binary_content.length());
-    if (!ok) return ok;
+  const AudioSetConfigurations* GetContextConfigurations(
+      LeAudioContextType context_type) {
+    auto it = context_configurations_.find(context_type);
+    if (it != context_configurations_.end()) return &it->second;
 
-    /* Load the content from JSON */
-    std::string scenarios_json_content;
-    ok = flatbuffers::LoadFile(content_file, false, &scenarios_json_content);
-    if (!ok) return ok;
+    auto flat_scenario = context_scenarios_.at(context_type);
+    return &context_configurations_
+                .emplace(context_type,
+                         AudioSetConfigurationsFromFlatScenario(flat_scenario))
+                .first->second;
+  }
 
-    /* Parse */
-    ok = scenarios_parser_.Parse(scenarios_json_content.c_str());
-    if (!ok) return ok;
+  bool LoadScenarios(const FlatBufferFiles& files) {
+    auto content = LoadFlatBuffer(
+        files, bluetooth::le_audio::VerifyAudioSetScenariosBuffer);
+    if (!content) return false;
 
     /* Import from flatbuffers */
-    auto scenarios_root = bluetooth::le_audio::GetAudioSetScenarios(
-        scenarios_parser_.builder_.GetBufferPointer());
+    auto scenarios_root =
+        bluetooth::le_audio::GetAudioSetScenarios(content->Data());
     if (!scenarios_root) return false;
 
     auto flat_scenarios = scenarios_root->scenarios();
@@ -507,25 +630,22 @@ struct AudioSetConfigurationProviderJson {
       auto [it_begin, it_end] =
           ScenarioToContextTypes(scenario->name()->c_str());
       for (auto it = it_begin; it != it_end; ++it) {
-        context_configurations_.insert_or_assign(
-            it->second, AudioSetConfigurationsFromFlatScenario(scenario));
+        context_scenarios_.insert_or_assign(it->second, scenario);
       }
     }
 
+    scenario_contents_.push_back(std::move(content));
     return true;
   }
 
-  bool LoadContent(
-      std::vector<std::pair<const char* /*schema*/, const char* /*content*/>>
-          config_files,
-      std::vector<std::pair<const char* /*schema*/, const char* /*content*/>>
-          scenario_files) {
-    for (auto [schema, content] : config_files) {
-      if (!LoadConfigurationsFromFiles(schema, content)) return false;
+  bool LoadContent(const std::vector<FlatBufferFiles>& config_files,
+                   const std::vector<FlatBufferFiles>& scenario_files) {
+    for (auto const& files : config_files) {
+      if (!LoadConfigurations(files)) return false;
     }
 
-    for (auto [schema, content] : scenario_files) {
-      if (!LoadScenariosFromFiles(schema, content)) return false;
+    for (auto const& files : scenario_files) {
+      if (!LoadScenarios(files)) return false;
     }
     return true;
   }
@@ -551,6 +671,13 @@ struct AudioSetConfigurationProvider::impl {
   void Dump(int fd) {
     std::stringstream stream;
 
+    auto [num_built, num_total] =
+        config_provider_impl_->GetConfigurationCounts();
+    stream << "  Loaded from: "
+           << (config_provider_impl_->IsMapped() ? "binary" : "JSON")
+           << ", configurations in use: " << num_built << " of " << num_total
+           << "\n";
+
     for (LeAudioContextType context : types::kLeAudioContextAllTypesArray) {
       auto confs = Get()->GetConfigurations(context);
       stream << "\n  === Configurations for context type: " << (int)context
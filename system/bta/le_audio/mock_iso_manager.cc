@@ -17,6 +17,8 @@
 
 #include "mock_iso_manager.h"
 
+#include "osi/include/allocator.h"
+
 MockIsoManager* mock_pimpl_;
 MockIsoManager* MockIsoManager::GetInstance() {
   bluetooth::hci::IsoManager::GetInstance();
@@ -95,6 +97,13 @@ void IsoManager::SendIsoData(uint16_t iso_handle, const uint8_t* data,
   pimpl_->SendIsoData(iso_handle, data, data_len);
 }
 
+void IsoManager::SendIsoSdu(uint16_t iso_handle, BT_HDR* p_sdu) {
+  /* Mock actions can look at the SDU, it is freed here as the ISO manager
+   * takes it over */
+  if (pimpl_) pimpl_->SendIsoSdu(iso_handle, p_sdu);
+  osi_free(p_sdu);
+}
+
 void IsoManager::CreateBig(uint8_t big_id,
                            struct iso_manager::big_create_params big_params) {
   if (!pimpl_) return;
@@ -0,0 +1,202 @@
+/*
+ *  Copyright 2023 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Holds the decoded PCM of the A2DP Sink between the decoder and the audio
+// track, and keeps enough of it to ride out the gaps of a bursty or jittery
+// AVDTP stream without adding more latency than the stream needs.
+//
+// The depth it fills up to before playing follows the inter-arrival times of
+// the media packets: it covers the 95th percentile of the recent gaps, or the
+// longest gap of the last seconds when longer, plus one playout tick, and is
+// grown on each underrun. While playing, the buffer aims to keep a margin of
+// one tick at its lowest point over the last seconds. When it is higher the
+// audio is played 1/|kStretchPeriodFrames| faster, and slower when it is
+// lower, interpolating between the frames so that the waveform stays
+// continuous: a pitch shift of under two cents, rather than the click of a
+// frame dropped or repeated outright. It only drops whole chunks when far
+// beyond the maximum depth.
+//
+// The PCM is kept in a ring allocated by Configure(), so nothing is allocated
+// per packet. Write() and Read() may run on different threads without a lock,
+// as long as there is a single producer and a single consumer.
+// OnPacketArrival() is meant for the thread receiving the media packets, and
+// must not race with Configure().
+class BtifA2dpSinkJitterBuffer {
+ public:
+  struct Options {
+    // Bounds of the target depth
+    uint32_t min_depth_ms = 40;
+    uint32_t max_depth_ms = 500;
+    // Period at which the consumer is woken up to play the audio
+    uint32_t tick_ms = 20;
+    // Stretch the audio to converge on the margin. When disabled, the depth
+    // only changes through underruns and overflows.
+    bool adjust_depth = true;
+    // Fill up to this depth rather than the one derived from the arrivals
+    uint32_t fixed_depth_ms = 0;
+  };
+
+  struct Stats {
+    uint64_t frames_written;
+    uint64_t frames_played;
+    uint64_t overflow_frames;
+    uint64_t underruns;
+    uint64_t silence_frames;
+    // Frames skipped or added, by stretching the audio or by dropping chunks
+    uint64_t dropped_frames;
+    uint64_t inserted_frames;
+    uint32_t target_depth_ms;
+    uint32_t depth_ms;
+  };
+
+  // Output frames over which stretching gains or loses one frame, 0.1%
+  static constexpr uint32_t kStretchPeriodFrames = 1000;
+  // Without packets for this long once the buffer ran dry, the stream is
+  // idle
+  static constexpr uint64_t kIdleUs = 1000000;
+
+  BtifA2dpSinkJitterBuffer();
+  explicit BtifA2dpSinkJitterBuffer(const Options& options);
+
+  // Allocates the ring for a stream of |sample_rate| Hz of interleaved little
+  // endian PCM of |bits_per_sample| bits (16, 24 or 32) and |channel_count|
+  // channels, and resets the buffer and its statistics.
+  bool Configure(uint32_t sample_rate, uint32_t bits_per_sample,
+                 uint32_t channel_count);
+
+  // Drops the buffered audio, which will be played again once the target
+  // depth is reached. Must be called from the consumer.
+  void Flush();
+
+  // Records the arrival of a media packet at |now_us|.
+  void OnPacketArrival(uint64_t now_us);
+
+  // Producer: queues |len| bytes of decoded PCM. Returns the bytes queued,
+  // less than |len| when the ring is full.
+  size_t Write(const uint8_t* data, size_t len);
+
+  // Consumer: number of frames to write for the audio track to hold two
+  // ticks of audio, given the |track_frames| it has yet to play. Follows the
+  // pace the audio track actually plays at.
+  size_t FramesDueForTrack(size_t track_frames) const;
+
+  // Consumer: number of frames the audio track played since the last call
+  // going by the clock, for when the level of the audio track is unknown.
+  // Frames owed after the consumer was held up are handed out over the next
+  // calls rather than skipped.
+  size_t FramesDue(uint64_t now_us);
+
+  // Consumer: whether the buffer ran dry and no packet came for |kIdleUs|,
+  // the stream being stalled or suspended.
+  bool IsIdle(uint64_t now_us) const;
+
+  // Consumer: fills |out| with |frames| frames, silence included when the
+  // buffer is still filling up or runs dry. Returns the frames of audio.
+  size_t Read(uint8_t* out, size_t frames);
+
+  // Largest number of frames FramesDue() hands out at once
+  size_t MaxFramesDue() const { return max_frames_due_; }
+  size_t BytesPerFrame() const { return bytes_per_frame_; }
+  Stats GetStats() const;
+
+ private:
+  static constexpr uint32_t kBucketMs = 2;
+  static constexpr size_t kNumBuckets = 256;
+  // Arrivals after which the histogram is halved, to follow the stream
+  static constexpr uint32_t kHistogramHalfLife = 512;
+  // Gaps longer than this are a suspended stream rather than jitter
+  static constexpr uint64_t kMaxInterArrivalUs = 1000000;
+  // The longest gap is remembered for one to two of these
+  static constexpr uint64_t kPeakWindowUs = 10000000;
+  // Windows over which the lowest depth decides to drop or repeat frames
+  static constexpr uint32_t kDropWindowMs = 5000;
+  static constexpr uint32_t kRepeatWindowMs = 500;
+
+  enum class State { kBuffering, kPlaying };
+
+  // Lowest value over the current and the previous window
+  struct WindowMin {
+    uint64_t current = UINT64_MAX;
+    uint64_t previous = UINT64_MAX;
+    size_t frames = 0;
+    bool full = false;
+
+    void Reset() { *this = WindowMin(); }
+    void Update(uint64_t value, size_t frames, size_t window_frames);
+    uint64_t Get() const { return std::min(current, previous); }
+  };
+
+  size_t MsToFrames(uint32_t ms) const;
+  uint32_t FramesToMs(size_t frames) const;
+  size_t TargetFrames();
+  void CopyOut(uint8_t* out, uint64_t read_pos, size_t frames) const;
+  // Writes the frame |phase| / |kStretchPeriodFrames| of the way from the
+  // frame at |read_pos| to the next one
+  void InterpolateOut(uint8_t* out, uint64_t read_pos, uint32_t phase) const;
+
+  const Options options_;
+  uint32_t sample_rate_ = 0;
+  size_t bytes_per_sample_ = 0;
+  size_t channel_count_ = 0;
+  size_t bytes_per_frame_ = 0;
+  std::vector<uint8_t> ring_;
+  uint64_t capacity_frames_ = 0;
+  uint64_t capacity_mask_ = 0;
+  std::atomic<uint64_t> write_pos_{0};
+  std::atomic<uint64_t> read_pos_{0};
+
+  // Receive path
+  std::array<uint32_t, kNumBuckets> histogram_{};
+  uint32_t histogram_count_ = 0;
+  std::atomic<uint64_t> last_arrival_us_{0};
+  uint64_t peak_window_start_us_ = 0;
+  uint64_t peak_gap_us_ = 0;
+  uint64_t previous_peak_gap_us_ = 0;
+  std::atomic<uint32_t> arrival_depth_ms_{0};
+
+  // Consumer
+  State state_ = State::kBuffering;
+  uint32_t underrun_boost_ms_ = 0;
+  uint64_t frames_since_underrun_ = 0;
+  // Depth left after each read
+  WindowMin drop_window_;
+  WindowMin repeat_window_;
+  // Direction of the stretch in progress, and how far between two frames the
+  // next output frame is, in 1/kStretchPeriodFrames of a frame
+  int stretch_ = 0;
+  uint32_t stretch_phase_ = 0;
+  uint64_t playout_start_us_ = 0;
+  uint64_t playout_frames_ = 0;
+  size_t max_frames_due_ = 0;
+
+  std::atomic<uint64_t> overflow_frames_{0};
+  std::atomic<uint64_t> frames_played_{0};
+  std::atomic<uint64_t> underruns_{0};
+  std::atomic<uint64_t> silence_frames_{0};
+  std::atomic<uint64_t> dropped_frames_{0};
+  std::atomic<uint64_t> inserted_frames_{0};
+  std::atomic<uint32_t> target_depth_ms_{0};
+  std::atomic<uint32_t> depth_ms_{0};
+};
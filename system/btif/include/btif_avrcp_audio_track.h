@@ -60,6 +60,12 @@ void BtifAvrcpSetAudioTrackGain(void* handle, float gain);
 void BtifAvrcpAudioTrackStop(void* handle);
 void BtifAvrcpAudioTrackDelete(void* handle);
 
+/**
+ * Returns the number of frames written to the audio track which it has yet to
+ * play, or -1 if it cannot tell.
+ */
+int BtifAvrcpAudioTrackGetBufferedFrames(void* handle);
+
 /**
  * Writes the audio track data to file.
  *
@@ -75,6 +75,7 @@
 #include "common/metric_id_allocator.h"
 #include "common/metrics.h"
 #include "common/os_utils.h"
+#include "common/task_latency_tracer.h"
 #include "device/include/interop.h"
 #include "gd/common/init_flags.h"
 #include "gd/os/parameter_provider.h"
@@ -111,6 +112,9 @@ bool common_criteria_mode = false;
 const int CONFIG_COMPARE_ALL_PASS = 0b11;
 int common_criteria_config_compare_result = CONFIG_COMPARE_ALL_PASS;
 bool is_local_device_atv = false;
+// Written on dumpsys when task latency tracing is enabled, loadable in Perfetto
+static const char* kTaskLatencyTracePath =
+    "/data/misc/bluetooth/logs/bt_task_latency_trace.json";
 
 /*******************************************************************************
  *  Externs
@@ -454,6 +458,8 @@ static void dump(int fd, const char** arguments) {
 #endif
   connection_manager::dump(fd);
   bluetooth::bqr::DebugDump(fd);
+  bluetooth::common::TaskLatencyTracer::DumpAll(fd);
+  bluetooth::common::TaskLatencyTracer::WriteAllTraces(kTaskLatencyTracePath);
   bluetooth::shim::Dump(fd, arguments);
 }
 
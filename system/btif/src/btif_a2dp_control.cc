@@ -102,7 +102,7 @@ static tA2DP_CTRL_ACK btif_a2dp_control_on_start() {
   if (btif_av_stream_ready()) {
     /* Setup audio data channel listener */
     UIPC_Open(*a2dp_uipc, UIPC_CH_ID_AV_AUDIO, btif_a2dp_data_cb,
-              A2DP_DATA_PATH);
+              A2DP_DATA_PATH, true /* offer_rings */);
 
     /*
      * Post start event and wait for audio path to open.
@@ -119,7 +119,7 @@ static tA2DP_CTRL_ACK btif_a2dp_control_on_start() {
      * back immediately.
      */
     UIPC_Open(*a2dp_uipc, UIPC_CH_ID_AV_AUDIO, btif_a2dp_data_cb,
-              A2DP_DATA_PATH);
+              A2DP_DATA_PATH, true /* offer_rings */);
     return A2DP_CTRL_ACK_SUCCESS;
   }
   APPL_TRACE_WARNING("%s: A2DP command start while AV stream is not ready",
@@ -27,13 +27,16 @@
 #include <atomic>
 #include <mutex>
 #include <string>
+#include <vector>
 
 #include "bt_target.h"  // Must be first to define build configuration
+#include "btif/include/btif_a2dp_sink_jitter_buffer.h"
 #include "btif/include/btif_av.h"
 #include "btif/include/btif_av_co.h"
 #include "btif/include/btif_avrcp_audio_track.h"
 #include "btif/include/btif_util.h"  // CASE_RETURN_STR
 #include "common/message_loop_thread.h"
+#include "common/time_util.h"
 #include "osi/include/alarm.h"
 #include "osi/include/allocator.h"
 #include "osi/include/fixed_queue.h"
@@ -95,7 +98,8 @@ class BtifA2dpSinkControlBlock {
         channel_count(0),
         rx_focus_state(BTIF_A2DP_SINK_FOCUS_NOT_GRANTED),
         audio_track(nullptr),
-        decoder_interface(nullptr) {}
+        decoder_interface(nullptr),
+        playout_restart(false) {}
 
   void Reset() {
     if (audio_track != nullptr) {
@@ -112,6 +116,7 @@ class BtifA2dpSinkControlBlock {
     sample_rate = 0;
     channel_count = 0;
     decoder_interface = nullptr;
+    playout_restart = false;
   }
 
   MessageLoopThread worker_thread;
@@ -124,6 +129,10 @@ class BtifA2dpSinkControlBlock {
   btif_a2dp_sink_focus_state_t rx_focus_state; /* audio focus state */
   void* audio_track;
   const tA2DP_DECODER_INTERFACE* decoder_interface;
+  // Decoded audio waiting to be played, filled and drained by the worker
+  BtifA2dpSinkJitterBuffer jitter_buffer;
+  std::vector<uint8_t> playout_buffer;
+  bool playout_restart; /* drop the audio left over from the last stream */
 };
 
 // Mutex for below data structures.
@@ -145,6 +154,7 @@ static void btif_a2dp_sink_audio_handle_stop_decoding();
 static void btif_decode_alarm_cb(void* context);
 static void btif_a2dp_sink_audio_handle_start_decoding();
 static void btif_a2dp_sink_avk_handle_timer();
+static void btif_a2dp_sink_stop_idle_playout();
 static void btif_a2dp_sink_audio_rx_flush_req();
 /* Handle incoming media packets A2DP SINK streaming */
 static void btif_a2dp_sink_handle_inc_media(BT_HDR* p_msg);
@@ -514,17 +524,74 @@ static void btif_a2dp_sink_audio_handle_start_decoding() {
     LOG_ERROR("%s: unable to allocate decode alarm", __func__);
     return;
   }
+  btif_a2dp_sink_cb.playout_restart = true;
   alarm_set(btif_a2dp_sink_cb.decode_alarm, BTIF_SINK_MEDIA_TIME_TICK_MS,
             btif_decode_alarm_cb, nullptr);
 }
 
 static void btif_a2dp_sink_on_decode_complete(uint8_t* data, uint32_t len) {
+  btif_a2dp_sink_cb.jitter_buffer.Write(data, len);
+}
+
+// Must be called while locked.
+static void btif_a2dp_sink_play_audio() {
+  BtifA2dpSinkJitterBuffer& jitter_buffer = btif_a2dp_sink_cb.jitter_buffer;
+  uint64_t now_us = bluetooth::common::time_get_os_boottime_us();
+
+  // The stream went quiet without being suspended: stop the tick rather than
+  // feed silence to the audio track, the next packets start it again
+  if (jitter_buffer.IsIdle(now_us)) {
+    btif_a2dp_sink_cb.worker_thread.DoInThread(
+        FROM_HERE, base::BindOnce(btif_a2dp_sink_stop_idle_playout));
+    return;
+  }
+
+  // Keep up with what the audio track played, and only go by the clock when
+  // it cannot tell
+  int track_frames = -1;
+#ifndef OS_GENERIC
+  if (btif_a2dp_sink_cb.audio_track != nullptr) {
+    track_frames =
+        BtifAvrcpAudioTrackGetBufferedFrames(btif_a2dp_sink_cb.audio_track);
+  }
+#endif
+  size_t frames = track_frames >= 0
+                      ? jitter_buffer.FramesDueForTrack(track_frames)
+                      : jitter_buffer.FramesDue(now_us);
+  if (frames == 0) return;
+
+  jitter_buffer.Read(btif_a2dp_sink_cb.playout_buffer.data(), frames);
 #ifndef OS_GENERIC
-  BtifAvrcpAudioTrackWriteData(btif_a2dp_sink_cb.audio_track,
-                               reinterpret_cast<void*>(data), len);
+  if (btif_a2dp_sink_cb.audio_track == nullptr) return;
+  BtifAvrcpAudioTrackWriteData(
+      btif_a2dp_sink_cb.audio_track,
+      reinterpret_cast<void*>(btif_a2dp_sink_cb.playout_buffer.data()),
+      frames * jitter_buffer.BytesPerFrame());
 #endif
 }
 
+static void btif_a2dp_sink_stop_idle_playout() {
+  alarm_t* old_alarm;
+  {
+    LockGuard lock(g_mutex);
+    // Packets may have come in since
+    if (btif_a2dp_sink_cb.decode_alarm == nullptr ||
+        !btif_a2dp_sink_cb.jitter_buffer.IsIdle(
+            bluetooth::common::time_get_os_boottime_us())) {
+      return;
+    }
+    LOG_INFO("%s: no audio to play, stopping the playout", __func__);
+#ifndef OS_GENERIC
+    BtifAvrcpAudioTrackPause(btif_a2dp_sink_cb.audio_track);
+#endif
+    old_alarm = btif_a2dp_sink_cb.decode_alarm;
+    btif_a2dp_sink_cb.decode_alarm = nullptr;
+  }
+
+  // Freed unlocked, as in btif_a2dp_sink_audio_handle_stop_decoding
+  alarm_free(old_alarm);
+}
+
 // Must be called while locked.
 static void btif_a2dp_sink_handle_inc_media(BT_HDR* p_msg) {
   if ((btif_av_get_peer_sep() == AVDT_TSEP_SNK) ||
@@ -543,11 +610,6 @@ static void btif_a2dp_sink_avk_handle_timer() {
   LockGuard lock(g_mutex);
 
   BT_HDR* p_msg;
-  if (fixed_queue_is_empty(btif_a2dp_sink_cb.rx_audio_queue)) {
-    APPL_TRACE_DEBUG("%s: empty queue", __func__);
-    return;
-  }
-
   /* Don't do anything in case of focus not granted */
   if (btif_a2dp_sink_cb.rx_focus_state == BTIF_A2DP_SINK_FOCUS_NOT_GRANTED) {
     APPL_TRACE_DEBUG("%s: skipping frames since focus is not present",
@@ -557,8 +619,13 @@ static void btif_a2dp_sink_avk_handle_timer() {
   /* Play only in BTIF_A2DP_SINK_FOCUS_GRANTED case */
   if (btif_a2dp_sink_cb.rx_flush) {
     fixed_queue_flush(btif_a2dp_sink_cb.rx_audio_queue, osi_free);
+    btif_a2dp_sink_cb.jitter_buffer.Flush();
     return;
   }
+  if (btif_a2dp_sink_cb.playout_restart) {
+    btif_a2dp_sink_cb.jitter_buffer.Flush();
+    btif_a2dp_sink_cb.playout_restart = false;
+  }
 
   APPL_TRACE_DEBUG("%s: process frames begin", __func__);
   while (true) {
@@ -574,6 +641,9 @@ static void btif_a2dp_sink_avk_handle_timer() {
     osi_free(p_msg);
   }
   APPL_TRACE_DEBUG("%s: process frames end", __func__);
+
+  // The audio track is fed at the pace it plays, whatever came in this tick
+  btif_a2dp_sink_play_audio();
 }
 
 /* when true media task discards any rx frames */
@@ -589,6 +659,7 @@ static void btif_a2dp_sink_audio_rx_flush_event() {
   LockGuard lock(g_mutex);
   // Flush all received encoded audio buffers
   fixed_queue_flush(btif_a2dp_sink_cb.rx_audio_queue, osi_free);
+  btif_a2dp_sink_cb.jitter_buffer.Flush();
 }
 
 static void btif_a2dp_sink_decoder_update_event(
@@ -624,6 +695,14 @@ static void btif_a2dp_sink_decoder_update_event(
   btif_a2dp_sink_cb.bits_per_sample = bits_per_sample;
   btif_a2dp_sink_cb.channel_count = channel_count;
 
+  BtifA2dpSinkJitterBuffer& jitter_buffer = btif_a2dp_sink_cb.jitter_buffer;
+  if (!jitter_buffer.Configure(sample_rate, bits_per_sample, channel_count)) {
+    LOG_ERROR("%s: cannot buffer the decoded audio", __func__);
+    return;
+  }
+  btif_a2dp_sink_cb.playout_buffer.resize(jitter_buffer.MaxFramesDue() *
+                                          jitter_buffer.BytesPerFrame());
+
   btif_a2dp_sink_cb.rx_flush = false;
   APPL_TRACE_DEBUG("%s: reset to Sink role", __func__);
 
@@ -661,6 +740,9 @@ uint8_t btif_a2dp_sink_enqueue_buf(BT_HDR* p_pkt) {
   if (btif_a2dp_sink_cb.rx_flush) /* Flush enabled, do not enqueue */
     return fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue);
 
+  btif_a2dp_sink_cb.jitter_buffer.OnPacketArrival(
+      bluetooth::common::time_get_os_boottime_us());
+
   if (fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue) ==
       MAX_INPUT_A2DP_FRAME_QUEUE_SZ) {
     uint8_t ret = fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue);
@@ -699,8 +781,35 @@ void btif_a2dp_sink_audio_rx_flush_req() {
       FROM_HERE, base::BindOnce(btif_a2dp_sink_command_ready, p_buf));
 }
 
-void btif_a2dp_sink_debug_dump(UNUSED_ATTR int fd) {
-  // Nothing to do
+void btif_a2dp_sink_debug_dump(int fd) {
+  LockGuard lock(g_mutex);
+  if (btif_a2dp_sink_cb.sample_rate == 0) return;
+
+  BtifA2dpSinkJitterBuffer::Stats stats =
+      btif_a2dp_sink_cb.jitter_buffer.GetStats();
+  uint64_t frames_per_ms = btif_a2dp_sink_cb.sample_rate / 1000;
+  dprintf(fd, "\nA2DP Sink State:\n");
+  dprintf(fd, "  Jitter buffer:\n");
+  dprintf(fd,
+          "  Depth in ms (current/target)                            : %u / "
+          "%u\n",
+          stats.depth_ms, stats.target_depth_ms);
+  dprintf(fd,
+          "  Frames (written/played)                                 : %llu / "
+          "%llu\n",
+          (unsigned long long)stats.frames_written,
+          (unsigned long long)stats.frames_played);
+  dprintf(fd,
+          "  Underruns (count/silence in ms)                         : %llu / "
+          "%llu\n",
+          (unsigned long long)stats.underruns,
+          (unsigned long long)(stats.silence_frames / frames_per_ms));
+  dprintf(fd,
+          "  Frames adjusted (dropped/repeated/overflowed)           : %llu / "
+          "%llu / %llu\n",
+          (unsigned long long)stats.dropped_frames,
+          (unsigned long long)stats.inserted_frames,
+          (unsigned long long)stats.overflow_frames);
 }
 
 void btif_a2dp_sink_set_focus_state_req(btif_a2dp_sink_focus_state_t state) {
@@ -0,0 +1,374 @@
+/*
+ *  Copyright 2023 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "btif/include/btif_a2dp_sink_jitter_buffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Little endian PCM sample of |bytes| bytes, sign extended
+int32_t LoadSample(const uint8_t* data, size_t bytes) {
+  uint32_t value = 0;
+  for (size_t i = 0; i < bytes; i++) value |= uint32_t{data[i]} << (8 * i);
+  uint32_t shift = 32 - 8 * bytes;
+  return static_cast<int32_t>(value << shift) >> shift;
+}
+
+void StoreSample(uint8_t* data, size_t bytes, int32_t sample) {
+  uint32_t value = static_cast<uint32_t>(sample);
+  for (size_t i = 0; i < bytes; i++) data[i] = value >> (8 * i);
+}
+
+}  // namespace
+
+BtifA2dpSinkJitterBuffer::BtifA2dpSinkJitterBuffer()
+    : BtifA2dpSinkJitterBuffer(Options()) {}
+
+BtifA2dpSinkJitterBuffer::BtifA2dpSinkJitterBuffer(const Options& options)
+    : options_(options) {}
+
+bool BtifA2dpSinkJitterBuffer::Configure(uint32_t sample_rate,
+                                         uint32_t bits_per_sample,
+                                         uint32_t channel_count) {
+  if (sample_rate == 0 || channel_count == 0) return false;
+  if (bits_per_sample != 16 && bits_per_sample != 24 && bits_per_sample != 32)
+    return false;
+
+  sample_rate_ = sample_rate;
+  bytes_per_sample_ = bits_per_sample / 8;
+  channel_count_ = channel_count;
+  bytes_per_frame_ = bytes_per_sample_ * channel_count_;
+
+  // Room for twice the deepest the buffer gets, as a burst lands on top of
+  // what is already buffered
+  uint32_t max_depth_ms =
+      std::max(options_.max_depth_ms, options_.fixed_depth_ms);
+  size_t wanted = MsToFrames(2 * max_depth_ms);
+  capacity_frames_ = 1;
+  while (capacity_frames_ < wanted) capacity_frames_ <<= 1;
+  capacity_mask_ = capacity_frames_ - 1;
+  ring_.assign(capacity_frames_ * bytes_per_frame_, 0);
+  write_pos_ = 0;
+  read_pos_ = 0;
+
+  histogram_.fill(0);
+  histogram_count_ = 0;
+  last_arrival_us_ = 0;
+  peak_window_start_us_ = 0;
+  peak_gap_us_ = 0;
+  previous_peak_gap_us_ = 0;
+  arrival_depth_ms_ = options_.min_depth_ms;
+
+  state_ = State::kBuffering;
+  underrun_boost_ms_ = 0;
+  frames_since_underrun_ = 0;
+  drop_window_.Reset();
+  repeat_window_.Reset();
+  stretch_ = 0;
+  stretch_phase_ = 0;
+  playout_start_us_ = 0;
+  playout_frames_ = 0;
+  max_frames_due_ = MsToFrames(4 * options_.tick_ms);
+
+  overflow_frames_ = 0;
+  frames_played_ = 0;
+  underruns_ = 0;
+  silence_frames_ = 0;
+  dropped_frames_ = 0;
+  inserted_frames_ = 0;
+  target_depth_ms_ = 0;
+  depth_ms_ = 0;
+  return true;
+}
+
+void BtifA2dpSinkJitterBuffer::Flush() {
+  read_pos_.store(write_pos_.load(std::memory_order_acquire),
+                  std::memory_order_release);
+  state_ = State::kBuffering;
+  stretch_ = 0;
+  stretch_phase_ = 0;
+  playout_start_us_ = 0;
+  playout_frames_ = 0;
+  depth_ms_ = 0;
+}
+
+void BtifA2dpSinkJitterBuffer::OnPacketArrival(uint64_t now_us) {
+  uint64_t last_arrival_us =
+      last_arrival_us_.exchange(now_us, std::memory_order_relaxed);
+  if (last_arrival_us == 0 || now_us < last_arrival_us) return;
+  uint64_t gap_us = now_us - last_arrival_us;
+  if (gap_us > kMaxInterArrivalUs) return;
+
+  size_t bucket = std::min<uint64_t>(gap_us / 1000 / kBucketMs,
+                                     kNumBuckets - 1);
+  histogram_[bucket]++;
+  histogram_count_++;
+  if (histogram_count_ >= kHistogramHalfLife) {
+    histogram_count_ = 0;
+    for (auto& count : histogram_) {
+      count /= 2;
+      histogram_count_ += count;
+    }
+  }
+
+  if (now_us - peak_window_start_us_ >= kPeakWindowUs) {
+    previous_peak_gap_us_ = peak_gap_us_;
+    peak_gap_us_ = 0;
+    peak_window_start_us_ = now_us;
+  }
+  peak_gap_us_ = std::max(peak_gap_us_, gap_us);
+
+  // The buffer has to last through the 95th percentile gap, and through the
+  // odd long gap when one came recently, plus the tick for the audio to go
+  // through the decoder
+  uint64_t threshold = (histogram_count_ * 95 + 99) / 100;
+  uint64_t cumulative = 0;
+  size_t percentile = 0;
+  for (; percentile < kNumBuckets - 1; percentile++) {
+    cumulative += histogram_[percentile];
+    if (cumulative >= threshold) break;
+  }
+  uint64_t gap_ms = std::max<uint64_t>(
+      (percentile + 1) * kBucketMs,
+      std::max(peak_gap_us_, previous_peak_gap_us_) / 1000);
+  arrival_depth_ms_.store(gap_ms + options_.tick_ms,
+                          std::memory_order_relaxed);
+}
+
+size_t BtifA2dpSinkJitterBuffer::Write(const uint8_t* data, size_t len) {
+  if (ring_.empty()) return 0;
+
+  size_t frames = len / bytes_per_frame_;
+  uint64_t write_pos = write_pos_.load(std::memory_order_relaxed);
+  uint64_t read_pos = read_pos_.load(std::memory_order_acquire);
+  size_t count =
+      std::min<uint64_t>(frames, capacity_frames_ - (write_pos - read_pos));
+
+  size_t index = write_pos & capacity_mask_;
+  size_t first = std::min<uint64_t>(count, capacity_frames_ - index);
+  memcpy(&ring_[index * bytes_per_frame_], data, first * bytes_per_frame_);
+  memcpy(&ring_[0], data + first * bytes_per_frame_,
+         (count - first) * bytes_per_frame_);
+  write_pos_.store(write_pos + count, std::memory_order_release);
+
+  if (count < frames) {
+    overflow_frames_.fetch_add(frames - count, std::memory_order_relaxed);
+  }
+  return count * bytes_per_frame_;
+}
+
+size_t BtifA2dpSinkJitterBuffer::FramesDueForTrack(size_t track_frames) const {
+  // The track plays one tick while the next one is prepared, and keeps
+  // another to ride out a late tick
+  size_t wanted = MsToFrames(2 * options_.tick_ms);
+  if (track_frames >= wanted) return 0;
+  return std::min(wanted - track_frames, max_frames_due_);
+}
+
+size_t BtifA2dpSinkJitterBuffer::FramesDue(uint64_t now_us) {
+  if (sample_rate_ == 0) return 0;
+  if (playout_start_us_ == 0 || now_us < playout_start_us_) {
+    playout_start_us_ = now_us;
+    playout_frames_ = 0;
+  }
+
+  // The playout runs a tick ahead of the clock, so that the audio track has
+  // a tick worth of audio to play while the next one is prepared
+  uint64_t elapsed_us = now_us - playout_start_us_ + options_.tick_ms * 1000;
+  uint64_t frames = elapsed_us * sample_rate_ / 1000000;
+  // A consumer which was held up catches up over the next calls
+  size_t due = std::min<uint64_t>(frames - playout_frames_, max_frames_due_);
+  playout_frames_ += due;
+  return due;
+}
+
+bool BtifA2dpSinkJitterBuffer::IsIdle(uint64_t now_us) const {
+  if (state_ != State::kBuffering) return false;
+  uint64_t last_arrival_us = last_arrival_us_.load(std::memory_order_relaxed);
+  return now_us >= last_arrival_us + kIdleUs;
+}
+
+size_t BtifA2dpSinkJitterBuffer::Read(uint8_t* out, size_t frames) {
+  if (ring_.empty() || frames == 0) return 0;
+
+  uint64_t read_pos = read_pos_.load(std::memory_order_relaxed);
+  uint64_t available =
+      write_pos_.load(std::memory_order_acquire) - read_pos;
+  size_t target = TargetFrames();
+  depth_ms_.store(FramesToMs(available), std::memory_order_relaxed);
+
+  if (state_ == State::kBuffering) {
+    if (available < target || available == 0) {
+      memset(out, 0, frames * bytes_per_frame_);
+      silence_frames_.fetch_add(frames, std::memory_order_relaxed);
+      return 0;
+    }
+    state_ = State::kPlaying;
+    drop_window_.Reset();
+    repeat_window_.Reset();
+  }
+
+  if (available > MsToFrames(options_.max_depth_ms) + frames) {
+    uint64_t drop = available - target;
+    read_pos += drop;
+    available -= drop;
+    dropped_frames_.fetch_add(drop, std::memory_order_relaxed);
+    drop_window_.Reset();
+    repeat_window_.Reset();
+  }
+
+  // The lowest the buffer got recently is what it could have done without
+  uint64_t left = available > frames ? available - frames : 0;
+  drop_window_.Update(left, frames, MsToFrames(kDropWindowMs));
+  repeat_window_.Update(left, frames, MsToFrames(kRepeatWindowMs));
+
+  int adjust = 0;
+  if (options_.adjust_depth) {
+    uint64_t margin = MsToFrames(options_.tick_ms + underrun_boost_ms_);
+    uint64_t hysteresis = MsToFrames(options_.tick_ms / 2);
+    if (drop_window_.full && drop_window_.Get() > margin + hysteresis) {
+      adjust = 1;
+    } else if (repeat_window_.Get() + hysteresis < margin) {
+      adjust = -1;
+    }
+  }
+
+  // Stretching goes on until the output is back on a whole frame, so that
+  // it never ends in a jump of a fraction of a frame
+  if (stretch_ == 0 && adjust != 0) stretch_ = adjust;
+  size_t played = 0;
+  while (played < frames && stretch_ != 0 && available >= 2) {
+    InterpolateOut(out + played * bytes_per_frame_, read_pos, stretch_phase_);
+    played++;
+    stretch_phase_ += kStretchPeriodFrames + stretch_;
+    uint32_t advance = stretch_phase_ / kStretchPeriodFrames;
+    stretch_phase_ %= kStretchPeriodFrames;
+    read_pos += advance;
+    available -= advance;
+    if (advance > 1) {
+      dropped_frames_.fetch_add(1, std::memory_order_relaxed);
+    } else if (advance == 0) {
+      inserted_frames_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (stretch_phase_ == 0) stretch_ = adjust;
+  }
+
+  if (stretch_ == 0) {
+    size_t count = std::min<uint64_t>(frames - played, available);
+    CopyOut(out + played * bytes_per_frame_, read_pos, count);
+    read_pos += count;
+    available -= count;
+    played += count;
+  }
+  read_pos_.store(read_pos, std::memory_order_release);
+  frames_played_.fetch_add(played, std::memory_order_relaxed);
+
+  if (played < frames) {
+    memset(out + played * bytes_per_frame_, 0,
+           (frames - played) * bytes_per_frame_);
+    silence_frames_.fetch_add(frames - played, std::memory_order_relaxed);
+    underruns_.fetch_add(1, std::memory_order_relaxed);
+    state_ = State::kBuffering;
+    stretch_ = 0;
+    stretch_phase_ = 0;
+    underrun_boost_ms_ = std::min(underrun_boost_ms_ + options_.tick_ms,
+                                  options_.max_depth_ms);
+    frames_since_underrun_ = 0;
+    return played;
+  }
+
+  // Give back a millisecond of the depth gained on underruns for every
+  // second played without one
+  frames_since_underrun_ += frames;
+  if (frames_since_underrun_ >= sample_rate_) {
+    frames_since_underrun_ = 0;
+    if (underrun_boost_ms_ > 0) underrun_boost_ms_--;
+  }
+  return played;
+}
+
+BtifA2dpSinkJitterBuffer::Stats BtifA2dpSinkJitterBuffer::GetStats() const {
+  Stats stats;
+  stats.frames_written = write_pos_.load(std::memory_order_relaxed);
+  stats.frames_played = frames_played_.load(std::memory_order_relaxed);
+  stats.overflow_frames = overflow_frames_.load(std::memory_order_relaxed);
+  stats.underruns = underruns_.load(std::memory_order_relaxed);
+  stats.silence_frames = silence_frames_.load(std::memory_order_relaxed);
+  stats.dropped_frames = dropped_frames_.load(std::memory_order_relaxed);
+  stats.inserted_frames = inserted_frames_.load(std::memory_order_relaxed);
+  stats.target_depth_ms = target_depth_ms_.load(std::memory_order_relaxed);
+  stats.depth_ms = depth_ms_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void BtifA2dpSinkJitterBuffer::WindowMin::Update(uint64_t value,
+                                                size_t frames,
+                                                size_t window_frames) {
+  current = std::min(current, value);
+  this->frames += frames;
+  if (this->frames >= window_frames) {
+    previous = current;
+    current = UINT64_MAX;
+    this->frames = 0;
+    full = true;
+  }
+}
+
+size_t BtifA2dpSinkJitterBuffer::MsToFrames(uint32_t ms) const {
+  return static_cast<uint64_t>(ms) * sample_rate_ / 1000;
+}
+
+uint32_t BtifA2dpSinkJitterBuffer::FramesToMs(size_t frames) const {
+  if (sample_rate_ == 0) return 0;
+  return static_cast<uint64_t>(frames) * 1000 / sample_rate_;
+}
+
+size_t BtifA2dpSinkJitterBuffer::TargetFrames() {
+  uint32_t depth_ms = options_.fixed_depth_ms;
+  if (depth_ms == 0) {
+    depth_ms = arrival_depth_ms_.load(std::memory_order_relaxed) +
+               underrun_boost_ms_;
+    depth_ms = std::clamp(depth_ms, options_.min_depth_ms,
+                          options_.max_depth_ms);
+  }
+  target_depth_ms_.store(depth_ms, std::memory_order_relaxed);
+  return MsToFrames(depth_ms);
+}
+
+void BtifA2dpSinkJitterBuffer::CopyOut(uint8_t* out, uint64_t read_pos,
+                                       size_t frames) const {
+  size_t index = read_pos & capacity_mask_;
+  size_t first = std::min<uint64_t>(frames, capacity_frames_ - index);
+  memcpy(out, &ring_[index * bytes_per_frame_], first * bytes_per_frame_);
+  memcpy(out + first * bytes_per_frame_, &ring_[0],
+         (frames - first) * bytes_per_frame_);
+}
+
+void BtifA2dpSinkJitterBuffer::InterpolateOut(uint8_t* out, uint64_t read_pos,
+                                              uint32_t phase) const {
+  const uint8_t* from = &ring_[(read_pos & capacity_mask_) * bytes_per_frame_];
+  const uint8_t* to =
+      &ring_[((read_pos + 1) & capacity_mask_) * bytes_per_frame_];
+  for (size_t i = 0; i < channel_count_; i++) {
+    size_t offset = i * bytes_per_sample_;
+    int64_t a = LoadSample(from + offset, bytes_per_sample_);
+    int64_t b = LoadSample(to + offset, bytes_per_sample_);
+    StoreSample(out + offset, bytes_per_sample_,
+                a + (b - a) * phase / kStretchPeriodFrames);
+  }
+}
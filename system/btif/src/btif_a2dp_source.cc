@@ -1293,6 +1293,21 @@ void btif_a2dp_source_debug_dump(int fd) {
       (unsigned long long)dequeue_stats->max_premature_scheduling_delta_us /
           1000,
       (unsigned long long)ave_time_us / 1000);
+
+  tUIPC_RING_STATS ring_stats;
+  if (a2dp_uipc != nullptr &&
+      UIPC_Ioctl(*a2dp_uipc, UIPC_CH_ID_AV_AUDIO, UIPC_GET_RING_STATS,
+                 &ring_stats)) {
+    const bluetooth::uipc::RingStats& rx = ring_stats.upstream;
+    dprintf(fd,
+            "  Audio ring fill in bytes (size/now/max/ave)             : %u / "
+            "%u / %u / %u\n",
+            rx.size, rx.fill, rx.max_fill, rx.avg_fill);
+    dprintf(fd,
+            "  Audio ring counts (underruns/overruns)                  : %llu "
+            "/ %llu\n",
+            (unsigned long long)rx.underruns, (unsigned long long)rx.overruns);
+  }
 }
 
 static void btif_a2dp_source_update_metrics(void) {
@@ -142,6 +142,19 @@ void BtifAvrcpSetAudioTrackGain(void* handle, float gain) {
   // Does nothing right now
 }
 
+int BtifAvrcpAudioTrackGetBufferedFrames(void* handle) {
+  if (handle == NULL) {
+    LOG_INFO("%s handle is null.", __func__);
+    return -1;
+  }
+  BtifAvrcpAudioTrack* trackHolder = static_cast<BtifAvrcpAudioTrack*>(handle);
+  CHECK(trackHolder->stream != NULL);
+  int64_t written = AAudioStream_getFramesWritten(trackHolder->stream);
+  int64_t read = AAudioStream_getFramesRead(trackHolder->stream);
+  if (written < 0 || read < 0) return -1;
+  return std::max<int64_t>(written - read, 0);
+}
+
 constexpr float kScaleQ15ToFloat = 1.0f / 32768.0f;
 constexpr float kScaleQ23ToFloat = 1.0f / 8388608.0f;
 constexpr float kScaleQ31ToFloat = 1.0f / 2147483648.0f;
@@ -31,6 +31,8 @@ void BtifAvrcpAudioTrackPause(void* handle) {}
 
 void BtifAvrcpSetAudioTrackGain(void* handle, float gain) {}
 
+int BtifAvrcpAudioTrackGetBufferedFrames(void* handle) { return -1; }
+
 int BtifAvrcpAudioTrackWriteData(void* handle, void* audioBuffer,
                                  int bufferlen) {
   return 0;
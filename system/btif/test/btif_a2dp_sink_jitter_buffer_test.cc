@@ -0,0 +1,368 @@
+/*
+ *  Copyright 2023 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "btif/include/btif_a2dp_sink_jitter_buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t kSampleRate = 48000;
+constexpr size_t kFramesPerMs = kSampleRate / 1000;
+// 16 bit stereo, each frame holding its index for the tests to follow
+constexpr uint32_t kBitsPerSample = 16;
+constexpr uint32_t kChannelCount = 2;
+constexpr size_t kBytesPerFrame = 4;
+
+std::vector<uint8_t> MakeFrames(uint32_t first, size_t count) {
+  std::vector<uint8_t> data(count * kBytesPerFrame);
+  for (size_t i = 0; i < count; i++) {
+    uint32_t index = first + i;
+    memcpy(&data[i * kBytesPerFrame], &index, kBytesPerFrame);
+  }
+  return data;
+}
+
+uint32_t FrameAt(const std::vector<uint8_t>& data, size_t i) {
+  uint32_t index;
+  memcpy(&index, &data[i * kBytesPerFrame], kBytesPerFrame);
+  return index;
+}
+
+class BtifA2dpSinkJitterBufferTest : public ::testing::Test {
+ protected:
+  void Configure(const BtifA2dpSinkJitterBuffer::Options& options) {
+    buffer_ = std::make_unique<BtifA2dpSinkJitterBuffer>(options);
+    ASSERT_TRUE(buffer_->Configure(kSampleRate, kBitsPerSample, kChannelCount));
+  }
+
+  void WriteFrames(size_t frames) {
+    auto data = MakeFrames(next_frame_, frames);
+    ASSERT_EQ(buffer_->Write(data.data(), data.size()), data.size());
+    next_frame_ += frames;
+  }
+
+  void WriteMs(uint32_t ms) { WriteFrames(ms * kFramesPerMs); }
+
+  // A 1 kHz tone at half scale on both channels, continuing from the last
+  // frames written
+  void WriteTone(size_t frames) {
+    std::vector<int16_t> data(frames * kChannelCount);
+    for (size_t i = 0; i < frames; i++) {
+      double t = static_cast<double>(next_frame_ + i) / kSampleRate;
+      int16_t sample = 16384 * std::sin(2 * M_PI * 1000 * t);
+      data[i * kChannelCount] = sample;
+      data[i * kChannelCount + 1] = -sample;
+    }
+    ASSERT_EQ(buffer_->Write(reinterpret_cast<uint8_t*>(data.data()),
+                             data.size() * sizeof(int16_t)),
+              data.size() * sizeof(int16_t));
+    next_frame_ += frames;
+  }
+
+  // Largest difference between two successive samples of the left channel
+  // read so far, a jump in the waveform showing up as a large one
+  int32_t ReadToneMs(uint32_t ms) {
+    size_t played = ReadMs(ms);
+    EXPECT_EQ(played, ms * kFramesPerMs);
+    const int16_t* samples = reinterpret_cast<const int16_t*>(out_.data());
+    for (size_t i = 0; i < played; i++) {
+      int16_t sample = samples[i * kChannelCount];
+      EXPECT_EQ(samples[i * kChannelCount + 1], -sample);
+      if (has_last_sample_) {
+        max_step_ = std::max(max_step_, std::abs(sample - last_sample_));
+      }
+      last_sample_ = sample;
+      has_last_sample_ = true;
+    }
+    return max_step_;
+  }
+
+  size_t ReadMs(uint32_t ms) {
+    out_.resize(ms * kFramesPerMs * kBytesPerFrame);
+    return buffer_->Read(out_.data(), ms * kFramesPerMs);
+  }
+
+  std::unique_ptr<BtifA2dpSinkJitterBuffer> buffer_;
+  std::vector<uint8_t> out_;
+  uint32_t next_frame_ = 1;
+  int32_t last_sample_ = 0;
+  bool has_last_sample_ = false;
+  int32_t max_step_ = 0;
+};
+
+// Largest difference between two successive samples of the tone of WriteTone
+// played as is: 16384 * 2 * pi * 1000 / 48000, rounded up
+constexpr int32_t kToneMaxStep = 2146;
+
+TEST_F(BtifA2dpSinkJitterBufferTest, rejects_invalid_stream) {
+  BtifA2dpSinkJitterBuffer buffer;
+  ASSERT_FALSE(buffer.Configure(0, kBitsPerSample, kChannelCount));
+  ASSERT_FALSE(buffer.Configure(kSampleRate, 8, kChannelCount));
+  ASSERT_FALSE(buffer.Configure(kSampleRate, kBitsPerSample, 0));
+  uint8_t frame[kBytesPerFrame] = {};
+  ASSERT_EQ(buffer.Write(frame, sizeof(frame)), 0u);
+}
+
+TEST_F(BtifA2dpSinkJitterBufferTest, plays_silence_until_target_depth) {
+  BtifA2dpSinkJitterBuffer::Options options;
+  options.min_depth_ms = 40;
+  Configure(options);
+
+  WriteMs(20);
+  ASSERT_EQ(ReadMs(20), 0u);
+  for (size_t i = 0; i < 20 * kFramesPerMs; i++) {
+    ASSERT_EQ(FrameAt(out_, i), 0u);
+  }
+
+  WriteMs(20);
+  ASSERT_EQ(ReadMs(20), 20 * kFramesPerMs);
+  ASSERT_EQ(FrameAt(out_, 0), 1u);
+  ASSERT_EQ(buffer_->GetStats().silence_frames, 20 * kFramesPerMs);
+  ASSERT_EQ(buffer_->GetStats().underruns, 0u);
+}
+
+TEST_F(BtifA2dpSinkJitterBufferTest, plays_in_order_across_the_ring) {
+  BtifA2dpSinkJitterBuffer::Options options;
+  options.fixed_depth_ms = 10;
+  options.adjust_depth = false;
+  Configure(options);
+
+  // Write and read in sizes that do not divide the ring, many times over
+  uint32_t expected = 1;
+  for (int i = 0; i < 500; i++) {
+    WriteMs(17);
+    if (i == 0) continue;
+    size_t played = ReadMs(17);
+    for (size_t j = 0; j < played; j++) {
+      ASSERT_EQ(FrameAt(out_, j), expected++);
+    }
+  }
+  ASSERT_EQ(buffer_->GetStats().underruns, 0u);
+  ASSERT_EQ(buffer_->GetStats().dropped_frames, 0u);
+}
+
+TEST_F(BtifA2dpSinkJitterBufferTest, underrun_fills_silence_and_rebuffers) {
+  BtifA2dpSinkJitterBuffer::Options options;
+  options.min_depth_ms = 40;
+  options.adjust_depth = false;
+  Configure(options);
+
+  WriteMs(50);
+  ASSERT_EQ(ReadMs(20), 20 * kFramesPerMs);
+  ASSERT_EQ(ReadMs(20), 20 * kFramesPerMs);
+  ASSERT_EQ(ReadMs(20), 10 * kFramesPerMs);
+  ASSERT_EQ(FrameAt(out_, 10 * kFramesPerMs - 1), 50 * kFramesPerMs);
+  ASSERT_EQ(FrameAt(out_, 10 * kFramesPerMs), 0u);
+
+  auto stats = buffer_->GetStats();
+  ASSERT_EQ(stats.underruns, 1u);
+  ASSERT_EQ(stats.silence_frames, 10 * kFramesPerMs);
+
+  // Back to buffering, with a deeper target after the underrun
+  WriteMs(40);
+  ASSERT_EQ(ReadMs(20), 0u);
+  ASSERT_EQ(buffer_->GetStats().target_depth_ms, 60u);
+  WriteMs(20);
+  ASSERT_EQ(ReadMs(20), 20 * kFramesPerMs);
+}
+
+TEST_F(BtifA2dpSinkJitterBufferTest, target_follows_packet_gaps) {
+  BtifA2dpSinkJitterBuffer::Options options;
+  options.min_depth_ms = 40;
+  options.max_depth_ms = 500;
+  Configure(options);
+
+  // A steady stream needs no more than the minimum
+  uint64_t now_us = 1000000;
+  for (int i = 0; i < 100; i++) {
+    buffer_->OnPacketArrival(now_us);
+    now_us += 13000;
+  }
+  ReadMs(20);
+  ASSERT_EQ(buffer_->GetStats().target_depth_ms, 40u);
+
+  // Bursts of five packets every 100 ms need to last through the gaps
+  for (int i = 0; i < 100; i++) {
+    for (int j = 0; j < 5; j++) buffer_->OnPacketArrival(now_us + j * 500);
+    now_us += 100000;
+  }
+  ReadMs(20);
+  uint32_t target_ms = buffer_->GetStats().target_depth_ms;
+  ASSERT_GE(target_ms, 100u + options.tick_ms);
+  ASSERT_LE(target_ms, 110u + options.tick_ms);
+
+  // A suspended stream is not a gap to cover
+  buffer_->OnPacketArrival(now_us + 5000000);
+  ReadMs(20);
+  ASSERT_EQ(buffer_->GetStats().target_depth_ms, target_ms);
+}
+
+TEST_F(BtifA2dpSinkJitterBufferTest, converges_on_target_by_dropping) {
+  BtifA2dpSinkJitterBuffer::Options options;
+  options.fixed_depth_ms = 60;
+  Configure(options);
+
+  WriteTone(150 * kFramesPerMs);
+  for (int i = 0; i < 10000; i++) {
+    WriteTone(20 * kFramesPerMs);
+    ReadToneMs(20);
+  }
+  auto stats = buffer_->GetStats();
+  ASSERT_EQ(stats.underruns, 0u);
+  ASSERT_GT(stats.dropped_frames, 0u);
+  ASSERT_EQ(stats.inserted_frames, 0u);
+  // Down to a margin of a tick after the read, give or take half a tick
+  ASSERT_LE(stats.depth_ms, options.tick_ms * 5 / 2 + 1);
+  // Played at most 0.1% faster, without a jump in the waveform
+  ASSERT_LE(max_step_, kToneMaxStep * 1001 / 1000 + 1);
+}
+
+TEST_F(BtifA2dpSinkJitterBufferTest, converges_on_target_by_repeating) {
+  BtifA2dpSinkJitterBuffer::Options options;
+  options.fixed_depth_ms = 100;
+  Configure(options);
+
+  WriteTone(100 * kFramesPerMs);
+  ReadToneMs(20);
+  // The source clock runs 0.05% slower than the one of the audio track
+  for (int i = 0; i < 4000; i++) {
+    WriteTone(20 * kFramesPerMs * 9995 / 10000);
+    ReadToneMs(20);
+  }
+  auto stats = buffer_->GetStats();
+  ASSERT_EQ(stats.underruns, 0u);
+  ASSERT_GT(stats.inserted_frames, 0u);
+  ASSERT_GE(stats.depth_ms, options.tick_ms * 5 / 4);
+  // Played slower, so no step is any larger than in the tone
+  ASSERT_LE(max_step_, kToneMaxStep);
+}
+
+TEST_F(BtifA2dpSinkJitterBufferTest, stretches_24_bit_audio) {
+  BtifA2dpSinkJitterBuffer::Options options;
+  options.fixed_depth_ms = 40;
+  buffer_ = std::make_unique<BtifA2dpSinkJitterBuffer>(options);
+  ASSERT_TRUE(buffer_->Configure(kSampleRate, 24, 1));
+
+  // A ramp of packed 24 bit samples, going through negative values
+  auto write_ramp = [this](size_t frames) {
+    std::vector<uint8_t> data(frames * 3);
+    for (size_t i = 0; i < frames; i++) {
+      int32_t sample = (static_cast<int32_t>(next_frame_ + i) - 100000) * 16;
+      memcpy(&data[i * 3], &sample, 3);
+    }
+    ASSERT_EQ(buffer_->Write(data.data(), data.size()), data.size());
+    next_frame_ += frames;
+  };
+  write_ramp(200 * kFramesPerMs);
+  std::vector<uint8_t> out(20 * kFramesPerMs * 3);
+  int32_t last = 0;
+  for (int i = 0; i < 400; i++) {
+    write_ramp(20 * kFramesPerMs);
+    ASSERT_EQ(buffer_->Read(out.data(), 20 * kFramesPerMs), 20 * kFramesPerMs);
+    for (size_t j = 0; j < 20 * kFramesPerMs; j++) {
+      int32_t sample = 0;
+      memcpy(&sample, &out[j * 3], 3);
+      sample = static_cast<int32_t>(static_cast<uint32_t>(sample) << 8) >> 8;
+      // The ramp climbs by 16 per frame, a little more while stretching
+      if (i > 0 || j > 0) {
+        ASSERT_GE(sample - last, 16);
+        ASSERT_LE(sample - last, 17);
+      }
+      last = sample;
+    }
+  }
+  ASSERT_GT(buffer_->GetStats().dropped_frames, 0u);
+}
+
+TEST_F(BtifA2dpSinkJitterBufferTest, drops_when_far_too_deep) {
+  BtifA2dpSinkJitterBuffer::Options options;
+  options.fixed_depth_ms = 40;
+  options.max_depth_ms = 200;
+  options.adjust_depth = false;
+  Configure(options);
+
+  WriteMs(300);
+  ASSERT_EQ(ReadMs(20), 20 * kFramesPerMs);
+  auto stats = buffer_->GetStats();
+  ASSERT_EQ(stats.dropped_frames, 260 * kFramesPerMs);
+  ASSERT_EQ(FrameAt(out_, 0), 260 * kFramesPerMs + 1);
+}
+
+TEST_F(BtifA2dpSinkJitterBufferTest, counts_overflow) {
+  BtifA2dpSinkJitterBuffer::Options options;
+  options.max_depth_ms = 100;
+  Configure(options);
+
+  // The ring holds at least twice the maximum depth
+  auto data = MakeFrames(0, 1000 * kFramesPerMs);
+  size_t written = buffer_->Write(data.data(), data.size());
+  ASSERT_GE(written, 200 * kFramesPerMs * kBytesPerFrame);
+  ASSERT_LT(written, data.size());
+  ASSERT_EQ(buffer_->GetStats().overflow_frames,
+            (data.size() - written) / kBytesPerFrame);
+}
+
+TEST_F(BtifA2dpSinkJitterBufferTest, frames_due_follow_the_clock) {
+  BtifA2dpSinkJitterBuffer::Options options;
+  Configure(options);
+
+  uint64_t now_us = 5000000;
+  ASSERT_EQ(buffer_->FramesDue(now_us), options.tick_ms * kFramesPerMs);
+  ASSERT_EQ(buffer_->FramesDue(now_us + 20000), 20 * kFramesPerMs);
+  ASSERT_EQ(buffer_->FramesDue(now_us + 45000), 25 * kFramesPerMs);
+  // A consumer held up for 100 ms catches up over the next ticks, at most
+  // MaxFramesDue() at a time
+  ASSERT_EQ(buffer_->FramesDue(now_us + 145000), buffer_->MaxFramesDue());
+  ASSERT_EQ(buffer_->FramesDue(now_us + 165000), 40 * kFramesPerMs);
+  ASSERT_EQ(buffer_->FramesDue(now_us + 185000), 20 * kFramesPerMs);
+}
+
+TEST_F(BtifA2dpSinkJitterBufferTest, frames_due_follow_the_track) {
+  BtifA2dpSinkJitterBuffer::Options options;
+  Configure(options);
+
+  // Up to two ticks in the audio track
+  ASSERT_EQ(buffer_->FramesDueForTrack(0), 2 * options.tick_ms * kFramesPerMs);
+  ASSERT_EQ(buffer_->FramesDueForTrack(15 * kFramesPerMs),
+            (2 * options.tick_ms - 15) * kFramesPerMs);
+  ASSERT_EQ(buffer_->FramesDueForTrack(2 * options.tick_ms * kFramesPerMs),
+            0u);
+  ASSERT_EQ(buffer_->FramesDueForTrack(500 * kFramesPerMs), 0u);
+}
+
+TEST_F(BtifA2dpSinkJitterBufferTest, idle_without_packets_or_audio) {
+  BtifA2dpSinkJitterBuffer::Options options;
+  Configure(options);
+
+  uint64_t now_us = 5000000;
+  buffer_->OnPacketArrival(now_us);
+  WriteMs(50);
+  ReadMs(20);
+  // Still playing what came in
+  ASSERT_FALSE(buffer_->IsIdle(now_us + 2 * BtifA2dpSinkJitterBuffer::kIdleUs));
+
+  ReadMs(20);
+  ReadMs(20);
+  ASSERT_FALSE(buffer_->IsIdle(now_us + 60000));
+  ASSERT_TRUE(buffer_->IsIdle(now_us + BtifA2dpSinkJitterBuffer::kIdleUs));
+}
+
+}  // namespace
@@ -0,0 +1,190 @@
+/*
+ *  Copyright 2023 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+// Replays the timing of an AVDTP media stream through the A2DP Sink jitter
+// buffer, as the sink worker would run it, and reports the latency and the
+// underruns it ends up with. Each run is printed on one line of key=value
+// pairs.
+//
+// Usage: btif_a2dp_sink_jitter_replay [--rate=<hz>] [--fixed=<ms>,...]
+//            <trace>...
+//
+// A trace is a text file with one media packet per line: its arrival time in
+// microseconds and the number of PCM frames it decodes to, as extracted from
+// a btsnoop log. Lines starting with '#' are ignored. The synthetic traces
+// "steady", "bursty", "stalls" and "drift" can be named in place of a file.
+//
+// Every trace is played with the adaptive depth, then with each of the fixed
+// depths given by --fixed, which play the part of a static queue size.
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "btif/include/btif_a2dp_sink_jitter_buffer.h"
+
+namespace {
+
+// 16 bit stereo
+constexpr size_t kBytesPerFrame = 4;
+
+struct Packet {
+  uint64_t arrival_us;
+  uint32_t frames;
+};
+
+bool LoadTrace(const char* path, std::vector<Packet>* trace) {
+  FILE* file = fopen(path, "r");
+  if (file == nullptr) return false;
+  char line[256];
+  while (fgets(line, sizeof(line), file) != nullptr) {
+    if (line[0] == '#' || line[0] == '\n') continue;
+    Packet packet;
+    if (sscanf(line, "%" SCNu64 " %" SCNu32, &packet.arrival_us,
+               &packet.frames) != 2) {
+      fprintf(stderr, "%s: cannot parse '%s'\n", path, line);
+      fclose(file);
+      return false;
+    }
+    trace->push_back(packet);
+  }
+  fclose(file);
+  return true;
+}
+
+// One minute of SBC packets of 8 frames of 128 samples at 44.1 kHz, each
+// lasting 23.2 ms
+std::vector<Packet> SyntheticTrace(const std::string& name, uint32_t rate) {
+  constexpr uint32_t kFramesPerPacket = 1024;
+  uint64_t packet_us = kFramesPerPacket * 1000000ull / rate;
+  uint64_t packets = 60000000 / packet_us;
+  std::vector<Packet> trace;
+  srand(1);
+  for (uint64_t i = 0; i < packets; i++) {
+    uint64_t sent_us = i * packet_us;
+    uint64_t arrival_us = sent_us;
+    if (name == "steady") {
+      // A few milliseconds of jitter on the radio
+      arrival_us += rand() % 4000;
+    } else if (name == "bursty") {
+      // Sent five at a time, the way some phones fill their buffers
+      arrival_us = (i / 5 + 1) * 5 * packet_us + rand() % 2000;
+    } else if (name == "stalls") {
+      // Wi-Fi coexistence holding the link for 150 ms every 3 seconds
+      uint64_t period = (sent_us + 1500000) % 3000000;
+      if (period < 150000) arrival_us += 150000 - period;
+      arrival_us += rand() % 4000;
+    } else if (name == "drift") {
+      // The clock of the phone running 0.05% slower than the audio track
+      arrival_us = sent_us * 10005 / 10000 + rand() % 4000;
+    } else {
+      return {};
+    }
+    trace.push_back({arrival_us, kFramesPerPacket});
+  }
+  std::sort(trace.begin(), trace.end(), [](const Packet& a, const Packet& b) {
+    return a.arrival_us < b.arrival_us;
+  });
+  return trace;
+}
+
+void Replay(const std::string& name, const std::vector<Packet>& trace,
+            uint32_t rate, const BtifA2dpSinkJitterBuffer::Options& options,
+            const std::string& mode) {
+  BtifA2dpSinkJitterBuffer buffer(options);
+  buffer.Configure(rate, 16, 2);
+  std::vector<uint8_t> pcm;
+  std::vector<uint8_t> out(buffer.MaxFramesDue() * kBytesPerFrame);
+  std::vector<uint32_t> latencies_ms;
+
+  // Decoding happens on the ticks of the sink worker, as does the playout
+  uint64_t tick_us = options.tick_ms * 1000;
+  uint64_t now_us = trace.front().arrival_us + tick_us;
+  size_t next = 0;
+  while (next < trace.size()) {
+    for (; next < trace.size() && trace[next].arrival_us <= now_us; next++) {
+      buffer.OnPacketArrival(trace[next].arrival_us);
+      pcm.resize(trace[next].frames * kBytesPerFrame);
+      buffer.Write(pcm.data(), pcm.size());
+    }
+    size_t frames = buffer.FramesDue(now_us);
+    buffer.Read(out.data(), frames);
+    // What is buffered, plus the tick the audio track is ahead by
+    latencies_ms.push_back(buffer.GetStats().depth_ms + options.tick_ms);
+    now_us += tick_us;
+  }
+
+  auto stats = buffer.GetStats();
+  std::sort(latencies_ms.begin(), latencies_ms.end());
+  uint64_t total_ms = 0;
+  for (uint32_t latency_ms : latencies_ms) total_ms += latency_ms;
+  printf(
+      "trace=%s mode=%s packets=%zu latency_mean_ms=%" PRIu64
+      " latency_p95_ms=%u latency_max_ms=%u underruns=%" PRIu64
+      " silence_ms=%" PRIu64 " dropped_frames=%" PRIu64
+      " inserted_frames=%" PRIu64 " overflow_frames=%" PRIu64 "\n",
+      name.c_str(), mode.c_str(), trace.size(),
+      total_ms / latencies_ms.size(),
+      latencies_ms[latencies_ms.size() * 95 / 100], latencies_ms.back(),
+      stats.underruns, stats.silence_frames * 1000 / rate,
+      stats.dropped_frames, stats.inserted_frames, stats.overflow_frames);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  uint32_t rate = 44100;
+  std::vector<uint32_t> fixed_depths_ms = {40, 100, 200};
+  std::vector<std::string> traces;
+
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "--rate=", 7) == 0) {
+      rate = atoi(argv[i] + 7);
+    } else if (strncmp(argv[i], "--fixed=", 8) == 0) {
+      fixed_depths_ms.clear();
+      for (char* depth = strtok(argv[i] + 8, ","); depth != nullptr;
+           depth = strtok(nullptr, ",")) {
+        fixed_depths_ms.push_back(atoi(depth));
+      }
+    } else {
+      traces.push_back(argv[i]);
+    }
+  }
+  if (traces.empty()) traces = {"steady", "bursty", "stalls", "drift"};
+
+  for (const auto& name : traces) {
+    std::vector<Packet> trace = SyntheticTrace(name, rate);
+    if (trace.empty() && !LoadTrace(name.c_str(), &trace)) {
+      fprintf(stderr, "cannot read trace %s\n", name.c_str());
+      return 1;
+    }
+    if (trace.empty()) continue;
+
+    BtifA2dpSinkJitterBuffer::Options options;
+    Replay(name, trace, rate, options, "adaptive");
+    for (uint32_t depth_ms : fixed_depths_ms) {
+      options.fixed_depth_ms = depth_ms;
+      options.adjust_depth = false;
+      Replay(name, trace, rate, options, "fixed" + std::to_string(depth_ms));
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,181 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Allocation patterns of the stack data paths, run through the osi allocator.
+// Pass --osi_buffer_pools to serve them from the buffer pools rather than from
+// malloc, and compare the two runs.
+
+#include <benchmark/benchmark.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#include "osi/include/allocator.h"
+#include "osi/include/fixed_queue.h"
+
+using ::benchmark::State;
+
+namespace {
+
+constexpr int kBatch = 10000;
+
+// Sizes of the BT_HDR allocations, as the stack makes them
+constexpr size_t kBtHdrSize = 8;
+constexpr size_t kAclPacketSize = kBtHdrSize + 4 + 1021;
+constexpr size_t kL2capSduSize = kBtHdrSize + 1691;
+constexpr size_t kMediaPacketSize = kBtHdrSize + 4096 + 16;
+constexpr size_t kHciEventSize = kBtHdrSize + 2 + 255;
+
+// Resident set size of the process
+int64_t ResidentKb() {
+  FILE* file = fopen("/proc/self/statm", "r");
+  if (file == nullptr) return 0;
+  long size = 0, resident = 0;
+  if (fscanf(file, "%ld %ld", &size, &resident) != 2) resident = 0;
+  fclose(file);
+  return resident * sysconf(_SC_PAGESIZE) / 1024;
+}
+
+void* Fill(void* buffer, size_t size) {
+  // Touched as the stack would write the headers and copy in the payload
+  memset(buffer, 0, size);
+  return buffer;
+}
+
+// The allocator alone: buffers of each size allocated and freed on the same
+// thread, a few of them held at any time
+void BM_AllocFree(State& state) {
+  const size_t size = state.range(0);
+  void* held[8] = {};
+  size_t next = 0;
+  for (auto _ : state) {
+    osi_free(held[next]);
+    held[next] = osi_malloc(size);
+    ::benchmark::DoNotOptimize(held[next]);
+    next = (next + 1) % 8;
+  }
+  for (void* buffer : held) osi_free(buffer);
+  state.SetItemsProcessed(state.iterations());
+}
+
+// ACL packets looped back through the stack: the HCI thread receives the
+// packets and hands them to the stack thread, which reassembles them in L2CAP
+// SDUs and answers with packets of its own, freed by the HCI thread once
+// sent, along with the Number Of Completed Packets events.
+void BM_AclLoopback(State& state) {
+  fixed_queue_t* rx_queue = fixed_queue_new(SIZE_MAX);
+  fixed_queue_t* tx_queue = fixed_queue_new(SIZE_MAX);
+
+  for (auto _ : state) {
+    std::thread hci([rx_queue, tx_queue] {
+      for (int i = 0; i < kBatch; i++) {
+        fixed_queue_enqueue(rx_queue,
+                            Fill(osi_malloc(kAclPacketSize), kAclPacketSize));
+        osi_free(fixed_queue_dequeue(tx_queue));
+        if (i % 8 == 0) osi_free(Fill(osi_malloc(kHciEventSize), 16));
+      }
+    });
+
+    void* sdu = nullptr;
+    for (int i = 0; i < kBatch; i++) {
+      void* packet = fixed_queue_dequeue(rx_queue);
+      if (sdu == nullptr) sdu = osi_malloc(kL2capSduSize);
+      memcpy(sdu, packet, kAclPacketSize);
+      osi_free(packet);
+      // An SDU of the L2CAP MTU spans two ACL packets
+      if (i % 2 == 1) {
+        osi_free(sdu);
+        sdu = nullptr;
+      }
+      fixed_queue_enqueue(tx_queue,
+                          Fill(osi_malloc(kAclPacketSize), kAclPacketSize));
+    }
+    osi_free(sdu);
+    hci.join();
+  }
+
+  state.SetItemsProcessed(state.iterations() * kBatch);
+  state.counters["rss_kb"] = ResidentKb();
+  fixed_queue_free(rx_queue, osi_free);
+  fixed_queue_free(tx_queue, osi_free);
+}
+
+// A2DP Source media: the encoder thread allocates a media packet for each
+// encoded frame and queues it, and the HCI thread fragments each of them in
+// ACL packets once the queue holds a few, the way a stalled link drains.
+void BM_A2dpEncode(State& state) {
+  const size_t queue_depth = state.range(0);
+  fixed_queue_t* media_queue = fixed_queue_new(queue_depth);
+
+  for (auto _ : state) {
+    std::thread hci([media_queue] {
+      for (int i = 0; i < kBatch; i++) {
+        void* media = fixed_queue_dequeue(media_queue);
+        for (int fragment = 0; fragment < 4; fragment++) {
+          osi_free(Fill(osi_malloc(kAclPacketSize), kAclPacketSize));
+        }
+        osi_free(media);
+      }
+    });
+
+    for (int i = 0; i < kBatch; i++) {
+      void* media = osi_malloc(kMediaPacketSize);
+      Fill(media, kMediaPacketSize);
+      fixed_queue_enqueue(media_queue, media);
+    }
+    hci.join();
+  }
+
+  state.SetItemsProcessed(state.iterations() * kBatch);
+  state.counters["rss_kb"] = ResidentKb();
+  fixed_queue_free(media_queue, osi_free);
+}
+
+BENCHMARK(BM_AllocFree)
+    ->Arg(kHciEventSize)
+    ->Arg(kAclPacketSize)
+    ->Arg(kL2capSduSize)
+    ->Arg(kMediaPacketSize);
+BENCHMARK(BM_AclLoopback)->Unit(::benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_A2dpEncode)
+    ->Arg(2)
+    ->Arg(32)
+    ->Unit(::benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  // Set before the first allocation, and not known to the benchmark library
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--osi_buffer_pools") != 0) continue;
+    if (!osi_allocator_enable_pools()) {
+      fprintf(stderr, "The buffer pools could not be enabled\n");
+      return 1;
+    }
+    memmove(&argv[i], &argv[i + 1], (argc - i) * sizeof(argv[0]));
+    argc--;
+    break;
+  }
+
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
@@ -0,0 +1,182 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Loading, querying and saving a bt_config.conf holding a given number of
+// bonded devices, the way the stack does when it is enabled.
+
+#include <benchmark/benchmark.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "osi/include/config.h"
+
+using ::benchmark::State;
+
+namespace {
+
+const char* kLinkKeys[] = {"LinkKey",      "LE_KEY_PENC", "LE_KEY_PID",
+                           "LE_KEY_PCSRK", "LE_KEY_LENC", "LE_KEY_LCSRK",
+                           "LE_KEY_LID"};
+
+std::string TempDir() {
+  const char* dir = getenv("TMPDIR");
+  if (dir != nullptr) return dir;
+  if (access("/data/local/tmp", W_OK) == 0) return "/data/local/tmp";
+  return "/tmp";
+}
+
+std::string DeviceName(int device) {
+  char name[18];
+  snprintf(name, sizeof(name), "a4:5e:60:%02x:%02x:%02x", (device >> 16) & 0xff,
+           (device >> 8) & 0xff, device & 0xff);
+  return name;
+}
+
+// A config of the sections of the adapter, followed by those of |devices|
+// bonded devices with the keys a phone ends up storing for headsets, watches
+// and cars
+std::unique_ptr<config_t> MakeConfig(int devices) {
+  std::unique_ptr<config_t> config = config_new_empty();
+  config_set_string(config.get(), "Info", "FileSource", "Empty");
+  config_set_string(config.get(), "Info", "TimeCreated", "2023-01-01 00:00:00");
+  config_set_string(config.get(), "Metrics", "Salt256Bit",
+                    std::string(64, 'f'));
+  config_set_string(config.get(), "Adapter", "Address", "a4:5e:60:00:00:00");
+  config_set_string(config.get(), "Adapter", "Name", "Phone");
+  config_set_int(config.get(), "Adapter", "ScanMode", 0);
+  config_set_int(config.get(), "Adapter", "DiscoveryTimeout", 120);
+  config_set_string(config.get(), "Adapter", "LE_LOCAL_KEY_IRK",
+                    std::string(32, '0'));
+
+  for (int i = 0; i < devices; i++) {
+    std::string name = DeviceName(i);
+    config_set_string(config.get(), name, "Name", "Device " + name);
+    config_set_int(config.get(), name, "Timestamp", 1672531200 + i);
+    config_set_int(config.get(), name, "DevClass", 0x240404);
+    config_set_int(config.get(), name, "DevType", 3);
+    config_set_int(config.get(), name, "AddrType", 0);
+    config_set_string(config.get(), name, "Service",
+                      "0000110b-0000-1000-8000-00805f9b34fb "
+                      "0000110e-0000-1000-8000-00805f9b34fb "
+                      "0000111e-0000-1000-8000-00805f9b34fb");
+    config_set_int(config.get(), name, "Manufacturer", 29);
+    config_set_int(config.get(), name, "LmpVer", 11);
+    config_set_int(config.get(), name, "LmpSubVer", 8721);
+    config_set_int(config.get(), name, "AvrcpCtVersion", 0x0106);
+    config_set_int(config.get(), name, "AvrcpFeatures", 0x01c3);
+    config_set_int(config.get(), name, "LinkKeyType", 8);
+    config_set_int(config.get(), name, "PinLength", 0);
+    for (const char* key : kLinkKeys) {
+      config_set_string(config.get(), name, key, std::string(56, '3'));
+    }
+    config_set_int(config.get(), name, "LE_KEY_PENC_SIZE", 16);
+    config_set_string(config.get(), name, "GattClientDatabaseHash",
+                      std::string(32, 'a'));
+  }
+  return config;
+}
+
+class ConfigFixture : public ::benchmark::Fixture {
+ public:
+  void SetUp(const State& state) override {
+    config_ = MakeConfig(state.range(0));
+    path_ = TempDir() + "/bt_config_benchmark.conf";
+    config_save(*config_, path_);
+  }
+
+  void TearDown(const State& state) override {
+    unlink(path_.c_str());
+    config_.reset();
+  }
+
+ protected:
+  std::unique_ptr<config_t> config_;
+  std::string path_;
+};
+
+// config_new at enable, which btif_config and bte_conf go through
+BENCHMARK_DEFINE_F(ConfigFixture, BM_Load)(State& state) {
+  for (auto _ : state) {
+    std::unique_ptr<config_t> config = config_new(path_.c_str());
+    ::benchmark::DoNotOptimize(config);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// The lookups of btif_storage_load_bonded_devices: the keys of each bonded
+// device, as btif_in_fetch_bonded_devices and the remote device properties
+// read them, including the LE keys a BR/EDR device does not have
+BENCHMARK_DEFINE_F(ConfigFixture, BM_LoadBondedDevices)(State& state) {
+  std::vector<std::string> names;
+  for (int i = 0; i < state.range(0); i++) names.push_back(DeviceName(i));
+
+  for (auto _ : state) {
+    int found = 0;
+    for (const std::string& name : names) {
+      found += config_get_string(*config_, name, "LinkKey", nullptr) != nullptr;
+      found += config_get_int(*config_, name, "LinkKeyType", -1);
+      found += config_get_int(*config_, name, "DevClass", 0);
+      found += config_get_int(*config_, name, "PinLength", 0);
+      found += config_get_int(*config_, name, "DevType", 0);
+      for (const char* key : kLinkKeys) {
+        found += config_has_key(*config_, name, key);
+      }
+      found += config_get_int(*config_, name, "AddrType", 0);
+      found += config_get_string(*config_, name, "Name", nullptr) != nullptr;
+      found += config_get_string(*config_, name, "Aliase", nullptr) != nullptr;
+      found += config_get_int(*config_, name, "DevClass", 0);
+      found += config_get_int(*config_, name, "DevType", 0);
+      found += config_get_string(*config_, name, "Service", nullptr) != nullptr;
+    }
+    ::benchmark::DoNotOptimize(found);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// config_save of btif_config, on every bonding and property change
+BENCHMARK_DEFINE_F(ConfigFixture, BM_Save)(State& state) {
+  for (auto _ : state) {
+    config_save(*config_, path_);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK_REGISTER_F(ConfigFixture, BM_Load)
+    ->Arg(10)
+    ->Arg(100)
+    ->Arg(500)
+    ->Unit(::benchmark::kMicrosecond);
+BENCHMARK_REGISTER_F(ConfigFixture, BM_LoadBondedDevices)
+    ->Arg(10)
+    ->Arg(100)
+    ->Arg(500)
+    ->Unit(::benchmark::kMicrosecond);
+BENCHMARK_REGISTER_F(ConfigFixture, BM_Save)
+    ->Arg(500)
+    ->Unit(::benchmark::kMicrosecond);
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
@@ -0,0 +1,198 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "osi/include/fixed_queue.h"
+#include "osi/include/list.h"
+#include "osi/include/reactor.h"
+#include "osi/include/semaphore.h"
+#include "osi/include/thread.h"
+
+using ::benchmark::State;
+
+namespace {
+
+constexpr int kBatch = 10000;
+
+// The fixed_queue_t as it was before the ring: a list guarded by a mutex, and
+// an eventfd semaphore for each direction, kept here as the baseline.
+class LegacyQueue {
+ public:
+  explicit LegacyQueue(size_t capacity)
+      : list_(list_new(nullptr)),
+        enqueue_sem_(semaphore_new(capacity)),
+        dequeue_sem_(semaphore_new(0)) {}
+
+  ~LegacyQueue() {
+    list_free(list_);
+    semaphore_free(enqueue_sem_);
+    semaphore_free(dequeue_sem_);
+  }
+
+  void Enqueue(void* data) {
+    semaphore_wait(enqueue_sem_);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      list_append(list_, data);
+    }
+    semaphore_post(dequeue_sem_);
+  }
+
+  void* Dequeue() {
+    semaphore_wait(dequeue_sem_);
+    return Pop();
+  }
+
+  void* TryDequeue() {
+    if (!semaphore_try_wait(dequeue_sem_)) return nullptr;
+    return Pop();
+  }
+
+  int DequeueFd() const { return semaphore_get_fd(dequeue_sem_); }
+
+ private:
+  void* Pop() {
+    void* ret;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ret = list_front(list_);
+      list_remove(list_, ret);
+    }
+    semaphore_post(enqueue_sem_);
+    return ret;
+  }
+
+  list_t* list_;
+  semaphore_t* enqueue_sem_;
+  semaphore_t* dequeue_sem_;
+  std::mutex mutex_;
+};
+
+class FixedQueue {
+ public:
+  explicit FixedQueue(size_t capacity) : queue_(fixed_queue_new(capacity)) {}
+  ~FixedQueue() { fixed_queue_free(queue_, nullptr); }
+
+  void Enqueue(void* data) { fixed_queue_enqueue(queue_, data); }
+  void* Dequeue() { return fixed_queue_dequeue(queue_); }
+  void* TryDequeue() { return fixed_queue_try_dequeue(queue_); }
+  int DequeueFd() const { return fixed_queue_get_dequeue_fd(queue_); }
+
+ private:
+  fixed_queue_t* queue_;
+};
+
+// Enqueue and dequeue on the same thread, which is what most of the stack
+// queues see
+template <typename Queue>
+void BM_EnqueueDequeue(State& state) {
+  Queue queue(SIZE_MAX);
+  for (auto _ : state) {
+    queue.Enqueue(&queue);
+    ::benchmark::DoNotOptimize(queue.TryDequeue());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// A producer and a consumer thread with a small queue in between, which
+// blocks either of them in turn
+template <typename Queue>
+void BM_ProducerConsumer(State& state) {
+  Queue queue(state.range(0));
+  for (auto _ : state) {
+    std::thread producer([&queue] {
+      for (int i = 0; i < kBatch; i++) queue.Enqueue(&queue);
+    });
+    for (int i = 0; i < kBatch; i++) {
+      ::benchmark::DoNotOptimize(queue.Dequeue());
+    }
+    producer.join();
+  }
+  state.SetItemsProcessed(state.iterations() * kBatch);
+}
+
+// Batches handed over to a thread dispatching them from its reactor, as the
+// stack threads and the alarm callbacks do
+template <typename Queue>
+void BM_ReactorDispatch(State& state) {
+  struct Context {
+    Queue* queue;
+    std::atomic<int> counter;
+    std::promise<void> done;
+  };
+
+  Queue queue(SIZE_MAX);
+  thread_t* thread = thread_new("BM_ReactorDispatch thread");
+  Context context = {&queue, {0}, {}};
+  reactor_object_t* object = reactor_register(
+      thread_get_reactor(thread), queue.DequeueFd(), &context,
+      [](void* ptr) {
+        auto context = static_cast<Context*>(ptr);
+        // A single element per wake up, as the fixed_queue_cb callbacks do
+        context->queue->Dequeue();
+        if (++context->counter == kBatch) context->done.set_value();
+      },
+      nullptr);
+
+  for (auto _ : state) {
+    context.counter = 0;
+    context.done = std::promise<void>();
+    std::future<void> done = context.done.get_future();
+    for (int i = 0; i < kBatch; i++) queue.Enqueue(&queue);
+    done.wait();
+  }
+  state.SetItemsProcessed(state.iterations() * kBatch);
+
+  reactor_unregister(object);
+  thread_free(thread);
+}
+
+BENCHMARK_TEMPLATE(BM_EnqueueDequeue, LegacyQueue);
+BENCHMARK_TEMPLATE(BM_EnqueueDequeue, FixedQueue);
+BENCHMARK_TEMPLATE(BM_ProducerConsumer, LegacyQueue)
+    ->Arg(4)
+    ->Arg(128)
+    ->Unit(::benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ProducerConsumer, FixedQueue)
+    ->Arg(4)
+    ->Arg(128)
+    ->Unit(::benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ReactorDispatch, LegacyQueue)
+    ->Unit(::benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ReactorDispatch, FixedQueue)
+    ->Unit(::benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Streaming audio sized chunks from a producer thread to a consumer thread
+// through the osi ringbuffers.
+
+#include <benchmark/benchmark.h>
+#include <string.h>
+
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "osi/include/ringbuffer.h"
+
+using ::benchmark::State;
+
+namespace {
+
+constexpr size_t kCapacity = 16 * 1024;
+constexpr size_t kStreamBytes = 4 * 1024 * 1024;
+
+// The ringbuffer_t shared the only way it can be, behind a mutex
+class LockedRingbuffer {
+ public:
+  LockedRingbuffer() : rb_(ringbuffer_init(kCapacity)) {}
+  ~LockedRingbuffer() { ringbuffer_free(rb_); }
+
+  size_t Write(const uint8_t* p, size_t length) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ringbuffer_insert(rb_, p, length);
+  }
+
+  size_t Read(uint8_t* p, size_t length) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ringbuffer_pop(rb_, p, length);
+  }
+
+ private:
+  ringbuffer_t* rb_;
+  std::mutex mutex_;
+};
+
+// The single producer, single consumer ringbuffer, copying in and out
+class SpscRingbuffer {
+ public:
+  SpscRingbuffer() : rb_(spsc_ringbuffer_init(kCapacity)) {}
+  ~SpscRingbuffer() { spsc_ringbuffer_free(rb_); }
+
+  size_t Write(const uint8_t* p, size_t length) {
+    return spsc_ringbuffer_insert(rb_, p, length);
+  }
+
+  size_t Read(uint8_t* p, size_t length) {
+    return spsc_ringbuffer_pop(rb_, p, length);
+  }
+
+ private:
+  spsc_ringbuffer_t* rb_;
+};
+
+// Copy through an intermediate buffer on both sides, as the callers of the
+// locked ringbuffer have to
+template <typename Ringbuffer>
+void BM_RingbufferCopy(State& state) {
+  const size_t chunk = state.range(0);
+  Ringbuffer rb;
+  std::vector<uint8_t> in(chunk, 0x5a);
+  std::vector<uint8_t> out(chunk);
+  for (auto _ : state) {
+    std::thread producer([&rb, &in, chunk] {
+      size_t written = 0;
+      while (written < kStreamBytes) {
+        size_t length = rb.Write(in.data(), chunk);
+        if (length == 0) std::this_thread::yield();
+        written += length;
+      }
+    });
+    size_t read = 0;
+    while (read < kStreamBytes) {
+      size_t length = rb.Read(out.data(), chunk);
+      if (length == 0) std::this_thread::yield();
+      read += length;
+    }
+    producer.join();
+    ::benchmark::DoNotOptimize(out.data());
+  }
+  state.SetBytesProcessed(state.iterations() * kStreamBytes);
+}
+
+// Produce straight into the reserved spans and consume straight out of the
+// peeked ones, as an encoder or a decoder would
+void BM_SpscRingbufferSpans(State& state) {
+  const size_t chunk = state.range(0);
+  spsc_ringbuffer_t* rb = spsc_ringbuffer_init(kCapacity);
+  for (auto _ : state) {
+    std::thread producer([rb, chunk] {
+      size_t written = 0;
+      while (written < kStreamBytes) {
+        ringbuffer_span_t span;
+        size_t length = spsc_ringbuffer_reserve(rb, chunk, &span);
+        if (length == 0) {
+          std::this_thread::yield();
+          continue;
+        }
+        memset(span.data[0], 0x5a, span.length[0]);
+        memset(span.data[1], 0x5a, span.length[1]);
+        spsc_ringbuffer_commit(rb, length);
+        written += length;
+      }
+    });
+    size_t read = 0;
+    uint64_t sum = 0;
+    while (read < kStreamBytes) {
+      ringbuffer_span_t span;
+      size_t length = spsc_ringbuffer_peek(rb, chunk, &span);
+      if (length == 0) {
+        std::this_thread::yield();
+        continue;
+      }
+      for (int piece = 0; piece < 2; piece++) {
+        for (size_t i = 0; i < span.length[piece]; i += 64) {
+          sum += span.data[piece][i];
+        }
+      }
+      spsc_ringbuffer_consume(rb, length);
+      read += length;
+    }
+    producer.join();
+    ::benchmark::DoNotOptimize(sum);
+  }
+  spsc_ringbuffer_free(rb);
+  state.SetBytesProcessed(state.iterations() * kStreamBytes);
+}
+
+// SBC and AAC frames, then whole PCM buffers
+BENCHMARK_TEMPLATE(BM_RingbufferCopy, LockedRingbuffer)
+    ->Arg(128)
+    ->Arg(512)
+    ->Arg(4096)
+    ->Unit(::benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_RingbufferCopy, SpscRingbuffer)
+    ->Arg(128)
+    ->Arg(512)
+    ->Arg(4096)
+    ->Unit(::benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK(BM_SpscRingbufferSpans)
+    ->Arg(128)
+    ->Arg(512)
+    ->Arg(4096)
+    ->Unit(::benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
@@ -371,6 +371,42 @@ BENCHMARK_F(BM_MessageLooopThread, sequential_execution)(State& state) {
   }
 };
 
+// The same as BM_MessageLooopThread, with task latency tracing enabled. The
+// latter shows the cost of having it disabled, the former its cost when on.
+class BM_MessageLoopThreadTraced : public BM_MessageLooopThread {
+ protected:
+  void SetUp(State& st) override {
+    BM_MessageLooopThread::SetUp(st);
+    message_loop_thread_->EnableTaskLatencyTracing(true);
+  }
+};
+
+BENCHMARK_F(BM_MessageLoopThreadTraced, batch_enque_dequeue)(State& state) {
+  for (auto _ : state) {
+    g_counter = 0;
+    g_counter_promise = std::make_unique<std::promise<void>>();
+    std::future<void> counter_future = g_counter_promise->get_future();
+    for (int i = 0; i < NUM_MESSAGES_TO_SEND; i++) {
+      fixed_queue_enqueue(bt_msg_queue_, (void*)&g_counter);
+      message_loop_thread_->DoInThread(
+          FROM_HERE, base::BindOnce(&callback_batch, bt_msg_queue_, nullptr));
+    }
+    counter_future.wait();
+  }
+};
+
+BENCHMARK_F(BM_MessageLoopThreadTraced, sequential_execution)(State& state) {
+  for (auto _ : state) {
+    for (int i = 0; i < NUM_MESSAGES_TO_SEND; i++) {
+      g_counter_promise = std::make_unique<std::promise<void>>();
+      std::future<void> counter_future = g_counter_promise->get_future();
+      message_loop_thread_->DoInThread(
+          FROM_HERE, base::BindOnce(&callback_sequential, nullptr));
+      counter_future.wait();
+    }
+  }
+};
+
 class BM_LibChromeThread : public BM_ThreadPerformance {
  protected:
   void SetUp(State& st) override {
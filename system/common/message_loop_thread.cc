@@ -23,6 +23,8 @@
 #include <base/logging.h>
 #include <base/strings/stringprintf.h>
 
+#include "common/task_latency_tracer.h"
+#include "common/time_util.h"
 #include "gd/common/init_flags.h"
 #include "osi/include/log.h"
 
@@ -32,6 +34,16 @@ namespace common {
 
 static constexpr int kRealTimeFifoSchedulingPriority = 1;
 
+static void RunTracedTask(TaskLatencyTracer* tracer,
+                          const base::Location& from_here, uint64_t ready_us,
+                          base::OnceClosure task) {
+  uint64_t start_us = time_get_os_boottime_us();
+  std::move(task).Run();
+  tracer->RecordTask(from_here.function_name(), from_here.file_name(),
+                     from_here.line_number(), ready_us, start_us,
+                     time_get_os_boottime_us());
+}
+
 MessageLoopThread::MessageLoopThread(const std::string& thread_name)
     : MessageLoopThread(thread_name, false) {}
 
@@ -48,7 +60,10 @@ MessageLoopThread::MessageLoopThread(const std::string& thread_name,
       is_main_(is_main),
       rust_thread_(nullptr) {}
 
-MessageLoopThread::~MessageLoopThread() { ShutDown(); }
+MessageLoopThread::~MessageLoopThread() {
+  ShutDown();
+  delete task_latency_tracer_;
+}
 
 void MessageLoopThread::StartUp() {
   if (is_main_ && init_flags::gd_rust_is_enabled()) {
@@ -85,6 +100,13 @@ bool MessageLoopThread::DoInThreadDelayed(const base::Location& from_here,
                                           base::OnceClosure task,
                                           const base::TimeDelta& delay) {
   std::lock_guard<std::recursive_mutex> api_lock(api_mutex_);
+  if (trace_task_latency_) {
+    task = base::BindOnce(&RunTracedTask,
+                          base::Unretained(task_latency_tracer_),
+                          from_here,
+                          time_get_os_boottime_us() + delay.InMicroseconds(),
+                          std::move(task));
+  }
   if (is_main_ && init_flags::gd_rust_is_enabled()) {
     if (rust_thread_ == nullptr) {
       LOG(ERROR) << __func__ << ": rust thread is null for thread " << *this
@@ -211,6 +233,14 @@ bool MessageLoopThread::EnableRealTimeScheduling() {
   return true;
 }
 
+void MessageLoopThread::EnableTaskLatencyTracing(bool enable) {
+  std::lock_guard<std::recursive_mutex> api_lock(api_mutex_);
+  if (enable && task_latency_tracer_ == nullptr) {
+    task_latency_tracer_ = new TaskLatencyTracer(thread_name_);
+  }
+  trace_task_latency_ = enable;
+}
+
 base::WeakPtr<MessageLoopThread> MessageLoopThread::GetWeakPtr() {
   std::lock_guard<std::recursive_mutex> api_lock(api_mutex_);
   return weak_ptr_factory_.GetWeakPtr();
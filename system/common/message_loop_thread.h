@@ -34,6 +34,8 @@ namespace bluetooth {
 
 namespace common {
 
+class TaskLatencyTracer;
+
 /**
  * An interface to various thread related functionality
  */
@@ -169,6 +171,16 @@ class MessageLoopThread final {
   bool DoInThreadDelayed(const base::Location& from_here,
                          base::OnceClosure task, const base::TimeDelta& delay);
 
+  /**
+   * Enable or disable tracing the latency of the tasks posted to this thread
+   * from now on: how long each waits in the queue and runs, per location it is
+   * posted from. See TaskLatencyTracer for how to get the results. While
+   * disabled, posting a task only checks a flag.
+   *
+   * @param enable whether to trace the tasks posted from now on
+   */
+  void EnableTaskLatencyTracing(bool enable);
+
  private:
   /**
    * Static method to run the thread
@@ -202,6 +214,10 @@ class MessageLoopThread final {
   bool shutting_down_;
   bool is_main_;
   ::rust::Box<shim::rust::MessageLoopThread>* rust_thread_ = nullptr;
+  // Created when first enabled, and kept until destroyed for the tasks
+  // already posted
+  TaskLatencyTracer* task_latency_tracer_ = nullptr;
+  bool trace_task_latency_ = false;
 };
 
 inline std::ostream& operator<<(std::ostream& os,
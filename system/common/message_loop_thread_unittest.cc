@@ -19,6 +19,7 @@
 #include <memory>
 #include <mutex>
 
+#include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
 #include <base/bind.h>
@@ -26,7 +27,10 @@
 #include <sys/capability.h>
 #include <syscall.h>
 
+#include "common/task_latency_tracer.h"
+
 using bluetooth::common::MessageLoopThread;
+using bluetooth::common::TaskLatencyTracer;
 
 /**
  * Unit tests to verify MessageLoopThread. Must have CAP_SYS_NICE capability.
@@ -166,6 +170,42 @@ TEST_F(MessageLoopThreadTest, test_thread_id) {
   ASSERT_EQ(thread_id, my_thread_id);
 }
 
+TEST_F(MessageLoopThreadTest, test_task_latency_tracing) {
+  std::string name = "traced_thread";
+  MessageLoopThread message_loop_thread(name);
+  message_loop_thread.EnableTaskLatencyTracing(true);
+  message_loop_thread.StartUp();
+  std::promise<std::string> name_promise;
+  std::future<std::string> name_future = name_promise.get_future();
+  message_loop_thread.DoInThread(
+      FROM_HERE,
+      base::BindOnce(&MessageLoopThreadTest::SleepAndGetName,
+                     base::Unretained(this), std::move(name_promise), 10));
+  ASSERT_EQ(name, name_future.get());
+
+  // Not traced, and run once the first task is recorded
+  message_loop_thread.EnableTaskLatencyTracing(false);
+  std::promise<std::string> untraced_name_promise;
+  std::future<std::string> untraced_name_future =
+      untraced_name_promise.get_future();
+  message_loop_thread.DoInThread(
+      FROM_HERE,
+      base::BindOnce(&MessageLoopThreadTest::GetName, base::Unretained(this),
+                     std::move(untraced_name_promise)));
+  ASSERT_EQ(name, untraced_name_future.get());
+
+  FILE* dump_file = tmpfile();
+  TaskLatencyTracer::DumpAll(fileno(dump_file));
+  fseek(dump_file, 0, SEEK_SET);
+  char buffer[4096] = {};
+  fread(buffer, 1, sizeof(buffer) - 1, dump_file);
+  fclose(dump_file);
+  std::string dump(buffer);
+  EXPECT_THAT(dump, ::testing::HasSubstr(name + " (tid "));
+  EXPECT_THAT(dump, ::testing::HasSubstr("): 1 tasks"));
+  EXPECT_THAT(dump, ::testing::HasSubstr("message_loop_thread_unittest.cc:"));
+}
+
 TEST_F(MessageLoopThreadTest, test_set_realtime_priority_fail_before_start) {
   std::string name = "test_thread";
   MessageLoopThread message_loop_thread(name);
@@ -0,0 +1,324 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "bt_task_latency_tracer"
+
+#include "common/task_latency_tracer.h"
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "osi/include/log.h"
+
+namespace bluetooth {
+
+namespace common {
+
+namespace {
+
+// All the tracers of the process, for dumpsys
+std::mutex& tracers_mutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+std::vector<const TaskLatencyTracer*>& tracers() {
+  static std::vector<const TaskLatencyTracer*> tracers;
+  return tracers;
+}
+
+// Increments |value|, written by a single thread
+template <typename T>
+void Increment(std::atomic<T>& value, T increment) {
+  value.store(value.load(std::memory_order_relaxed) + increment,
+              std::memory_order_relaxed);
+}
+
+const char* Basename(const char* path) {
+  const char* slash = strrchr(path, '/');
+  return slash == nullptr ? path : slash + 1;
+}
+
+void AppendJsonString(std::string* out, const char* str) {
+  out->push_back('"');
+  for (; *str != '\0'; str++) {
+    if (*str == '"' || *str == '\\') out->push_back('\\');
+    if (static_cast<unsigned char>(*str) >= 0x20) out->push_back(*str);
+  }
+  out->push_back('"');
+}
+
+void AppendTraceEventSeparator(std::string* trace) {
+  if (!trace->empty() && trace->back() != '[') trace->append(",\n");
+}
+
+}  // namespace
+
+void TaskLatencyTracer::Histogram::Add(uint64_t duration_us) {
+  size_t bucket =
+      duration_us == 0
+          ? 0
+          : std::min<size_t>(64 - __builtin_clzll(duration_us),
+                             kNumBuckets - 1);
+  Increment<uint32_t>(buckets[bucket], 1);
+  Increment<uint64_t>(total_us, duration_us);
+  if (duration_us > max_us.load(std::memory_order_relaxed)) {
+    max_us.store(duration_us, std::memory_order_relaxed);
+  }
+}
+
+uint64_t TaskLatencyTracer::Histogram::Count() const {
+  uint64_t count = 0;
+  for (const auto& bucket : buckets) {
+    count += bucket.load(std::memory_order_relaxed);
+  }
+  return count;
+}
+
+uint64_t TaskLatencyTracer::Histogram::Percentile(int percent) const {
+  uint64_t target = (Count() * percent + 99) / 100;
+  uint64_t count = 0;
+  for (size_t i = 0; i < kNumBuckets - 1; i++) {
+    count += buckets[i].load(std::memory_order_relaxed);
+    if (count >= target && count > 0) return uint64_t(1) << i;
+  }
+  return max_us.load(std::memory_order_relaxed);
+}
+
+TaskLatencyTracer::TaskLatencyTracer(const std::string& thread_name)
+    : thread_name_(thread_name) {
+  call_site_index_.fill(-1);
+  std::lock_guard<std::mutex> lock(tracers_mutex());
+  tracers().push_back(this);
+}
+
+TaskLatencyTracer::~TaskLatencyTracer() {
+  std::lock_guard<std::mutex> lock(tracers_mutex());
+  auto& all = tracers();
+  all.erase(std::remove(all.begin(), all.end(), this), all.end());
+}
+
+size_t TaskLatencyTracer::FindOrAddCallSite(const char* function_name,
+                                            const char* file_name,
+                                            int line_number) {
+  const size_t index_size = call_site_index_.size();
+  size_t slot = (static_cast<size_t>(line_number) * 2654435761u) % index_size;
+  for (; call_site_index_[slot] >= 0; slot = (slot + 1) % index_size) {
+    const CallSite& site = call_sites_[call_site_index_[slot]];
+    if (site.line_number == line_number &&
+        (site.file_name == file_name ||
+         strcmp(site.file_name, file_name) == 0)) {
+      return call_site_index_[slot];
+    }
+  }
+
+  size_t num_call_sites = num_call_sites_.load(std::memory_order_relaxed);
+  if (num_call_sites == kMaxCallSites) return kMaxCallSites - 1;
+  CallSite& site = call_sites_[num_call_sites];
+  if (num_call_sites == kMaxCallSites - 1) {
+    // Not indexed, all the locations not found end up here
+    site.function_name = "(other locations)";
+    site.file_name = "";
+  } else {
+    site.function_name = function_name;
+    site.file_name = file_name;
+    site.line_number = line_number;
+    call_site_index_[slot] = num_call_sites;
+  }
+  num_call_sites_.store(num_call_sites + 1, std::memory_order_release);
+  return num_call_sites;
+}
+
+void TaskLatencyTracer::RecordTask(const char* function_name,
+                                   const char* file_name, int line_number,
+                                   uint64_t ready_us, uint64_t start_us,
+                                   uint64_t end_us) {
+  // Locations built without source information
+  if (function_name == nullptr) function_name = "(unknown)";
+  if (file_name == nullptr) file_name = "";
+  if (tid_.load(std::memory_order_relaxed) == 0) {
+    tid_.store(static_cast<int>(syscall(SYS_gettid)),
+               std::memory_order_relaxed);
+  }
+
+  size_t call_site = FindOrAddCallSite(function_name, file_name, line_number);
+  CallSite& site = call_sites_[call_site];
+  site.queue.Add(start_us > ready_us ? start_us - ready_us : 0);
+  site.run.Add(end_us > start_us ? end_us - start_us : 0);
+
+  uint64_t index = num_trace_events_.load(std::memory_order_relaxed);
+  TraceEvent& event = trace_events_[index % kMaxTraceEvents];
+  event.sequence.store(2 * index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  event.call_site.store(call_site, std::memory_order_relaxed);
+  event.ready_us.store(ready_us, std::memory_order_relaxed);
+  event.start_us.store(start_us, std::memory_order_relaxed);
+  event.end_us.store(end_us, std::memory_order_relaxed);
+  event.sequence.store(2 * index + 2, std::memory_order_release);
+  num_trace_events_.store(index + 1, std::memory_order_release);
+}
+
+void TaskLatencyTracer::Dump(int fd) const {
+  // Sorted on a snapshot of the queueing delays, which keep changing
+  size_t num_call_sites = num_call_sites_.load(std::memory_order_acquire);
+  std::vector<std::pair<uint64_t, const CallSite*>> sorted;
+  uint64_t num_tasks = 0;
+  for (size_t i = 0; i < num_call_sites; i++) {
+    sorted.emplace_back(call_sites_[i].queue.total_us.load(), &call_sites_[i]);
+    num_tasks += call_sites_[i].run.Count();
+  }
+  std::sort(sorted.begin(), sorted.end(),
+            [](const auto& a, const auto& b) { return a.first > b.first; });
+
+  dprintf(fd, "  Task latency of %s (tid %d): %" PRIu64 " tasks\n",
+          thread_name_.c_str(), tid_.load(std::memory_order_relaxed),
+          num_tasks);
+  if (sorted.empty()) return;
+  dprintf(fd,
+          "    Queued and run times in us: total, 50th and 99th percentile "
+          "bucket bounds, maximum\n");
+  dprintf(fd, "    %8s %10s %7s %7s %8s %10s %7s %7s %8s  %s\n", "Tasks",
+          "Queued", "p50", "p99", "max", "Run", "p50", "p99", "max",
+          "Posted from");
+  for (const auto& [queued_us, site] : sorted) {
+    dprintf(fd,
+            "    %8" PRIu64 " %10" PRIu64 " %7" PRIu64 " %7" PRIu64
+            " %8" PRIu64 " %10" PRIu64 " %7" PRIu64 " %7" PRIu64 " %8" PRIu64
+            "  %s %s:%d\n",
+            site->run.Count(), queued_us,
+            site->queue.Percentile(50), site->queue.Percentile(99),
+            site->queue.max_us.load(), site->run.total_us.load(),
+            site->run.Percentile(50), site->run.Percentile(99),
+            site->run.max_us.load(), site->function_name,
+            Basename(site->file_name), site->line_number);
+  }
+}
+
+void TaskLatencyTracer::AppendTraceEvents(std::string* trace) const {
+  const int pid = getpid();
+  const int tid = tid_.load(std::memory_order_relaxed);
+  char buffer[160];
+
+  AppendTraceEventSeparator(trace);
+  snprintf(buffer, sizeof(buffer),
+           "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%d,"
+           "\"args\":{\"name\":",
+           pid, tid);
+  trace->append(buffer);
+  AppendJsonString(trace, thread_name_.c_str());
+  trace->append("}}");
+
+  size_t num_call_sites = num_call_sites_.load(std::memory_order_acquire);
+  uint64_t end = num_trace_events_.load(std::memory_order_acquire);
+  uint64_t begin = end > kMaxTraceEvents ? end - kMaxTraceEvents : 0;
+  for (uint64_t index = begin; index < end; index++) {
+    const TraceEvent& event = trace_events_[index % kMaxTraceEvents];
+    uint64_t sequence = event.sequence.load(std::memory_order_acquire);
+    uint64_t call_site = event.call_site.load(std::memory_order_relaxed);
+    uint64_t ready_us = event.ready_us.load(std::memory_order_relaxed);
+    uint64_t start_us = event.start_us.load(std::memory_order_relaxed);
+    uint64_t end_us = event.end_us.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // Skip the events overwritten while being read
+    if (sequence != 2 * index + 2 ||
+        event.sequence.load(std::memory_order_relaxed) != sequence ||
+        call_site >= num_call_sites) {
+      continue;
+    }
+    const CallSite& site = call_sites_[call_site];
+    uint64_t queued_us = start_us > ready_us ? start_us - ready_us : 0;
+
+    AppendTraceEventSeparator(trace);
+    trace->append("{\"ph\":\"X\",\"cat\":\"task\",\"name\":");
+    AppendJsonString(trace, site.function_name);
+    snprintf(buffer, sizeof(buffer),
+             ",\"pid\":%d,\"tid\":%d,\"ts\":%" PRIu64 ",\"dur\":%" PRIu64
+             ",\"args\":{\"queued_us\":%" PRIu64 ",\"posted_from\":",
+             pid, tid, start_us, end_us - start_us, queued_us);
+    trace->append(buffer);
+    snprintf(buffer, sizeof(buffer), "%s:%d", Basename(site.file_name),
+             site.line_number);
+    AppendJsonString(trace, buffer);
+    trace->append("}}");
+
+    if (queued_us == 0) continue;
+    for (const char* phase : {"b", "e"}) {
+      trace->append(",\n{\"ph\":\"");
+      trace->append(phase);
+      trace->append("\",\"cat\":\"queue\",\"name\":");
+      AppendJsonString(trace, site.function_name);
+      snprintf(buffer, sizeof(buffer),
+               ",\"id\":%" PRIu64 ",\"pid\":%d,\"tid\":%d,\"ts\":%" PRIu64 "}",
+               (static_cast<uint64_t>(tid) << 32) | (index & 0xffffffff), pid,
+               tid, *phase == 'b' ? ready_us : start_us);
+      trace->append(buffer);
+    }
+  }
+}
+
+void TaskLatencyTracer::DumpAll(int fd) {
+  std::lock_guard<std::mutex> lock(tracers_mutex());
+  for (const TaskLatencyTracer* tracer : tracers()) {
+    tracer->Dump(fd);
+  }
+}
+
+bool TaskLatencyTracer::WriteAllTraces(const std::string& path) {
+  std::string trace = "{\"traceEvents\":[";
+  {
+    std::lock_guard<std::mutex> lock(tracers_mutex());
+    if (tracers().empty()) return false;
+    for (const TaskLatencyTracer* tracer : tracers()) {
+      tracer->AppendTraceEvents(&trace);
+    }
+  }
+  trace.append("],\n\"displayTimeUnit\":\"ms\"}\n");
+
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0660);
+  if (fd < 0) {
+    LOG_ERROR("%s: unable to open %s: %s", __func__, path.c_str(),
+              strerror(errno));
+    return false;
+  }
+  size_t written = 0;
+  while (written < trace.size()) {
+    ssize_t ret = write(fd, trace.data() + written, trace.size() - written);
+    if (ret < 0 && errno == EINTR) continue;
+    if (ret <= 0) {
+      LOG_ERROR("%s: unable to write %s: %s", __func__, path.c_str(),
+                strerror(errno));
+      close(fd);
+      return false;
+    }
+    written += ret;
+  }
+  close(fd);
+  return true;
+}
+
+}  // namespace common
+
+}  // namespace bluetooth
@@ -0,0 +1,149 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace bluetooth {
+
+namespace common {
+
+/**
+ * Latency of the tasks run by one thread, per location they are posted from:
+ * how long each task waited in the queue once due, and how long it ran.
+ *
+ * Only the thread running the tasks records them, so recording takes no lock
+ * and no atomic read-modify-write. Any other thread may dump the histograms,
+ * or write the most recent tasks as a trace that Perfetto and chrome://tracing
+ * load, while tasks are recorded.
+ */
+class TaskLatencyTracer {
+ public:
+  /**
+   * Histogram buckets: bucket 0 counts durations under 1 us, bucket i those
+   * in [2^(i-1), 2^i) us, and the last one all the longer ones.
+   */
+  static constexpr size_t kNumBuckets = 22;
+  /**
+   * Locations a tracer tells apart. Tasks from any further location are
+   * counted together in the last one.
+   */
+  static constexpr size_t kMaxCallSites = 128;
+  /**
+   * Tasks kept for the trace, the oldest ones being overwritten
+   */
+  static constexpr size_t kMaxTraceEvents = 4096;
+
+  /**
+   * @param thread_name name of the thread whose tasks are traced
+   */
+  explicit TaskLatencyTracer(const std::string& thread_name);
+  ~TaskLatencyTracer();
+
+  TaskLatencyTracer(const TaskLatencyTracer&) = delete;
+  TaskLatencyTracer& operator=(const TaskLatencyTracer&) = delete;
+
+  /**
+   * Record a task. Must always be called from the same thread, the one
+   * running the tasks.
+   *
+   * @param function_name, file_name, line_number location the task was posted
+   * from, with static storage duration
+   * @param ready_us time the task was due to run, in CLOCK_BOOTTIME us
+   * @param start_us time the task started running
+   * @param end_us time the task finished running
+   */
+  void RecordTask(const char* function_name, const char* file_name,
+                  int line_number, uint64_t ready_us, uint64_t start_us,
+                  uint64_t end_us);
+
+  /**
+   * Dump the histograms of each location, the ones adding the most queueing
+   * delay first, to |fd| in a user-readable text format
+   */
+  void Dump(int fd) const;
+
+  /**
+   * Append the most recent tasks to |trace| as JSON trace events: a slice for
+   * each task run, and an async slice for the time it was queued
+   */
+  void AppendTraceEvents(std::string* trace) const;
+
+  /**
+   * Dump all the tracers of the process to |fd|
+   */
+  static void DumpAll(int fd);
+
+  /**
+   * Write the recent tasks of all the tracers of the process to |path|, as a
+   * JSON trace file
+   *
+   * @return true if there were tracers and the file was written
+   */
+  static bool WriteAllTraces(const std::string& path);
+
+ private:
+  struct Histogram {
+    std::array<std::atomic<uint32_t>, kNumBuckets> buckets{};
+    std::atomic<uint64_t> total_us{0};
+    std::atomic<uint64_t> max_us{0};
+
+    void Add(uint64_t duration_us);
+    uint64_t Count() const;
+    // Upper bound of the bucket holding the |percent|th percentile, in us
+    uint64_t Percentile(int percent) const;
+  };
+
+  struct CallSite {
+    const char* function_name = nullptr;
+    const char* file_name = nullptr;
+    int line_number = 0;
+    Histogram queue;
+    Histogram run;
+  };
+
+  // A task, stored under a sequence lock as it may be read while overwritten
+  struct TraceEvent {
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<uint64_t> call_site{0};
+    std::atomic<uint64_t> ready_us{0};
+    std::atomic<uint64_t> start_us{0};
+    std::atomic<uint64_t> end_us{0};
+  };
+
+  size_t FindOrAddCallSite(const char* function_name, const char* file_name,
+                           int line_number);
+
+  const std::string thread_name_;
+  std::atomic<int> tid_{0};
+
+  std::array<CallSite, kMaxCallSites> call_sites_;
+  // Call sites filled in, published to the dumping threads
+  std::atomic<size_t> num_call_sites_{0};
+  // Open addressed index of |call_sites_|, used by the recording thread only
+  std::array<int16_t, 2 * kMaxCallSites> call_site_index_;
+
+  std::array<TraceEvent, kMaxTraceEvents> trace_events_;
+  std::atomic<uint64_t> num_trace_events_{0};
+};
+
+}  // namespace common
+
+}  // namespace bluetooth
@@ -0,0 +1,177 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "common/task_latency_tracer.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using bluetooth::common::TaskLatencyTracer;
+using testing::HasSubstr;
+using testing::Not;
+using testing::StartsWith;
+
+namespace {
+
+std::string Dump(const TaskLatencyTracer& tracer) {
+  FILE* file = tmpfile();
+  tracer.Dump(fileno(file));
+  fseek(file, 0, SEEK_SET);
+  std::string dump;
+  char buffer[256];
+  size_t read;
+  while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    dump.append(buffer, read);
+  }
+  fclose(file);
+  return dump;
+}
+
+size_t CountOf(const std::string& str, const std::string& pattern) {
+  size_t count = 0;
+  for (size_t pos = str.find(pattern); pos != std::string::npos;
+       pos = str.find(pattern, pos + 1)) {
+    count++;
+  }
+  return count;
+}
+
+}  // namespace
+
+TEST(TaskLatencyTracerTest, test_dump_per_call_site) {
+  TaskLatencyTracer tracer("test_thread");
+  // A task delaying the next ones
+  tracer.RecordTask("slow_task", "stack/btu/btu_hcif.cc", 10, 1000, 1000, 6000);
+  for (uint64_t i = 0; i < 10; i++) {
+    tracer.RecordTask("fast_task", "bta/av/bta_av_act.cc", 20, 1000, 6000 + i,
+                      6001 + i);
+  }
+
+  std::string dump = Dump(tracer);
+  EXPECT_THAT(dump, HasSubstr("test_thread"));
+  EXPECT_THAT(dump, HasSubstr("11 tasks"));
+  EXPECT_THAT(dump, HasSubstr("slow_task btu_hcif.cc:10"));
+  EXPECT_THAT(dump, HasSubstr("fast_task bta_av_act.cc:20"));
+  // The most queued first
+  EXPECT_LT(dump.find("fast_task"), dump.find("slow_task"));
+}
+
+TEST(TaskLatencyTracerTest, test_same_location_is_one_call_site) {
+  TaskLatencyTracer tracer("test_thread");
+  // The same location, from two copies of an inlined function
+  char file_name[] = "common/message_loop_thread.h";
+  tracer.RecordTask("task", "common/message_loop_thread.h", 30, 0, 0, 1);
+  tracer.RecordTask("task", file_name, 30, 0, 0, 1);
+  tracer.RecordTask("task", "common/message_loop_thread.h", 31, 0, 0, 1);
+
+  std::string dump = Dump(tracer);
+  EXPECT_EQ(CountOf(dump, "message_loop_thread.h:30"), 1u);
+  EXPECT_EQ(CountOf(dump, "message_loop_thread.h:31"), 1u);
+  EXPECT_THAT(dump, HasSubstr("3 tasks"));
+}
+
+TEST(TaskLatencyTracerTest, test_too_many_call_sites) {
+  TaskLatencyTracer tracer("test_thread");
+  for (int line = 1; line <= 2 * TaskLatencyTracer::kMaxCallSites; line++) {
+    tracer.RecordTask("task", "file.cc", line, 0, 0, 1);
+  }
+  // Known locations are still told apart
+  tracer.RecordTask("task", "file.cc", 1, 0, 0, 1);
+
+  std::string dump = Dump(tracer);
+  EXPECT_THAT(dump, HasSubstr("(other locations)"));
+  EXPECT_EQ(CountOf(dump, "file.cc:"), TaskLatencyTracer::kMaxCallSites - 1);
+  EXPECT_THAT(dump, HasSubstr("257 tasks"));
+}
+
+TEST(TaskLatencyTracerTest, test_trace_events) {
+  TaskLatencyTracer tracer("test_thread");
+  tracer.RecordTask("queued_task", "file.cc", 1, 100, 150, 170);
+  tracer.RecordTask("run_at_once", "file.cc", 2, 200, 200, 210);
+
+  std::string trace = "[";
+  tracer.AppendTraceEvents(&trace);
+  EXPECT_THAT(trace, HasSubstr("\"name\":\"thread_name\""));
+  EXPECT_THAT(trace, HasSubstr("\"name\":\"test_thread\""));
+  EXPECT_THAT(trace, HasSubstr("\"name\":\"queued_task\",\"pid\":"));
+  EXPECT_THAT(trace, HasSubstr("\"ts\":150,\"dur\":20"));
+  EXPECT_THAT(trace, HasSubstr("\"queued_us\":50"));
+  EXPECT_THAT(trace, HasSubstr("\"posted_from\":\"file.cc:1\""));
+  EXPECT_THAT(trace, HasSubstr("\"ts\":200,\"dur\":10"));
+  // Only the queued task has a queue slice
+  EXPECT_EQ(CountOf(trace, "\"ph\":\"b\""), 1u);
+  EXPECT_EQ(CountOf(trace, "\"ph\":\"e\""), 1u);
+  EXPECT_THAT(trace, Not(HasSubstr(",,")));
+}
+
+TEST(TaskLatencyTracerTest, test_trace_keeps_most_recent_events) {
+  TaskLatencyTracer tracer("test_thread");
+  for (uint64_t i = 0; i < TaskLatencyTracer::kMaxTraceEvents + 10; i++) {
+    tracer.RecordTask("task", "file.cc", 1, 0, i, i);
+  }
+
+  std::string trace = "[";
+  tracer.AppendTraceEvents(&trace);
+  EXPECT_EQ(CountOf(trace, "\"ph\":\"X\""), TaskLatencyTracer::kMaxTraceEvents);
+  EXPECT_THAT(trace, Not(HasSubstr("\"ts\":9,")));
+  EXPECT_THAT(trace, HasSubstr("\"ts\":10,"));
+}
+
+TEST(TaskLatencyTracerTest, test_write_all_traces) {
+  char path[] = "/tmp/task_latency_trace_XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  close(fd);
+  {
+    TaskLatencyTracer first("first_thread");
+    TaskLatencyTracer second("second_thread");
+    first.RecordTask("task", "file.cc", 1, 0, 0, 1);
+    second.RecordTask("task", "file.cc", 1, 0, 0, 1);
+    ASSERT_TRUE(TaskLatencyTracer::WriteAllTraces(path));
+  }
+
+  std::ifstream file(path);
+  std::stringstream trace;
+  trace << file.rdbuf();
+  EXPECT_THAT(trace.str(), StartsWith("{\"traceEvents\":[{"));
+  EXPECT_THAT(trace.str(), HasSubstr("first_thread"));
+  EXPECT_THAT(trace.str(), HasSubstr("second_thread"));
+  EXPECT_THAT(trace.str(), HasSubstr("}],\n\"displayTimeUnit\":\"ms\"}"));
+  unlink(path);
+}
+
+TEST(TaskLatencyTracerTest, test_dump_while_recording) {
+  TaskLatencyTracer tracer("test_thread");
+  std::thread recorder([&tracer] {
+    for (uint64_t i = 0; i < 100000; i++) {
+      tracer.RecordTask("task", "file.cc", i % 200, i, i + 1, i + 2);
+    }
+  });
+  for (int i = 0; i < 20; i++) {
+    std::string trace = "[";
+    tracer.AppendTraceEvents(&trace);
+    EXPECT_THAT(Dump(tracer), HasSubstr("test_thread"));
+  }
+  recorder.join();
+  EXPECT_THAT(Dump(tracer), HasSubstr("100000 tasks"));
+}
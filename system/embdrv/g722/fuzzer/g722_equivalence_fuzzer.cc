@@ -0,0 +1,183 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fuzzer/FuzzedDataProvider.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "../g722_enc_dec.h"
+#include "../g722_qmf.h"
+#include "g722_reference.h"
+
+// Checks that the G.722 codec, with its QMF running on whichever SIMD
+// implementation this CPU picked, stays bit exact with the scalar reference.
+
+namespace {
+
+constexpr unsigned int kRates[] = {48000, 56000, 64000};
+
+void Check(bool equal, const char* what) {
+  if (!equal) {
+    fprintf(stderr, "g722 %s differs from the reference with the %s QMF\n",
+            what, g722_qmf_filter_name());
+    abort();
+  }
+}
+
+std::vector<int16_t> ConsumeSamples(FuzzedDataProvider* fdp, size_t count) {
+  std::vector<int16_t> samples(count);
+  for (auto& sample : samples) {
+    sample = fdp->ConsumeIntegral<int16_t>();
+  }
+  return samples;
+}
+
+// Splits |total| units into consecutive chunks of random even size, as the
+// codec state has to carry over from one call to the next.
+std::vector<int> ConsumeChunks(FuzzedDataProvider* fdp, int total) {
+  std::vector<int> chunks;
+  while (total > 0) {
+    int chunk = 2 * fdp->ConsumeIntegralInRange<int>(1, total / 2 + 1);
+    if (chunk > total) chunk = total;
+    chunks.push_back(chunk);
+    total -= chunk;
+  }
+  return chunks;
+}
+
+void CheckQmf(FuzzedDataProvider* fdp) {
+  int windows = fdp->ConsumeIntegralInRange<int>(1, 64);
+  auto x = ConsumeSamples(fdp, 2 * windows + G722_QMF_HISTORY);
+  // Coefficients as large as the sums of 24 taps can take without overflow
+  std::vector<int16_t> coeffs_a(G722_QMF_TAPS), coeffs_b(G722_QMF_TAPS);
+  for (auto& c : coeffs_a) c = fdp->ConsumeIntegralInRange(-2048, 2048);
+  for (auto& c : coeffs_b) c = fdp->ConsumeIntegralInRange(-2048, 2048);
+
+  std::vector<int32_t> out_a(windows), out_b(windows);
+  std::vector<int32_t> ref_a(windows), ref_b(windows);
+  g722_qmf_filter(x.data(), windows, coeffs_a.data(), coeffs_b.data(),
+                  out_a.data(), out_b.data());
+  g722_qmf_filter_c(x.data(), windows, coeffs_a.data(), coeffs_b.data(),
+                    ref_a.data(), ref_b.data());
+  Check(out_a == ref_a && out_b == ref_b, "QMF");
+}
+
+void CheckEncode(FuzzedDataProvider* fdp, unsigned int rate) {
+  int len = 2 * fdp->ConsumeIntegralInRange<int>(0, 1024);
+  auto amp = ConsumeSamples(fdp, len);
+  auto chunks = ConsumeChunks(fdp, len);
+
+  g722_encode_state_t state, ref_state;
+  g722_encode_init(&state, rate, G722_PACKED);
+  g722_reference_encode_init(&ref_state, rate, G722_PACKED);
+
+  std::vector<uint8_t> out(len / 2), ref(len / 2);
+  int offset = 0;
+  for (int chunk : chunks) {
+    int bytes = g722_encode(&state, out.data() + offset / 2,
+                            amp.data() + offset, chunk);
+    int ref_bytes = g722_reference_encode(&ref_state, ref.data() + offset / 2,
+                                          amp.data() + offset, chunk);
+    Check(bytes == ref_bytes, "encoded length");
+    offset += chunk;
+  }
+  Check(out == ref, "encoding");
+}
+
+void CheckEncodeStereo(FuzzedDataProvider* fdp, unsigned int rate) {
+  int frames = 2 * fdp->ConsumeIntegralInRange<int>(0, 512);
+  auto amp = ConsumeSamples(fdp, 2 * frames);
+  auto chunks = ConsumeChunks(fdp, frames);
+
+  g722_encode_state_t left, right, ref_left, ref_right;
+  g722_encode_init(&left, rate, G722_PACKED);
+  g722_encode_init(&right, rate, G722_PACKED);
+  g722_reference_encode_init(&ref_left, rate, G722_PACKED);
+  g722_reference_encode_init(&ref_right, rate, G722_PACKED);
+
+  std::vector<uint8_t> out_left(frames / 2), out_right(frames / 2);
+  int offset = 0;
+  for (int chunk : chunks) {
+    int bytes = g722_encode_stereo(&left, &right, out_left.data() + offset / 2,
+                                   out_right.data() + offset / 2,
+                                   amp.data() + 2 * offset, chunk);
+    Check(bytes == chunk / 2, "stereo encoded length");
+    offset += chunk;
+  }
+
+  std::vector<int16_t> chan_left(frames), chan_right(frames);
+  for (int i = 0; i < frames; i++) {
+    chan_left[i] = amp[2 * i];
+    chan_right[i] = amp[2 * i + 1];
+  }
+  std::vector<uint8_t> ref_out_left(frames / 2), ref_out_right(frames / 2);
+  g722_reference_encode(&ref_left, ref_out_left.data(), chan_left.data(),
+                        frames);
+  g722_reference_encode(&ref_right, ref_out_right.data(), chan_right.data(),
+                        frames);
+  Check(out_left == ref_out_left && out_right == ref_out_right,
+        "stereo encoding");
+}
+
+void CheckDecode(FuzzedDataProvider* fdp, unsigned int rate) {
+  int len = fdp->ConsumeIntegralInRange<int>(0, 1024);
+  auto data = fdp->ConsumeBytes<uint8_t>(len);
+  len = data.size();
+  auto chunks = ConsumeChunks(fdp, len);
+  uint16_t gain = fdp->ConsumeIntegral<uint16_t>();
+
+  g722_decode_state_t state, ref_state;
+  g722_decode_init(&state, rate, G722_PACKED);
+  g722_reference_decode_init(&ref_state, rate, G722_PACKED);
+
+  std::vector<int16_t> out(2 * len), ref(2 * len);
+  int offset = 0;
+  for (int chunk : chunks) {
+    uint32_t samples = g722_decode(&state, out.data() + 2 * offset,
+                                   data.data() + offset, chunk, gain);
+    uint32_t ref_samples =
+        g722_reference_decode(&ref_state, ref.data() + 2 * offset,
+                              data.data() + offset, chunk, gain);
+    Check(samples == ref_samples, "decoded length");
+    offset += chunk;
+  }
+  Check(out == ref, "decoding");
+}
+
+}  // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  FuzzedDataProvider fdp(data, size);
+
+  unsigned int rate = fdp.PickValueInArray(kRates);
+  switch (fdp.ConsumeIntegralInRange<int>(0, 3)) {
+    case 0:
+      CheckQmf(&fdp);
+      break;
+    case 1:
+      CheckEncode(&fdp, rate);
+      break;
+    case 2:
+      CheckEncodeStereo(&fdp, rate);
+      break;
+    default:
+      CheckDecode(&fdp, rate);
+      break;
+  }
+  return 0;
+}
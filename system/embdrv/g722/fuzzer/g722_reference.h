@@ -0,0 +1,37 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "../g722_enc_dec.h"
+
+/* The scalar G.722 codec as it was before the QMF got vectorized, which the
+ * optimized one must stay bit exact with. */
+
+g722_encode_state_t* g722_reference_encode_init(g722_encode_state_t* s,
+                                                unsigned int rate, int options);
+int g722_reference_encode_release(g722_encode_state_t* s);
+int g722_reference_encode(g722_encode_state_t* s, uint8_t g722_data[],
+                          const int16_t amp[], int len);
+
+g722_decode_state_t* g722_reference_decode_init(g722_decode_state_t* s,
+                                                unsigned int rate, int options);
+int g722_reference_decode_release(g722_decode_state_t* s);
+uint32_t g722_reference_decode(g722_decode_state_t* s, int16_t amp[],
+                               const uint8_t g722_data[], int len,
+                               uint16_t gain);
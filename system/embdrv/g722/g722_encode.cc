@@ -31,6 +31,7 @@
 
 #include "g722_typedefs.h"
 #include "g722_enc_dec.h"
+#include "g722_qmf.h"
 
 #if !defined(FALSE)
 #define FALSE 0
@@ -259,17 +260,31 @@ static int16_t qm2[4] =
 {
     -7408,  -1616,   7408,   1616
 };
-static int16_t qmf_coeffs[12] =
-{
-       3,  -11,   12,   32, -210,  951, 3876, -805,  362, -156,   53,  -11,
-};
 static int16_t ihn[3] = {0, 1, 0};
 static int16_t ihp[3] = {0, 3, 2};
 static int16_t wh[3] = {0, -214, 798};
 static int16_t rh2[4] = {2, 1, 2, 1};
 
-int g722_encode(g722_encode_state_t *s, uint8_t g722_data[],
-                       const int16_t amp[], int len)
+/* The transmit QMF coefficients
+     3, -11, 12, 32, -210, 951, 3876, -805, 362, -156, 53, -11
+   on the odd taps, and reversed on the even taps, as the two filters
+   g722_qmf_filter() applies: sumeven + sumodd gives the low band and
+   sumeven - sumodd the high band */
+static const int16_t qmf_coeffs_low[G722_QMF_TAPS] =
+{
+       3,  -11,  -11,   53,   12, -156,   32,  362, -210, -805,  951, 3876,
+    3876,  951, -805, -210,  362,   32, -156,   12,   53,  -11,  -11,    3,
+};
+static const int16_t qmf_coeffs_high[G722_QMF_TAPS] =
+{
+      -3,  -11,   11,   53,  -12, -156,  -32,  362,  210, -805, -951, 3876,
+   -3876,  951,  805, -210, -362,   32,  156,   12,  -53,  -11,   11,    3,
+};
+
+/* Number of sample pairs put through the QMF at a time */
+#define QMF_BLOCK_PAIRS 128
+
+static __inline uint8_t encode_pair(g722_encode_state_t *s, int xlow, int xhigh)
 {
     int dlow;
     int dhigh;
@@ -284,155 +299,282 @@ int g722_encode(g722_encode_state_t *s, uint8_t g722_data[],
     int eh;
     int mih;
     int i;
-    int j;
-    /* Low and high band PCM from the QMF */
-    int xlow;
-    int xhigh;
-    int g722_bytes;
-    /* Even and odd tap accumulators */
-    int sumeven;
-    int sumodd;
     int ihigh;
     int ilow;
     int code;
 
-    g722_bytes = 0;
-    xhigh = 0;
-    for (j = 0;  j < len;  )
-    {
-        if (s->itu_test_mode)
-        {
-            xlow =
-            xhigh = amp[j++] >> 1;
-        }
-        else
-        {
-            {
-                /* Apply the transmit QMF */
-                /* Shuffle the buffer down */
-                for (i = 0;  i < 22;  i++)
-                    s->x[i] = s->x[i + 2];
-                //TODO: if len is odd, then this can be a buffer overrun
-                s->x[22] = amp[j++];
-                s->x[23] = amp[j++];
-    
-                /* Discard every other QMF output */
-                sumeven = 0;
-                sumodd = 0;
-                for (i = 0;  i < 12;  i++)
-                {
-                    sumodd += s->x[2*i]*qmf_coeffs[i];
-                    sumeven += s->x[2*i + 1]*qmf_coeffs[11 - i];
-                }
-                /* We shift by 12 to allow for the QMF filters (DC gain = 4096), plus 1
-                   to allow for us summing two filters, plus 1 to allow for the 15 bit
-                   input to the G.722 algorithm. */
-                xlow = (sumeven + sumodd) >> 14;
-                xhigh = (sumeven - sumodd) >> 14;
-
 #ifdef RUN_LIKE_REFERENCE_G722
-                /* The following lines are only used to verify bit-exactness
-                 * with reference implementation of G.722. Higher precision
-                 * is achieved without limiting the values.
-                 */
-                xlow = limitValues(xlow);
-                xhigh = limitValues(xhigh);
+    /* The following lines are only used to verify bit-exactness
+     * with reference implementation of G.722. Higher precision
+     * is achieved without limiting the values.
+     */
+    xlow = limitValues(xlow);
+    xhigh = limitValues(xhigh);
 #endif
-            }
-        }
-        /* Block 1L, SUBTRA */
-        el = saturate(xlow - s->band[0].s);
 
-        /* Block 1L, QUANTL */
-        wd = (el >= 0)  ?  el  :  -(el + 1);
+    /* Block 1L, SUBTRA */
+    el = saturate(xlow - s->band[0].s);
 
-        for (i = 1;  i < 30;  i++)
-        {
-            wd1 = (q6[i]*s->band[0].det) >> 12;
-            if (wd < wd1)
-                break;
-        }
-        ilow = (el < 0)  ?  iln[i]  :  ilp[i];
-
-        /* Block 2L, INVQAL */
-        ril = ilow >> 2;
-        wd2 = qm4[ril];
-        dlow = (s->band[0].det*wd2) >> 15;
-
-        /* Block 3L, LOGSCL */
-        il4 = rl42[ril];
-        wd = (s->band[0].nb*127) >> 7;
-        s->band[0].nb = wd + wl[il4];
-        if (s->band[0].nb < 0)
-            s->band[0].nb = 0;
-        else if (s->band[0].nb > 18432)
-            s->band[0].nb = 18432;
-
-        /* Block 3L, SCALEL */
-        wd1 = (s->band[0].nb >> 6) & 31;
-        wd2 = 8 - (s->band[0].nb >> 11);
+    /* Block 1L, QUANTL */
+    wd = (el >= 0)  ?  el  :  -(el + 1);
+
+    for (i = 1;  i < 30;  i++)
+    {
+        wd1 = (q6[i]*s->band[0].det) >> 12;
+        if (wd < wd1)
+            break;
+    }
+    ilow = (el < 0)  ?  iln[i]  :  ilp[i];
+
+    /* Block 2L, INVQAL */
+    ril = ilow >> 2;
+    wd2 = qm4[ril];
+    dlow = (s->band[0].det*wd2) >> 15;
+
+    /* Block 3L, LOGSCL */
+    il4 = rl42[ril];
+    wd = (s->band[0].nb*127) >> 7;
+    s->band[0].nb = wd + wl[il4];
+    if (s->band[0].nb < 0)
+        s->band[0].nb = 0;
+    else if (s->band[0].nb > 18432)
+        s->band[0].nb = 18432;
+
+    /* Block 3L, SCALEL */
+    wd1 = (s->band[0].nb >> 6) & 31;
+    wd2 = 8 - (s->band[0].nb >> 11);
+    wd3 = (wd2 < 0)  ?  (ilb[wd1] << -wd2)  :  (ilb[wd1] >> wd2);
+    s->band[0].det = wd3 << 2;
+
+    block4(&s->band[0], dlow);
+    {
+        int nb;
+
+        /* Block 1H, SUBTRA */
+        eh = saturate(xhigh - s->band[1].s);
+
+        /* Block 1H, QUANTH */
+        wd = (eh >= 0)  ?  eh  :  -(eh + 1);
+        wd1 = (564*s->band[1].det) >> 12;
+        mih = (wd >= wd1)  ?  2  :  1;
+        ihigh = (eh < 0)  ?  ihn[mih]  :  ihp[mih];
+
+        /* Block 2H, INVQAH */
+        wd2 = qm2[ihigh];
+        dhigh = (s->band[1].det*wd2) >> 15;
+
+        /* Block 3H, LOGSCH */
+        ih2 = rh2[ihigh];
+        wd = (s->band[1].nb*127) >> 7;
+
+        nb = wd + wh[ih2];
+        if (nb < 0)
+            nb = 0;
+        else if (nb > 22528)
+            nb = 22528;
+        s->band[1].nb = nb;
+
+        /* Block 3H, SCALEH */
+        wd1 = (s->band[1].nb >> 6) & 31;
+        wd2 = 10 - (s->band[1].nb >> 11);
         wd3 = (wd2 < 0)  ?  (ilb[wd1] << -wd2)  :  (ilb[wd1] >> wd2);
-        s->band[0].det = wd3 << 2;
+        s->band[1].det = wd3 << 2;
 
-        block4(&s->band[0], dlow);
-        {
-	    int nb;
-
-            /* Block 1H, SUBTRA */
-            eh = saturate(xhigh - s->band[1].s);
-
-            /* Block 1H, QUANTH */
-            wd = (eh >= 0)  ?  eh  :  -(eh + 1);
-            wd1 = (564*s->band[1].det) >> 12;
-            mih = (wd >= wd1)  ?  2  :  1;
-            ihigh = (eh < 0)  ?  ihn[mih]  :  ihp[mih];
-
-            /* Block 2H, INVQAH */
-            wd2 = qm2[ihigh];
-            dhigh = (s->band[1].det*wd2) >> 15;
-
-            /* Block 3H, LOGSCH */
-            ih2 = rh2[ihigh];
-            wd = (s->band[1].nb*127) >> 7;
-
-            nb = wd + wh[ih2];
-            if (nb < 0)
-                nb = 0;
-            else if (nb > 22528)
-                nb = 22528;
-	    s->band[1].nb = nb;
-
-            /* Block 3H, SCALEH */
-            wd1 = (s->band[1].nb >> 6) & 31;
-            wd2 = 10 - (s->band[1].nb >> 11);
-            wd3 = (wd2 < 0)  ?  (ilb[wd1] << -wd2)  :  (ilb[wd1] >> wd2);
-            s->band[1].det = wd3 << 2;
-
-            block4(&s->band[1], dhigh);
+        block4(&s->band[1], dhigh);
 #if   BITS_PER_SAMPLE == 8
-            code = ((ihigh << 6) | ilow);
+        code = ((ihigh << 6) | ilow);
 #elif BITS_PER_SAMPLE == 7
-            code = ((ihigh << 6) | ilow) >> 1;
+        code = ((ihigh << 6) | ilow) >> 1;
 #elif BITS_PER_SAMPLE == 6
-            code = ((ihigh << 6) | ilow) >> 2;
+        code = ((ihigh << 6) | ilow) >> 2;
 #endif
-        }
+    }
+    return (uint8_t) code;
+}
+/*- End of function --------------------------------------------------------*/
 
+static __inline int put_code(g722_encode_state_t *s, uint8_t g722_data[],
+                             int g722_bytes, uint8_t code)
+{
 #if PACKED_OUTPUT == 1
-            /* Pack the code bits */
-            s->out_buffer |= (code << s->out_bits);
-            s->out_bits += s->bits_per_sample;
-            if (s->out_bits >= 8)
-            {
-                g722_data[g722_bytes++] = (uint8_t) (s->out_buffer & 0xFF);
-                s->out_bits -= 8;
-                s->out_buffer >>= 8;
-            }
+    /* Pack the code bits */
+    s->out_buffer |= (code << s->out_bits);
+    s->out_bits += s->bits_per_sample;
+    if (s->out_bits >= 8)
+    {
+        g722_data[g722_bytes++] = (uint8_t) (s->out_buffer & 0xFF);
+        s->out_bits -= 8;
+        s->out_buffer >>= 8;
+    }
 #else
-            g722_data[g722_bytes++] = (uint8_t) code;
+    (void) s;
+    g722_data[g722_bytes++] = code;
 #endif
+    return g722_bytes;
+}
+/*- End of function --------------------------------------------------------*/
+
+/* Starts a block of the transmit QMF: |x| gets the history of the filter,
+   ahead of the samples of the block */
+static __inline void qmf_load_history(const g722_encode_state_t *s, int16_t x[])
+{
+    int i;
+
+    for (i = 0;  i < G722_QMF_HISTORY;  i++)
+        x[i] = (int16_t) s->x[i + 2];
+}
+/*- End of function --------------------------------------------------------*/
+
+/* Keeps the last window of a block of |pairs| pairs as the history of the
+   filter */
+static __inline void qmf_store_history(g722_encode_state_t *s, const int16_t x[],
+                                       int pairs)
+{
+    int i;
+
+    for (i = 0;  i < G722_QMF_TAPS;  i++)
+        s->x[i] = x[2*(pairs - 1) + i];
+}
+/*- End of function --------------------------------------------------------*/
+
+int g722_encode(g722_encode_state_t *s, uint8_t g722_data[],
+                       const int16_t amp[], int len)
+{
+    /* QMF history followed by the samples of the block */
+    int16_t x[G722_QMF_HISTORY + 2*QMF_BLOCK_PAIRS];
+    /* Low and high band PCM from the QMF, before the shift */
+    int32_t sumlow[QMF_BLOCK_PAIRS];
+    int32_t sumhigh[QMF_BLOCK_PAIRS];
+    int g722_bytes;
+    int pairs;
+    int i;
+    int j;
+    int k;
+
+    g722_bytes = 0;
+    if (s->itu_test_mode)
+    {
+        for (j = 0;  j < len;  j++)
+        {
+            int xband = amp[j] >> 1;
+
+            g722_bytes = put_code(s, g722_data, g722_bytes,
+                                  encode_pair(s, xband, xband));
+        }
+        return g722_bytes;
+    }
+
+    for (j = 0;  j < len;  j += 2*pairs)
+    {
+        pairs = (len - j + 1)/2;
+        if (pairs > QMF_BLOCK_PAIRS)
+            pairs = QMF_BLOCK_PAIRS;
+
+        /* Apply the transmit QMF to the whole block, discarding every
+           other output */
+        qmf_load_history(s, x);
+        for (i = 0;  i < 2*pairs;  i++)
+        {
+            /* An odd trailing sample is paired with silence rather than
+               read past the end of amp */
+            x[G722_QMF_HISTORY + i] = (j + i < len)  ?  amp[j + i]  :  0;
+        }
+        g722_qmf_filter(x, pairs, qmf_coeffs_low, qmf_coeffs_high,
+                        sumlow, sumhigh);
+        qmf_store_history(s, x, pairs);
+
+        /* We shift by 12 to allow for the QMF filters (DC gain = 4096), plus 1
+           to allow for us summing two filters, plus 1 to allow for the 15 bit
+           input to the G.722 algorithm. */
+        for (k = 0;  k < pairs;  k++)
+        {
+            g722_bytes = put_code(s, g722_data, g722_bytes,
+                                  encode_pair(s, sumlow[k] >> 14,
+                                              sumhigh[k] >> 14));
+        }
     }
     return g722_bytes;
 }
 /*- End of function --------------------------------------------------------*/
+
+int g722_encode_stereo(g722_encode_state_t *left, g722_encode_state_t *right,
+                       uint8_t left_data[], uint8_t right_data[],
+                       const int16_t amp[], int len)
+{
+    int16_t xl[G722_QMF_HISTORY + 2*QMF_BLOCK_PAIRS];
+    int16_t xr[G722_QMF_HISTORY + 2*QMF_BLOCK_PAIRS];
+    int32_t sumlow[2][QMF_BLOCK_PAIRS];
+    int32_t sumhigh[2][QMF_BLOCK_PAIRS];
+    int left_bytes;
+    int right_bytes;
+    int pairs;
+    int i;
+    int j;
+    int k;
+
+    /* The test mode has no QMF to share, so just do one side after the other */
+    if (left->itu_test_mode  ||  right->itu_test_mode)
+    {
+        int16_t block[2*QMF_BLOCK_PAIRS];
+
+        left_bytes = 0;
+        right_bytes = 0;
+        for (j = 0;  j < len;  j += k)
+        {
+            k = (len - j < 2*QMF_BLOCK_PAIRS)  ?  (len - j)  :  2*QMF_BLOCK_PAIRS;
+            for (i = 0;  i < k;  i++)
+                block[i] = amp[2*(j + i)];
+            left_bytes += g722_encode(left, left_data + left_bytes, block, k);
+            for (i = 0;  i < k;  i++)
+                block[i] = amp[2*(j + i) + 1];
+            right_bytes += g722_encode(right, right_data + right_bytes, block, k);
+        }
+        return left_bytes;
+    }
+
+    left_bytes = 0;
+    right_bytes = 0;
+    for (j = 0;  j < len;  j += 2*pairs)
+    {
+        pairs = (len - j + 1)/2;
+        if (pairs > QMF_BLOCK_PAIRS)
+            pairs = QMF_BLOCK_PAIRS;
+
+        /* Split the channels straight into the QMF blocks */
+        qmf_load_history(left, xl);
+        qmf_load_history(right, xr);
+        for (i = 0;  i < 2*pairs;  i++)
+        {
+            if (j + i < len)
+            {
+                xl[G722_QMF_HISTORY + i] = amp[2*(j + i)];
+                xr[G722_QMF_HISTORY + i] = amp[2*(j + i) + 1];
+            }
+            else
+            {
+                xl[G722_QMF_HISTORY + i] = 0;
+                xr[G722_QMF_HISTORY + i] = 0;
+            }
+        }
+        g722_qmf_filter(xl, pairs, qmf_coeffs_low, qmf_coeffs_high,
+                        sumlow[0], sumhigh[0]);
+        g722_qmf_filter(xr, pairs, qmf_coeffs_low, qmf_coeffs_high,
+                        sumlow[1], sumhigh[1]);
+        qmf_store_history(left, xl, pairs);
+        qmf_store_history(right, xr, pairs);
+
+        /* The two sides are independent, so their adaptation can overlap */
+        for (k = 0;  k < pairs;  k++)
+        {
+            left_bytes = put_code(left, left_data, left_bytes,
+                                  encode_pair(left, sumlow[0][k] >> 14,
+                                              sumhigh[0][k] >> 14));
+            right_bytes = put_code(right, right_data, right_bytes,
+                                   encode_pair(right, sumlow[1][k] >> 14,
+                                               sumhigh[1][k] >> 14));
+        }
+    }
+    return left_bytes;
+}
+/*- End of function --------------------------------------------------------*/
 /*- End of file ------------------------------------------------------------*/
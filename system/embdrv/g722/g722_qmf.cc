@@ -0,0 +1,219 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "g722_qmf.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define G722_QMF_X86
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#define G722_QMF_NEON
+#include <arm_neon.h>
+#endif
+
+typedef void (*qmf_filter_fn)(const int16_t x[], int windows,
+                              const int16_t coeffs_a[G722_QMF_TAPS],
+                              const int16_t coeffs_b[G722_QMF_TAPS],
+                              int32_t out_a[], int32_t out_b[]);
+
+void g722_qmf_filter_c(const int16_t x[], int windows,
+                       const int16_t coeffs_a[G722_QMF_TAPS],
+                       const int16_t coeffs_b[G722_QMF_TAPS], int32_t out_a[],
+                       int32_t out_b[]) {
+  for (int k = 0; k < windows; k++) {
+    const int16_t* w = x + 2 * k;
+    int32_t sum_a = 0;
+    int32_t sum_b = 0;
+    for (int t = 0; t < G722_QMF_TAPS; t++) {
+      sum_a += w[t] * coeffs_a[t];
+      sum_b += w[t] * coeffs_b[t];
+    }
+    out_a[k] = sum_a;
+    out_b[k] = sum_b;
+  }
+}
+
+#ifdef G722_QMF_X86
+/* The products of the 16 bit samples and coefficients are summed pairwise by
+ * PMADDWD, which cannot overflow as the coefficients are far from -32768. */
+
+__attribute__((target("sse2"))) static inline int32_t hsum_sse2(__m128i v) {
+  v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+  v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtsi128_si32(v);
+}
+
+__attribute__((target("sse2"))) static void qmf_filter_sse2(
+    const int16_t x[], int windows, const int16_t coeffs_a[G722_QMF_TAPS],
+    const int16_t coeffs_b[G722_QMF_TAPS], int32_t out_a[], int32_t out_b[]) {
+  const __m128i a0 = _mm_loadu_si128((const __m128i*)coeffs_a);
+  const __m128i a1 = _mm_loadu_si128((const __m128i*)(coeffs_a + 8));
+  const __m128i a2 = _mm_loadu_si128((const __m128i*)(coeffs_a + 16));
+  const __m128i b0 = _mm_loadu_si128((const __m128i*)coeffs_b);
+  const __m128i b1 = _mm_loadu_si128((const __m128i*)(coeffs_b + 8));
+  const __m128i b2 = _mm_loadu_si128((const __m128i*)(coeffs_b + 16));
+
+  for (int k = 0; k < windows; k++) {
+    const int16_t* w = x + 2 * k;
+    const __m128i w0 = _mm_loadu_si128((const __m128i*)w);
+    const __m128i w1 = _mm_loadu_si128((const __m128i*)(w + 8));
+    const __m128i w2 = _mm_loadu_si128((const __m128i*)(w + 16));
+
+    __m128i sum_a = _mm_madd_epi16(w0, a0);
+    sum_a = _mm_add_epi32(sum_a, _mm_madd_epi16(w1, a1));
+    sum_a = _mm_add_epi32(sum_a, _mm_madd_epi16(w2, a2));
+    __m128i sum_b = _mm_madd_epi16(w0, b0);
+    sum_b = _mm_add_epi32(sum_b, _mm_madd_epi16(w1, b1));
+    sum_b = _mm_add_epi32(sum_b, _mm_madd_epi16(w2, b2));
+
+    out_a[k] = hsum_sse2(sum_a);
+    out_b[k] = hsum_sse2(sum_b);
+  }
+}
+
+/* Two windows at a time, one in each 128 bit lane */
+__attribute__((target("avx2"))) static void qmf_filter_avx2(
+    const int16_t x[], int windows, const int16_t coeffs_a[G722_QMF_TAPS],
+    const int16_t coeffs_b[G722_QMF_TAPS], int32_t out_a[], int32_t out_b[]) {
+  const __m256i a0 =
+      _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)coeffs_a));
+  const __m256i a1 = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128((const __m128i*)(coeffs_a + 8)));
+  const __m256i a2 = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128((const __m128i*)(coeffs_a + 16)));
+  const __m256i b0 =
+      _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)coeffs_b));
+  const __m256i b1 = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128((const __m128i*)(coeffs_b + 8)));
+  const __m256i b2 = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128((const __m128i*)(coeffs_b + 16)));
+
+  int k = 0;
+  for (; k + 1 < windows; k += 2) {
+    const int16_t* w = x + 2 * k;
+    __m256i w0 = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)w)),
+        _mm_loadu_si128((const __m128i*)(w + 2)), 1);
+    __m256i w1 = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(w + 8))),
+        _mm_loadu_si128((const __m128i*)(w + 10)), 1);
+    __m256i w2 = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(w + 16))),
+        _mm_loadu_si128((const __m128i*)(w + 18)), 1);
+
+    __m256i sum_a = _mm256_madd_epi16(w0, a0);
+    sum_a = _mm256_add_epi32(sum_a, _mm256_madd_epi16(w1, a1));
+    sum_a = _mm256_add_epi32(sum_a, _mm256_madd_epi16(w2, a2));
+    __m256i sum_b = _mm256_madd_epi16(w0, b0);
+    sum_b = _mm256_add_epi32(sum_b, _mm256_madd_epi16(w1, b1));
+    sum_b = _mm256_add_epi32(sum_b, _mm256_madd_epi16(w2, b2));
+
+    /* Each lane ends up as {a, b, a, b} for its window */
+    __m256i sums = _mm256_hadd_epi32(sum_a, sum_b);
+    sums = _mm256_hadd_epi32(sums, sums);
+    out_a[k] = _mm256_extract_epi32(sums, 0);
+    out_b[k] = _mm256_extract_epi32(sums, 1);
+    out_a[k + 1] = _mm256_extract_epi32(sums, 4);
+    out_b[k + 1] = _mm256_extract_epi32(sums, 5);
+  }
+
+  if (k < windows) {
+    qmf_filter_sse2(x + 2 * k, windows - k, coeffs_a, coeffs_b, out_a + k,
+                    out_b + k);
+  }
+}
+#endif
+
+#ifdef G722_QMF_NEON
+static inline int32_t hsum_neon(int32x4_t v) {
+#if defined(__aarch64__)
+  return vaddvq_s32(v);
+#else
+  int32x2_t s = vadd_s32(vget_low_s32(v), vget_high_s32(v));
+  return vget_lane_s32(vpadd_s32(s, s), 0);
+#endif
+}
+
+static inline int32x4_t dot_neon(int16x8_t w0, int16x8_t w1, int16x8_t w2,
+                                 int16x8_t c0, int16x8_t c1, int16x8_t c2) {
+  int32x4_t sum = vmull_s16(vget_low_s16(w0), vget_low_s16(c0));
+  sum = vmlal_s16(sum, vget_high_s16(w0), vget_high_s16(c0));
+  sum = vmlal_s16(sum, vget_low_s16(w1), vget_low_s16(c1));
+  sum = vmlal_s16(sum, vget_high_s16(w1), vget_high_s16(c1));
+  sum = vmlal_s16(sum, vget_low_s16(w2), vget_low_s16(c2));
+  sum = vmlal_s16(sum, vget_high_s16(w2), vget_high_s16(c2));
+  return sum;
+}
+
+static void qmf_filter_neon(const int16_t x[], int windows,
+                            const int16_t coeffs_a[G722_QMF_TAPS],
+                            const int16_t coeffs_b[G722_QMF_TAPS],
+                            int32_t out_a[], int32_t out_b[]) {
+  const int16x8_t a0 = vld1q_s16(coeffs_a);
+  const int16x8_t a1 = vld1q_s16(coeffs_a + 8);
+  const int16x8_t a2 = vld1q_s16(coeffs_a + 16);
+  const int16x8_t b0 = vld1q_s16(coeffs_b);
+  const int16x8_t b1 = vld1q_s16(coeffs_b + 8);
+  const int16x8_t b2 = vld1q_s16(coeffs_b + 16);
+
+  for (int k = 0; k < windows; k++) {
+    const int16_t* w = x + 2 * k;
+    const int16x8_t w0 = vld1q_s16(w);
+    const int16x8_t w1 = vld1q_s16(w + 8);
+    const int16x8_t w2 = vld1q_s16(w + 16);
+
+    out_a[k] = hsum_neon(dot_neon(w0, w1, w2, a0, a1, a2));
+    out_b[k] = hsum_neon(dot_neon(w0, w1, w2, b0, b1, b2));
+  }
+}
+#endif
+
+static const char* qmf_filter_name = "c";
+
+static qmf_filter_fn select_qmf_filter(void) {
+#ifdef G722_QMF_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    qmf_filter_name = "avx2";
+    return qmf_filter_avx2;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    qmf_filter_name = "sse2";
+    return qmf_filter_sse2;
+  }
+#elif defined(G722_QMF_NEON)
+  qmf_filter_name = "neon";
+  return qmf_filter_neon;
+#endif
+  return g722_qmf_filter_c;
+}
+
+static qmf_filter_fn get_qmf_filter(void) {
+  static const qmf_filter_fn filter = select_qmf_filter();
+  return filter;
+}
+
+void g722_qmf_filter(const int16_t x[], int windows,
+                     const int16_t coeffs_a[G722_QMF_TAPS],
+                     const int16_t coeffs_b[G722_QMF_TAPS], int32_t out_a[],
+                     int32_t out_b[]) {
+  get_qmf_filter()(x, windows, coeffs_a, coeffs_b, out_a, out_b);
+}
+
+const char* g722_qmf_filter_name(void) {
+  get_qmf_filter();
+  return qmf_filter_name;
+}
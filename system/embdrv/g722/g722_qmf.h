@@ -0,0 +1,46 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/* Number of taps of the transmit and receive QMF */
+#define G722_QMF_TAPS 24
+
+/* History the QMF needs in front of the samples of a block */
+#define G722_QMF_HISTORY (G722_QMF_TAPS - 2)
+
+/* Applies two 24 tap filters to windows of |x| which move by two samples:
+ * for each of the |windows| windows k,
+ *   out_a[k] = sum(x[2k + t] * coeffs_a[t]) for t in [0, 24),
+ * and likewise for out_b with coeffs_b. |x| holds 2 * |windows| + 22 samples.
+ *
+ * The sums are exact, so each implementation - scalar, SSE2, AVX2 or NEON,
+ * picked at runtime after the CPU features - gives the same result. */
+void g722_qmf_filter(const int16_t x[], int windows,
+                     const int16_t coeffs_a[G722_QMF_TAPS],
+                     const int16_t coeffs_b[G722_QMF_TAPS], int32_t out_a[],
+                     int32_t out_b[]);
+
+/* The scalar implementation, for comparison */
+void g722_qmf_filter_c(const int16_t x[], int windows,
+                       const int16_t coeffs_a[G722_QMF_TAPS],
+                       const int16_t coeffs_b[G722_QMF_TAPS], int32_t out_a[],
+                       int32_t out_b[]);
+
+/* Name of the implementation picked by g722_qmf_filter() */
+const char* g722_qmf_filter_name(void);
@@ -87,35 +87,21 @@ std::optional<Address> Address::FromString(const std::string& from) {
     return std::nullopt;
   }
 
+  // Parsed in place rather than with a stream, as this is on the path of every config property read at start up
   Address addr{};
-  std::istringstream stream(from);
-  std::string token;
-  int index = 0;
-  while (getline(stream, token, ':')) {
-    if (index >= 6) {
-      return std::nullopt;
-    }
-
-    if (token.length() != 2) {
+  for (int index = 0; index < 6; index++) {
+    const char* token_start = from.c_str() + index * 3;
+    if (index < 5 && token_start[2] != ':') {
       return std::nullopt;
     }
 
+    char token[3] = {token_start[0], token_start[1], '\0'};
     char* temp = nullptr;
-    addr.address.at(5 - index) = std::strtol(token.c_str(), &temp, 16);
-    if (temp == token.c_str()) {
-      // string token is empty or has wrong format
-      return std::nullopt;
-    }
-    if (temp != (token.c_str() + token.size())) {
-      // cannot parse whole string
+    addr.address.at(5 - index) = std::strtol(token, &temp, 16);
+    if (temp != token + 2) {
+      // string token is empty, has wrong format or cannot be parsed whole
       return std::nullopt;
     }
-
-    index++;
-  }
-
-  if (index != 6) {
-    return std::nullopt;
   }
 
   return addr;
@@ -17,6 +17,8 @@
 #include "hci/controller.h"
 
 #include <android-base/strings.h>
+#include <atomic>
+#include <chrono>
 #include <future>
 #include <memory>
 #include <string>
@@ -42,64 +44,67 @@ struct Controller::impl {
   void Start(hci::HciLayer* hci) {
     hci_ = hci;
     Handler* handler = module_.GetHandler();
+    auto start_time = std::chrono::steady_clock::now();
     hci_->RegisterEventHandler(
         EventCode::NUMBER_OF_COMPLETED_PACKETS, handler->BindOn(this, &Controller::impl::NumberOfCompletedPackets));
 
     le_set_event_mask(kDefaultLeEventMask);
     set_event_mask(kDefaultEventMask);
     write_le_host_support(Enable::ENABLED, Enable::DISABLED);
-    hci_->EnqueueCommand(ReadLocalNameBuilder::Create(),
-                         handler->BindOnceOn(this, &Controller::impl::read_local_name_complete_handler));
-    hci_->EnqueueCommand(ReadLocalVersionInformationBuilder::Create(),
-                         handler->BindOnceOn(this, &Controller::impl::read_local_version_information_complete_handler));
-    hci_->EnqueueCommand(ReadLocalSupportedCommandsBuilder::Create(),
-                         handler->BindOnceOn(this, &Controller::impl::read_local_supported_commands_complete_handler));
 
-    hci_->EnqueueCommand(
-        LeReadLocalSupportedFeaturesBuilder::Create(),
-        handler->BindOnceOn(this, &Controller::impl::le_read_local_supported_features_handler));
-
-    hci_->EnqueueCommand(
-        LeReadSupportedStatesBuilder::Create(),
-        handler->BindOnceOn(this, &Controller::impl::le_read_supported_states_handler));
-
-    // Wait for all extended features read
-    std::promise<void> features_promise;
-    auto features_future = features_promise.get_future();
-    hci_->EnqueueCommand(ReadLocalExtendedFeaturesBuilder::Create(0x00),
-                         handler->BindOnceOn(this, &Controller::impl::read_local_extended_features_complete_handler,
-                                             std::move(features_promise)));
-    features_future.wait();
+    // The reads don't depend on each other, so they are sent as fast as the controller takes them. The ones after
+    // depend on the supported commands and features read here.
+    enqueue_startup_read(ReadLocalNameBuilder::Create(), &Controller::impl::read_local_name_complete_handler);
+    enqueue_startup_read(
+        ReadLocalVersionInformationBuilder::Create(),
+        &Controller::impl::read_local_version_information_complete_handler);
+    enqueue_startup_read(
+        ReadLocalSupportedCommandsBuilder::Create(), &Controller::impl::read_local_supported_commands_complete_handler);
+    enqueue_startup_read(
+        LeReadLocalSupportedFeaturesBuilder::Create(), &Controller::impl::le_read_local_supported_features_handler);
+    enqueue_startup_read(LeReadSupportedStatesBuilder::Create(), &Controller::impl::le_read_supported_states_handler);
+    enqueue_startup_read(
+        ReadLocalExtendedFeaturesBuilder::Create(0x00),
+        &Controller::impl::read_local_extended_features_complete_handler);
+    // Read before the LE buffer size, which may take half of the ACL buffers
+    enqueue_startup_read(ReadBufferSizeBuilder::Create(), &Controller::impl::read_buffer_size_complete_handler);
+    wait_for_startup_reads();
 
-    hci_->EnqueueCommand(ReadBufferSizeBuilder::Create(),
-                         handler->BindOnceOn(this, &Controller::impl::read_buffer_size_complete_handler));
+    // SSP is managed by security layer once enabled
+    if (!common::init_flags::gd_security_is_enabled()) {
+      write_simple_pairing_mode(Enable::ENABLED);
+      if (module_.SupportsSecureConnections()) {
+        hci_->EnqueueCommand(
+            WriteSecureConnectionsHostSupportBuilder::Create(Enable::ENABLED),
+            handler->BindOnceOn(this, &Controller::impl::write_secure_connections_host_support_complete_handler));
+      }
+    }
+    if (is_supported(OpCode::LE_SET_HOST_FEATURE) && module_.SupportsBleConnectedIsochronousStreamCentral()) {
+      hci_->EnqueueCommand(
+          LeSetHostFeatureBuilder::Create(LeHostFeatureBits::CONNECTED_ISO_STREAM_HOST_SUPPORT, Enable::ENABLED),
+          handler->BindOnceOn(this, &Controller::impl::le_set_host_feature_handler));
+    }
 
     if (is_supported(OpCode::LE_READ_BUFFER_SIZE_V2)) {
-      hci_->EnqueueCommand(
-          LeReadBufferSizeV2Builder::Create(),
-          handler->BindOnceOn(this, &Controller::impl::le_read_buffer_size_v2_handler));
+      enqueue_startup_read(LeReadBufferSizeV2Builder::Create(), &Controller::impl::le_read_buffer_size_v2_handler);
     } else {
-      hci_->EnqueueCommand(
-          LeReadBufferSizeV1Builder::Create(),
-          handler->BindOnceOn(this, &Controller::impl::le_read_buffer_size_handler));
+      enqueue_startup_read(LeReadBufferSizeV1Builder::Create(), &Controller::impl::le_read_buffer_size_handler);
     }
 
-    hci_->EnqueueCommand(
-        LeReadFilterAcceptListSizeBuilder::Create(),
-        handler->BindOnceOn(this, &Controller::impl::le_read_connect_list_size_handler));
+    enqueue_startup_read(
+        LeReadFilterAcceptListSizeBuilder::Create(), &Controller::impl::le_read_connect_list_size_handler);
 
     if (is_supported(OpCode::LE_READ_RESOLVING_LIST_SIZE) && module_.SupportsBlePrivacy()) {
-      hci_->EnqueueCommand(
-          LeReadResolvingListSizeBuilder::Create(),
-          handler->BindOnceOn(this, &Controller::impl::le_read_resolving_list_size_handler));
+      enqueue_startup_read(
+          LeReadResolvingListSizeBuilder::Create(), &Controller::impl::le_read_resolving_list_size_handler);
     } else {
       LOG_INFO("LE_READ_RESOLVING_LIST_SIZE not supported, defaulting to 0");
       le_resolving_list_size_ = 0;
     }
 
     if (is_supported(OpCode::LE_READ_MAXIMUM_DATA_LENGTH) && module_.SupportsBleDataPacketLengthExtension()) {
-      hci_->EnqueueCommand(LeReadMaximumDataLengthBuilder::Create(),
-                           handler->BindOnceOn(this, &Controller::impl::le_read_maximum_data_length_handler));
+      enqueue_startup_read(
+          LeReadMaximumDataLengthBuilder::Create(), &Controller::impl::le_read_maximum_data_length_handler);
     } else {
       LOG_INFO("LE_READ_MAXIMUM_DATA_LENGTH not supported, defaulting to 0");
       le_maximum_data_length_.supported_max_rx_octets_ = 0;
@@ -108,28 +113,19 @@ struct Controller::impl {
       le_maximum_data_length_.supported_max_tx_time_ = 0;
     }
 
-    // SSP is managed by security layer once enabled
-    if (!common::init_flags::gd_security_is_enabled()) {
-      write_simple_pairing_mode(Enable::ENABLED);
-      if (module_.SupportsSecureConnections()) {
-        hci_->EnqueueCommand(
-            WriteSecureConnectionsHostSupportBuilder::Create(Enable::ENABLED),
-            handler->BindOnceOn(this, &Controller::impl::write_secure_connections_host_support_complete_handler));
-      }
-    }
     if (is_supported(OpCode::LE_READ_SUGGESTED_DEFAULT_DATA_LENGTH) && module_.SupportsBleDataPacketLengthExtension()) {
-      hci_->EnqueueCommand(
+      enqueue_startup_read(
           LeReadSuggestedDefaultDataLengthBuilder::Create(),
-          handler->BindOnceOn(this, &Controller::impl::le_read_suggested_default_data_length_handler));
+          &Controller::impl::le_read_suggested_default_data_length_handler);
     } else {
       LOG_INFO("LE_READ_SUGGESTED_DEFAULT_DATA_LENGTH not supported, defaulting to 27 (0x1B)");
       le_suggested_default_data_length_ = 27;
     }
 
     if (is_supported(OpCode::LE_READ_MAXIMUM_ADVERTISING_DATA_LENGTH) && module_.SupportsBleExtendedAdvertising()) {
-      hci_->EnqueueCommand(
+      enqueue_startup_read(
           LeReadMaximumAdvertisingDataLengthBuilder::Create(),
-          handler->BindOnceOn(this, &Controller::impl::le_read_maximum_advertising_data_length_handler));
+          &Controller::impl::le_read_maximum_advertising_data_length_handler);
     } else {
       LOG_INFO("LE_READ_MAXIMUM_ADVERTISING_DATA_LENGTH not supported, defaulting to 31 (0x1F)");
       le_maximum_advertising_data_length_ = 31;
@@ -137,40 +133,68 @@ struct Controller::impl {
 
     if (is_supported(OpCode::LE_READ_NUMBER_OF_SUPPORTED_ADVERTISING_SETS) &&
         module_.SupportsBleExtendedAdvertising()) {
-      hci_->EnqueueCommand(
+      enqueue_startup_read(
           LeReadNumberOfSupportedAdvertisingSetsBuilder::Create(),
-          handler->BindOnceOn(this, &Controller::impl::le_read_number_of_supported_advertising_sets_handler));
+          &Controller::impl::le_read_number_of_supported_advertising_sets_handler);
     } else {
       LOG_INFO("LE_READ_NUMBER_OF_SUPPORTED_ADVERTISING_SETS not supported, defaulting to 1");
       le_number_supported_advertising_sets_ = 1;
     }
 
     if (is_supported(OpCode::LE_READ_PERIODIC_ADVERTISING_LIST_SIZE) && module_.SupportsBlePeriodicAdvertising()) {
-      hci_->EnqueueCommand(
+      enqueue_startup_read(
           LeReadPeriodicAdvertiserListSizeBuilder::Create(),
-          handler->BindOnceOn(this, &Controller::impl::le_read_periodic_advertiser_list_size_handler));
+          &Controller::impl::le_read_periodic_advertiser_list_size_handler);
     } else {
       LOG_INFO("LE_READ_PERIODIC_ADVERTISING_LIST_SIZE not supported, defaulting to 0");
       le_periodic_advertiser_list_size_ = 0;
     }
-    if (is_supported(OpCode::LE_SET_HOST_FEATURE) && module_.SupportsBleConnectedIsochronousStreamCentral()) {
-      hci_->EnqueueCommand(
-          LeSetHostFeatureBuilder::Create(LeHostFeatureBits::CONNECTED_ISO_STREAM_HOST_SUPPORT, Enable::ENABLED),
-          handler->BindOnceOn(this, &Controller::impl::le_set_host_feature_handler));
-    }
 
-    hci_->EnqueueCommand(LeGetVendorCapabilitiesBuilder::Create(),
-                         handler->BindOnceOn(this, &Controller::impl::le_get_vendor_capabilities_handler));
+    enqueue_startup_read(
+        LeGetVendorCapabilitiesBuilder::Create(), &Controller::impl::le_get_vendor_capabilities_handler);
+    enqueue_startup_read(ReadBdAddrBuilder::Create(), &Controller::impl::read_controller_mac_address_handler);
+    wait_for_startup_reads();
+
+    start_duration_ =
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time);
+    LOG_INFO("Controller ready in %lld us", (long long)start_duration_.count());
+  }
+
+  // Send a read of the controller capabilities, which may be outstanding along with the other ones
+  void enqueue_startup_read(
+      std::unique_ptr<CommandBuilder> command, void (Controller::impl::*complete_handler)(CommandCompleteView)) {
+    startup_reads_pending_++;
+    hci_->EnqueueIndependentCommand(
+        std::move(command),
+        module_.GetHandler()->BindOnceOn(this, &Controller::impl::on_startup_read_complete, complete_handler));
+  }
+
+  void on_startup_read_complete(
+      void (Controller::impl::*complete_handler)(CommandCompleteView), CommandCompleteView view) {
+    (this->*complete_handler)(std::move(view));
+    if (--startup_reads_pending_ == 0 && startup_reads_promise_ != nullptr) {
+      startup_reads_promise_->set_value();
+      startup_reads_promise_.reset();
+    }
+  }
 
-    // We only need to synchronize the last read. Make BD_ADDR to be the last one.
+  // Wait for all the reads sent so far to complete
+  void wait_for_startup_reads() {
     std::promise<void> promise;
     auto future = promise.get_future();
-    hci_->EnqueueCommand(
-        ReadBdAddrBuilder::Create(),
-        handler->BindOnceOn(this, &Controller::impl::read_controller_mac_address_handler, std::move(promise)));
+    module_.GetHandler()->Post(
+        common::BindOnce(&Controller::impl::join_startup_reads, common::Unretained(this), std::move(promise)));
     future.wait();
   }
 
+  void join_startup_reads(std::promise<void> promise) {
+    if (startup_reads_pending_ == 0) {
+      promise.set_value();
+    } else {
+      startup_reads_promise_ = std::make_unique<std::promise<void>>(std::move(promise));
+    }
+  }
+
   void Stop() {
     if (bluetooth::common::init_flags::gd_core_is_enabled()) {
       hci_->UnregisterEventHandler(EventCode::NUMBER_OF_COMPLETED_PACKETS);
@@ -276,7 +300,7 @@ struct Controller::impl {
     }
   }
 
-  void read_local_extended_features_complete_handler(std::promise<void> promise, CommandCompleteView view) {
+  void read_local_extended_features_complete_handler(CommandCompleteView view) {
     auto complete_view = ReadLocalExtendedFeaturesCompleteView::Create(view);
     ASSERT(complete_view.IsValid());
     ErrorCode status = complete_view.GetStatus();
@@ -287,12 +311,9 @@ struct Controller::impl {
     // Query all extended features
     if (page_number < complete_view.GetMaximumPageNumber()) {
       page_number++;
-      hci_->EnqueueCommand(
+      enqueue_startup_read(
           ReadLocalExtendedFeaturesBuilder::Create(page_number),
-          module_.GetHandler()->BindOnceOn(this, &Controller::impl::read_local_extended_features_complete_handler,
-                                           std::move(promise)));
-    } else {
-      promise.set_value();
+          &Controller::impl::read_local_extended_features_complete_handler);
     }
   }
 
@@ -308,13 +329,12 @@ struct Controller::impl {
     sco_buffers_ = complete_view.GetTotalNumSynchronousDataPackets();
   }
 
-  void read_controller_mac_address_handler(std::promise<void> promise, CommandCompleteView view) {
+  void read_controller_mac_address_handler(CommandCompleteView view) {
     auto complete_view = ReadBdAddrCompleteView::Create(view);
     ASSERT(complete_view.IsValid());
     ErrorCode status = complete_view.GetStatus();
     ASSERT_LOG(status == ErrorCode::SUCCESS, "Status 0x%02hhx, %s", status, ErrorCodeText(status).c_str());
     mac_address_ = complete_view.GetBdAddr();
-    promise.set_value();
   }
 
   void le_read_buffer_size_handler(CommandCompleteView view) {
@@ -930,6 +950,12 @@ struct Controller::impl {
   uint8_t le_number_supported_advertising_sets_{};
   uint8_t le_periodic_advertiser_list_size_{};
   VendorCapabilities vendor_capabilities_{};
+
+  // Reads sent from Start() and not completed yet, and the promise kept once they all are
+  std::atomic<int> startup_reads_pending_{0};
+  std::unique_ptr<std::promise<void>> startup_reads_promise_;
+  // Time from Start() until all the controller capabilities are read
+  std::chrono::microseconds start_duration_{0};
 };  // namespace hci
 
 Controller::Controller() : impl_(std::make_unique<impl>(*this)) {}
@@ -1293,6 +1319,7 @@ void Controller::impl::Dump(
   builder.add_le_local_supported_features(le_local_supported_features_);
   builder.add_le_supported_states(le_supported_states_);
   builder.add_vendor_capabilities(&vendor_capabilities_data);
+  builder.add_start_time_us(start_duration_.count());
 
   flatbuffers::Offset<ControllerData> dumpsys_data = builder.Finish();
   promise.set_value(dumpsys_data);
@@ -19,7 +19,9 @@
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <deque>
 #include <future>
 #include <map>
 #include <memory>
@@ -29,6 +31,7 @@
 #include "common/init_flags.h"
 #include "hci/address.h"
 #include "hci/hci_layer.h"
+#include "os/alarm.h"
 #include "os/thread.h"
 #include "packet/raw_builder.h"
 
@@ -81,6 +84,12 @@ class TestHciLayer : public HciLayer {
     FAIL() << "Controller properties should not generate Command Status";
   }
 
+  void EnqueueIndependentCommand(
+      std::unique_ptr<CommandBuilder> command,
+      common::ContextualOnceCallback<void(CommandCompleteView)> on_complete) override {
+    EnqueueCommand(std::move(command), std::move(on_complete));
+  }
+
   void HandleCommand(
       std::unique_ptr<CommandBuilder> command_builder,
       common::ContextualOnceCallback<void(CommandCompleteView)> on_complete) {
@@ -282,6 +291,98 @@ class TestHciLayer : public HciLayer {
   std::condition_variable not_empty_;
 };
 
+// Completes each command |latency| after sending it, with up to |credits| independent commands in flight like
+// Num_HCI_Command_Packets allows, and a regular command only in flight on its own
+class LatencyHciLayer : public TestHciLayer {
+ public:
+  LatencyHciLayer(size_t credits, std::chrono::milliseconds latency) : credits_(credits), latency_(latency) {}
+
+  void EnqueueCommand(
+      std::unique_ptr<CommandBuilder> command,
+      common::ContextualOnceCallback<void(CommandCompleteView)> on_complete) override {
+    GetHandler()->Post(common::BindOnce(
+        &LatencyHciLayer::QueueCommand, common::Unretained(this), std::move(command), std::move(on_complete), false));
+  }
+
+  void EnqueueIndependentCommand(
+      std::unique_ptr<CommandBuilder> command,
+      common::ContextualOnceCallback<void(CommandCompleteView)> on_complete) override {
+    GetHandler()->Post(common::BindOnce(
+        &LatencyHciLayer::QueueCommand, common::Unretained(this), std::move(command), std::move(on_complete), true));
+  }
+
+  size_t GetMaxCommandsInFlight() const {
+    return max_in_flight_;
+  }
+
+  void Start() override {
+    for (size_t i = 0; i < credits_; i++) {
+      alarms_.push_back(std::make_unique<os::Alarm>(GetHandler()));
+      free_alarms_.push_back(i);
+    }
+  }
+
+  void Stop() override {
+    alarms_.clear();
+  }
+
+ private:
+  struct QueuedCommand {
+    std::unique_ptr<CommandBuilder> command;
+    common::ContextualOnceCallback<void(CommandCompleteView)> on_complete;
+    bool independent;
+  };
+
+  void QueueCommand(
+      std::unique_ptr<CommandBuilder> command,
+      common::ContextualOnceCallback<void(CommandCompleteView)> on_complete,
+      bool independent) {
+    queue_.push_back({std::move(command), std::move(on_complete), independent});
+    SendQueuedCommands();
+  }
+
+  void SendQueuedCommands() {
+    while (!queue_.empty() && !free_alarms_.empty() &&
+           (in_flight_ == 0 || (!regular_in_flight_ && queue_.front().independent))) {
+      QueuedCommand queued = std::move(queue_.front());
+      queue_.pop_front();
+      size_t alarm = free_alarms_.back();
+      free_alarms_.pop_back();
+      regular_in_flight_ = !queued.independent;
+      in_flight_++;
+      max_in_flight_ = std::max(max_in_flight_.load(), in_flight_);
+      alarms_[alarm]->Schedule(
+          common::BindOnce(
+              &LatencyHciLayer::CompleteCommand,
+              common::Unretained(this),
+              alarm,
+              std::move(queued.command),
+              std::move(queued.on_complete)),
+          latency_);
+    }
+  }
+
+  void CompleteCommand(
+      size_t alarm,
+      std::unique_ptr<CommandBuilder> command,
+      common::ContextualOnceCallback<void(CommandCompleteView)> on_complete) {
+    free_alarms_.push_back(alarm);
+    in_flight_--;
+    regular_in_flight_ = false;
+    HandleCommand(std::move(command), std::move(on_complete));
+    SendQueuedCommands();
+  }
+
+  const size_t credits_;
+  const std::chrono::milliseconds latency_;
+  std::vector<std::unique_ptr<os::Alarm>> alarms_;
+  std::vector<size_t> free_alarms_;
+  std::deque<QueuedCommand> queue_;
+  size_t in_flight_ = 0;
+  bool regular_in_flight_ = false;
+  std::atomic<size_t> max_in_flight_{0};
+};
+
 }  // namespace
 class ControllerTest : public ::testing::Test {
  protected:
@@ -514,6 +615,72 @@ void le_rand_callback(uint64_t random) {
   le_rand_set.set_value(random);
 }
 
+// A controller started behind a LatencyHciLayer
+struct LatencyControllerStack {
+  LatencyControllerStack(size_t credits, std::chrono::milliseconds latency) {
+    hci_layer = new LatencyHciLayer(credits, latency);
+    registry.InjectTestModule(&HciLayer::Factory, hci_layer);
+    auto start_time = std::chrono::steady_clock::now();
+    registry.Start<Controller>(&registry.GetTestThread());
+    start_duration = std::chrono::steady_clock::now() - start_time;
+    controller = static_cast<Controller*>(registry.GetModuleUnderTest(&Controller::Factory));
+  }
+
+  ~LatencyControllerStack() {
+    registry.StopAll();
+  }
+
+  TestModuleRegistry registry;
+  LatencyHciLayer* hci_layer = nullptr;
+  Controller* controller = nullptr;
+  std::chrono::steady_clock::duration start_duration;
+};
+
+void ExpectSameControllerState(const Controller& expected, const Controller& actual) {
+  EXPECT_EQ(expected.GetLocalName(), actual.GetLocalName());
+  EXPECT_EQ(expected.GetLocalVersionInformation().hci_version_, actual.GetLocalVersionInformation().hci_version_);
+  EXPECT_EQ(expected.GetLocalVersionInformation().lmp_subversion_, actual.GetLocalVersionInformation().lmp_subversion_);
+  for (uint8_t page_number = 0; page_number < 3; page_number++) {
+    EXPECT_EQ(expected.GetLocalFeatures(page_number), actual.GetLocalFeatures(page_number));
+  }
+  EXPECT_EQ(expected.GetLocalLeFeatures(), actual.GetLocalLeFeatures());
+  EXPECT_EQ(expected.GetLeSupportedStates(), actual.GetLeSupportedStates());
+  for (auto op_code : {OpCode::INQUIRY, OpCode::LE_MULTI_ADVT, OpCode::LE_REMOVE_ADVERTISING_SET,
+                       OpCode::CONTROLLER_A2DP_OPCODE, OpCode::LE_SET_PERIODIC_ADVERTISING_PARAM}) {
+    EXPECT_EQ(expected.IsSupported(op_code), actual.IsSupported(op_code));
+  }
+  EXPECT_EQ(expected.GetAclPacketLength(), actual.GetAclPacketLength());
+  EXPECT_EQ(expected.GetNumAclPacketBuffers(), actual.GetNumAclPacketBuffers());
+  EXPECT_EQ(expected.GetScoPacketLength(), actual.GetScoPacketLength());
+  EXPECT_EQ(expected.GetNumScoPacketBuffers(), actual.GetNumScoPacketBuffers());
+  EXPECT_EQ(expected.GetMacAddress(), actual.GetMacAddress());
+  EXPECT_EQ(expected.GetLeBufferSize().le_data_packet_length_, actual.GetLeBufferSize().le_data_packet_length_);
+  EXPECT_EQ(expected.GetLeBufferSize().total_num_le_packets_, actual.GetLeBufferSize().total_num_le_packets_);
+  EXPECT_EQ(
+      expected.GetLeMaximumDataLength().supported_max_tx_octets_,
+      actual.GetLeMaximumDataLength().supported_max_tx_octets_);
+  EXPECT_EQ(expected.GetLeMaximumAdvertisingDataLength(), actual.GetLeMaximumAdvertisingDataLength());
+  EXPECT_EQ(expected.GetLeNumberOfSupportedAdverisingSets(), actual.GetLeNumberOfSupportedAdverisingSets());
+  EXPECT_EQ(expected.GetVendorCapabilities().version_supported_, actual.GetVendorCapabilities().version_supported_);
+  EXPECT_EQ(expected.GetVendorCapabilities().max_advt_instances_, actual.GetVendorCapabilities().max_advt_instances_);
+}
+
+TEST(ControllerStartTest, pipelined_start_reads_the_same_state) {
+  feature_spec_version = 98;
+  bluetooth::common::InitFlags::SetAllForTesting();
+  constexpr auto kCommandLatency = 5ms;
+
+  // A single credit sends the reads one at a time
+  LatencyControllerStack serial(1, kCommandLatency);
+  LatencyControllerStack pipelined(4, kCommandLatency);
+
+  ExpectSameControllerState(*serial.controller, *pipelined.controller);
+  ASSERT_EQ(serial.hci_layer->GetMaxCommandsInFlight(), 1u);
+  ASSERT_GT(pipelined.hci_layer->GetMaxCommandsInFlight(), 1u);
+  ASSERT_LE(pipelined.hci_layer->GetMaxCommandsInFlight(), 4u);
+  ASSERT_LT(pipelined.start_duration, serial.start_duration);
+}
+
 TEST_F(ControllerTest, Dumpsys) {
   ModuleDumper dumper(fake_registry_, title);
 
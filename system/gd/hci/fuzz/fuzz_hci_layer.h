@@ -67,6 +67,12 @@ class FuzzHciLayer : public HciLayer {
     }
   }
 
+  void EnqueueIndependentCommand(
+      std::unique_ptr<hci::CommandBuilder> command,
+      common::ContextualOnceCallback<void(hci::CommandCompleteView)> on_complete) override {
+    EnqueueCommand(std::move(command), std::move(on_complete));
+  }
+
   common::BidiQueueEnd<hci::AclBuilder, hci::AclView>* GetAclQueueEnd() override {
     return acl_queue_.GetUpEnd();
   }
@@ -71,6 +71,8 @@ class CommandQueueEntry {
   unique_ptr<CommandBuilder> command;
   unique_ptr<CommandView> command_view;
 
+  // May be outstanding along with other independent commands
+  bool independent_ = false;
   bool waiting_for_status_;
   ContextualOnceCallback<void(CommandStatusView)> on_status;
   ContextualOnceCallback<void(CommandCompleteView)> on_complete;
@@ -143,6 +145,13 @@ struct HciLayer::impl {
     send_next_command();
   }
 
+  void enqueue_independent_command(
+      unique_ptr<CommandBuilder> command, ContextualOnceCallback<void(CommandCompleteView)> on_complete) {
+    command_queue_.emplace_back(move(command), move(on_complete));
+    command_queue_.back().independent_ = true;
+    send_next_command();
+  }
+
   void on_command_status(EventView event) {
     CommandStatusView response_view = CommandStatusView::Create(event);
     ASSERT(response_view.IsValid());
@@ -180,12 +189,19 @@ struct HciLayer::impl {
       LOG_ERROR("Discarding event that came after timeout 0x%02hx (%s)", op_code, OpCodeText(op_code).c_str());
       return;
     }
-    ASSERT_LOG(waiting_command_ == op_code, "Waiting for 0x%02hx (%s), got 0x%02hx (%s)", waiting_command_,
+    // Commands sent together may complete in any order
+    auto command = command_queue_.begin();
+    size_t position = 0;
+    while (position < outstanding_commands_ && command->command_view->GetOpCode() != op_code) {
+      command++;
+      position++;
+    }
+    ASSERT_LOG(position < outstanding_commands_, "Waiting for 0x%02hx (%s), got 0x%02hx (%s)", waiting_command_,
                OpCodeText(waiting_command_).c_str(), op_code, OpCodeText(op_code).c_str());
 
     bool is_vendor_specific = static_cast<int>(op_code) & (0x3f << 10);
     CommandStatusView status_view = CommandStatusView::Create(event);
-    if (is_vendor_specific && (is_status && !command_queue_.front().waiting_for_status_) &&
+    if (is_vendor_specific && (is_status && !command->waiting_for_status_) &&
         (status_view.IsValid() && status_view.GetStatus() == ErrorCode::UNKNOWN_HCI_COMMAND)) {
       // If this is a command status of a vendor specific command, and command complete is expected, we can't treat
       // this as hard failure since we have no way of probing this lack of support at earlier time. Instead we let
@@ -193,21 +209,27 @@ struct HciLayer::impl {
       // response.
       CommandCompleteView command_complete_view = CommandCompleteView::Create(
           EventView::Create(PacketView<kLittleEndian>(std::make_shared<std::vector<uint8_t>>(std::vector<uint8_t>()))));
-      command_queue_.front().GetCallback<CommandCompleteView>()->Invoke(move(command_complete_view));
+      command->GetCallback<CommandCompleteView>()->Invoke(move(command_complete_view));
     } else {
-      if (command_queue_.front().waiting_for_status_ == is_status) {
-        command_queue_.front().GetCallback<TResponse>()->Invoke(move(response_view));
+      if (command->waiting_for_status_ == is_status) {
+        command->GetCallback<TResponse>()->Invoke(move(response_view));
       } else {
         CommandCompleteView command_complete_view = CommandCompleteView::Create(
             EventView::Create(PacketView<kLittleEndian>(std::make_shared<std::vector<uint8_t>>(std::vector<uint8_t>()))));
-        command_queue_.front().GetCallback<CommandCompleteView>()->Invoke(move(command_complete_view));
+        command->GetCallback<CommandCompleteView>()->Invoke(move(command_complete_view));
       }
     }
 
-    command_queue_.pop_front();
-    waiting_command_ = OpCode::NONE;
+    command_queue_.erase(command);
+    outstanding_commands_--;
+    waiting_command_ = outstanding_commands_ > 0 ? command_queue_.front().command_view->GetOpCode() : OpCode::NONE;
     if (hci_timeout_alarm_ != nullptr) {
       hci_timeout_alarm_->Cancel();
+      if (waiting_command_ != OpCode::NONE) {
+        // Time the oldest command left
+        hci_timeout_alarm_->Schedule(
+            BindOnce(&impl::on_hci_timeout, common::Unretained(this), waiting_command_), kHciTimeoutMs);
+      }
       send_next_command();
     }
   }
@@ -220,6 +242,7 @@ struct HciLayer::impl {
     LOG_ERROR("Flushing %zd waiting commands", command_queue_.size());
     // Clear any waiting commands (there is an abort coming anyway)
     command_queue_.clear();
+    outstanding_commands_ = 0;
     command_credits_ = 1;
     waiting_command_ = OpCode::NONE;
     enqueue_command(
@@ -238,33 +261,50 @@ struct HciLayer::impl {
     }
   }
 
-  void send_next_command() {
+  bool can_send_next_command() const {
     if (command_credits_ == 0) {
-      return;
+      return false;
     }
-    if (waiting_command_ != OpCode::NONE) {
-      return;
+    if (command_queue_.size() <= outstanding_commands_) {
+      return false;
     }
-    if (command_queue_.size() == 0) {
-      return;
+    if (outstanding_commands_ == 0) {
+      return true;
     }
-    std::shared_ptr<std::vector<uint8_t>> bytes = std::make_shared<std::vector<uint8_t>>();
-    BitInserter bi(*bytes);
-    command_queue_.front().command->Serialize(bi);
-    hal_->sendHciCommand(*bytes);
-
-    auto cmd_view = CommandView::Create(PacketView<kLittleEndian>(bytes));
-    ASSERT(cmd_view.IsValid());
-    OpCode op_code = cmd_view.GetOpCode();
-    command_queue_.front().command_view = std::make_unique<CommandView>(std::move(cmd_view));
-    log_link_layer_connection_command(command_queue_.front().command_view);
-    log_classic_pairing_command_status(command_queue_.front().command_view, ErrorCode::STATUS_UNKNOWN);
-    waiting_command_ = op_code;
-    command_credits_ = 0;  // Only allow one outstanding command
-    if (hci_timeout_alarm_ != nullptr) {
-      hci_timeout_alarm_->Schedule(BindOnce(&impl::on_hci_timeout, common::Unretained(this), op_code), kHciTimeoutMs);
-    } else {
-      LOG_WARN("%s sent without an hci-timeout timer", OpCodeText(op_code).c_str());
+    // Either a single command is outstanding, or only independent ones
+    auto next_command = std::next(command_queue_.begin(), outstanding_commands_);
+    return command_queue_.front().independent_ && next_command->independent_;
+  }
+
+  void send_next_command() {
+    while (can_send_next_command()) {
+      auto command = std::next(command_queue_.begin(), outstanding_commands_);
+      std::shared_ptr<std::vector<uint8_t>> bytes = std::make_shared<std::vector<uint8_t>>();
+      BitInserter bi(*bytes);
+      command->command->Serialize(bi);
+      hal_->sendHciCommand(*bytes);
+
+      auto cmd_view = CommandView::Create(PacketView<kLittleEndian>(bytes));
+      ASSERT(cmd_view.IsValid());
+      OpCode op_code = cmd_view.GetOpCode();
+      command->command_view = std::make_unique<CommandView>(std::move(cmd_view));
+      log_link_layer_connection_command(command->command_view);
+      log_classic_pairing_command_status(command->command_view, ErrorCode::STATUS_UNKNOWN);
+      if (command->independent_) {
+        command_credits_--;
+      } else {
+        command_credits_ = 0;  // Only allow one outstanding command
+      }
+      if (outstanding_commands_++ > 0) {
+        // The oldest command is already timed
+        continue;
+      }
+      waiting_command_ = op_code;
+      if (hci_timeout_alarm_ != nullptr) {
+        hci_timeout_alarm_->Schedule(BindOnce(&impl::on_hci_timeout, common::Unretained(this), op_code), kHciTimeoutMs);
+      } else {
+        LOG_WARN("%s sent without an hci-timeout timer", OpCodeText(op_code).c_str());
+      }
     }
   }
 
@@ -397,7 +437,10 @@ struct HciLayer::impl {
 
   std::map<EventCode, ContextualCallback<void(EventView)>> event_handlers_;
   std::map<SubeventCode, ContextualCallback<void(LeMetaEventView)>> subevent_handlers_;
+  // Oldest command sent and not completed yet
   OpCode waiting_command_{OpCode::NONE};
+  // Commands at the front of |command_queue_| sent and not completed yet
+  size_t outstanding_commands_{0};
   uint8_t command_credits_{1};  // Send reset first
   Alarm* hci_timeout_alarm_{nullptr};
   Alarm* hci_abort_alarm_{nullptr};
@@ -473,6 +516,11 @@ void HciLayer::EnqueueCommand(
   CallOn(impl_, &impl::enqueue_command<CommandStatusView>, move(command), move(on_status));
 }
 
+void HciLayer::EnqueueIndependentCommand(
+    unique_ptr<CommandBuilder> command, ContextualOnceCallback<void(CommandCompleteView)> on_complete) {
+  CallOn(impl_, &impl::enqueue_independent_command, move(command), move(on_complete));
+}
+
 void HciLayer::RegisterEventHandler(EventCode event, ContextualCallback<void(EventView)> handler) {
   CallOn(impl_, &impl::register_event, event, handler);
 }
@@ -56,6 +56,12 @@ class HciLayer : public Module, public CommandInterface<CommandBuilder> {
       std::unique_ptr<CommandBuilder> command,
       common::ContextualOnceCallback<void(CommandStatusView)> on_status) override;
 
+  // Enqueue a command which doesn't depend on the outcome of the commands before it, like a read of the controller
+  // capabilities. It may be sent while other such commands are outstanding, as long as the controller has
+  // Num_HCI_Command_Packets credits left.
+  virtual void EnqueueIndependentCommand(
+      std::unique_ptr<CommandBuilder> command, common::ContextualOnceCallback<void(CommandCompleteView)> on_complete);
+
   virtual common::BidiQueueEnd<AclBuilder, AclView>* GetAclQueueEnd();
 
   virtual common::BidiQueueEnd<ScoBuilder, ScoView>* GetScoQueueEnd();
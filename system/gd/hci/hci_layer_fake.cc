@@ -81,6 +81,11 @@ void TestHciLayer::EnqueueCommand(
   }
 }
 
+void TestHciLayer::EnqueueIndependentCommand(
+    std::unique_ptr<CommandBuilder> command, common::ContextualOnceCallback<void(CommandCompleteView)> on_complete) {
+  EnqueueCommand(std::move(command), std::move(on_complete));
+}
+
 CommandView TestHciLayer::GetCommand() {
   EXPECT_EQ(command_future_.wait_for(std::chrono::milliseconds(1000)), std::future_status::ready);
 
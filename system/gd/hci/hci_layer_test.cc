@@ -197,6 +197,11 @@ class DependsOnHci : public Module {
         std::move(command), GetHandler()->BindOnceOn(this, &DependsOnHci::handle_event<CommandCompleteView>));
   }
 
+  void SendIndependentCommandExpectingComplete(std::unique_ptr<CommandBuilder> command) {
+    hci_->EnqueueIndependentCommand(
+        std::move(command), GetHandler()->BindOnceOn(this, &DependsOnHci::handle_event<CommandCompleteView>));
+  }
+
   void SendSecurityCommandExpectingComplete(std::unique_ptr<SecurityCommandBuilder> command) {
     if (security_interface_ == nullptr) {
       security_interface_ =
@@ -622,6 +627,103 @@ TEST_F(HciTest, creditsTest) {
       ReadLocalSupportedFeaturesCompleteView::Create(CommandCompleteView::Create(EventView::Create(event))).IsValid());
 }
 
+TEST_F(HciTest, independentCommandsShareCredits) {
+  ASSERT_EQ(0u, hal->GetNumSentCommands());
+
+  // Hold the commands until they are all queued
+  uint8_t num_packets = 0;
+  hal->callbacks->hciEventReceived(GetPacketBytes(NoCommandCompleteBuilder::Create(num_packets)));
+
+  upper->SendIndependentCommandExpectingComplete(ReadLocalVersionInformationBuilder::Create());
+  upper->SendIndependentCommandExpectingComplete(ReadLocalSupportedCommandsBuilder::Create());
+  upper->SendIndependentCommandExpectingComplete(ReadLocalSupportedFeaturesBuilder::Create());
+  upper->SendHciCommandExpectingComplete(ReadBdAddrBuilder::Create());
+  ASSERT_TRUE(fake_registry_.SynchronizeModuleHandler(&HciLayer::Factory, kTimeout));
+  ASSERT_EQ(0u, hal->GetNumSentCommands());
+
+  // Verify that the independent commands are sent together
+  num_packets = 3;
+  hal->callbacks->hciEventReceived(GetPacketBytes(NoCommandCompleteBuilder::Create(num_packets)));
+  ASSERT_TRUE(fake_registry_.SynchronizeModuleHandler(&HciLayer::Factory, kTimeout));
+  ASSERT_EQ(3u, hal->GetNumSentCommands());
+  ASSERT_TRUE(ReadLocalVersionInformationView::Create(CommandView::Create(hal->GetSentCommand())).IsValid());
+  ASSERT_TRUE(ReadLocalSupportedCommandsView::Create(CommandView::Create(hal->GetSentCommand())).IsValid());
+  ASSERT_TRUE(ReadLocalSupportedFeaturesView::Create(CommandView::Create(hal->GetSentCommand())).IsValid());
+
+  // Complete them out of order
+  ErrorCode error_code = ErrorCode::SUCCESS;
+  auto event_future = upper->GetReceivedEventFuture();
+  num_packets = 1;
+  uint64_t lmp_features = 0x012345678abcdef;
+  hal->callbacks->hciEventReceived(
+      GetPacketBytes(ReadLocalSupportedFeaturesCompleteBuilder::Create(num_packets, error_code, lmp_features)));
+  ASSERT_EQ(event_future.wait_for(kTimeout), std::future_status::ready);
+  ASSERT_TRUE(ReadLocalSupportedFeaturesCompleteView::Create(
+                  CommandCompleteView::Create(EventView::Create(upper->GetReceivedEvent())))
+                  .IsValid());
+
+  event_future = upper->GetReceivedEventFuture();
+  LocalVersionInformation local_version_information;
+  local_version_information.hci_version_ = HciVersion::V_5_0;
+  local_version_information.hci_revision_ = 0x1234;
+  local_version_information.lmp_version_ = LmpVersion::V_4_2;
+  local_version_information.manufacturer_name_ = 0xBAD;
+  local_version_information.lmp_subversion_ = 0x5678;
+  hal->callbacks->hciEventReceived(GetPacketBytes(
+      ReadLocalVersionInformationCompleteBuilder::Create(num_packets, error_code, local_version_information)));
+  ASSERT_EQ(event_future.wait_for(kTimeout), std::future_status::ready);
+  ASSERT_TRUE(ReadLocalVersionInformationCompleteView::Create(
+                  CommandCompleteView::Create(EventView::Create(upper->GetReceivedEvent())))
+                  .IsValid());
+
+  // Verify that the regular command waits for the last independent one
+  ASSERT_TRUE(fake_registry_.SynchronizeModuleHandler(&HciLayer::Factory, kTimeout));
+  ASSERT_EQ(0u, hal->GetNumSentCommands());
+
+  auto command_future = hal->GetSentCommandFuture();
+  event_future = upper->GetReceivedEventFuture();
+  std::array<uint8_t, 64> supported_commands{};
+  hal->callbacks->hciEventReceived(
+      GetPacketBytes(ReadLocalSupportedCommandsCompleteBuilder::Create(num_packets, error_code, supported_commands)));
+  ASSERT_EQ(event_future.wait_for(kTimeout), std::future_status::ready);
+  ASSERT_TRUE(ReadLocalSupportedCommandsCompleteView::Create(
+                  CommandCompleteView::Create(EventView::Create(upper->GetReceivedEvent())))
+                  .IsValid());
+
+  ASSERT_EQ(command_future.wait_for(kTimeout), std::future_status::ready);
+  ASSERT_EQ(1u, hal->GetNumSentCommands());
+  ASSERT_TRUE(ReadBdAddrView::Create(CommandView::Create(hal->GetSentCommand())).IsValid());
+}
+
+TEST_F(HciTest, regularCommandIsSentAlone) {
+  ASSERT_EQ(0u, hal->GetNumSentCommands());
+
+  uint8_t num_packets = 0;
+  hal->callbacks->hciEventReceived(GetPacketBytes(NoCommandCompleteBuilder::Create(num_packets)));
+
+  upper->SendHciCommandExpectingComplete(ReadBdAddrBuilder::Create());
+  upper->SendIndependentCommandExpectingComplete(ReadLocalVersionInformationBuilder::Create());
+  ASSERT_TRUE(fake_registry_.SynchronizeModuleHandler(&HciLayer::Factory, kTimeout));
+
+  // Verify that the independent command isn't sent behind the regular one
+  num_packets = 2;
+  hal->callbacks->hciEventReceived(GetPacketBytes(NoCommandCompleteBuilder::Create(num_packets)));
+  ASSERT_TRUE(fake_registry_.SynchronizeModuleHandler(&HciLayer::Factory, kTimeout));
+  ASSERT_EQ(1u, hal->GetNumSentCommands());
+  ASSERT_TRUE(ReadBdAddrView::Create(CommandView::Create(hal->GetSentCommand())).IsValid());
+
+  auto command_future = hal->GetSentCommandFuture();
+  auto event_future = upper->GetReceivedEventFuture();
+  hal->callbacks->hciEventReceived(
+      GetPacketBytes(ReadBdAddrCompleteBuilder::Create(num_packets, ErrorCode::SUCCESS, Address::kAny)));
+  ASSERT_EQ(event_future.wait_for(kTimeout), std::future_status::ready);
+  upper->GetReceivedEvent();
+
+  ASSERT_EQ(command_future.wait_for(kTimeout), std::future_status::ready);
+  ASSERT_EQ(1u, hal->GetNumSentCommands());
+  ASSERT_TRUE(ReadLocalVersionInformationView::Create(CommandView::Create(hal->GetSentCommand())).IsValid());
+}
+
 TEST_F(HciTest, leSecurityInterfaceTest) {
   // Send LeRand to the controller
   auto command_future = hal->GetSentCommandFuture();
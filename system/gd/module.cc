@@ -16,6 +16,12 @@
 #define LOG_TAG "BtGdModule"
 
 #include "module.h"
+
+#include <condition_variable>
+#include <deque>
+#include <queue>
+#include <thread>
+
 #include "common/init_flags.h"
 #include "dumpsys/init_flags.h"
 #include "os/wakelock_manager.h"
@@ -56,12 +62,14 @@ Module* Module::GetDependency(const ModuleFactory* module) const {
 }
 
 Module* ModuleRegistry::Get(const ModuleFactory* module) const {
+  std::lock_guard<std::mutex> lock(mutex_);
   auto instance = started_modules_.find(module);
   ASSERT_LOG(instance != started_modules_.end(), "Request for module not started up, maybe not in Start(ModuleList)?");
   return instance->second;
 }
 
 bool ModuleRegistry::IsStarted(const ModuleFactory* module) const {
+  std::lock_guard<std::mutex> lock(mutex_);
   return started_modules_.find(module) != started_modules_.end();
 }
 
@@ -77,14 +85,20 @@ void ModuleRegistry::set_registry_and_handler(Module* instance, Thread* thread)
 }
 
 Module* ModuleRegistry::Start(const ModuleFactory* module, Thread* thread) {
-  auto started_instance = started_modules_.find(module);
-  if (started_instance != started_modules_.end()) {
-    return started_instance->second;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto started_instance = started_modules_.find(module);
+    if (started_instance != started_modules_.end()) {
+      return started_instance->second;
+    }
   }
 
   LOG_DEBUG("Constructing next module");
   Module* instance = module->ctor_();
-  last_instance_ = "starting " + instance->ToString();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    last_instance_ = "starting " + instance->ToString();
+  }
   set_registry_and_handler(instance, thread);
 
   LOG_DEBUG("Starting dependencies of %s", instance->ToString().c_str());
@@ -93,19 +107,141 @@ Module* ModuleRegistry::Start(const ModuleFactory* module, Thread* thread) {
 
   LOG_DEBUG("Finished starting dependencies and calling Start() of %s", instance->ToString().c_str());
 
+  auto start_time = std::chrono::steady_clock::now();
   instance->Start();
-  start_order_.push_back(module);
-  started_modules_[module] = instance;
+  instance->start_duration_ =
+      std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    start_order_.push_back(module);
+    started_modules_[module] = instance;
+  }
   LOG_DEBUG("Started %s", instance->ToString().c_str());
   return instance;
 }
 
+// A module constructed but not started yet
+struct ModuleRegistry::PendingModule {
+  Module* instance = nullptr;
+  // Dependencies not started yet
+  size_t waiting_on = 0;
+  // Modules waiting on this one
+  std::vector<const ModuleFactory*> dependents;
+};
+
+void ModuleRegistry::ConstructPendingModule(
+    const ModuleFactory* module,
+    Thread* thread,
+    std::map<const ModuleFactory*, PendingModule>* pending,
+    std::vector<const ModuleFactory*>* construct_order) {
+  if (IsStarted(module) || pending->find(module) != pending->end()) {
+    return;
+  }
+
+  LOG_DEBUG("Constructing next module");
+  Module* instance = module->ctor_();
+  set_registry_and_handler(instance, thread);
+  instance->ListDependencies(&instance->dependencies_);
+  (*pending)[module].instance = instance;
+
+  for (auto dependency : instance->dependencies_.list_) {
+    ConstructPendingModule(dependency, thread, pending, construct_order);
+    auto pending_dependency = pending->find(dependency);
+    if (pending_dependency != pending->end()) {
+      (*pending)[module].waiting_on++;
+      pending_dependency->second.dependents.push_back(module);
+    }
+  }
+  construct_order->push_back(module);
+}
+
+void ModuleRegistry::StartParallel(ModuleList* modules, Thread* thread, size_t max_concurrent_starts) {
+  ASSERT(max_concurrent_starts > 0);
+
+  // Construct all the modules first to know which ones wait on which
+  std::map<const ModuleFactory*, PendingModule> pending;
+  std::vector<const ModuleFactory*> construct_order;
+  for (auto module : modules->list_) {
+    ConstructPendingModule(module, thread, &pending, &construct_order);
+  }
+
+  // In the order they would have been started one at a time
+  std::deque<const ModuleFactory*> ready;
+  for (auto module : construct_order) {
+    if (pending[module].waiting_on == 0) {
+      ready.push_back(module);
+    }
+  }
+
+  std::mutex finished_mutex;
+  std::condition_variable finished_cv;
+  std::vector<const ModuleFactory*> finished;
+  std::vector<std::thread> workers;
+  size_t running = 0;
+  size_t started = 0;
+
+  while (started < pending.size()) {
+    while (!ready.empty() && running < max_concurrent_starts) {
+      const ModuleFactory* module = ready.front();
+      ready.pop_front();
+      Module* instance = pending[module].instance;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        last_instance_ = "starting " + instance->ToString();
+      }
+      LOG_DEBUG("Calling Start() of %s", instance->ToString().c_str());
+      running++;
+      workers.emplace_back([module, instance, &finished_mutex, &finished_cv, &finished]() {
+        auto module_start_time = std::chrono::steady_clock::now();
+        instance->Start();
+        instance->start_duration_ =
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - module_start_time);
+        std::lock_guard<std::mutex> lock(finished_mutex);
+        finished.push_back(module);
+        finished_cv.notify_one();
+      });
+    }
+    ASSERT_LOG(running > 0, "Modules depend on each other, last instance: %s", GetLastInstance().c_str());
+
+    std::vector<const ModuleFactory*> just_finished;
+    {
+      std::unique_lock<std::mutex> lock(finished_mutex);
+      finished_cv.wait(lock, [&finished]() { return !finished.empty(); });
+      just_finished.swap(finished);
+    }
+
+    for (auto module : just_finished) {
+      running--;
+      started++;
+      PendingModule& pending_module = pending[module];
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        start_order_.push_back(module);
+        started_modules_[module] = pending_module.instance;
+      }
+      LOG_DEBUG("Started %s", pending_module.instance->ToString().c_str());
+      for (auto dependent : pending_module.dependents) {
+        if (--pending[dependent].waiting_on == 0) {
+          ready.push_back(dependent);
+        }
+      }
+    }
+  }
+
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
+
 void ModuleRegistry::StopAll() {
   // Since modules were brought up in dependency order, it is safe to tear down by going in reverse order.
   for (auto it = start_order_.rbegin(); it != start_order_.rend(); it++) {
     auto instance = started_modules_.find(*it);
     ASSERT(instance != started_modules_.end());
-    last_instance_ = "stopping " + instance->second->ToString();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      last_instance_ = "stopping " + instance->second->ToString();
+    }
 
     // Clear the handler before stopping the module to allow it to shut down gracefully.
     LOG_INFO("Stopping Handler of Module %s", instance->second->ToString().c_str());
@@ -114,6 +250,8 @@ void ModuleRegistry::StopAll() {
     LOG_INFO("Stopping Module %s", instance->second->ToString().c_str());
     instance->second->Stop();
   }
+
+  std::lock_guard<std::mutex> lock(mutex_);
   for (auto it = start_order_.rbegin(); it != start_order_.rend(); it++) {
     auto instance = started_modules_.find(*it);
     ASSERT(instance != started_modules_.end());
@@ -127,6 +265,7 @@ void ModuleRegistry::StopAll() {
 }
 
 os::Handler* ModuleRegistry::GetModuleHandler(const ModuleFactory* module) const {
+  std::lock_guard<std::mutex> lock(mutex_);
   auto started_instance = started_modules_.find(module);
   if (started_instance != started_modules_.end()) {
     return started_instance->second->GetHandler();
@@ -134,26 +273,60 @@ os::Handler* ModuleRegistry::GetModuleHandler(const ModuleFactory* module) const
   return nullptr;
 }
 
+std::string ModuleRegistry::GetLastInstance() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return last_instance_;
+}
+
 void ModuleDumper::DumpState(std::string* output) const {
   ASSERT(output != nullptr);
 
+  // Modules may look up their dependencies while dumping
+  std::vector<Module*> instances;
+  bool parallel_start;
+  std::chrono::microseconds total_start_duration;
+  {
+    std::lock_guard<std::mutex> lock(module_registry_.mutex_);
+    for (auto it = module_registry_.start_order_.rbegin(); it != module_registry_.start_order_.rend(); it++) {
+      auto instance = module_registry_.started_modules_.find(*it);
+      ASSERT(instance != module_registry_.started_modules_.end());
+      instances.push_back(instance->second);
+    }
+    parallel_start = module_registry_.parallel_start_;
+    total_start_duration = module_registry_.total_start_duration_;
+  }
+
   flatbuffers::FlatBufferBuilder builder(1024);
   auto title = builder.CreateString(title_);
 
   auto init_flags_offset = dumpsys::InitFlags::Dump(&builder);
   auto wakelock_offset = WakelockManager::Get().GetDumpsysData(&builder);
 
+  // In start order
+  std::vector<std::string> module_start_times;
+  for (auto it = instances.rbegin(); it != instances.rend(); it++) {
+    module_start_times.push_back(
+        (*it)->ToString() + " " + std::to_string((*it)->start_duration_.count()) + " us");
+  }
+  auto module_start_title = builder.CreateString("----- Module Start -----");
+  auto module_start_times_offset = builder.CreateVectorOfStrings(module_start_times);
+  ModuleStartDataBuilder module_start_builder(builder);
+  module_start_builder.add_title(module_start_title);
+  module_start_builder.add_parallel_start(parallel_start);
+  module_start_builder.add_total_start_time_us(total_start_duration.count());
+  module_start_builder.add_module_start_times(module_start_times_offset);
+  auto module_start_offset = module_start_builder.Finish();
+
   std::queue<DumpsysDataFinisher> queue;
-  for (auto it = module_registry_.start_order_.rbegin(); it != module_registry_.start_order_.rend(); it++) {
-    auto instance = module_registry_.started_modules_.find(*it);
-    ASSERT(instance != module_registry_.started_modules_.end());
-    queue.push(instance->second->GetDumpsysData(&builder));
+  for (auto instance : instances) {
+    queue.push(instance->GetDumpsysData(&builder));
   }
 
   DumpsysDataBuilder data_builder(builder);
   data_builder.add_title(title);
   data_builder.add_init_flags(init_flags_offset);
   data_builder.add_wakelock_manager_data(wakelock_offset);
+  data_builder.add_module_start_data(module_start_offset);
 
   while (!queue.empty()) {
     queue.front()(&data_builder);
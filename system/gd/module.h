@@ -17,9 +17,11 @@
 #pragma once
 
 #include <flatbuffers/flatbuffers.h>
+#include <chrono>
 #include <functional>
 #include <future>
 #include <map>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -119,6 +121,8 @@ class Module {
   ::bluetooth::os::Handler* handler_ = nullptr;
   ModuleList dependencies_;
   const ModuleRegistry* registry_;
+  // How long Start() took, not counting the dependencies
+  std::chrono::microseconds start_duration_{0};
 };
 
 class ModuleRegistry {
@@ -144,6 +148,11 @@ class ModuleRegistry {
 
   Module* Start(const ModuleFactory* id, ::bluetooth::os::Thread* thread);
 
+  // Start all the modules on this list and their dependencies, calling Start()
+  // of up to |max_concurrent_starts| modules at once from worker threads.
+  // A module still only starts once all of its dependencies have.
+  void StartParallel(ModuleList* modules, ::bluetooth::os::Thread* thread, size_t max_concurrent_starts);
+
   // Stop all running modules in reverse order of start
   void StopAll();
 
@@ -154,9 +163,24 @@ class ModuleRegistry {
 
   os::Handler* GetModuleHandler(const ModuleFactory* module) const;
 
+  std::string GetLastInstance() const;
+
+  // Guards the members below, as modules look up their dependencies from the
+  // worker threads while the others start
+  mutable std::mutex mutex_;
   std::map<const ModuleFactory*, Module*> started_modules_;
   std::vector<const ModuleFactory*> start_order_;
   std::string last_instance_;
+  bool parallel_start_ = false;
+  std::chrono::microseconds total_start_duration_{0};
+
+ private:
+  struct PendingModule;
+  void ConstructPendingModule(
+      const ModuleFactory* module,
+      ::bluetooth::os::Thread* thread,
+      std::map<const ModuleFactory*, PendingModule>* pending,
+      std::vector<const ModuleFactory*>* construct_order);
 };
 
 class ModuleDumper {
@@ -0,0 +1,239 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Enable to ready latency of a module graph shaped like the one the shim
+// starts, against a fake controller answering each command after a round trip.
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "benchmark/benchmark.h"
+#include "module.h"
+#include "os/thread.h"
+
+using ::benchmark::State;
+
+namespace bluetooth {
+namespace {
+
+// Answers commands in order once their round trip is over, with at most
+// |credits| of them in flight like Num_HCI_Command_Packets allows
+class FakeController {
+ public:
+  FakeController(int credits, std::chrono::microseconds round_trip)
+      : credits_(credits), round_trip_(round_trip), thread_([this]() { Run(); }) {}
+
+  ~FakeController() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopped_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+  }
+
+  // Send |count| commands and wait for the last one to complete
+  void SendCommands(int count) {
+    std::future<void> last;
+    for (int i = 0; i < count; i++) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this]() { return credits_ > 0; });
+      credits_--;
+      in_flight_.push_back({std::chrono::steady_clock::now() + round_trip_, std::promise<void>()});
+      last = in_flight_.back().complete.get_future();
+      cv_.notify_all();
+    }
+    if (last.valid()) {
+      last.wait();
+    }
+  }
+
+ private:
+  struct Command {
+    std::chrono::steady_clock::time_point complete_time;
+    std::promise<void> complete;
+  };
+
+  void Run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopped_) {
+      if (in_flight_.empty()) {
+        cv_.wait(lock);
+        continue;
+      }
+      auto complete_time = in_flight_.front().complete_time;
+      if (std::chrono::steady_clock::now() < complete_time) {
+        cv_.wait_until(lock, complete_time);
+        continue;
+      }
+      in_flight_.front().complete.set_value();
+      in_flight_.pop_front();
+      credits_++;
+      cv_.notify_all();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  int credits_;
+  const std::chrono::microseconds round_trip_;
+  std::deque<Command> in_flight_;
+  bool stopped_ = false;
+  std::thread thread_;
+};
+
+FakeController* fake_controller = nullptr;
+
+template <typename... Modules>
+struct DependsOn {
+  static void Add(ModuleList* list) {
+    (list->add<Modules>(), ...);
+  }
+};
+
+// A module sending |Spec::kCommands| commands to the controller from Start(),
+// after some work of its own
+template <typename Spec>
+class FakeModule : public Module {
+ public:
+  static const ModuleFactory Factory;
+
+ protected:
+  void ListDependencies(ModuleList* list) const override {
+    Spec::Dependencies::Add(list);
+  }
+
+  void Start() override {
+    std::this_thread::sleep_for(Spec::kWork);
+    fake_controller->SendCommands(Spec::kCommands);
+  }
+
+  void Stop() override {}
+
+  std::string ToString() const override {
+    return Spec::kName;
+  }
+};
+
+template <typename Spec>
+const ModuleFactory FakeModule<Spec>::Factory = ModuleFactory([]() { return new FakeModule<Spec>(); });
+
+using namespace std::chrono_literals;
+
+struct HciHal {
+  static constexpr const char* kName = "HciHal";
+  static constexpr auto kWork = 5ms;
+  static constexpr int kCommands = 0;
+  using Dependencies = DependsOn<>;
+};
+struct HciLayer {
+  static constexpr const char* kName = "HciLayer";
+  static constexpr auto kWork = 0ms;
+  static constexpr int kCommands = 1;
+  using Dependencies = DependsOn<FakeModule<HciHal>>;
+};
+struct StorageModule {
+  static constexpr const char* kName = "StorageModule";
+  static constexpr auto kWork = 5ms;
+  static constexpr int kCommands = 0;
+  using Dependencies = DependsOn<>;
+};
+struct VendorSpecificEventManager {
+  static constexpr const char* kName = "VendorSpecificEventManager";
+  static constexpr auto kWork = 0ms;
+  static constexpr int kCommands = 1;
+  using Dependencies = DependsOn<FakeModule<HciLayer>>;
+};
+struct Controller {
+  static constexpr const char* kName = "Controller";
+  static constexpr auto kWork = 0ms;
+  static constexpr int kCommands = 20;
+  using Dependencies = DependsOn<FakeModule<HciLayer>>;
+};
+struct AclManager {
+  static constexpr const char* kName = "AclManager";
+  static constexpr auto kWork = 0ms;
+  static constexpr int kCommands = 4;
+  using Dependencies = DependsOn<FakeModule<Controller>, FakeModule<StorageModule>>;
+};
+struct LeAdvertisingManager {
+  static constexpr const char* kName = "LeAdvertisingManager";
+  static constexpr auto kWork = 0ms;
+  static constexpr int kCommands = 6;
+  using Dependencies = DependsOn<FakeModule<Controller>, FakeModule<AclManager>>;
+};
+struct LeScanningManager {
+  static constexpr const char* kName = "LeScanningManager";
+  static constexpr auto kWork = 0ms;
+  static constexpr int kCommands = 4;
+  using Dependencies = DependsOn<FakeModule<Controller>, FakeModule<StorageModule>>;
+};
+struct Dumpsys {
+  static constexpr const char* kName = "Dumpsys";
+  static constexpr auto kWork = 0ms;
+  static constexpr int kCommands = 0;
+  using Dependencies = DependsOn<FakeModule<StorageModule>>;
+};
+
+void AddStackModules(ModuleList* modules) {
+  modules->add<FakeModule<HciHal>>();
+  modules->add<FakeModule<HciLayer>>();
+  modules->add<FakeModule<StorageModule>>();
+  modules->add<FakeModule<Dumpsys>>();
+  modules->add<FakeModule<VendorSpecificEventManager>>();
+  modules->add<FakeModule<Controller>>();
+  modules->add<FakeModule<AclManager>>();
+  modules->add<FakeModule<LeAdvertisingManager>>();
+  modules->add<FakeModule<LeScanningManager>>();
+}
+
+// range(0): parallel start, range(1): controller command credits
+void BM_StackStartUp(State& state) {
+  FakeController controller(state.range(1), std::chrono::microseconds(500));
+  fake_controller = &controller;
+  os::Thread thread("stack_thread", os::Thread::Priority::NORMAL);
+  for (auto _ : state) {
+    ModuleRegistry registry;
+    ModuleList modules;
+    AddStackModules(&modules);
+    if (state.range(0)) {
+      registry.StartParallel(&modules, &thread, 4);
+    } else {
+      registry.Start(&modules, &thread);
+    }
+    state.PauseTiming();
+    registry.StopAll();
+    state.ResumeTiming();
+  }
+  fake_controller = nullptr;
+}
+
+BENCHMARK(BM_StackStartUp)
+    ->ArgNames({"parallel", "credits"})
+    ->Args({0, 1})
+    ->Args({1, 1})
+    ->Args({0, 4})
+    ->Args({1, 4})
+    ->Unit(::benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace bluetooth
@@ -21,9 +21,13 @@
 
 #include "gtest/gtest.h"
 
+#include <atomic>
+#include <condition_variable>
 #include <functional>
 #include <future>
+#include <mutex>
 #include <string>
+#include <thread>
 
 using ::bluetooth::os::Thread;
 
@@ -217,6 +221,92 @@ class TestModuleDumpState : public Module {
 
 const ModuleFactory TestModuleDumpState::Factory = ModuleFactory([]() { return new TestModuleDumpState(); });
 
+// Modules only starting once the other one is starting too
+std::mutex rendezvous_mutex;
+std::condition_variable rendezvous_cv;
+int rendezvous_count = 0;
+
+bool Rendezvous() {
+  std::unique_lock<std::mutex> lock(rendezvous_mutex);
+  rendezvous_count++;
+  rendezvous_cv.notify_all();
+  return rendezvous_cv.wait_for(lock, std::chrono::seconds(1), [] { return rendezvous_count >= 2; });
+}
+
+class TestModuleRendezvous : public Module {
+ public:
+  static const ModuleFactory Factory;
+
+ protected:
+  void ListDependencies(ModuleList* list) const {
+    list->add<TestModuleNoDependency>();
+  }
+
+  void Start() override {
+    EXPECT_TRUE(GetModuleRegistry()->IsStarted<TestModuleNoDependency>());
+    EXPECT_TRUE(Rendezvous());
+  }
+
+  void Stop() override {}
+
+  std::string ToString() const override {
+    return std::string("TestModuleRendezvous");
+  }
+};
+
+const ModuleFactory TestModuleRendezvous::Factory = ModuleFactory([]() { return new TestModuleRendezvous(); });
+
+class TestModuleRendezvousTwo : public Module {
+ public:
+  static const ModuleFactory Factory;
+
+ protected:
+  void ListDependencies(ModuleList* list) const {
+    list->add<TestModuleNoDependency>();
+  }
+
+  void Start() override {
+    EXPECT_TRUE(GetModuleRegistry()->IsStarted<TestModuleNoDependency>());
+    EXPECT_TRUE(Rendezvous());
+  }
+
+  void Stop() override {}
+
+  std::string ToString() const override {
+    return std::string("TestModuleRendezvousTwo");
+  }
+};
+
+const ModuleFactory TestModuleRendezvousTwo::Factory = ModuleFactory([]() { return new TestModuleRendezvousTwo(); });
+
+class TestModuleAfterRendezvous : public Module {
+ public:
+  static const ModuleFactory Factory;
+
+ protected:
+  void ListDependencies(ModuleList* list) const {
+    list->add<TestModuleRendezvous>();
+    list->add<TestModuleRendezvousTwo>();
+  }
+
+  void Start() override {
+    EXPECT_TRUE(GetModuleRegistry()->IsStarted<TestModuleRendezvous>());
+    EXPECT_TRUE(GetModuleRegistry()->IsStarted<TestModuleRendezvousTwo>());
+  }
+
+  void Stop() override {
+    EXPECT_TRUE(GetModuleRegistry()->IsStarted<TestModuleRendezvous>());
+    EXPECT_TRUE(GetModuleRegistry()->IsStarted<TestModuleRendezvousTwo>());
+  }
+
+  std::string ToString() const override {
+    return std::string("TestModuleAfterRendezvous");
+  }
+};
+
+const ModuleFactory TestModuleAfterRendezvous::Factory =
+    ModuleFactory([]() { return new TestModuleAfterRendezvous(); });
+
 TEST_F(ModuleTest, no_dependency) {
   ModuleList list;
   list.add<TestModuleNoDependency>();
@@ -271,6 +361,54 @@ TEST_F(ModuleTest, two_dependencies) {
   EXPECT_FALSE(registry_->IsStarted<TestModuleTwoDependencies>());
 }
 
+TEST_F(ModuleTest, parallel_two_dependencies) {
+  ModuleList list;
+  list.add<TestModuleTwoDependencies>();
+  registry_->StartParallel(&list, thread_, 4);
+
+  EXPECT_TRUE(registry_->IsStarted<TestModuleNoDependency>());
+  EXPECT_TRUE(registry_->IsStarted<TestModuleOneDependency>());
+  EXPECT_TRUE(registry_->IsStarted<TestModuleNoDependencyTwo>());
+  EXPECT_TRUE(registry_->IsStarted<TestModuleTwoDependencies>());
+
+  registry_->StopAll();
+
+  EXPECT_FALSE(registry_->IsStarted<TestModuleNoDependency>());
+  EXPECT_FALSE(registry_->IsStarted<TestModuleOneDependency>());
+  EXPECT_FALSE(registry_->IsStarted<TestModuleNoDependencyTwo>());
+  EXPECT_FALSE(registry_->IsStarted<TestModuleTwoDependencies>());
+}
+
+TEST_F(ModuleTest, parallel_start_independent_modules_together) {
+  rendezvous_count = 0;
+  ModuleList list;
+  list.add<TestModuleAfterRendezvous>();
+  registry_->StartParallel(&list, thread_, 2);
+
+  EXPECT_EQ(2, rendezvous_count);
+  EXPECT_TRUE(registry_->IsStarted<TestModuleNoDependency>());
+  EXPECT_TRUE(registry_->IsStarted<TestModuleRendezvous>());
+  EXPECT_TRUE(registry_->IsStarted<TestModuleRendezvousTwo>());
+  EXPECT_TRUE(registry_->IsStarted<TestModuleAfterRendezvous>());
+
+  registry_->StopAll();
+}
+
+TEST_F(ModuleTest, parallel_start_after_started_modules) {
+  ModuleList first;
+  first.add<TestModuleOneDependency>();
+  registry_->Start(&first, thread_);
+
+  ModuleList list;
+  list.add<TestModuleTwoDependencies>();
+  registry_->StartParallel(&list, thread_, 1);
+
+  EXPECT_TRUE(registry_->IsStarted<TestModuleNoDependencyTwo>());
+  EXPECT_TRUE(registry_->IsStarted<TestModuleTwoDependencies>());
+
+  registry_->StopAll();
+}
+
 void post_to_module_one_handler() {
   std::this_thread::sleep_for(std::chrono::milliseconds(100));
   test_module_one_dependency_handler->Post(common::BindOnce([] { FAIL(); }));
@@ -301,6 +439,12 @@ TEST_F(ModuleTest, dump_state) {
   auto test_data = data->module_unittest_data();
   EXPECT_STREQ("Initial Test String", test_data->title()->c_str());
 
+  auto start_data = data->module_start_data();
+  ASSERT_NE(nullptr, start_data->module_start_times());
+  ASSERT_EQ(2u, start_data->module_start_times()->size());
+  EXPECT_EQ(0u, start_data->module_start_times()->Get(0)->str().find("TestModuleNoDependency "));
+  EXPECT_EQ(0u, start_data->module_start_times()->Get(1)->str().find("TestModuleDumpState "));
+
   TestModuleDumpState* test_module =
       static_cast<TestModuleDumpState*>(registry_->Start(&TestModuleDumpState::Factory, nullptr));
   test_module->test_string_ = "A Second Test String";
@@ -133,7 +133,8 @@ bool WriteToFile(const std::string& path, const std::string& data) {
     return false;
   }
 
-  if (std::fprintf(fp, "%s", data.c_str()) < 0) {
+  // fwrite rather than fprintf, as |data| may hold binary content with '\0' in it
+  if (std::fwrite(data.data(), 1, data.size(), fp) != data.size()) {
     LOG_ERROR("unable to write to file '%s', error: %s", temp_path.c_str(), strerror(errno));
     HandleError(temp_path, &dir_fd, &fp);
     return false;
@@ -25,6 +25,7 @@
 #include "module.h"
 #include "os/handler.h"
 #include "os/log.h"
+#include "os/system_properties.h"
 #include "os/thread.h"
 #include "os/wakelock_manager.h"
 
@@ -34,6 +35,11 @@ using ::bluetooth::os::WakelockManager;
 
 namespace bluetooth {
 
+// Start the modules not depending on each other at the same time
+constexpr char kParallelStartProperty[] = "persist.bluetooth.gd.parallel_start";
+// Modules whose Start() may run at once, most of them waiting on the controller
+constexpr size_t kMaxConcurrentStarts = 4;
+
 void StackManager::StartUp(ModuleList* modules, Thread* stack_thread) {
   management_thread_ = new Thread("management_thread", Thread::Priority::NORMAL);
   handler_ = new Handler(management_thread_);
@@ -52,13 +58,30 @@ void StackManager::StartUp(ModuleList* modules, Thread* stack_thread) {
   ASSERT_LOG(
       init_status == std::future_status::ready,
       "Can't start stack, last instance: %s",
-      registry_.last_instance_.c_str());
+      registry_.GetLastInstance().c_str());
 
   LOG_INFO("init complete");
 }
 
 void StackManager::handle_start_up(ModuleList* modules, Thread* stack_thread, std::promise<void> promise) {
-  registry_.Start(modules, stack_thread);
+  bool parallel_start = os::GetSystemPropertyBool(kParallelStartProperty, false);
+  auto start_time = std::chrono::steady_clock::now();
+  if (parallel_start) {
+    registry_.StartParallel(modules, stack_thread, kMaxConcurrentStarts);
+  } else {
+    registry_.Start(modules, stack_thread);
+  }
+  auto start_duration =
+      std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time);
+  {
+    std::lock_guard<std::mutex> lock(registry_.mutex_);
+    registry_.parallel_start_ = parallel_start;
+    registry_.total_start_duration_ = start_duration;
+  }
+  LOG_INFO(
+      "Started modules %s in %lld us",
+      parallel_start ? "in parallel" : "one at a time",
+      (long long)start_duration.count());
   promise.set_value();
 }
 
@@ -77,7 +100,7 @@ void StackManager::ShutDown() {
   ASSERT_LOG(
       stop_status == std::future_status::ready,
       "Can't stop stack, last instance: %s",
-      registry_.last_instance_.c_str());
+      registry_.GetLastInstance().c_str());
 
   handler_->Clear();
   handler_->WaitUntilStopped(std::chrono::milliseconds(2000));
@@ -16,10 +16,13 @@
 
 #include "storage/config_cache.h"
 
+#include <cerrno>
+#include <cstdlib>
 #include <ios>
 #include <sstream>
 #include <utility>
 
+#include "common/strings.h"
 #include "hci/enum_helper.h"
 #include "os/parameter_provider.h"
 #include "storage/mutation.h"
@@ -43,6 +46,30 @@ bool InEncryptKeyNameList(std::string key) {
   return kEncryptKeyNameList.find(key) != kEncryptKeyNameList.end();
 }
 
+// common::Int64FromString() and common::Uint64FromString() without their logs, as most values are not integers
+std::optional<int64_t> ParseInt64(const std::string& str) {
+  char* ptr = nullptr;
+  errno = 0;
+  int64_t value = std::strtoll(str.c_str(), &ptr, 10);
+  if (errno != 0 || ptr == str.c_str() || ptr != str.c_str() + str.size()) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+std::optional<uint64_t> ParseUint64(const std::string& str) {
+  if (str.find('-') != std::string::npos) {
+    return std::nullopt;
+  }
+  char* ptr = nullptr;
+  errno = 0;
+  uint64_t value = std::strtoull(str.c_str(), &ptr, 10);
+  if (errno != 0 || ptr == str.c_str() || ptr != str.c_str() + str.size()) {
+    return std::nullopt;
+  }
+  return value;
+}
+
 }  // namespace
 
 namespace bluetooth {
@@ -58,6 +85,9 @@ const std::string ConfigCache::kDefaultSectionName = "Global";
 
 std::string kEncryptedStr = "encrypted";
 
+ConfigCache::PropertyValue::PropertyValue(std::string value)
+    : str(std::move(value)), int64(ParseInt64(str)), uint64(ParseUint64(str)) {}
+
 ConfigCache::ConfigCache(size_t temp_device_capacity, std::unordered_set<std::string_view> persistent_property_names)
     : persistent_property_names_(std::move(persistent_property_names)),
       information_sections_(),
@@ -65,7 +95,7 @@ ConfigCache::ConfigCache(size_t temp_device_capacity, std::unordered_set<std::st
       temporary_devices_(temp_device_capacity) {}
 
 void ConfigCache::SetPersistentConfigChangedCallback(std::function<void()> persistent_config_changed_callback) {
-  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  std::unique_lock<std::shared_mutex> lock(mutex_);
   persistent_config_changed_callback_ = std::move(persistent_config_changed_callback);
 }
 
@@ -83,8 +113,8 @@ ConfigCache& ConfigCache::operator=(ConfigCache&& other) noexcept {
   if (&other == this) {
     return *this;
   }
-  std::lock_guard<std::recursive_mutex> my_lock(mutex_);
-  std::lock_guard<std::recursive_mutex> others_lock(other.mutex_);
+  std::unique_lock<std::shared_mutex> my_lock(mutex_);
+  std::unique_lock<std::shared_mutex> others_lock(other.mutex_);
   persistent_config_changed_callback_.swap(other.persistent_config_changed_callback_);
   other.persistent_config_changed_callback_ = {};
   persistent_property_names_ = std::move(other.persistent_property_names_);
@@ -95,8 +125,8 @@ ConfigCache& ConfigCache::operator=(ConfigCache&& other) noexcept {
 }
 
 bool ConfigCache::operator==(const ConfigCache& rhs) const {
-  std::lock_guard<std::recursive_mutex> my_lock(mutex_);
-  std::lock_guard<std::recursive_mutex> others_lock(rhs.mutex_);
+  std::shared_lock<std::shared_mutex> my_lock(mutex_);
+  std::shared_lock<std::shared_mutex> others_lock(rhs.mutex_);
   return persistent_property_names_ == rhs.persistent_property_names_ &&
          information_sections_ == rhs.information_sections_ && persistent_devices_ == rhs.persistent_devices_ &&
          temporary_devices_ == rhs.temporary_devices_;
@@ -107,7 +137,7 @@ bool ConfigCache::operator!=(const ConfigCache& rhs) const {
 }
 
 void ConfigCache::Clear() {
-  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  std::unique_lock<std::shared_mutex> lock(mutex_);
   if (information_sections_.size() > 0) {
     information_sections_.clear();
     PersistentConfigChangedCallback();
@@ -121,61 +151,123 @@ void ConfigCache::Clear() {
   }
 }
 
-bool ConfigCache::HasSection(const std::string& section) const {
-  std::lock_guard<std::recursive_mutex> lock(mutex_);
-  return information_sections_.contains(section) || persistent_devices_.contains(section) ||
-         temporary_devices_.contains(section);
+template <typename Read>
+auto ConfigCache::ReadSection(const std::string& section, Read read) const {
+  {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto section_iter = information_sections_.find(section);
+    if (section_iter != information_sections_.end()) {
+      return read(&section_iter->second, false);
+    }
+    section_iter = persistent_devices_.find(section);
+    if (section_iter != persistent_devices_.end()) {
+      return read(&section_iter->second, true);
+    }
+  }
+  // The section is either temporary or missing, or has just been made persistent
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  bool is_persistent = false;
+  const Section* properties = FindSectionLocked(section, &is_persistent);
+  return read(properties, is_persistent);
 }
 
-bool ConfigCache::HasProperty(const std::string& section, const std::string& property) const {
-  std::lock_guard<std::recursive_mutex> lock(mutex_);
-  auto section_iter = information_sections_.find(section);
+const ConfigCache::Section* ConfigCache::FindSectionLocked(const std::string& section, bool* is_persistent) const {
+  // Sections are unique among all three maps. The temporary ones come first, as the shared lock finds the others
+  *is_persistent = false;
+  auto section_iter = temporary_devices_.find(section);
+  if (section_iter != temporary_devices_.end()) {
+    return &section_iter->second;
+  }
+  section_iter = information_sections_.find(section);
   if (section_iter != information_sections_.end()) {
-    return section_iter->second.find(property) != section_iter->second.end();
+    return &section_iter->second;
   }
   section_iter = persistent_devices_.find(section);
   if (section_iter != persistent_devices_.end()) {
-    return section_iter->second.find(property) != section_iter->second.end();
+    *is_persistent = true;
+    return &section_iter->second;
   }
-  section_iter = temporary_devices_.find(section);
-  if (section_iter != temporary_devices_.end()) {
-    return section_iter->second.find(property) != section_iter->second.end();
-  }
-  return false;
+  return nullptr;
+}
+
+bool ConfigCache::HasSection(const std::string& section) const {
+  return ReadSection(section, [](const Section* properties, bool) { return properties != nullptr; });
+}
+
+bool ConfigCache::HasProperty(const std::string& section, const std::string& property) const {
+  return ReadSection(section, [&property](const Section* properties, bool) {
+    return properties != nullptr && properties->contains(property);
+  });
 }
 
 std::optional<std::string> ConfigCache::GetProperty(const std::string& section, const std::string& property) const {
-  std::lock_guard<std::recursive_mutex> lock(mutex_);
-  auto section_iter = information_sections_.find(section);
-  if (section_iter != information_sections_.end()) {
-    auto property_iter = section_iter->second.find(property);
-    if (property_iter != section_iter->second.end()) {
-      return property_iter->second;
-    }
-  }
-  section_iter = persistent_devices_.find(section);
-  if (section_iter != persistent_devices_.end()) {
-    auto property_iter = section_iter->second.find(property);
-    if (property_iter != section_iter->second.end()) {
-      std::string value = property_iter->second;
-      if (os::ParameterProvider::GetBtKeystoreInterface() != nullptr && value == kEncryptedStr) {
-        return os::ParameterProvider::GetBtKeystoreInterface()->get_key(section + "-" + property);
-      }
-      return value;
-    }
-  }
-  section_iter = temporary_devices_.find(section);
-  if (section_iter != temporary_devices_.end()) {
-    auto property_iter = section_iter->second.find(property);
-    if (property_iter != section_iter->second.end()) {
-      return property_iter->second;
-    }
-  }
-  return std::nullopt;
+  return ReadSection(
+      section, [&section, &property](const Section* properties, bool is_persistent) -> std::optional<std::string> {
+        if (properties == nullptr) {
+          return std::nullopt;
+        }
+        auto property_iter = properties->find(property);
+        if (property_iter == properties->end()) {
+          return std::nullopt;
+        }
+        const std::string& value = property_iter->second.str;
+        if (is_persistent && os::ParameterProvider::GetBtKeystoreInterface() != nullptr && value == kEncryptedStr) {
+          return os::ParameterProvider::GetBtKeystoreInterface()->get_key(section + "-" + property);
+        }
+        return value;
+      });
+}
+
+std::optional<int64_t> ConfigCache::GetInt64Property(const std::string& section, const std::string& property) const {
+  return ReadSection(
+      section, [&section, &property](const Section* properties, bool is_persistent) -> std::optional<int64_t> {
+        if (properties == nullptr) {
+          return std::nullopt;
+        }
+        auto property_iter = properties->find(property);
+        if (property_iter == properties->end()) {
+          return std::nullopt;
+        }
+        if (property_iter->second.int64) {
+          return property_iter->second.int64;
+        }
+        // Not an integer, unless it is an encrypted key, and parsed again to log why
+        std::string value = property_iter->second.str;
+        if (is_persistent && os::ParameterProvider::GetBtKeystoreInterface() != nullptr && value == kEncryptedStr) {
+          value = os::ParameterProvider::GetBtKeystoreInterface()->get_key(section + "-" + property);
+        }
+        return common::Int64FromString(value);
+      });
+}
+
+std::optional<uint64_t> ConfigCache::GetUint64Property(const std::string& section, const std::string& property) const {
+  return ReadSection(
+      section, [&section, &property](const Section* properties, bool is_persistent) -> std::optional<uint64_t> {
+        if (properties == nullptr) {
+          return std::nullopt;
+        }
+        auto property_iter = properties->find(property);
+        if (property_iter == properties->end()) {
+          return std::nullopt;
+        }
+        if (property_iter->second.uint64) {
+          return property_iter->second.uint64;
+        }
+        // Not an integer, unless it is an encrypted key, and parsed again to log why
+        std::string value = property_iter->second.str;
+        if (is_persistent && os::ParameterProvider::GetBtKeystoreInterface() != nullptr && value == kEncryptedStr) {
+          value = os::ParameterProvider::GetBtKeystoreInterface()->get_key(section + "-" + property);
+        }
+        return common::Uint64FromString(value);
+      });
 }
 
 void ConfigCache::SetProperty(std::string section, std::string property, std::string value) {
-  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  SetPropertyLocked(std::move(section), std::move(property), std::move(value));
+}
+
+void ConfigCache::SetPropertyLocked(std::string section, std::string property, std::string value) {
   TrimAfterNewLine(section);
   TrimAfterNewLine(property);
   TrimAfterNewLine(value);
@@ -184,7 +276,7 @@ void ConfigCache::SetProperty(std::string section, std::string property, std::st
   if (!IsDeviceSection(section)) {
     auto section_iter = information_sections_.find(section);
     if (section_iter == information_sections_.end()) {
-      section_iter = information_sections_.try_emplace_back(section, common::ListMap<std::string, std::string>{}).first;
+      section_iter = information_sections_.try_emplace_back(section, Section{}).first;
     }
     section_iter->second.insert_or_assign(property, std::move(value));
     PersistentConfigChangedCallback();
@@ -197,7 +289,7 @@ void ConfigCache::SetProperty(std::string section, std::string property, std::st
     if (section_properties) {
       section_iter = persistent_devices_.try_emplace_back(section, std::move(section_properties->second)).first;
     } else {
-      section_iter = persistent_devices_.try_emplace_back(section, common::ListMap<std::string, std::string>{}).first;
+      section_iter = persistent_devices_.try_emplace_back(section, Section{}).first;
     }
   }
   if (section_iter != persistent_devices_.end()) {
@@ -215,14 +307,18 @@ void ConfigCache::SetProperty(std::string section, std::string property, std::st
   }
   section_iter = temporary_devices_.find(section);
   if (section_iter == temporary_devices_.end()) {
-    auto triple = temporary_devices_.try_emplace(section, common::ListMap<std::string, std::string>{});
+    auto triple = temporary_devices_.try_emplace(section, Section{});
     section_iter = std::get<0>(triple);
   }
   section_iter->second.insert_or_assign(property, std::move(value));
 }
 
 bool ConfigCache::RemoveSection(const std::string& section) {
-  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  return RemoveSectionLocked(section);
+}
+
+bool ConfigCache::RemoveSectionLocked(const std::string& section) {
   // sections are unique among all three maps, hence removing from one of them is enough
   if (information_sections_.extract(section) || persistent_devices_.extract(section)) {
     PersistentConfigChangedCallback();
@@ -233,7 +329,11 @@ bool ConfigCache::RemoveSection(const std::string& section) {
 }
 
 bool ConfigCache::RemoveProperty(const std::string& section, const std::string& property) {
-  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  return RemovePropertyLocked(section, property);
+}
+
+bool ConfigCache::RemovePropertyLocked(const std::string& section, const std::string& property) {
   auto section_iter = information_sections_.find(section);
   if (section_iter != information_sections_.end()) {
     auto value = section_iter->second.extract(property);
@@ -282,27 +382,31 @@ bool ConfigCache::RemoveProperty(const std::string& section, const std::string&
 }
 
 void ConfigCache::ConvertEncryptOrDecryptKeyIfNeeded() {
-  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  std::unique_lock<std::shared_mutex> lock(mutex_);
   LOG_INFO("%s", __func__);
-  auto persistent_sections = GetPersistentSections();
+  std::vector<std::string> persistent_sections;
+  persistent_sections.reserve(persistent_devices_.size());
+  for (const auto& elem : persistent_devices_) {
+    persistent_sections.emplace_back(elem.first);
+  }
   for (const auto& section : persistent_sections) {
     auto section_iter = persistent_devices_.find(section);
     for (const auto& property : kEncryptKeyNameList) {
       auto property_iter = section_iter->second.find(std::string(property));
       if (property_iter != section_iter->second.end()) {
-        bool is_encrypted = property_iter->second == kEncryptedStr;
-        if ((!property_iter->second.empty()) && os::ParameterProvider::GetBtKeystoreInterface() != nullptr &&
+        bool is_encrypted = property_iter->second.str == kEncryptedStr;
+        if ((!property_iter->second.str.empty()) && os::ParameterProvider::GetBtKeystoreInterface() != nullptr &&
             os::ParameterProvider::IsCommonCriteriaMode() && !is_encrypted) {
           if (os::ParameterProvider::GetBtKeystoreInterface()->set_encrypt_key_or_remove_key(
-                  section + "-" + std::string(property), property_iter->second)) {
-            SetProperty(section, std::string(property), kEncryptedStr);
+                  section + "-" + std::string(property), property_iter->second.str)) {
+            SetPropertyLocked(section, std::string(property), kEncryptedStr);
           }
         }
         if (os::ParameterProvider::GetBtKeystoreInterface() != nullptr && is_encrypted) {
           std::string value_str =
               os::ParameterProvider::GetBtKeystoreInterface()->get_key(section + "-" + std::string(property));
           if (!os::ParameterProvider::IsCommonCriteriaMode()) {
-            SetProperty(section, std::string(property), value_str);
+            SetPropertyLocked(section, std::string(property), value_str);
           }
         }
       }
@@ -319,7 +423,7 @@ bool ConfigCache::IsPersistentProperty(const std::string& property) const {
 }
 
 void ConfigCache::RemoveSectionWithProperty(const std::string& property) {
-  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  std::unique_lock<std::shared_mutex> lock(mutex_);
   size_t num_persistent_removed = 0;
   for (auto* config_section : {&information_sections_, &persistent_devices_}) {
     for (auto it = config_section->begin(); it != config_section->end();) {
@@ -346,7 +450,7 @@ void ConfigCache::RemoveSectionWithProperty(const std::string& property) {
 }
 
 std::vector<std::string> ConfigCache::GetPersistentSections() const {
-  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  std::shared_lock<std::shared_mutex> lock(mutex_);
   std::vector<std::string> paired_devices;
   paired_devices.reserve(persistent_devices_.size());
   for (const auto& elem : persistent_devices_) {
@@ -356,19 +460,19 @@ std::vector<std::string> ConfigCache::GetPersistentSections() const {
 }
 
 void ConfigCache::Commit(std::queue<MutationEntry>& mutation_entries) {
-  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  std::unique_lock<std::shared_mutex> lock(mutex_);
   while (!mutation_entries.empty()) {
     auto entry = std::move(mutation_entries.front());
     mutation_entries.pop();
     switch (entry.entry_type) {
       case MutationEntry::EntryType::SET:
-        SetProperty(std::move(entry.section), std::move(entry.property), std::move(entry.value));
+        SetPropertyLocked(std::move(entry.section), std::move(entry.property), std::move(entry.value));
         break;
       case MutationEntry::EntryType::REMOVE_PROPERTY:
-        RemoveProperty(entry.section, entry.property);
+        RemovePropertyLocked(entry.section, entry.property);
         break;
       case MutationEntry::EntryType::REMOVE_SECTION:
-        RemoveSection(entry.section);
+        RemoveSectionLocked(entry.section);
         break;
         // do not write a default case so that when a new enum is defined, compilation would fail automatically
     }
@@ -376,13 +480,13 @@ void ConfigCache::Commit(std::queue<MutationEntry>& mutation_entries) {
 }
 
 std::string ConfigCache::SerializeToLegacyFormat() const {
-  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  std::shared_lock<std::shared_mutex> lock(mutex_);
   std::stringstream serialized;
   for (const auto* config_section : {&information_sections_, &persistent_devices_}) {
     for (const auto& section : *config_section) {
       serialized << "[" << section.first << "]" << std::endl;
       for (const auto& property : section.second) {
-        serialized << property.first << " = " << property.second << std::endl;
+        serialized << property.first << " = " << property.second.str << std::endl;
       }
       serialized << std::endl;
     }
@@ -392,13 +496,13 @@ std::string ConfigCache::SerializeToLegacyFormat() const {
 
 std::vector<ConfigCache::SectionAndPropertyValue> ConfigCache::GetSectionNamesWithProperty(
     const std::string& property) const {
-  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  std::shared_lock<std::shared_mutex> lock(mutex_);
   std::vector<SectionAndPropertyValue> result;
   for (auto* config_section : {&information_sections_, &persistent_devices_}) {
     for (const auto& elem : *config_section) {
       auto it = elem.second.find(property);
       if (it != elem.second.end()) {
-        result.emplace_back(SectionAndPropertyValue{.section = elem.first, .property = it->second});
+        result.emplace_back(SectionAndPropertyValue{.section = elem.first, .property = it->second.str});
         continue;
       }
     }
@@ -406,7 +510,7 @@ std::vector<ConfigCache::SectionAndPropertyValue> ConfigCache::GetSectionNamesWi
   for (const auto& elem : temporary_devices_) {
     auto it = elem.second.find(property);
     if (it != elem.second.end()) {
-      result.emplace_back(SectionAndPropertyValue{.section = elem.first, .property = it->second});
+      result.emplace_back(SectionAndPropertyValue{.section = elem.first, .property = it->second.str});
       continue;
     }
   }
@@ -415,14 +519,14 @@ std::vector<ConfigCache::SectionAndPropertyValue> ConfigCache::GetSectionNamesWi
 
 namespace {
 
-bool FixDeviceTypeInconsistencyInSection(
-    const std::string& section_name, common::ListMap<std::string, std::string>& device_section_entries) {
+template <typename Section>
+bool FixDeviceTypeInconsistencyInSection(const std::string& section_name, Section& device_section_entries) {
   if (!hci::Address::IsValidAddress(section_name)) {
     return false;
   }
   auto device_type_iter = device_section_entries.find("DevType");
   if (device_type_iter != device_section_entries.end() &&
-      device_type_iter->second == std::to_string(hci::DeviceType::DUAL)) {
+      device_type_iter->second.str == std::to_string(hci::DeviceType::DUAL)) {
     // We might only have one of classic/LE keys for a dual device, but it is still a dual device,
     // so we should not change the DevType.
     return false;
@@ -452,7 +556,7 @@ bool FixDeviceTypeInconsistencyInSection(
   bool inconsistent = true;
   std::string device_type_str = std::to_string(device_type);
   if (device_type_iter != device_section_entries.end()) {
-    inconsistent = device_type_str != device_type_iter->second;
+    inconsistent = device_type_str != device_type_iter->second.str;
     if (inconsistent) {
       device_type_iter->second = std::move(device_type_str);
     }
@@ -465,7 +569,7 @@ bool FixDeviceTypeInconsistencyInSection(
 }  // namespace
 
 bool ConfigCache::FixDeviceTypeInconsistencies() {
-  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  std::unique_lock<std::shared_mutex> lock(mutex_);
   bool persistent_device_changed = false;
   for (auto* config_section : {&information_sections_, &persistent_devices_}) {
     for (auto& elem : *config_section) {
@@ -488,34 +592,21 @@ bool ConfigCache::FixDeviceTypeInconsistencies() {
 
 bool ConfigCache::HasAtLeastOneMatchingPropertiesInSection(
     const std::string& section, const std::unordered_set<std::string_view>& property_names) const {
-  std::lock_guard<std::recursive_mutex> lock(mutex_);
-  const common::ListMap<std::string, std::string>* section_ptr;
-  if (!IsDeviceSection(section)) {
-    auto section_iter = information_sections_.find(section);
-    if (section_iter == information_sections_.end()) {
+  return ReadSection(section, [&property_names](const Section* properties, bool) {
+    if (properties == nullptr) {
       return false;
     }
-    section_ptr = &section_iter->second;
-  } else {
-    auto section_iter = persistent_devices_.find(section);
-    if (section_iter == persistent_devices_.end()) {
-      section_iter = temporary_devices_.find(section);
-      if (section_iter == temporary_devices_.end()) {
-        return false;
+    for (const auto& property : *properties) {
+      if (property_names.count(property.first) > 0) {
+        return true;
       }
     }
-    section_ptr = &section_iter->second;
-  }
-  for (const auto& property : *section_ptr) {
-    if (property_names.count(property.first) > 0) {
-      return true;
-    }
-  }
-  return false;
+    return false;
+  });
 }
 
 bool ConfigCache::IsPersistentSection(const std::string& section) const {
-  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  std::shared_lock<std::shared_mutex> lock(mutex_);
   return persistent_devices_.contains(section);
 }
 
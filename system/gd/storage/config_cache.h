@@ -15,11 +15,13 @@
  */
 #pragma once
 
+#include <cstdint>
 #include <functional>
 #include <list>
 #include <mutex>
 #include <optional>
 #include <queue>
+#include <shared_mutex>
 #include <string>
 #include <string_view>
 #include <unordered_set>
@@ -48,7 +50,9 @@ class Mutation;
 // The definition of persistent sections is up to the user and is defined through the |persistent_property_names|
 // argument. When these properties are link key properties, then persistent sections is equal to bonded devices
 //
-// This class is thread safe
+// This class is thread safe. Information and persistent sections are read under a shared lock, so that the many
+// threads reading device properties do not serialize behind each other. Temporary sections are kept in an LRU cache
+// that every look-up reorders, so they are read under the exclusive lock, as all writes are.
 class ConfigCache {
  public:
   ConfigCache(size_t temp_device_capacity, std::unordered_set<std::string_view> persistent_property_names);
@@ -73,6 +77,10 @@ class ConfigCache {
   virtual bool HasProperty(const std::string& section, const std::string& property) const;
   // Get property, return std::nullopt if section or property does not exist
   virtual std::optional<std::string> GetProperty(const std::string& section, const std::string& property) const;
+  // Get property as an integer, return std::nullopt if section or property does not exist or if the property is not an
+  // integer. The integer forms of a value are parsed once when it is set, rather than on every read
+  virtual std::optional<int64_t> GetInt64Property(const std::string& section, const std::string& property) const;
+  virtual std::optional<uint64_t> GetUint64Property(const std::string& section, const std::string& property) const;
   // Returns a copy of persistent device MAC addresses
   virtual std::vector<std::string> GetPersistentSections() const;
   // Return true if a section is persistent
@@ -109,7 +117,8 @@ class ConfigCache {
   virtual void RemoveSectionWithProperty(const std::string& property);
   // remove all content in this config cache, restore it to the state after the explicit constructor
   virtual void Clear();
-  // Set a callback to notify interested party that a persistent config change has just happened
+  // Set a callback to notify interested party that a persistent config change has just happened. It is called with the
+  // config lock held and must not call back into this config cache
   virtual void SetPersistentConfigChangedCallback(std::function<void()> persistent_config_changed_callback);
 
   // Device config specific methods
@@ -125,19 +134,43 @@ class ConfigCache {
   static const std::string kDefaultSectionName;
 
  private:
-  mutable std::recursive_mutex mutex_;
+  // A property value, along with its integer forms parsed when it is set
+  struct PropertyValue {
+    PropertyValue(std::string value);  // NOLINT(google-explicit-constructor) values are assigned from strings
+    bool operator==(const PropertyValue& rhs) const {
+      return str == rhs.str;
+    }
+    std::string str;
+    std::optional<int64_t> int64;
+    std::optional<uint64_t> uint64;
+  };
+  using Section = common::ListMap<std::string, PropertyValue>;
+
+  mutable std::shared_mutex mutex_;
   // A callback to notify interested party that a persistent config change has just happened, empty by default
   std::function<void()> persistent_config_changed_callback_;
   // A set of property names that if set would make a section persistent and if non of these properties are set, a
   // section would become temporary again
   std::unordered_set<std::string_view> persistent_property_names_;
   // Common section that does not relate to remote device, will be written to disk
-  common::ListMap<std::string, common::ListMap<std::string, std::string>> information_sections_;
+  common::ListMap<std::string, Section> information_sections_;
   // Information about persistent devices, normally paired, will be written to disk
-  common::ListMap<std::string, common::ListMap<std::string, std::string>> persistent_devices_;
+  common::ListMap<std::string, Section> persistent_devices_;
   // Information about temporary devices, normally unpaired, will not be written to disk, will be evicted automatically
   // if capacity exceeds given value during initialization
-  common::LruCache<std::string, common::ListMap<std::string, std::string>> temporary_devices_;
+  common::LruCache<std::string, Section> temporary_devices_;
+
+  // Call |read| with the properties of |section| and whether it is a persistent device section, or with nullptr if
+  // there is no such section, under the lightest lock that allows finding it
+  template <typename Read>
+  auto ReadSection(const std::string& section, Read read) const;
+  // Return the properties of |section| and whether it is a persistent device section, or nullptr. Requires the
+  // exclusive lock, as finding a temporary section makes it the most recently used
+  const Section* FindSectionLocked(const std::string& section, bool* is_persistent) const;
+  // Modifiers for which the exclusive lock is already held
+  void SetPropertyLocked(std::string section, std::string property, std::string value);
+  bool RemoveSectionLocked(const std::string& section);
+  bool RemovePropertyLocked(const std::string& section, const std::string& property);
 
   // Convenience method to check if the callback is valid before calling it
   inline void PersistentConfigChangedCallback() const {
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "storage/config_cache.h"
+#include "storage/config_cache_helper.h"
+#include "storage/device.h"
+
+using ::benchmark::State;
+
+namespace bluetooth {
+namespace storage {
+
+namespace {
+
+constexpr int kNumBondedDevices = 50;
+constexpr int kNumTemporaryDevices = 50;
+
+std::string DeviceAddress(int i) {
+  char address[18];
+  std::snprintf(address, sizeof(address), "AA:BB:CC:DD:%02X:%02X", (i >> 8) & 0xff, i & 0xff);
+  return address;
+}
+
+// A config of bonded devices, as read by the profiles on the stack, HCI and binder threads, and of scanned devices
+ConfigCache& Config() {
+  static ConfigCache* config = [] {
+    auto* config = new ConfigCache(10000, Device::kLinkKeyProperties);
+    config->SetProperty("Adapter", "Address", "AA:BB:CC:DD:EE:FF");
+    config->SetProperty("Adapter", "ScanMode", "0");
+    for (int i = 0; i < kNumBondedDevices; i++) {
+      std::string address = DeviceAddress(i);
+      config->SetProperty(address, "Name", "Device " + address);
+      config->SetProperty(address, "DevClass", "2360324");
+      config->SetProperty(address, "DevType", "3");
+      config->SetProperty(address, "AddrType", "0");
+      config->SetProperty(address, "Timestamp", std::to_string(1672531200 + i));
+      config->SetProperty(address, "LinkKeyType", "8");
+      config->SetProperty(address, "LinkKey", std::string(32, '3'));
+      config->SetProperty(address, "LE_KEY_PENC", std::string(56, '3'));
+    }
+    for (int i = kNumBondedDevices; i < kNumBondedDevices + kNumTemporaryDevices; i++) {
+      std::string address = DeviceAddress(i);
+      config->SetProperty(address, "Name", "Device " + address);
+      config->SetProperty(address, "DevType", "2");
+    }
+    return config;
+  }();
+  return *config;
+}
+
+}  // namespace
+
+// Readers of the properties of bonded devices, on as many threads
+void BM_ConfigCacheRead(State& state) {
+  ConfigCache& config = Config();
+  int device = state.thread_index();
+  for (auto _ : state) {
+    std::string address = DeviceAddress(device);
+    ::benchmark::DoNotOptimize(config.GetProperty(address, "Name"));
+    ::benchmark::DoNotOptimize(config.GetProperty(address, "DevType"));
+    ::benchmark::DoNotOptimize(config.HasProperty(address, "LinkKey"));
+    device = (device + 1) % kNumBondedDevices;
+  }
+  state.SetItemsProcessed(state.iterations() * 3);
+}
+
+// The same readers, and a writer updating the timestamps of the bonded devices on the first thread
+void BM_ConfigCacheReadWrite(State& state) {
+  ConfigCache& config = Config();
+  int device = state.thread_index();
+  for (auto _ : state) {
+    std::string address = DeviceAddress(device);
+    if (state.thread_index() == 0) {
+      config.SetProperty(address, "Timestamp", std::to_string(device));
+    } else {
+      ::benchmark::DoNotOptimize(config.GetProperty(address, "Name"));
+      ::benchmark::DoNotOptimize(config.GetProperty(address, "DevType"));
+      ::benchmark::DoNotOptimize(config.HasProperty(address, "LinkKey"));
+    }
+    device = (device + 1) % kNumBondedDevices;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Integer properties read through ConfigCacheHelper, as the generated Device getters do
+void BM_ConfigCacheHelperGetInt(State& state) {
+  ConfigCache& config = Config();
+  int device = 0;
+  for (auto _ : state) {
+    std::string address = DeviceAddress(device);
+    ::benchmark::DoNotOptimize(ConfigCacheHelper(config).GetUint32(address, "DevClass"));
+    ::benchmark::DoNotOptimize(ConfigCacheHelper(config).GetInt(address, "DevType"));
+    ::benchmark::DoNotOptimize(ConfigCacheHelper(config).GetInt64(address, "Timestamp"));
+    device = (device + 1) % kNumBondedDevices;
+  }
+  state.SetItemsProcessed(state.iterations() * 3);
+}
+
+// Temporary devices, which every look-up moves to the front of the LRU cache
+void BM_ConfigCacheReadTemporary(State& state) {
+  ConfigCache& config = Config();
+  int device = kNumBondedDevices + state.thread_index();
+  for (auto _ : state) {
+    ::benchmark::DoNotOptimize(config.GetProperty(DeviceAddress(device), "DevType"));
+    device = kNumBondedDevices + (device + 1 - kNumBondedDevices) % kNumTemporaryDevices;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_ConfigCacheRead)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_ConfigCacheReadWrite)->ThreadRange(2, 8)->UseRealTime();
+BENCHMARK(BM_ConfigCacheHelperGetInt);
+BENCHMARK(BM_ConfigCacheReadTemporary)->ThreadRange(1, 8)->UseRealTime();
+
+}  // namespace storage
+}  // namespace bluetooth
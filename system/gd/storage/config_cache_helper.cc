@@ -45,11 +45,7 @@ void ConfigCacheHelper::SetUint64(const std::string& section, const std::string&
 }
 
 std::optional<uint64_t> ConfigCacheHelper::GetUint64(const std::string& section, const std::string& property) const {
-  auto value_str = config_cache_.GetProperty(section, property);
-  if (!value_str) {
-    return std::nullopt;
-  }
-  return common::Uint64FromString(*value_str);
+  return config_cache_.GetUint64Property(section, property);
 }
 
 void ConfigCacheHelper::SetUint32(const std::string& section, const std::string& property, uint32_t value) {
@@ -57,10 +53,6 @@ void ConfigCacheHelper::SetUint32(const std::string& section, const std::string&
 }
 
 std::optional<uint32_t> ConfigCacheHelper::GetUint32(const std::string& section, const std::string& property) const {
-  auto value_str = config_cache_.GetProperty(section, property);
-  if (!value_str) {
-    return std::nullopt;
-  }
   auto large_value = GetUint64(section, property);
   if (!large_value) {
     return std::nullopt;
@@ -76,11 +68,7 @@ void ConfigCacheHelper::SetInt64(const std::string& section, const std::string&
 }
 
 std::optional<int64_t> ConfigCacheHelper::GetInt64(const std::string& section, const std::string& property) const {
-  auto value_str = config_cache_.GetProperty(section, property);
-  if (!value_str) {
-    return std::nullopt;
-  }
-  return common::Int64FromString(*value_str);
+  return config_cache_.GetInt64Property(section, property);
 }
 
 void ConfigCacheHelper::SetInt(const std::string& section, const std::string& property, int value) {
@@ -88,10 +76,6 @@ void ConfigCacheHelper::SetInt(const std::string& section, const std::string& pr
 }
 
 std::optional<int> ConfigCacheHelper::GetInt(const std::string& section, const std::string& property) const {
-  auto value_str = config_cache_.GetProperty(section, property);
-  if (!value_str) {
-    return std::nullopt;
-  }
   auto large_value = GetInt64(section, property);
   if (!large_value) {
     return std::nullopt;
@@ -20,6 +20,8 @@
 #include <gtest/gtest.h>
 
 #include <cstdio>
+#include <thread>
+#include <vector>
 
 #include "hci/enum_helper.h"
 #include "storage/device.h"
@@ -47,6 +49,61 @@ TEST(ConfigCacheTest, simple_set_get_test) {
   ASSERT_EQ(*value, "C");
 }
 
+TEST(ConfigCacheTest, integer_set_get_test) {
+  ConfigCache config(100, Device::kLinkKeyProperties);
+  config.SetProperty("A", "Positive", "42");
+  config.SetProperty("A", "Negative", "-42");
+  config.SetProperty("A", "Large", "18446744073709551615");
+  config.SetProperty("A", "NotANumber", "42abc");
+  config.SetProperty("CC:DD:EE:FF:00:10", "DevType", "3");
+  config.SetProperty("CC:DD:EE:FF:00:11", "LinkKey", "AABBAABBCCDDEE");
+  config.SetProperty("CC:DD:EE:FF:00:11", "DevClass", "7936");
+
+  ASSERT_THAT(config.GetInt64Property("A", "Positive"), Optional(42));
+  ASSERT_THAT(config.GetUint64Property("A", "Positive"), Optional(42u));
+  ASSERT_THAT(config.GetInt64Property("A", "Negative"), Optional(-42));
+  ASSERT_FALSE(config.GetUint64Property("A", "Negative"));
+  ASSERT_FALSE(config.GetInt64Property("A", "Large"));
+  ASSERT_THAT(config.GetUint64Property("A", "Large"), Optional(UINT64_MAX));
+  ASSERT_FALSE(config.GetInt64Property("A", "NotANumber"));
+  ASSERT_FALSE(config.GetUint64Property("A", "NotANumber"));
+  ASSERT_FALSE(config.GetInt64Property("A", "Missing"));
+  ASSERT_FALSE(config.GetInt64Property("B", "Positive"));
+  ASSERT_THAT(config.GetInt64Property("CC:DD:EE:FF:00:10", "DevType"), Optional(3));
+  ASSERT_THAT(config.GetUint64Property("CC:DD:EE:FF:00:11", "DevClass"), Optional(7936u));
+
+  // The integer forms follow the value
+  config.SetProperty("A", "Positive", "abc");
+  ASSERT_FALSE(config.GetInt64Property("A", "Positive"));
+  config.SetProperty("A", "NotANumber", "7");
+  ASSERT_THAT(config.GetInt64Property("A", "NotANumber"), Optional(7));
+}
+
+TEST(ConfigCacheTest, concurrent_get_set_test) {
+  ConfigCache config(100, Device::kLinkKeyProperties);
+  config.SetProperty("CC:DD:EE:FF:00:10", "LinkKey", "AABBAABBCCDDEE");
+  config.SetProperty("CC:DD:EE:FF:00:10", "DevType", "0");
+  config.SetProperty("CC:DD:EE:FF:00:11", "DevType", "0");
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; i++) {
+    readers.emplace_back([&config] {
+      for (int j = 0; j < 1000; j++) {
+        ASSERT_TRUE(config.GetInt64Property("CC:DD:EE:FF:00:10", "DevType"));
+        ASSERT_TRUE(config.GetProperty("CC:DD:EE:FF:00:11", "DevType"));
+      }
+    });
+  }
+  for (int j = 0; j < 1000; j++) {
+    config.SetProperty("CC:DD:EE:FF:00:10", "DevType", std::to_string(j % 3));
+    config.SetProperty("CC:DD:EE:FF:00:11", "DevType", std::to_string(j % 3));
+  }
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  ASSERT_THAT(config.GetInt64Property("CC:DD:EE:FF:00:10", "DevType"), Optional(999 % 3));
+}
+
 TEST(ConfigCacheTest, empty_values_test) {
   ConfigCache config(100, Device::kLinkKeyProperties);
   ASSERT_DEATH({ config.SetProperty("", "B", "C"); }, "Empty section name not allowed");
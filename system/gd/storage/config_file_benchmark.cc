@@ -0,0 +1,128 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Time to load the config at start up, from the config file or from its snapshot, with the files in the page cache
+// (warm) or evicted from it (cold)
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "os/files.h"
+#include "storage/config_cache.h"
+#include "storage/config_snapshot_file.h"
+#include "storage/device.h"
+#include "storage/legacy_config_file.h"
+
+using ::benchmark::State;
+
+namespace bluetooth {
+namespace storage {
+
+namespace {
+
+std::string DeviceAddress(int i) {
+  char address[18];
+  std::snprintf(address, sizeof(address), "AA:BB:CC:DD:%02X:%02X", (i >> 8) & 0xff, i & 0xff);
+  return address;
+}
+
+// A config of |num_devices| bonded devices, with keys and metadata of both transports
+std::string SerializedConfig(int num_devices) {
+  ConfigCache config(10000, Device::kLinkKeyProperties);
+  config.SetProperty("Info", "TimeCreated", "2023-01-01 00:00:00");
+  config.SetProperty("Adapter", "Address", "AA:BB:CC:DD:EE:FF");
+  config.SetProperty("Adapter", "ScanMode", "0");
+  config.SetProperty("Adapter", "LE_LOCAL_KEY_IRK", std::string(32, '1'));
+  for (int i = 0; i < num_devices; i++) {
+    std::string address = DeviceAddress(i);
+    config.SetProperty(address, "Name", "Device " + address);
+    config.SetProperty(address, "DevClass", "2360324");
+    config.SetProperty(address, "DevType", "3");
+    config.SetProperty(address, "AddrType", "0");
+    config.SetProperty(address, "Timestamp", std::to_string(1672531200 + i));
+    config.SetProperty(address, "Service", std::string(36 * 8, 'f'));
+    config.SetProperty(address, "LinkKeyType", "8");
+    config.SetProperty(address, "PinLength", "0");
+    config.SetProperty(address, "LinkKey", std::string(32, '3'));
+    config.SetProperty(address, "LE_KEY_PENC", std::string(56, '3'));
+    config.SetProperty(address, "LE_KEY_PID", std::string(46, '3'));
+    config.SetProperty(address, "LE_KEY_PCSRK", std::string(42, '3'));
+    config.SetProperty(address, "LE_KEY_LENC", std::string(40, '3'));
+    config.SetProperty(address, "LE_KEY_LCSRK", std::string(42, '3'));
+    config.SetProperty(address, "MetadataManufacturerName", "Manufacturer of " + address);
+  }
+  return config.SerializeToLegacyFormat();
+}
+
+// Drop the clean pages of |path| from the page cache, as after a reboot
+void EvictFromPageCache(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd >= 0) {
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+  }
+}
+
+}  // namespace
+
+// range(0): load from snapshot, range(1): cold page cache, range(2): number of bonded devices
+void BM_LoadConfig(State& state) {
+  auto temp_dir = std::filesystem::temp_directory_path();
+  std::string config_path = (temp_dir / "benchmark_config.conf").string();
+  std::string snapshot_path = (temp_dir / "benchmark_config.snapshot").string();
+  std::string serialized_config = SerializedConfig(state.range(2));
+  if (!os::WriteToFile(config_path, serialized_config) ||
+      !ConfigSnapshotFile::FromPath(snapshot_path).Write(serialized_config)) {
+    state.SkipWithError("unable to write config files");
+    return;
+  }
+  for (auto _ : state) {
+    if (state.range(1)) {
+      state.PauseTiming();
+      EvictFromPageCache(config_path);
+      EvictFromPageCache(snapshot_path);
+      state.ResumeTiming();
+    }
+    std::optional<ConfigCache> config;
+    if (state.range(0)) {
+      // Loading from the snapshot reads the config file too, to check that the snapshot is current
+      auto current_config = os::ReadSmallFile(config_path);
+      config = ConfigSnapshotFile::FromPath(snapshot_path).Read(10000, *current_config);
+    } else {
+      config = LegacyConfigFile::FromPath(config_path).Read(10000);
+    }
+    if (!config) {
+      state.SkipWithError("unable to load config");
+      break;
+    }
+    ::benchmark::DoNotOptimize(config);
+  }
+  std::filesystem::remove(config_path);
+  std::filesystem::remove(snapshot_path);
+}
+
+BENCHMARK(BM_LoadConfig)
+    ->ArgNames({"snapshot", "cold", "devices"})
+    ->ArgsProduct({{0, 1}, {0, 1}, {20, 200}})
+    ->Unit(::benchmark::kMicrosecond);
+
+}  // namespace storage
+}  // namespace bluetooth
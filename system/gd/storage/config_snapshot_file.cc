@@ -0,0 +1,276 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/config_snapshot_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+#include "os/files.h"
+#include "os/log.h"
+#include "storage/device.h"
+#include "storage/legacy_config_file.h"
+
+namespace bluetooth {
+namespace storage {
+
+namespace {
+
+// Layout of a snapshot, all integers in host byte order:
+//
+// Header
+// SectionEntry[num_sections]
+// PropertyEntry[num_properties]
+// String pool, that entries point into
+//
+// Everything after the header is the payload, that payload_hash covers. Sections are runs of properties in the order
+// of the legacy config, so that reading them back sets properties in the same order as parsing the legacy config does.
+constexpr uint32_t kMagic = 0x53434642;  // "BFCS" in little endian
+
+struct Header {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t legacy_config_hash;
+  uint64_t payload_size;
+  uint64_t payload_hash;
+  uint32_t num_sections;
+  uint32_t num_properties;
+};
+static_assert(sizeof(Header) == 40, "Header must not have padding");
+
+struct SectionEntry {
+  uint32_t name_offset;
+  uint32_t name_length;
+  uint32_t first_property;
+  uint32_t num_properties;
+};
+
+struct PropertyEntry {
+  uint32_t name_offset;
+  uint32_t name_length;
+  uint32_t value_offset;
+  uint32_t value_length;
+};
+
+// Read-only mapping of a whole file, unmapped when going out of scope
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& path) {
+    int fd = TEMP_FAILURE_RETRY(open(path.c_str(), O_RDONLY | O_CLOEXEC));
+    if (fd < 0) {
+      if (errno != ENOENT) {
+        LOG_WARN("unable to open file '%s', error: %s", path.c_str(), strerror(errno));
+      }
+      return;
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+      LOG_WARN("unable to stat file '%s', error: %s", path.c_str(), strerror(errno));
+    } else if (file_stat.st_size > 0) {
+      void* data = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data == MAP_FAILED) {
+        LOG_WARN("unable to mmap file '%s', error: %s", path.c_str(), strerror(errno));
+      } else {
+        data_ = static_cast<const uint8_t*>(data);
+        size_ = file_stat.st_size;
+      }
+    }
+    close(fd);
+  }
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile() {
+    if (data_ != nullptr) {
+      munmap(const_cast<uint8_t*>(data_), size_);
+    }
+  }
+
+  const uint8_t* data() const {
+    return data_;
+  }
+  size_t size() const {
+    return size_;
+  }
+
+ private:
+  const uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+void Append(std::string* out, const void* data, size_t size) {
+  out->append(static_cast<const char*>(data), size);
+}
+
+}  // namespace
+
+ConfigSnapshotFile::ConfigSnapshotFile(std::string path) : path_(std::move(path)) {
+  ASSERT(!path_.empty());
+}
+
+uint64_t ConfigSnapshotFile::Hash(std::string_view data) {
+  constexpr uint64_t kPrime = 0x100000001b3;
+  uint64_t hash = 0xcbf29ce484222325;
+  // Eight bytes at a time, as hashing the config file is on the start up path, folding the high bits back after each
+  // multiplication so that every byte reaches every bit
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= data.size(); i += sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, data.data() + i, sizeof(word));
+    hash = (hash ^ word) * kPrime;
+    hash ^= hash >> 32;
+  }
+  for (; i < data.size(); i++) {
+    hash = (hash ^ static_cast<unsigned char>(data[i])) * kPrime;
+  }
+  return hash;
+}
+
+std::optional<ConfigCache> ConfigSnapshotFile::Read(size_t temp_devices_capacity, std::string_view legacy_config) {
+  MappedFile file(path_);
+  if (file.data() == nullptr) {
+    return std::nullopt;
+  }
+  if (file.size() < sizeof(Header)) {
+    LOG_WARN("snapshot '%s' is truncated", path_.c_str());
+    return std::nullopt;
+  }
+  // mmap returns page aligned memory, and the header and entries are multiples of 4 bytes
+  const auto* header = reinterpret_cast<const Header*>(file.data());
+  if (header->magic != kMagic) {
+    LOG_WARN("'%s' is not a config snapshot", path_.c_str());
+    return std::nullopt;
+  }
+  if (header->version != kVersion) {
+    LOG_INFO("snapshot '%s' has version %u, expecting %u", path_.c_str(), header->version, kVersion);
+    return std::nullopt;
+  }
+  if (header->legacy_config_hash != Hash(legacy_config)) {
+    LOG_INFO("snapshot '%s' is stale", path_.c_str());
+    return std::nullopt;
+  }
+  std::string_view payload(reinterpret_cast<const char*>(file.data()) + sizeof(Header), file.size() - sizeof(Header));
+  if (header->payload_size != payload.size() || header->payload_hash != Hash(payload)) {
+    LOG_WARN("snapshot '%s' is corrupted", path_.c_str());
+    return std::nullopt;
+  }
+  uint64_t entries_size = static_cast<uint64_t>(header->num_sections) * sizeof(SectionEntry) +
+                          static_cast<uint64_t>(header->num_properties) * sizeof(PropertyEntry);
+  if (entries_size > payload.size()) {
+    LOG_WARN("snapshot '%s' is corrupted", path_.c_str());
+    return std::nullopt;
+  }
+  const auto* sections = reinterpret_cast<const SectionEntry*>(payload.data());
+  const auto* properties = reinterpret_cast<const PropertyEntry*>(sections + header->num_sections);
+  std::string_view strings = payload.substr(entries_size);
+  auto get_string = [&strings](uint32_t offset, uint32_t length) -> std::optional<std::string> {
+    if (offset > strings.size() || length > strings.size() - offset) {
+      return std::nullopt;
+    }
+    return std::string(strings.substr(offset, length));
+  };
+
+  ConfigCache cache(temp_devices_capacity, Device::kLinkKeyProperties);
+  for (uint32_t i = 0; i < header->num_sections; i++) {
+    const SectionEntry& section_entry = sections[i];
+    auto section = get_string(section_entry.name_offset, section_entry.name_length);
+    if (!section || section_entry.first_property > header->num_properties ||
+        section_entry.num_properties > header->num_properties - section_entry.first_property) {
+      LOG_WARN("snapshot '%s' has an invalid section entry %u", path_.c_str(), i);
+      return std::nullopt;
+    }
+    for (uint32_t j = 0; j < section_entry.num_properties; j++) {
+      const PropertyEntry& property_entry = properties[section_entry.first_property + j];
+      auto property = get_string(property_entry.name_offset, property_entry.name_length);
+      auto value = get_string(property_entry.value_offset, property_entry.value_length);
+      if (!property || !value) {
+        LOG_WARN("snapshot '%s' has an invalid property entry %u", path_.c_str(), section_entry.first_property + j);
+        return std::nullopt;
+      }
+      cache.SetProperty(*section, std::move(*property), std::move(*value));
+    }
+  }
+  return cache;
+}
+
+bool ConfigSnapshotFile::Write(const std::string& legacy_config) {
+  std::vector<SectionEntry> sections;
+  std::vector<PropertyEntry> properties;
+  std::string strings;
+  auto add_string = [&strings](const std::string& str) {
+    auto offset = static_cast<uint32_t>(strings.size());
+    strings.append(str);
+    return offset;
+  };
+  std::istringstream input(legacy_config);
+  std::string last_section;
+  bool parsed = LegacyConfigFile::Parse(input, [&](std::string section, std::string property, std::string value) {
+    if (sections.empty() || section != last_section) {
+      sections.push_back(SectionEntry{
+          .name_offset = add_string(section),
+          .name_length = static_cast<uint32_t>(section.size()),
+          .first_property = static_cast<uint32_t>(properties.size()),
+          .num_properties = 0});
+      last_section = std::move(section);
+    }
+    properties.push_back(PropertyEntry{
+        .name_offset = add_string(property),
+        .name_length = static_cast<uint32_t>(property.size()),
+        .value_offset = add_string(value),
+        .value_length = static_cast<uint32_t>(value.size())});
+    sections.back().num_properties++;
+  });
+  if (!parsed) {
+    LOG_ERROR("unable to parse config for snapshot '%s'", path_.c_str());
+    return false;
+  }
+
+  std::string payload;
+  payload.reserve(sections.size() * sizeof(SectionEntry) + properties.size() * sizeof(PropertyEntry) + strings.size());
+  Append(&payload, sections.data(), sections.size() * sizeof(SectionEntry));
+  Append(&payload, properties.data(), properties.size() * sizeof(PropertyEntry));
+  payload.append(strings);
+
+  Header header{
+      .magic = kMagic,
+      .version = kVersion,
+      .legacy_config_hash = Hash(legacy_config),
+      .payload_size = payload.size(),
+      .payload_hash = Hash(payload),
+      .num_sections = static_cast<uint32_t>(sections.size()),
+      .num_properties = static_cast<uint32_t>(properties.size())};
+  std::string snapshot;
+  snapshot.reserve(sizeof(Header) + payload.size());
+  Append(&snapshot, &header, sizeof(Header));
+  snapshot.append(payload);
+  return os::WriteToFile(path_, snapshot);
+}
+
+bool ConfigSnapshotFile::Delete() {
+  if (!os::FileExists(path_)) {
+    return false;
+  }
+  return os::RemoveFile(path_);
+}
+
+}  // namespace storage
+}  // namespace bluetooth
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "storage/config_cache.h"
+
+namespace bluetooth {
+namespace storage {
+
+// A binary snapshot of a config in the legacy format, so that it can be loaded without parsing text
+//
+// The snapshot holds the hash of the legacy config it was made from, and is only read when that config is unchanged,
+// so the legacy config file stays the source of truth. Its content is checksummed, and is indexed so that it is read
+// from an mmap of the file rather than tokenized line by line.
+class ConfigSnapshotFile {
+ public:
+  static ConfigSnapshotFile FromPath(std::string path) {
+    return ConfigSnapshotFile(std::move(path));
+  }
+  explicit ConfigSnapshotFile(std::string path);
+  // Return the config in the snapshot, or std::nullopt if the snapshot is missing, corrupted, of another version or
+  // was not made from |legacy_config|, the current content of the legacy config file
+  std::optional<ConfigCache> Read(size_t temp_devices_capacity, std::string_view legacy_config);
+  // Write a snapshot of |legacy_config|, a config serialized to the legacy format
+  bool Write(const std::string& legacy_config);
+  bool Delete();
+
+  // Bumped whenever the layout of the snapshot changes, snapshots of other versions are ignored
+  static constexpr uint32_t kVersion = 1;
+
+  // 64 bit hash of |data|, FNV-1a over 8 byte words. A checksum against corruption, not a cryptographic hash
+  static uint64_t Hash(std::string_view data);
+
+ private:
+  std::string path_;
+};
+
+}  // namespace storage
+}  // namespace bluetooth
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/config_snapshot_file.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <filesystem>
+
+#include "os/files.h"
+#include "storage/device.h"
+#include "storage/legacy_config_file.h"
+
+namespace testing {
+
+using bluetooth::os::ReadSmallFile;
+using bluetooth::os::WriteToFile;
+using bluetooth::storage::ConfigCache;
+using bluetooth::storage::ConfigSnapshotFile;
+using bluetooth::storage::Device;
+using bluetooth::storage::LegacyConfigFile;
+
+static const std::string kTestConfig =
+    "[Info]\n"
+    "FileSource = Empty\n"
+    "TimeCreated = 2020-05-20 01:20:56\n"
+    "\n"
+    "[Adapter]\n"
+    "Address = 01:02:03:ab:cd:ef\n"
+    "LE_LOCAL_KEY_IRK = fedcba0987654321fedcba0987654321\n"
+    "ScanMode = 2\n"
+    "\n"
+    "[01:02:03:ab:cd:ea]\n"
+    "name = hello world\n"
+    "LinkKey = fedcba0987654321fedcba0987654328\n"
+    "\n"
+    "[01:02:03:ab:cd:eb]\n"
+    "name = \n"
+    "LE_KEY_PENC = fedcba0987654321fedcba0987654328\n"
+    "\n";
+
+class ConfigSnapshotFileTest : public Test {
+ protected:
+  void SetUp() override {
+    auto temp_dir = std::filesystem::temp_directory_path();
+    temp_config_ = temp_dir / "temp_config.txt";
+    temp_snapshot_ = temp_dir / "temp_config.snapshot";
+    ASSERT_TRUE(WriteToFile(temp_config_.string(), kTestConfig));
+  }
+
+  void TearDown() override {
+    std::filesystem::remove(temp_config_);
+    std::filesystem::remove(temp_snapshot_);
+  }
+
+  // Flip a bit of the snapshot at |offset|
+  void CorruptSnapshot(size_t offset) {
+    auto snapshot = ReadSmallFile(temp_snapshot_.string());
+    ASSERT_TRUE(snapshot);
+    ASSERT_LT(offset, snapshot->size());
+    (*snapshot)[offset] ^= 0x01;
+    ASSERT_TRUE(WriteToFile(temp_snapshot_.string(), *snapshot));
+  }
+
+  std::filesystem::path temp_config_;
+  std::filesystem::path temp_snapshot_;
+};
+
+TEST_F(ConfigSnapshotFileTest, write_and_read_loop_back_test) {
+  ASSERT_TRUE(ConfigSnapshotFile::FromPath(temp_snapshot_.string()).Write(kTestConfig));
+  auto config = ConfigSnapshotFile::FromPath(temp_snapshot_.string()).Read(100, kTestConfig);
+  ASSERT_TRUE(config);
+  auto legacy_config = LegacyConfigFile::FromPath(temp_config_.string()).Read(100);
+  ASSERT_TRUE(legacy_config);
+  EXPECT_EQ(*legacy_config, *config);
+  EXPECT_THAT(config->GetPersistentSections(), ElementsAre("01:02:03:ab:cd:ea", "01:02:03:ab:cd:eb"));
+  EXPECT_THAT(config->GetProperty("Adapter", "Address"), Optional(StrEq("01:02:03:ab:cd:ef")));
+  EXPECT_THAT(config->GetProperty("01:02:03:ab:cd:eb", "name"), Optional(StrEq("")));
+  // Round trips through the legacy format too
+  EXPECT_EQ(config->SerializeToLegacyFormat(), kTestConfig);
+}
+
+TEST_F(ConfigSnapshotFileTest, empty_config_test) {
+  ASSERT_TRUE(ConfigSnapshotFile::FromPath(temp_snapshot_.string()).Write(""));
+  auto config = ConfigSnapshotFile::FromPath(temp_snapshot_.string()).Read(100, "");
+  ASSERT_TRUE(config);
+  EXPECT_EQ(*config, ConfigCache(100, Device::kLinkKeyProperties));
+}
+
+TEST_F(ConfigSnapshotFileTest, missing_snapshot_test) {
+  EXPECT_FALSE(ConfigSnapshotFile::FromPath(temp_snapshot_.string()).Read(100, kTestConfig));
+  EXPECT_FALSE(ConfigSnapshotFile::FromPath(temp_snapshot_.string()).Delete());
+}
+
+TEST_F(ConfigSnapshotFileTest, stale_snapshot_is_not_read_test) {
+  ASSERT_TRUE(ConfigSnapshotFile::FromPath(temp_snapshot_.string()).Write(kTestConfig));
+  std::string changed_config = kTestConfig + "[01:02:03:ab:cd:ec]\nLinkKey = 1234\n";
+  EXPECT_FALSE(ConfigSnapshotFile::FromPath(temp_snapshot_.string()).Read(100, changed_config));
+}
+
+TEST_F(ConfigSnapshotFileTest, corrupted_snapshot_is_not_read_test) {
+  ASSERT_TRUE(ConfigSnapshotFile::FromPath(temp_snapshot_.string()).Write(kTestConfig));
+  auto snapshot_size = std::filesystem::file_size(temp_snapshot_);
+  // A byte of the string pool, at the end of the snapshot
+  CorruptSnapshot(snapshot_size - 1);
+  EXPECT_FALSE(ConfigSnapshotFile::FromPath(temp_snapshot_.string()).Read(100, kTestConfig));
+
+  // Truncated snapshot
+  auto snapshot = ReadSmallFile(temp_snapshot_.string());
+  ASSERT_TRUE(snapshot);
+  ASSERT_TRUE(WriteToFile(temp_snapshot_.string(), snapshot->substr(0, 16)));
+  EXPECT_FALSE(ConfigSnapshotFile::FromPath(temp_snapshot_.string()).Read(100, kTestConfig));
+}
+
+TEST_F(ConfigSnapshotFileTest, snapshot_of_another_version_is_not_read_test) {
+  ASSERT_TRUE(ConfigSnapshotFile::FromPath(temp_snapshot_.string()).Write(kTestConfig));
+  // The version follows the 4 bytes of magic
+  CorruptSnapshot(4);
+  EXPECT_FALSE(ConfigSnapshotFile::FromPath(temp_snapshot_.string()).Read(100, kTestConfig));
+}
+
+TEST_F(ConfigSnapshotFileTest, malformed_config_is_not_snapshotted_test) {
+  EXPECT_FALSE(ConfigSnapshotFile::FromPath(temp_snapshot_.string()).Write("[Adapter\nAddress = 01:02:03:ab:cd:ef\n"));
+  EXPECT_FALSE(std::filesystem::exists(temp_snapshot_));
+}
+
+}  // namespace testing
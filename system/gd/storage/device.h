@@ -46,7 +46,8 @@ static_assert(false, "GENERATE_PROPERTY_GETTER_SETTER_REMOVER() must be uniquely
 #define GENERATE_PROPERTY_GETTER_SETTER_REMOVER(NAME, RETURN_TYPE, PROPERTY_KEY)                                \
  public:                                                                                                        \
   std::optional<RETURN_TYPE> Get##NAME() const {                                                                \
-    return ConfigCacheHelper(*config_).Get<RETURN_TYPE>(section_, PROPERTY_KEY);                                \
+    static const std::string kPropertyKey(PROPERTY_KEY);                                                        \
+    return ConfigCacheHelper(*config_).Get<RETURN_TYPE>(section_, kPropertyKey);                                \
   }                                                                                                             \
   MutationEntry Set##NAME(const RETURN_TYPE& value) {                                                           \
     return MutationEntry::Set<RETURN_TYPE>(MutationEntry::PropertyType::NORMAL, section_, PROPERTY_KEY, value); \
@@ -66,7 +67,8 @@ static_assert(
 #define GENERATE_PROPERTY_GETTER_SETTER_REMOVER_WITH_CUSTOM_SETTER(NAME, RETURN_TYPE, PROPERTY_KEY, FUNC)           \
  public:                                                                                                            \
   std::optional<RETURN_TYPE> Get##NAME() const {                                                                    \
-    return ConfigCacheHelper(*config_).Get<RETURN_TYPE>(section_, PROPERTY_KEY);                                    \
+    static const std::string kPropertyKey(PROPERTY_KEY);                                                            \
+    return ConfigCacheHelper(*config_).Get<RETURN_TYPE>(section_, kPropertyKey);                                    \
   }                                                                                                                 \
   MutationEntry Set##NAME(const RETURN_TYPE& value) {                                                               \
     auto new_value = [this](const RETURN_TYPE& value) -> RETURN_TYPE FUNC(value);                                   \
@@ -87,7 +89,8 @@ static_assert(false, "GENERATE_TEMP_PROPERTY_GETTER_SETTER_REMOVER() must be uni
 #define GENERATE_TEMP_PROPERTY_GETTER_SETTER_REMOVER(NAME, RETURN_TYPE, PROPERTY_KEY)                                \
  public:                                                                                                             \
   std::optional<RETURN_TYPE> GetTemp##NAME() const {                                                                 \
-    return ConfigCacheHelper(*memory_only_config_).Get<RETURN_TYPE>(section_, PROPERTY_KEY);                         \
+    static const std::string kPropertyKey(PROPERTY_KEY);                                                             \
+    return ConfigCacheHelper(*memory_only_config_).Get<RETURN_TYPE>(section_, kPropertyKey);                         \
   }                                                                                                                  \
   MutationEntry SetTemp##NAME(const RETURN_TYPE& value) {                                                            \
     return MutationEntry::Set<RETURN_TYPE>(MutationEntry::PropertyType::MEMORY_ONLY, section_, PROPERTY_KEY, value); \
@@ -15,6 +15,8 @@
  */
 #pragma once
 
+#include <functional>
+#include <istream>
 #include <string>
 #include <utility>
 
@@ -32,8 +34,16 @@ class LegacyConfigFile {
   explicit LegacyConfigFile(std::string path);
   std::optional<ConfigCache> Read(size_t temp_devices_capacity);
   bool Write(const ConfigCache& cache);
+  // Write a config already serialized to the legacy format
+  bool Write(const std::string& serialized_config);
   bool Delete();
 
+  // Parse a config in the legacy format from |input|, calling |set_property| for each property in file order
+  // Return false on a malformed line
+  static bool Parse(
+      std::istream& input,
+      const std::function<void(std::string section, std::string property, std::string value)>& set_property);
+
  private:
   std::string path_;
 };
@@ -30,6 +30,7 @@
 #include "os/parameter_provider.h"
 #include "os/system_properties.h"
 #include "storage/config_cache.h"
+#include "storage/config_snapshot_file.h"
 #include "storage/legacy_config_file.h"
 #include "storage/mutation.h"
 
@@ -42,6 +43,8 @@ using os::Alarm;
 using os::Handler;
 
 static const std::string kFactoryResetProperty = "persist.bluetooth.factoryreset";
+// Also save the config as a binary snapshot, and load it from that snapshot when it matches the config file
+static const std::string kConfigSnapshotProperty = "persist.bluetooth.config_snapshot";
 
 static const size_t kDefaultTempDeviceCapacity = 10000;
 // Save config whenever there is a change, but delay it by this value so that burst config change won't overwhelm disk
@@ -75,6 +78,8 @@ StorageModule::StorageModule(
       is_single_user_mode_(is_single_user_mode) {
   // e.g. "/data/misc/bluedroid/bt_config.conf" to "/data/misc/bluedroid/bt_config.bak"
   config_backup_path_ = config_file_path_.substr(0, config_file_path_.find_last_of('.')) + ".bak";
+  // e.g. "/data/misc/bluedroid/bt_config.conf" to "/data/misc/bluedroid/bt_config.snapshot"
+  config_snapshot_path_ = config_file_path_.substr(0, config_file_path_.find_last_of('.')) + ".snapshot";
   ASSERT_LOG(
       config_save_delay > kMinConfigSaveDelay,
       "Config save delay of %lld ms is not enough, must be at least %lld ms to avoid overwhelming the disk",
@@ -137,10 +142,16 @@ void StorageModule::SaveImmediately() {
     ASSERT(os::RenameFile(config_file_path_, config_backup_path_));
   }
   // 2. write in-memory config to disk, if failed, backup can still be used
-  ASSERT(LegacyConfigFile::FromPath(config_file_path_).Write(pimpl_->cache_));
+  std::string serialized_config = pimpl_->cache_.SerializeToLegacyFormat();
+  ASSERT(LegacyConfigFile::FromPath(config_file_path_).Write(serialized_config));
   // 3. now write back up to disk as well
-  ASSERT(LegacyConfigFile::FromPath(config_backup_path_).Write(pimpl_->cache_));
-  // 4. save checksum if it is running in common criteria mode
+  ASSERT(LegacyConfigFile::FromPath(config_backup_path_).Write(serialized_config));
+  // 4. write the snapshot of what was just written, a failure only means the next start parses the config file
+  if (os::GetSystemPropertyBool(kConfigSnapshotProperty, false) &&
+      !ConfigSnapshotFile::FromPath(config_snapshot_path_).Write(serialized_config)) {
+    LOG_WARN("unable to write config snapshot at %s", config_snapshot_path_.c_str());
+  }
+  // 5. save checksum if it is running in common criteria mode
   if (bluetooth::os::ParameterProvider::GetBtKeystoreInterface() != nullptr &&
       bluetooth::os::ParameterProvider::IsCommonCriteriaMode()) {
     bluetooth::os::ParameterProvider::GetBtKeystoreInterface()->set_encrypt_key_or_remove_key(
@@ -159,6 +170,7 @@ void StorageModule::Start() {
     LOG_INFO("%s is true, delete config files", kFactoryResetProperty.c_str());
     LegacyConfigFile::FromPath(config_file_path_).Delete();
     LegacyConfigFile::FromPath(config_backup_path_).Delete();
+    ConfigSnapshotFile::FromPath(config_snapshot_path_).Delete();
     os::SetSystemProperty(kFactoryResetProperty, "false");
   }
   if (!is_config_checksum_pass(kConfigFileComparePass)) {
@@ -167,17 +179,38 @@ void StorageModule::Start() {
   if (!is_config_checksum_pass(kConfigBackupComparePass)) {
     LegacyConfigFile::FromPath(config_backup_path_).Delete();
   }
-  auto config = LegacyConfigFile::FromPath(config_file_path_).Read(temp_devices_capacity_);
+  auto load_start_time = std::chrono::steady_clock::now();
+  std::optional<ConfigCache> config;
+  const char* loaded_from = "snapshot";
+  if (os::GetSystemPropertyBool(kConfigSnapshotProperty, false)) {
+    // The config file stays the source of truth, the snapshot is only used when it was made from that very content
+    auto serialized_config = os::ReadSmallFile(config_file_path_);
+    if (serialized_config) {
+      config = ConfigSnapshotFile::FromPath(config_snapshot_path_).Read(temp_devices_capacity_, *serialized_config);
+    }
+  }
+  if (!config || !config->HasSection(kAdapterSection)) {
+    config = LegacyConfigFile::FromPath(config_file_path_).Read(temp_devices_capacity_);
+    loaded_from = "file";
+  }
   if (!config || !config->HasSection(kAdapterSection)) {
     LOG_WARN("cannot load config at %s, using backup at %s.", config_file_path_.c_str(), config_backup_path_.c_str());
     config = LegacyConfigFile::FromPath(config_backup_path_).Read(temp_devices_capacity_);
     file_source = "Backup";
+    loaded_from = "backup";
   }
   if (!config || !config->HasSection(kAdapterSection)) {
     LOG_WARN("cannot load backup config at %s; creating new empty ones", config_backup_path_.c_str());
     config.emplace(temp_devices_capacity_, Device::kLinkKeyProperties);
     file_source = "Empty";
+    loaded_from = "nowhere";
   }
+  LOG_INFO(
+      "loaded config from %s in %lld us",
+      loaded_from,
+      static_cast<long long>(
+          std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - load_start_time)
+              .count()));
   if (!file_source.empty()) {
     config->SetProperty(kInfoSection, kFileSourceProperty, std::move(file_source));
   }
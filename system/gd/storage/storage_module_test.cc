@@ -29,7 +29,9 @@
 
 #include "module.h"
 #include "os/files.h"
+#include "os/system_properties.h"
 #include "storage/config_cache.h"
+#include "storage/config_snapshot_file.h"
 #include "storage/device.h"
 #include "storage/legacy_config_file.h"
 
@@ -38,6 +40,7 @@ namespace testing {
 using bluetooth::TestModuleRegistry;
 using bluetooth::hci::Address;
 using bluetooth::storage::ConfigCache;
+using bluetooth::storage::ConfigSnapshotFile;
 using bluetooth::storage::Device;
 using bluetooth::storage::LegacyConfigFile;
 using bluetooth::storage::StorageModule;
@@ -108,6 +111,7 @@ class StorageModuleTest : public Test {
     temp_dir_ = std::filesystem::temp_directory_path();
     temp_config_ = temp_dir_ / "temp_config.txt";
     temp_backup_config_ = temp_dir_ / "temp_config.bak";
+    temp_snapshot_config_ = temp_dir_ / "temp_config.snapshot";
     DeleteConfigFiles();
     ASSERT_FALSE(std::filesystem::exists(temp_config_));
     ASSERT_FALSE(std::filesystem::exists(temp_backup_config_));
@@ -124,11 +128,15 @@ class StorageModuleTest : public Test {
     if (std::filesystem::exists(temp_backup_config_)) {
       ASSERT_TRUE(std::filesystem::remove(temp_backup_config_));
     }
+    if (std::filesystem::exists(temp_snapshot_config_)) {
+      ASSERT_TRUE(std::filesystem::remove(temp_snapshot_config_));
+    }
   }
 
   std::filesystem::path temp_dir_;
   std::filesystem::path temp_config_;
   std::filesystem::path temp_backup_config_;
+  std::filesystem::path temp_snapshot_config_;
 };
 
 TEST_F(StorageModuleTest, empty_config_no_op_test) {
@@ -283,6 +291,49 @@ TEST_F(StorageModuleTest, save_config_test) {
   ASSERT_TRUE(std::filesystem::exists(temp_config_));
 }
 
+TEST_F(StorageModuleTest, config_snapshot_test) {
+  bluetooth::os::SetSystemProperty("persist.bluetooth.config_snapshot", "true");
+  ASSERT_TRUE(bluetooth::os::WriteToFile(temp_config_.string(), kReadTestConfig));
+
+  // A snapshot of the config file is saved along with it
+  {
+    auto* storage = new TestStorageModule(temp_config_.string(), kTestConfigSaveDelay, 10, false, false);
+    TestModuleRegistry test_registry;
+    test_registry.InjectTestModule(&StorageModule::Factory, storage);
+    test_registry.StopAll();
+  }
+  ASSERT_TRUE(std::filesystem::exists(temp_snapshot_config_));
+  auto serialized_config = bluetooth::os::ReadSmallFile(temp_config_.string());
+  ASSERT_TRUE(serialized_config);
+  auto snapshot_config = ConfigSnapshotFile::FromPath(temp_snapshot_config_.string()).Read(10, *serialized_config);
+  ASSERT_TRUE(snapshot_config);
+  ASSERT_EQ(*snapshot_config, *LegacyConfigFile::FromPath(temp_config_.string()).Read(10));
+
+  // The config file is the source of truth when it changed after the snapshot was saved
+  ASSERT_TRUE(bluetooth::os::WriteToFile(temp_config_.string(), kReadTestConfigCorrected));
+  auto config = LegacyConfigFile::FromPath(temp_config_.string()).Read(10);
+  ASSERT_TRUE(config);
+  config->SetProperty("01:02:03:ab:cd:ea", "name", "changed");
+  ASSERT_TRUE(LegacyConfigFile::FromPath(temp_config_.string()).Write(*config));
+  {
+    auto* storage = new TestStorageModule(temp_config_.string(), kTestConfigSaveDelay, 10, false, false);
+    TestModuleRegistry test_registry;
+    test_registry.InjectTestModule(&StorageModule::Factory, storage);
+    ASSERT_THAT(
+        storage->GetConfigCachePublic()->GetProperty("01:02:03:ab:cd:ea", "name"), Optional(StrEq("changed")));
+    test_registry.StopAll();
+  }
+
+  // The snapshot saved on stop is current again
+  serialized_config = bluetooth::os::ReadSmallFile(temp_config_.string());
+  ASSERT_TRUE(serialized_config);
+  snapshot_config = ConfigSnapshotFile::FromPath(temp_snapshot_config_.string()).Read(10, *serialized_config);
+  ASSERT_TRUE(snapshot_config);
+  ASSERT_THAT(snapshot_config->GetProperty("01:02:03:ab:cd:ea", "name"), Optional(StrEq("changed")));
+
+  bluetooth::os::SetSystemProperty("persist.bluetooth.config_snapshot", "false");
+}
+
 TEST_F(StorageModuleTest, get_bonded_devices_test) {
   // Prepare config file
   ASSERT_TRUE(bluetooth::os::WriteToFile(temp_config_.string(), kReadTestConfig));
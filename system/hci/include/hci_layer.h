@@ -21,6 +21,8 @@
 #include <base/callback.h>
 #include <base/location.h>
 
+#include <vector>
+
 #include "hci/include/hci_layer_legacy.h"
 #include "osi/include/future.h"
 #include "osi/include/osi.h"  // INVALID_FD
@@ -46,6 +48,14 @@ typedef struct hci_t {
 
   future_t* (*transmit_command_futured)(const BT_HDR* command);
 
+  // Send a command from its already encoded parameters, without a BT_HDR.
+  // Only for commands answered by a Command Complete event, as there is no
+  // command to hand back on Command Status.
+  void (*transmit_command_params)(command_opcode_t opcode,
+                                  std::vector<uint8_t> params,
+                                  command_complete_cb complete_callback,
+                                  void* context);
+
   // Send some data downward through the HCI layer
   void (*transmit_downward)(uint16_t type, void* data);
 } hci_t;
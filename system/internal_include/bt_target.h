@@ -728,6 +728,12 @@
 #define PORT_TX_BUF_CRITICAL_WM 15
 #endif
 
+/* The maximum number of frames taken from the port transmit queue at once when
+ * the peer grants credits. */
+#ifndef PORT_TX_BATCH_SIZE
+#define PORT_TX_BATCH_SIZE 8
+#endif
+
 /* The RFCOMM multiplexer preferred flow control mechanism. */
 #ifndef PORT_FC_DEFAULT
 #define PORT_FC_DEFAULT PORT_FC_CREDIT
@@ -22,6 +22,7 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <vector>
 
 #include "callbacks/callbacks.h"
 #include "gd/common/init_flags.h"
@@ -388,6 +389,27 @@ static void transmit_command(const BT_HDR* command,
   }
 }
 
+static void transmit_command_params(uint16_t command_op_code,
+                                    std::vector<uint8_t> params,
+                                    command_complete_cb complete_callback,
+                                    void* context) {
+  auto op_code = static_cast<const bluetooth::hci::OpCode>(command_op_code);
+  CHECK(!bluetooth::hci::Checker::IsCommandStatusOpcode(op_code));
+
+  // The parameters become the payload of the Gd command as they are
+  auto payload =
+      std::make_unique<bluetooth::packet::RawBuilder>(std::move(params));
+  auto packet =
+      bluetooth::hci::CommandBuilder::Create(op_code, std::move(payload));
+
+  LOG_DEBUG("Sending command %s", bluetooth::hci::OpCodeText(op_code).c_str());
+
+  bluetooth::shim::GetHciLayer()->EnqueueCommand(
+      std::move(packet),
+      bluetooth::shim::GetGdShimHandler()->BindOnce(
+          OnTransmitPacketCommandComplete, complete_callback, context));
+}
+
 static void transmit_fragment(const uint8_t* stream, size_t length) {
   uint16_t handle_with_flags;
   STREAM_TO_UINT16(handle_with_flags, stream);
@@ -653,6 +675,30 @@ static void transmit_command(const BT_HDR* command,
   }
 }
 
+static void transmit_command_params(uint16_t command_op_code,
+                                    std::vector<uint8_t> params,
+                                    command_complete_cb complete_callback,
+                                    void* context) {
+  auto op_code = static_cast<const bluetooth::hci::OpCode>(command_op_code);
+  CHECK(!bluetooth::hci::Checker::IsCommandStatusOpcode(op_code));
+
+  // Rust HCI layer takes the whole command, opcode and length included
+  std::vector<uint8_t> command;
+  command.reserve(kCommandOpcodeSize + kCommandLengthSize + params.size());
+  command.push_back(command_op_code & 0xff);
+  command.push_back(command_op_code >> 8);
+  command.push_back(params.size());
+  command.insert(command.end(), params.begin(), params.end());
+
+  LOG_DEBUG("Sending command %s", bluetooth::hci::OpCodeText(op_code).c_str());
+
+  bluetooth::shim::rust::hci_send_command(
+      **bluetooth::shim::Stack::Stack::GetInstance()->GetRustHci(),
+      ::rust::Slice<const uint8_t>(command.data(), command.size()),
+      std::make_unique<u8SliceOnceCallback>(BindOnce(
+          OnRustTransmitPacketCommandComplete, complete_callback, context)));
+}
+
 static void transmit_fragment(const uint8_t* stream, size_t length) {
   bluetooth::shim::rust::hci_send_acl(
       **bluetooth::shim::Stack::Stack::GetInstance()->GetRustHci(),
@@ -724,6 +770,20 @@ static void transmit_command(const BT_HDR* command,
   }
 }
 
+static void transmit_command_params(uint16_t opcode,
+                                    std::vector<uint8_t> params,
+                                    command_complete_cb complete_callback,
+                                    void* context) {
+  CHECK(params.size() <= UINT8_MAX);
+  if (bluetooth::common::init_flags::gd_rust_is_enabled()) {
+    rust::transmit_command_params(opcode, std::move(params), complete_callback,
+                                  context);
+  } else {
+    cpp::transmit_command_params(opcode, std::move(params), complete_callback,
+                                 context);
+  }
+}
+
 static void command_complete_callback(BT_HDR* response, void* context) {
   auto future = static_cast<future_t*>(context);
   future_ready(future, response);
@@ -814,6 +874,7 @@ static void transmit_downward(uint16_t type, void* raw_data) {
 static hci_t interface = {.set_data_cb = set_data_cb,
                           .transmit_command = transmit_command,
                           .transmit_command_futured = transmit_command_futured,
+                          .transmit_command_params = transmit_command_params,
                           .transmit_downward = transmit_downward};
 
 const hci_t* bluetooth::shim::hci_layer_get_interface() {
@@ -47,6 +47,13 @@ void osi_free(void* ptr);
 // |p_ptr| cannot be NULL.
 void osi_free_and_reset(void** p_ptr);
 
+// Serves the osi_*alloc functions from the pools of osi/include/buffer_pool.h
+// rather than from malloc, as the "persist.bluetooth.buffer_pools.enabled"
+// property does. Must be called before the first allocation, since the
+// buffers must be freed the way they were allocated. Returns true if the
+// pools are in use.
+bool osi_allocator_enable_pools(void);
+
 // Dump allocation-related statistics and debug info to the |fd| file
 // descriptor.
 // The information is in user-readable text format. The |fd| must be valid.
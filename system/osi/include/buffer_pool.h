@@ -0,0 +1,66 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Pools of buffers of a few fixed sizes, the ones of the BT_HDRs the stack
+// allocates the most, backing |osi_malloc| when enabled with
+// |osi_allocator_enable_pools|.
+//
+// Each thread keeps a small cache of free buffers of each size, so that most
+// allocations and frees take no lock. The caches exchange buffers in batches
+// with a shared pool per size, which keeps a bounded number of them and
+// releases the rest to the system. Allocations larger than the largest size
+// go to malloc.
+
+typedef struct {
+  // Largest allocation the buffers of this class take
+  size_t block_size;
+  // Allocations served from a pool, and from malloc
+  uint64_t hits;
+  uint64_t misses;
+  // Buffers allocated and not yet freed, and their most ever
+  uint64_t in_use;
+  uint64_t high_water;
+  // Free buffers kept in the shared pool, and the ones released beyond it
+  uint64_t pooled;
+  uint64_t released;
+} buffer_pool_stats_t;
+
+// Allocates a buffer of at least |size| bytes. Never returns NULL.
+void* buffer_pool_alloc(size_t size);
+
+// Frees |ptr|, which must come from |buffer_pool_alloc| or be NULL.
+void buffer_pool_free(void* ptr);
+
+// Number of size classes, for |buffer_pool_get_stats|.
+size_t buffer_pool_num_classes(void);
+
+// Fills |stats| with the statistics of the size class |size_class|. Returns
+// false if there is no such class.
+bool buffer_pool_get_stats(size_t size_class, buffer_pool_stats_t* stats);
+
+// Hands the free buffers cached by the calling thread back to the shared
+// pools. Called on thread exit, and useful to tests.
+void buffer_pool_flush_thread_cache(void);
+
+// Dumps the statistics of the pools to the |fd| file descriptor, in a
+// user-readable text format.
+void buffer_pool_debug_dump(int fd);
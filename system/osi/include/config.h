@@ -17,14 +17,131 @@
 // - All strings are case sensitive.
 
 #include <stdbool.h>
+#include <iterator>
 #include <list>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
 
 // The default section name to use if a key/value pair is not defined within
 // a section.
 #define CONFIG_DEFAULT_SECTION "Global"
 
+// A list of |T| in insertion order, which is the order of the file, indexed
+// by the name each element holds in its |Name| member once there are enough
+// of them for the index to pay off. The names of the elements must not be
+// changed while they are in the list. With duplicate names, |Find| returns
+// the first element of that name, as a scan of the list would.
+template <typename T, std::string T::*Name>
+class config_list_t {
+ public:
+  using iterator = typename std::list<T>::iterator;
+  using const_iterator = typename std::list<T>::const_iterator;
+
+  config_list_t() = default;
+  config_list_t(const config_list_t& other) : list_(other.list_) { Reindex(); }
+  config_list_t(config_list_t&& other) = default;
+  config_list_t& operator=(const config_list_t& other) {
+    if (this != &other) {
+      list_ = other.list_;
+      Reindex();
+    }
+    return *this;
+  }
+  config_list_t& operator=(config_list_t&& other) = default;
+
+  iterator begin() { return list_.begin(); }
+  iterator end() { return list_.end(); }
+  const_iterator begin() const { return list_.begin(); }
+  const_iterator end() const { return list_.end(); }
+  size_t size() const { return list_.size(); }
+  bool empty() const { return list_.empty(); }
+
+  iterator Find(std::string_view name) {
+    if (!indexed_) return Scan(name);
+    auto it = index_.find(name);
+    return it == index_.end() ? list_.end() : it->second;
+  }
+
+  const_iterator Find(std::string_view name) const {
+    return const_cast<config_list_t*>(this)->Find(name);
+  }
+
+  template <typename... Args>
+  T& emplace_back(Args&&... args) {
+    list_.emplace_back(std::forward<Args>(args)...);
+    if (indexed_) {
+      Index(std::prev(list_.end()));
+    } else if (list_.size() > kIndexThreshold) {
+      Reindex();
+    }
+    return list_.back();
+  }
+
+  iterator erase(const_iterator pos) {
+    if (indexed_) Unindex(pos);
+    return list_.erase(pos);
+  }
+
+  void clear() {
+    list_.clear();
+    index_.clear();
+    duplicates_ = 0;
+    indexed_ = false;
+  }
+
+ private:
+  // Lists this short are faster to scan than to hash into
+  static constexpr size_t kIndexThreshold = 8;
+
+  iterator Scan(std::string_view name) {
+    for (auto it = list_.begin(); it != list_.end(); ++it) {
+      if ((*it).*Name == name) return it;
+    }
+    return list_.end();
+  }
+
+  void Index(iterator it) {
+    if (!index_.emplace((*it).*Name, it).second) duplicates_++;
+  }
+
+  void Unindex(const_iterator pos) {
+    const std::string& name = (*pos).*Name;
+    auto indexed = index_.find(name);
+    if (indexed->second != pos) {
+      duplicates_--;
+      return;
+    }
+    index_.erase(indexed);
+    if (duplicates_ == 0) return;
+    // The next element of that name takes its place
+    for (auto it = list_.begin(); it != list_.end(); ++it) {
+      if (it != pos && (*it).*Name == name) {
+        index_.emplace((*it).*Name, it);
+        duplicates_--;
+        return;
+      }
+    }
+  }
+
+  void Reindex() {
+    index_.clear();
+    duplicates_ = 0;
+    indexed_ = list_.size() > kIndexThreshold;
+    if (!indexed_) return;
+    index_.reserve(list_.size());
+    for (auto it = list_.begin(); it != list_.end(); ++it) Index(it);
+  }
+
+  std::list<T> list_;
+  // Keyed by views of the names held by the elements of |list_|
+  std::unordered_map<std::string_view, iterator> index_;
+  size_t duplicates_ = 0;
+  bool indexed_ = false;
+};
+
 struct entry_t {
   std::string key;
   std::string value;
@@ -32,14 +149,14 @@ struct entry_t {
 
 struct section_t {
   std::string name;
-  std::list<entry_t> entries;
+  config_list_t<entry_t, &entry_t::key> entries;
   void Set(std::string key, std::string value);
   std::list<entry_t>::iterator Find(const std::string& key);
   bool Has(const std::string& key);
 };
 
 struct config_t {
-  std::list<section_t> sections;
+  config_list_t<section_t, &section_t::name> sections;
   std::list<section_t>::iterator Find(const std::string& section);
   bool Has(const std::string& section);
 };
@@ -98,11 +98,15 @@ void* fixed_queue_try_peek_last(fixed_queue_t* queue);
 // otherwise NULL.
 void* fixed_queue_try_remove_from_queue(fixed_queue_t* queue, void* data);
 
-// Returns the iterateable list with all entries in the |queue|. This function
-// will never block the caller. |queue| may not be NULL.
+// Returns an iterateable list with all entries in the |queue|, in queue order.
+// This function will never block the caller. |queue| may not be NULL.
 //
-// NOTE: The return result of this function is not thread safe: the list could
-// be modified by another thread, and the result would be unpredictable.
+// NOTE: The list is a snapshot of the |queue| at the time of the call, owned
+// by the queue and rebuilt on every call. Changing the list does not change
+// the queue, and the queue changing afterwards does not change the list. The
+// list stays valid only until the next call to this function on the same
+// |queue|, so it must not be called again on that queue while iterating over
+// the list. The caller must not free the list.
 // TODO: The usage of this function should be refactored, and the function
 // itself should be removed.
 list_t* fixed_queue_get_list(fixed_queue_t* queue);
@@ -60,3 +60,63 @@ size_t ringbuffer_pop(ringbuffer_t* rb, uint8_t* p, size_t length);
 // Deletes |length| bytes from the ringbuffer starting from the head
 // Return actual number of bytes deleted.
 size_t ringbuffer_delete(ringbuffer_t* rb, size_t length);
+
+// A ringbuffer for a single producer thread and a single consumer thread,
+// which insert and pop at the same time without locking.
+//
+// Rather than copying the data in and out, the producer reserves space and
+// writes or encodes into it, and commits what it wrote. The consumer peeks at
+// the data, reads or sends it from where it is, and consumes what it used.
+// Reserved space and peeked data are handed out as a span of up to two
+// contiguous pieces, split where the buffer wraps around.
+typedef struct spsc_ringbuffer_t spsc_ringbuffer_t;
+
+typedef struct {
+  // The second piece, if any, starts at the beginning of the buffer
+  uint8_t* data[2];
+  size_t length[2];
+} ringbuffer_span_t;
+
+// Create a single producer, single consumer ringbuffer of |size| bytes.
+// Resulting pointer must be freed using |spsc_ringbuffer_free|.
+spsc_ringbuffer_t* spsc_ringbuffer_init(const size_t size);
+
+// Frees the ringbuffer structure and buffer, once neither thread uses it.
+// Safe to call with NULL.
+void spsc_ringbuffer_free(spsc_ringbuffer_t* rb);
+
+// Returns remaining buffer size. Exact on the producer thread, which is the
+// only one making it smaller.
+size_t spsc_ringbuffer_available(const spsc_ringbuffer_t* rb);
+
+// Returns size of data in buffer. Exact on the consumer thread, which is the
+// only one making it smaller.
+size_t spsc_ringbuffer_size(const spsc_ringbuffer_t* rb);
+
+// Producer: reserves up to |length| bytes of space, described by |span|, and
+// returns how many. Can be less than |length| if the buffer is full. The data
+// written there is not seen by the consumer until committed.
+size_t spsc_ringbuffer_reserve(spsc_ringbuffer_t* rb, size_t length,
+                               ringbuffer_span_t* span);
+
+// Producer: commits the first |length| bytes of the last reserved space.
+void spsc_ringbuffer_commit(spsc_ringbuffer_t* rb, size_t length);
+
+// Producer: copies up to |length| bytes of data at |p| into the buffer, and
+// returns how many. Can be less than |length| if the buffer is full.
+size_t spsc_ringbuffer_insert(spsc_ringbuffer_t* rb, const uint8_t* p,
+                              size_t length);
+
+// Consumer: describes up to |length| bytes of data from the head of the buffer
+// in |span|, and returns how many. Can be less than |length| if there is less
+// data. The data stays in the buffer until consumed.
+size_t spsc_ringbuffer_peek(spsc_ringbuffer_t* rb, size_t length,
+                            ringbuffer_span_t* span);
+
+// Consumer: removes |length| bytes of the last peeked data from the buffer,
+// whose space the producer may then reuse.
+void spsc_ringbuffer_consume(spsc_ringbuffer_t* rb, size_t length);
+
+// Consumer: copies up to |length| bytes of data from the head of the buffer
+// into |p| and removes them, and returns how many.
+size_t spsc_ringbuffer_pop(spsc_ringbuffer_t* rb, uint8_t* p, size_t length);
@@ -19,17 +19,60 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <atomic>
+
 #include "check.h"
 #include "osi/include/allocation_tracker.h"
 #include "osi/include/allocator.h"
+#include "osi/include/buffer_pool.h"
+#include "osi/include/properties.h"
 
 static const allocator_id_t alloc_allocator_id = 42;
 
+static const char* POOLS_ENABLED_PROPERTY =
+    "persist.bluetooth.buffer_pools.enabled";
+
+// Whether the buffers come from the pools, settled by the first allocation
+// since a buffer must be freed the way it was allocated
+enum pools_state_t { POOLS_UNSET, POOLS_DISABLED, POOLS_ENABLED };
+static std::atomic<pools_state_t> pools_state(POOLS_UNSET);
+
+static bool latch_pools_state(pools_state_t wanted) {
+  pools_state_t state = POOLS_UNSET;
+  pools_state.compare_exchange_strong(state, wanted);
+  return pools_state.load(std::memory_order_relaxed) == POOLS_ENABLED;
+}
+
+static bool pools_enabled() {
+  pools_state_t state = pools_state.load(std::memory_order_relaxed);
+  if (state != POOLS_UNSET) return state == POOLS_ENABLED;
+  return latch_pools_state(
+      osi_property_get_bool(POOLS_ENABLED_PROPERTY, false) ? POOLS_ENABLED
+                                                           : POOLS_DISABLED);
+}
+
+static void* raw_alloc(size_t size) {
+  void* ptr = pools_enabled() ? buffer_pool_alloc(size) : malloc(size);
+  CHECK(ptr);
+  return ptr;
+}
+
+static void raw_free(void* ptr) {
+  if (pools_enabled()) {
+    buffer_pool_free(ptr);
+  } else {
+    free(ptr);
+  }
+}
+
+bool osi_allocator_enable_pools(void) {
+  return latch_pools_state(POOLS_ENABLED);
+}
+
 char* osi_strdup(const char* str) {
   size_t size = strlen(str) + 1;  // + 1 for the null terminator
   size_t real_size = allocation_tracker_resize_for_canary(size);
-  void* ptr = malloc(real_size);
-  CHECK(ptr);
+  void* ptr = raw_alloc(real_size);
 
   char* new_string = static_cast<char*>(
       allocation_tracker_notify_alloc(alloc_allocator_id, ptr, size));
@@ -44,8 +87,7 @@ char* osi_strndup(const char* str, size_t len) {
   if (len < size) size = len;
 
   size_t real_size = allocation_tracker_resize_for_canary(size + 1);
-  void* ptr = malloc(real_size);
-  CHECK(ptr);
+  void* ptr = raw_alloc(real_size);
 
   char* new_string = static_cast<char*>(
       allocation_tracker_notify_alloc(alloc_allocator_id, ptr, size + 1));
@@ -59,21 +101,27 @@ char* osi_strndup(const char* str, size_t len) {
 void* osi_malloc(size_t size) {
   CHECK(static_cast<ssize_t>(size) >= 0);
   size_t real_size = allocation_tracker_resize_for_canary(size);
-  void* ptr = malloc(real_size);
-  CHECK(ptr);
+  void* ptr = raw_alloc(real_size);
   return allocation_tracker_notify_alloc(alloc_allocator_id, ptr, size);
 }
 
 void* osi_calloc(size_t size) {
   CHECK(static_cast<ssize_t>(size) >= 0);
   size_t real_size = allocation_tracker_resize_for_canary(size);
-  void* ptr = calloc(1, real_size);
-  CHECK(ptr);
+  void* ptr;
+  if (pools_enabled()) {
+    // Pooled buffers come back with whatever their last user left in them
+    ptr = buffer_pool_alloc(real_size);
+    memset(ptr, 0, real_size);
+  } else {
+    ptr = calloc(1, real_size);
+    CHECK(ptr);
+  }
   return allocation_tracker_notify_alloc(alloc_allocator_id, ptr, size);
 }
 
 void osi_free(void* ptr) {
-  free(allocation_tracker_notify_free(alloc_allocator_id, ptr));
+  raw_free(allocation_tracker_notify_free(alloc_allocator_id, ptr));
 }
 
 void osi_free_and_reset(void** p_ptr) {
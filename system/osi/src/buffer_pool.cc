@@ -0,0 +1,288 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "bt_osi_buffer_pool"
+
+#include "osi/include/buffer_pool.h"
+
+#include <base/logging.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+#include "check.h"
+
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define BUFFER_POOL_ASAN 1
+#endif
+#elif defined(__SANITIZE_ADDRESS__)
+#define BUFFER_POOL_ASAN 1
+#endif
+
+#if defined(BUFFER_POOL_ASAN)
+#include <sanitizer/asan_interface.h>
+// A pooled buffer is off limits until allocated again, as a freed one is
+#define POISON(ptr, size) ASAN_POISON_MEMORY_REGION(ptr, size)
+#define UNPOISON(ptr, size) ASAN_UNPOISON_MEMORY_REGION(ptr, size)
+#else
+#define POISON(ptr, size)
+#define UNPOISON(ptr, size)
+#endif
+
+namespace {
+
+// Sizes of the buffers, each with room for the canaries of the allocation
+// tracker on top of the size the stack asks for.
+const size_t kBlockSizes[] = {
+    // Control blocks, timer and callback contexts
+    64,
+    // HCI events: a BT_HDR, the event header and up to 255 parameter bytes
+    288,
+    // BT_SMALL_BUFFER_SIZE: HCI commands and L2CAP signalling
+    688,
+    // ACL packets of the common controller buffer size of 1021 bytes
+    1056,
+    // L2CAP_MTU_SIZE: L2CAP SDUs and their reassembly
+    1728,
+    // BT_DEFAULT_BUFFER_SIZE: AVDTP media, RFCOMM and GATT buffers
+    4144,
+};
+constexpr size_t kNumClasses = sizeof(kBlockSizes) / sizeof(kBlockSizes[0]);
+
+// Free buffers a thread keeps of each size, and how many go to or come from
+// the shared pool at once
+constexpr size_t kThreadCacheBlocks = 32;
+constexpr size_t kTransferBlocks = 16;
+// Memory the shared pool of each size keeps in free buffers
+constexpr size_t kPooledBytes = 512 * 1024;
+
+constexpr uint32_t kMagic = 0x4f534950;  // "OSIP"
+constexpr uint32_t kNoClass = UINT32_MAX;
+
+// Precedes every buffer, keeping it aligned as malloc would
+struct alignas(16) BlockHeader {
+  uint32_t magic;
+  uint32_t size_class;
+  // Next free buffer while pooled
+  BlockHeader* next;
+};
+static_assert(sizeof(BlockHeader) == 16, "BlockHeader must keep alignment");
+
+struct SharedPool {
+  std::mutex mutex;
+  BlockHeader* free_list = nullptr;
+  size_t count = 0;
+
+  std::atomic<uint64_t> hits{0};
+  std::atomic<uint64_t> misses{0};
+  std::atomic<uint64_t> in_use{0};
+  std::atomic<uint64_t> high_water{0};
+  std::atomic<uint64_t> released{0};
+};
+
+SharedPool pools[kNumClasses];
+
+struct ThreadCache {
+  BlockHeader* blocks[kNumClasses][kThreadCacheBlocks];
+  size_t count[kNumClasses] = {};
+  bool alive = true;
+
+  ~ThreadCache() {
+    buffer_pool_flush_thread_cache();
+    alive = false;
+  }
+};
+
+thread_local ThreadCache thread_cache;
+
+uint32_t class_for(size_t size) {
+  for (uint32_t i = 0; i < kNumClasses; i++) {
+    if (size <= kBlockSizes[i]) return i;
+  }
+  return kNoClass;
+}
+
+void* to_user(BlockHeader* header) { return header + 1; }
+
+BlockHeader* from_user(void* ptr) {
+  BlockHeader* header = static_cast<BlockHeader*>(ptr) - 1;
+  CHECK(header->magic == kMagic);
+  return header;
+}
+
+// Moves up to |count| buffers from |pool| to |cache|.
+void take_from_pool(SharedPool& pool, BlockHeader** cache, size_t* cached,
+                    size_t count) {
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  for (; count > 0 && pool.free_list != nullptr; count--) {
+    BlockHeader* header = pool.free_list;
+    pool.free_list = header->next;
+    pool.count--;
+    cache[(*cached)++] = header;
+  }
+}
+
+// Moves |count| buffers from the end of |cache| to |pool|, and releases the
+// ones that do not fit in it.
+void give_to_pool(SharedPool& pool, size_t size_class, BlockHeader** cache,
+                  size_t* cached, size_t count) {
+  const size_t max_pooled =
+      std::max(kPooledBytes / kBlockSizes[size_class], kTransferBlocks);
+  size_t released = 0;
+  {
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    for (; count > 0; count--) {
+      BlockHeader* header = cache[--(*cached)];
+      if (pool.count < max_pooled) {
+        header->next = pool.free_list;
+        pool.free_list = header;
+        pool.count++;
+      } else {
+        free(header);
+        released++;
+      }
+    }
+  }
+  if (released > 0) pool.released += released;
+}
+
+void update_high_water(SharedPool& pool, uint64_t in_use) {
+  uint64_t high_water = pool.high_water.load(std::memory_order_relaxed);
+  while (in_use > high_water &&
+         !pool.high_water.compare_exchange_weak(high_water, in_use,
+                                                std::memory_order_relaxed)) {
+  }
+}
+
+}  // namespace
+
+void* buffer_pool_alloc(size_t size) {
+  uint32_t size_class = class_for(size);
+  if (size_class == kNoClass) {
+    BlockHeader* header =
+        static_cast<BlockHeader*>(malloc(sizeof(BlockHeader) + size));
+    CHECK(header);
+    header->magic = kMagic;
+    header->size_class = kNoClass;
+    return to_user(header);
+  }
+
+  SharedPool& pool = pools[size_class];
+  ThreadCache& cache = thread_cache;
+  BlockHeader* header = nullptr;
+  if (cache.alive) {
+    size_t* cached = &cache.count[size_class];
+    if (*cached == 0) {
+      take_from_pool(pool, cache.blocks[size_class], cached, kTransferBlocks);
+    }
+    if (*cached > 0) header = cache.blocks[size_class][--(*cached)];
+  } else {
+    // The thread is exiting, the shared pool serves it directly
+    size_t cached = 0;
+    take_from_pool(pool, &header, &cached, 1);
+  }
+
+  if (header != nullptr) {
+    pool.hits.fetch_add(1, std::memory_order_relaxed);
+    UNPOISON(to_user(header), kBlockSizes[size_class]);
+  } else {
+    pool.misses.fetch_add(1, std::memory_order_relaxed);
+    header = static_cast<BlockHeader*>(
+        malloc(sizeof(BlockHeader) + kBlockSizes[size_class]));
+    CHECK(header);
+    header->magic = kMagic;
+    header->size_class = size_class;
+  }
+  update_high_water(pool,
+                    pool.in_use.fetch_add(1, std::memory_order_relaxed) + 1);
+  return to_user(header);
+}
+
+void buffer_pool_free(void* ptr) {
+  if (ptr == nullptr) return;
+
+  BlockHeader* header = from_user(ptr);
+  uint32_t size_class = header->size_class;
+  if (size_class == kNoClass) {
+    free(header);
+    return;
+  }
+  CHECK(size_class < kNumClasses);
+
+  SharedPool& pool = pools[size_class];
+  pool.in_use.fetch_sub(1, std::memory_order_relaxed);
+  POISON(ptr, kBlockSizes[size_class]);
+
+  ThreadCache& cache = thread_cache;
+  if (cache.alive) {
+    size_t* cached = &cache.count[size_class];
+    if (*cached == kThreadCacheBlocks) {
+      give_to_pool(pool, size_class, cache.blocks[size_class], cached,
+                   kTransferBlocks);
+    }
+    cache.blocks[size_class][(*cached)++] = header;
+  } else {
+    size_t cached = 1;
+    give_to_pool(pool, size_class, &header, &cached, 1);
+  }
+}
+
+size_t buffer_pool_num_classes(void) { return kNumClasses; }
+
+bool buffer_pool_get_stats(size_t size_class, buffer_pool_stats_t* stats) {
+  CHECK(stats != NULL);
+  if (size_class >= kNumClasses) return false;
+
+  SharedPool& pool = pools[size_class];
+  stats->block_size = kBlockSizes[size_class];
+  stats->hits = pool.hits.load();
+  stats->misses = pool.misses.load();
+  stats->in_use = pool.in_use.load();
+  stats->high_water = pool.high_water.load();
+  stats->released = pool.released.load();
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  stats->pooled = pool.count;
+  return true;
+}
+
+void buffer_pool_flush_thread_cache(void) {
+  ThreadCache& cache = thread_cache;
+  if (!cache.alive) return;
+  for (size_t i = 0; i < kNumClasses; i++) {
+    give_to_pool(pools[i], i, cache.blocks[i], &cache.count[i],
+                 cache.count[i]);
+  }
+}
+
+void buffer_pool_debug_dump(int fd) {
+  dprintf(fd, "  Buffer pools:\n");
+  dprintf(fd, "    %10s %12s %12s %10s %10s %10s %10s\n", "Block size",
+          "Hits", "Misses", "In use", "High water", "Pooled", "Released");
+  for (size_t i = 0; i < kNumClasses; i++) {
+    buffer_pool_stats_t stats;
+    buffer_pool_get_stats(i, &stats);
+    dprintf(fd,
+            "    %10zu %12" PRIu64 " %12" PRIu64 " %10" PRIu64 " %10" PRIu64
+            " %10" PRIu64 " %10" PRIu64 "\n",
+            stats.block_size, stats.hits, stats.misses, stats.in_use,
+            stats.high_water, stats.pooled, stats.released);
+  }
+}
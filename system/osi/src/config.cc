@@ -28,20 +28,17 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
-#include <sstream>
-#include <type_traits>
-
 #include "check.h"
 
 void section_t::Set(std::string key, std::string value) {
-  for (entry_t& entry : entries) {
-    if (entry.key == key) {
-      entry.value = value;
-      return;
-    }
+  auto entry = entries.Find(key);
+  if (entry != entries.end()) {
+    entry->value = std::move(value);
+    return;
   }
   // add a new key to the section
   entries.emplace_back(
@@ -49,9 +46,7 @@ void section_t::Set(std::string key, std::string value) {
 }
 
 std::list<entry_t>::iterator section_t::Find(const std::string& key) {
-  return std::find_if(
-      entries.begin(), entries.end(),
-      [&key](const entry_t& entry) { return entry.key == key; });
+  return entries.Find(key);
 }
 
 bool section_t::Has(const std::string& key) {
@@ -59,37 +54,25 @@ bool section_t::Has(const std::string& key) {
 }
 
 std::list<section_t>::iterator config_t::Find(const std::string& section) {
-  return std::find_if(
-      sections.begin(), sections.end(),
-      [&section](const section_t& sec) { return sec.name == section; });
+  return sections.Find(section);
 }
 
 bool config_t::Has(const std::string& key) {
   return Find(key) != sections.end();
 }
 
-static bool config_parse(FILE* fp, config_t* config);
-
-template <typename T,
-          class = typename std::enable_if<std::is_same<
-              config_t, typename std::remove_const<T>::type>::value>>
-static auto section_find(T& config, const std::string& section) {
-  return std::find_if(
-      config.sections.begin(), config.sections.end(),
-      [&section](const section_t& sec) { return sec.name == section; });
-}
+static bool config_parse(const char* data, size_t size, config_t* config);
 
 static const entry_t* entry_find(const config_t& config,
                                  const std::string& section,
                                  const std::string& key) {
-  auto sec = section_find(config, section);
+  auto sec = config.sections.Find(section);
   if (sec == config.sections.end()) return nullptr;
 
-  for (const entry_t& entry : sec->entries) {
-    if (entry.key == key) return &entry;
-  }
+  auto entry = sec->entries.Find(key);
+  if (entry == sec->entries.end()) return nullptr;
 
-  return nullptr;
+  return &*entry;
 }
 
 std::unique_ptr<config_t> config_new_empty(void) {
@@ -101,18 +84,40 @@ std::unique_ptr<config_t> config_new(const char* filename) {
 
   std::unique_ptr<config_t> config = config_new_empty();
 
-  FILE* fp = fopen(filename, "rt");
-  if (!fp) {
+  int fd = open(filename, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
     LOG(ERROR) << __func__ << ": unable to open file '" << filename
                << "': " << strerror(errno);
     return nullptr;
   }
 
-  if (!config_parse(fp, config.get())) {
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    LOG(ERROR) << __func__ << ": unable to stat file '" << filename
+               << "': " << strerror(errno);
+    close(fd);
+    return nullptr;
+  }
+
+  // The file is parsed in place, in a single pass over its mapping
+  size_t size = st.st_size;
+  void* data = nullptr;
+  if (size > 0) {
+    data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      LOG(ERROR) << __func__ << ": unable to map file '" << filename
+                 << "': " << strerror(errno);
+      close(fd);
+      return nullptr;
+    }
+  }
+  close(fd);
+
+  if (!config_parse(static_cast<const char*>(data), size, config.get())) {
     config.reset();
   }
 
-  fclose(fp);
+  if (data != nullptr) munmap(data, size);
   return config;
 }
 
@@ -142,7 +147,7 @@ std::unique_ptr<config_t> config_new_clone(const config_t& src) {
 }
 
 bool config_has_section(const config_t& config, const std::string& section) {
-  return (section_find(config, section) != config.sections.end());
+  return (config.sections.Find(section) != config.sections.end());
 }
 
 bool config_has_key(const config_t& config, const std::string& section,
@@ -210,7 +215,7 @@ void config_set_string(config_t* config, const std::string& section,
                        const std::string& key, const std::string& value) {
   CHECK(config);
 
-  auto sec = section_find(*config, section);
+  auto sec = config->sections.Find(section);
   if (sec == config->sections.end()) {
     config->sections.emplace_back(section_t{.name = section});
     sec = std::prev(config->sections.end());
@@ -224,20 +229,20 @@ void config_set_string(config_t* config, const std::string& section,
     value_no_newline = value;
   }
 
-  for (entry_t& entry : sec->entries) {
-    if (entry.key == key) {
-      entry.value = value_no_newline;
-      return;
-    }
+  auto entry = sec->entries.Find(key);
+  if (entry != sec->entries.end()) {
+    entry->value = std::move(value_no_newline);
+    return;
   }
 
-  sec->entries.emplace_back(entry_t{.key = key, .value = value_no_newline});
+  sec->entries.emplace_back(
+      entry_t{.key = key, .value = std::move(value_no_newline)});
 }
 
 bool config_remove_section(config_t* config, const std::string& section) {
   CHECK(config);
 
-  auto sec = section_find(*config, section);
+  auto sec = config->sections.Find(section);
   if (sec == config->sections.end()) return false;
 
   config->sections.erase(sec);
@@ -247,18 +252,14 @@ bool config_remove_section(config_t* config, const std::string& section) {
 bool config_remove_key(config_t* config, const std::string& section,
                        const std::string& key) {
   CHECK(config);
-  auto sec = section_find(*config, section);
+  auto sec = config->sections.Find(section);
   if (sec == config->sections.end()) return false;
 
-  for (auto entry = sec->entries.begin(); entry != sec->entries.end();
-       ++entry) {
-    if (entry->key == key) {
-      sec->entries.erase(entry);
-      return true;
-    }
-  }
+  auto entry = sec->entries.Find(key);
+  if (entry == sec->entries.end()) return false;
 
-  return false;
+  sec->entries.erase(entry);
+  return true;
 }
 
 bool config_save(const config_t& config, const std::string& filename) {
@@ -275,7 +276,7 @@ bool config_save(const config_t& config, const std::string& filename) {
   //    This ensures directory entries are up-to-date.
   int dir_fd = -1;
   FILE* fp = nullptr;
-  std::stringstream serialized;
+  std::string serialized;
 
   // Build temp config file based on config file (e.g. bt_config.conf.new).
   const std::string temp_filename = filename + ".new";
@@ -302,16 +303,20 @@ bool config_save(const config_t& config, const std::string& filename) {
     goto error;
   }
 
+  // Serialized in one buffer, written at once
   for (const section_t& section : config.sections) {
-    serialized << "[" << section.name << "]" << std::endl;
+    serialized.append("[").append(section.name).append("]\n");
 
-    for (const entry_t& entry : section.entries)
-      serialized << entry.key << " = " << entry.value << std::endl;
+    for (const entry_t& entry : section.entries) {
+      serialized.append(entry.key).append(" = ").append(entry.value);
+      serialized.append("\n");
+    }
 
-    serialized << std::endl;
+    serialized.append("\n");
   }
 
-  if (fprintf(fp, "%s", serialized.str().c_str()) < 0) {
+  if (fwrite(serialized.data(), 1, serialized.size(), fp) !=
+      serialized.size()) {
     LOG(ERROR) << __func__ << ": unable to write to file '" << temp_filename
                << "': " << strerror(errno);
     goto error;
@@ -477,53 +482,74 @@ error2:
   return false;
 }
 
-static char* trim(char* str) {
-  while (isspace(*str)) ++str;
+static bool is_space(char c) { return isspace(static_cast<unsigned char>(c)); }
 
-  if (!*str) return str;
-
-  char* end_str = str + strlen(str) - 1;
-  while (end_str > str && isspace(*end_str)) --end_str;
-
-  end_str[1] = '\0';
+static std::string_view trim(std::string_view str) {
+  while (!str.empty() && is_space(str.front())) str.remove_prefix(1);
+  while (!str.empty() && is_space(str.back())) str.remove_suffix(1);
   return str;
 }
 
-static bool config_parse(FILE* fp, config_t* config) {
-  CHECK(fp != nullptr);
+static bool config_parse(const char* data, size_t size, config_t* config) {
+  CHECK(data != nullptr || size == 0);
   CHECK(config != nullptr);
 
   int line_num = 0;
-  char line[4096];
-  char section[4096];
-  strcpy(section, CONFIG_DEFAULT_SECTION);
-
-  while (fgets(line, sizeof(line), fp)) {
-    char* line_ptr = trim(line);
+  std::string_view section = CONFIG_DEFAULT_SECTION;
+  // Where the keys of |section| go, resolved at its first key since empty
+  // sections are not kept
+  section_t* current = nullptr;
+
+  std::string_view remaining(data, size);
+  while (!remaining.empty()) {
+    size_t line_end = remaining.find('\n');
+    std::string_view line = remaining.substr(0, line_end);
+    remaining.remove_prefix(line_end == std::string_view::npos
+                                ? remaining.size()
+                                : line_end + 1);
+    // Lines end at a NUL too, as they did when read as C strings
+    line = trim(line.substr(0, line.find('\0')));
     ++line_num;
 
     // Skip blank and comment lines.
-    if (*line_ptr == '\0' || *line_ptr == '#') continue;
+    if (line.empty() || line.front() == '#') continue;
 
-    if (*line_ptr == '[') {
-      size_t len = strlen(line_ptr);
-      if (line_ptr[len - 1] != ']') {
+    if (line.front() == '[') {
+      if (line.back() != ']') {
         VLOG(1) << __func__ << ": unterminated section name on line "
                 << line_num;
         return false;
       }
-      strncpy(section, line_ptr + 1, len - 2);  // NOLINT (len < 4096)
-      section[len - 2] = '\0';
+      section = line.substr(1, line.size() - 2);
+      current = nullptr;
     } else {
-      char* split = strchr(line_ptr, '=');
-      if (!split) {
+      size_t split = line.find('=');
+      if (split == std::string_view::npos) {
         VLOG(1) << __func__ << ": no key/value separator found on line "
                 << line_num;
         return false;
       }
 
-      *split = '\0';
-      config_set_string(config, section, trim(line_ptr), trim(split + 1));
+      if (current == nullptr) {
+        auto sec = config->sections.Find(section);
+        if (sec == config->sections.end()) {
+          current = &config->sections.emplace_back(
+              section_t{.name = std::string(section)});
+        } else {
+          current = &*sec;
+        }
+      }
+
+      // Views into the mapping until stored, which copies them only once
+      std::string_view key = trim(line.substr(0, split));
+      std::string_view value = trim(line.substr(split + 1));
+      auto entry = current->entries.Find(key);
+      if (entry != current->entries.end()) {
+        entry->value.assign(value);
+      } else {
+        current->entries.emplace_back(
+            entry_t{.key = std::string(key), .value = std::string(value)});
+      }
     }
   }
   return true;
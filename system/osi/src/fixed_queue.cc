@@ -16,26 +16,60 @@
  *
  ******************************************************************************/
 
+#define LOG_TAG "bt_osi_fixed_queue"
+
 #include <base/logging.h>
+#include <errno.h>
+#include <linux/futex.h>
 #include <string.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
+#include <atomic>
+#include <climits>
 #include <mutex>
 
 #include "check.h"
 #include "osi/include/allocator.h"
 #include "osi/include/fixed_queue.h"
 #include "osi/include/list.h"
+#include "osi/include/log.h"
 #include "osi/include/osi.h"
 #include "osi/include/reactor.h"
-#include "osi/include/semaphore.h"
 
+// Slots allocated for a queue to start with, doubled whenever it fills up
+// and short of its capacity
+static const size_t INITIAL_RING_SIZE = 16;
+
+// The elements are kept in a ring of slots, guarded by a mutex which only
+// ever goes to the kernel under contention. The number of elements is also
+// kept in an atomic, which lets the length be read without the lock and is
+// the futex word the callers blocked on an empty or full queue sleep on.
+//
+// The file descriptors are only created for the callers asking for them, the
+// reactor in the first place. Rather than counting the elements as a
+// semaphore would, they are readable for as long as the queue is not empty,
+// or not full, and are only written to or drained when the queue goes from
+// one state to the other.
 typedef struct fixed_queue_t {
-  list_t* list;
-  semaphore_t* enqueue_sem;
-  semaphore_t* dequeue_sem;
-  std::mutex* mutex;
+  mutable std::mutex mutex;
+  void** ring;
+  size_t ring_size;  // a power of two
+  size_t head;
+  std::atomic<uint32_t> count;
   size_t capacity;
 
+  std::atomic<uint32_t> enqueue_waiters;
+  std::atomic<uint32_t> dequeue_waiters;
+
+  // Readable while the queue is not full, and not empty
+  mutable int enqueue_fd;
+  mutable int dequeue_fd;
+
+  // Copy of the elements handed out by fixed_queue_get_list
+  list_t* list;
+
   reactor_object_t* dequeue_object;
   fixed_queue_cb dequeue_ready;
   void* dequeue_context;
@@ -43,27 +77,77 @@ typedef struct fixed_queue_t {
 
 static void internal_dequeue_ready(void* context);
 
-fixed_queue_t* fixed_queue_new(size_t capacity) {
-  fixed_queue_t* ret =
-      static_cast<fixed_queue_t*>(osi_calloc(sizeof(fixed_queue_t)));
+static void futex_wait(std::atomic<uint32_t>* word, uint32_t expected) {
+  syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
 
-  ret->mutex = new std::mutex;
-  ret->capacity = capacity;
+static void futex_wake(std::atomic<uint32_t>* word) {
+  syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
 
-  ret->list = list_new(NULL);
-  if (!ret->list) goto error;
+static void fd_signal(int fd) {
+  if (fd != INVALID_FD && eventfd_write(fd, 1) == -1)
+    LOG_ERROR("%s unable to signal queue fd: %s", __func__, strerror(errno));
+}
 
-  ret->enqueue_sem = semaphore_new(capacity);
-  if (!ret->enqueue_sem) goto error;
+static void fd_drain(int fd) {
+  eventfd_t value;
+  if (fd != INVALID_FD && eventfd_read(fd, &value) == -1)
+    LOG_ERROR("%s unable to drain queue fd: %s", __func__, strerror(errno));
+}
 
-  ret->dequeue_sem = semaphore_new(0);
-  if (!ret->dequeue_sem) goto error;
+static size_t slot(const fixed_queue_t* queue, size_t i) {
+  return (queue->head + i) & (queue->ring_size - 1);
+}
 
-  return ret;
+static bool is_full(const fixed_queue_t* queue, size_t count) {
+  return count >= queue->capacity;
+}
 
-error:
-  fixed_queue_free(ret, NULL);
-  return NULL;
+// Must be called with the lock held, and the ring full.
+static bool grow_ring(fixed_queue_t* queue) {
+  size_t count = queue->ring_size;
+  if (count > UINT32_MAX / 2) return false;
+
+  size_t ring_size = queue->ring_size * 2;
+  void** ring = static_cast<void**>(osi_malloc(ring_size * sizeof(void*)));
+  for (size_t i = 0; i < count; i++) ring[i] = queue->ring[slot(queue, i)];
+  osi_free(queue->ring);
+  queue->ring = ring;
+  queue->ring_size = ring_size;
+  queue->head = 0;
+  return true;
+}
+
+// Updates the fds and wakes up the callers blocked on |queue| after its
+// length went from |old_count| to |new_count|. Must be called with the lock
+// held, for the fds to follow the changes in order.
+static void notify_locked(fixed_queue_t* queue, size_t old_count,
+                          size_t new_count) {
+  if (old_count == 0 && new_count > 0) fd_signal(queue->dequeue_fd);
+  if (old_count > 0 && new_count == 0) fd_drain(queue->dequeue_fd);
+  if (!is_full(queue, old_count) && is_full(queue, new_count))
+    fd_drain(queue->enqueue_fd);
+  if (is_full(queue, old_count) && !is_full(queue, new_count))
+    fd_signal(queue->enqueue_fd);
+}
+
+static void wake_waiters(fixed_queue_t* queue,
+                         std::atomic<uint32_t>* waiters) {
+  if (waiters->load() > 0) futex_wake(&queue->count);
+}
+
+fixed_queue_t* fixed_queue_new(size_t capacity) {
+  fixed_queue_t* ret = new fixed_queue_t();
+
+  ret->capacity = capacity;
+  ret->ring_size = INITIAL_RING_SIZE;
+  ret->ring =
+      static_cast<void**>(osi_malloc(ret->ring_size * sizeof(void*)));
+  ret->enqueue_fd = INVALID_FD;
+  ret->dequeue_fd = INVALID_FD;
+
+  return ret;
 }
 
 void fixed_queue_free(fixed_queue_t* queue, fixed_queue_free_cb free_cb) {
@@ -71,16 +155,16 @@ void fixed_queue_free(fixed_queue_t* queue, fixed_queue_free_cb free_cb) {
 
   fixed_queue_unregister_dequeue(queue);
 
-  if (free_cb)
-    for (const list_node_t* node = list_begin(queue->list);
-         node != list_end(queue->list); node = list_next(node))
-      free_cb(list_node(node));
+  if (free_cb) {
+    size_t count = queue->count.load();
+    for (size_t i = 0; i < count; i++) free_cb(queue->ring[slot(queue, i)]);
+  }
 
+  if (queue->enqueue_fd != INVALID_FD) close(queue->enqueue_fd);
+  if (queue->dequeue_fd != INVALID_FD) close(queue->dequeue_fd);
   list_free(queue->list);
-  semaphore_free(queue->enqueue_sem);
-  semaphore_free(queue->dequeue_sem);
-  delete queue->mutex;
-  osi_free(queue);
+  osi_free(queue->ring);
+  delete queue;
 }
 
 void fixed_queue_flush(fixed_queue_t* queue, fixed_queue_free_cb free_cb) {
@@ -97,15 +181,13 @@ void fixed_queue_flush(fixed_queue_t* queue, fixed_queue_free_cb free_cb) {
 bool fixed_queue_is_empty(fixed_queue_t* queue) {
   if (queue == NULL) return true;
 
-  std::lock_guard<std::mutex> lock(*queue->mutex);
-  return list_is_empty(queue->list);
+  return queue->count.load() == 0;
 }
 
 size_t fixed_queue_length(fixed_queue_t* queue) {
   if (queue == NULL) return 0;
 
-  std::lock_guard<std::mutex> lock(*queue->mutex);
-  return list_length(queue->list);
+  return queue->count.load();
 }
 
 size_t fixed_queue_capacity(fixed_queue_t* queue) {
@@ -118,30 +200,26 @@ void fixed_queue_enqueue(fixed_queue_t* queue, void* data) {
   CHECK(queue != NULL);
   CHECK(data != NULL);
 
-  semaphore_wait(queue->enqueue_sem);
-
-  {
-    std::lock_guard<std::mutex> lock(*queue->mutex);
-    list_append(queue->list, data);
+  while (!fixed_queue_try_enqueue(queue, data)) {
+    // Registered as a waiter before looking at the count again, so that
+    // either the dequeue sees the waiter or the wait sees the new count
+    queue->enqueue_waiters++;
+    uint32_t count = queue->count.load();
+    if (is_full(queue, count)) futex_wait(&queue->count, count);
+    queue->enqueue_waiters--;
   }
-
-  semaphore_post(queue->dequeue_sem);
 }
 
 void* fixed_queue_dequeue(fixed_queue_t* queue) {
   CHECK(queue != NULL);
 
-  semaphore_wait(queue->dequeue_sem);
-
-  void* ret = NULL;
-  {
-    std::lock_guard<std::mutex> lock(*queue->mutex);
-    ret = list_front(queue->list);
-    list_remove(queue->list, ret);
+  void* ret;
+  while ((ret = fixed_queue_try_dequeue(queue)) == NULL) {
+    queue->dequeue_waiters++;
+    if (queue->count.load() == 0) futex_wait(&queue->count, 0);
+    queue->dequeue_waiters--;
   }
 
-  semaphore_post(queue->enqueue_sem);
-
   return ret;
 }
 
@@ -149,46 +227,56 @@ bool fixed_queue_try_enqueue(fixed_queue_t* queue, void* data) {
   CHECK(queue != NULL);
   CHECK(data != NULL);
 
-  if (!semaphore_try_wait(queue->enqueue_sem)) return false;
-
   {
-    std::lock_guard<std::mutex> lock(*queue->mutex);
-    list_append(queue->list, data);
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    size_t count = queue->count.load(std::memory_order_relaxed);
+    if (is_full(queue, count)) return false;
+    if (count == queue->ring_size && !grow_ring(queue)) return false;
+
+    queue->ring[slot(queue, count)] = data;
+    queue->count++;
+    notify_locked(queue, count, count + 1);
   }
 
-  semaphore_post(queue->dequeue_sem);
+  wake_waiters(queue, &queue->dequeue_waiters);
   return true;
 }
 
 void* fixed_queue_try_dequeue(fixed_queue_t* queue) {
   if (queue == NULL) return NULL;
 
-  if (!semaphore_try_wait(queue->dequeue_sem)) return NULL;
+  // Polling an empty queue does not need the lock
+  if (queue->count.load() == 0) return NULL;
 
   void* ret = NULL;
   {
-    std::lock_guard<std::mutex> lock(*queue->mutex);
-    ret = list_front(queue->list);
-    list_remove(queue->list, ret);
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    size_t count = queue->count.load(std::memory_order_relaxed);
+    if (count == 0) return NULL;
+
+    ret = queue->ring[queue->head];
+    queue->head = slot(queue, 1);
+    queue->count--;
+    notify_locked(queue, count, count - 1);
   }
 
-  semaphore_post(queue->enqueue_sem);
-
+  wake_waiters(queue, &queue->enqueue_waiters);
   return ret;
 }
 
 void* fixed_queue_try_peek_first(fixed_queue_t* queue) {
   if (queue == NULL) return NULL;
 
-  std::lock_guard<std::mutex> lock(*queue->mutex);
-  return list_is_empty(queue->list) ? NULL : list_front(queue->list);
+  std::lock_guard<std::mutex> lock(queue->mutex);
+  return queue->count.load() == 0 ? NULL : queue->ring[queue->head];
 }
 
 void* fixed_queue_try_peek_last(fixed_queue_t* queue) {
   if (queue == NULL) return NULL;
 
-  std::lock_guard<std::mutex> lock(*queue->mutex);
-  return list_is_empty(queue->list) ? NULL : list_back(queue->list);
+  std::lock_guard<std::mutex> lock(queue->mutex);
+  size_t count = queue->count.load();
+  return count == 0 ? NULL : queue->ring[slot(queue, count - 1)];
 }
 
 void* fixed_queue_try_remove_from_queue(fixed_queue_t* queue, void* data) {
@@ -196,16 +284,22 @@ void* fixed_queue_try_remove_from_queue(fixed_queue_t* queue, void* data) {
 
   bool removed = false;
   {
-    std::lock_guard<std::mutex> lock(*queue->mutex);
-    if (list_contains(queue->list, data) &&
-        semaphore_try_wait(queue->dequeue_sem)) {
-      removed = list_remove(queue->list, data);
-      CHECK(removed);
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    size_t count = queue->count.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < count; i++) {
+      if (queue->ring[slot(queue, i)] != data) continue;
+      // Close the gap with the elements behind
+      for (size_t j = i + 1; j < count; j++)
+        queue->ring[slot(queue, j - 1)] = queue->ring[slot(queue, j)];
+      queue->count--;
+      notify_locked(queue, count, count - 1);
+      removed = true;
+      break;
     }
   }
 
   if (removed) {
-    semaphore_post(queue->enqueue_sem);
+    wake_waiters(queue, &queue->enqueue_waiters);
     return data;
   }
   return NULL;
@@ -214,20 +308,44 @@ void* fixed_queue_try_remove_from_queue(fixed_queue_t* queue, void* data) {
 list_t* fixed_queue_get_list(fixed_queue_t* queue) {
   CHECK(queue != NULL);
 
-  // NOTE: Using the list in this way is not thread-safe.
-  // Using this list in any context where threads can call other functions
-  // to the queue can break our assumptions and the queue in general.
+  // NOTE: The list is a snapshot shared by all the callers on this queue, and
+  // is rebuilt here, so a list returned earlier is only valid until now.
+  std::lock_guard<std::mutex> lock(queue->mutex);
+  if (queue->list == NULL) queue->list = list_new(NULL);
+  list_clear(queue->list);
+  size_t count = queue->count.load();
+  for (size_t i = 0; i < count; i++)
+    list_append(queue->list, queue->ring[slot(queue, i)]);
   return queue->list;
 }
 
+// Creates the fd in |*fd| on first use, readable when |readable| says so.
+static int get_fd(const fixed_queue_t* queue, int* fd,
+                  bool (*readable)(const fixed_queue_t*, size_t)) {
+  std::lock_guard<std::mutex> lock(queue->mutex);
+  if (*fd == INVALID_FD) {
+    *fd = eventfd(readable(queue, queue->count.load()) ? 1 : 0, EFD_NONBLOCK);
+    CHECK(*fd != INVALID_FD);
+  }
+  return *fd;
+}
+
+static bool is_dequeue_ready(const fixed_queue_t* queue, size_t count) {
+  return count > 0;
+}
+
+static bool is_enqueue_ready(const fixed_queue_t* queue, size_t count) {
+  return !is_full(queue, count);
+}
+
 int fixed_queue_get_dequeue_fd(const fixed_queue_t* queue) {
   CHECK(queue != NULL);
-  return semaphore_get_fd(queue->dequeue_sem);
+  return get_fd(queue, &queue->dequeue_fd, is_dequeue_ready);
 }
 
 int fixed_queue_get_enqueue_fd(const fixed_queue_t* queue) {
   CHECK(queue != NULL);
-  return semaphore_get_fd(queue->enqueue_sem);
+  return get_fd(queue, &queue->enqueue_fd, is_enqueue_ready);
 }
 
 void fixed_queue_register_dequeue(fixed_queue_t* queue, reactor_t* reactor,
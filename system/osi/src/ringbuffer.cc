@@ -18,6 +18,10 @@
 
 #include <base/logging.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
 
 #include "check.h"
 #include "osi/include/allocator.h"
@@ -115,3 +119,138 @@ size_t ringbuffer_pop(ringbuffer_t* rb, uint8_t* p, size_t length) {
   rb->available += copied;
   return copied;
 }
+
+// The producer and consumer positions are on cache lines of their own, each
+// next to the copy of the other position its thread last read, so that the
+// threads only share a line when one needs a fresher position of the other.
+struct spsc_ringbuffer_t {
+  uint8_t* base;
+  size_t total;
+
+  // Written by the producer: total bytes ever committed
+  alignas(64) std::atomic<uint64_t> tail;
+  uint64_t producer_head;
+
+  // Written by the consumer: total bytes ever consumed
+  alignas(64) std::atomic<uint64_t> head;
+  uint64_t consumer_tail;
+};
+
+static void fill_span(const spsc_ringbuffer_t* rb, uint64_t position,
+                      size_t length, ringbuffer_span_t* span) {
+  const size_t offset = position % rb->total;
+  const size_t first = std::min(length, rb->total - offset);
+  span->data[0] = rb->base + offset;
+  span->length[0] = first;
+  span->data[1] = (length > first) ? rb->base : NULL;
+  span->length[1] = length - first;
+}
+
+spsc_ringbuffer_t* spsc_ringbuffer_init(const size_t size) {
+  CHECK(size > 0);
+  spsc_ringbuffer_t* rb = new spsc_ringbuffer_t();
+  rb->base = static_cast<uint8_t*>(osi_calloc(size));
+  rb->total = size;
+  rb->tail = 0;
+  rb->producer_head = 0;
+  rb->head = 0;
+  rb->consumer_tail = 0;
+  return rb;
+}
+
+void spsc_ringbuffer_free(spsc_ringbuffer_t* rb) {
+  if (rb == NULL) return;
+  osi_free(rb->base);
+  delete rb;
+}
+
+size_t spsc_ringbuffer_available(const spsc_ringbuffer_t* rb) {
+  CHECK(rb);
+  return rb->total - spsc_ringbuffer_size(rb);
+}
+
+size_t spsc_ringbuffer_size(const spsc_ringbuffer_t* rb) {
+  CHECK(rb);
+  // The head first, so that it is never ahead of the tail
+  const uint64_t head = rb->head.load(std::memory_order_acquire);
+  return rb->tail.load(std::memory_order_acquire) - head;
+}
+
+size_t spsc_ringbuffer_reserve(spsc_ringbuffer_t* rb, size_t length,
+                               ringbuffer_span_t* span) {
+  CHECK(rb);
+  CHECK(span);
+
+  const uint64_t tail = rb->tail.load(std::memory_order_relaxed);
+  size_t available = rb->total - (tail - rb->producer_head);
+  if (available < length) {
+    // Pairs with the consumer releasing the space once done reading it
+    rb->producer_head = rb->head.load(std::memory_order_acquire);
+    available = rb->total - (tail - rb->producer_head);
+  }
+
+  length = std::min(length, available);
+  fill_span(rb, tail, length, span);
+  return length;
+}
+
+void spsc_ringbuffer_commit(spsc_ringbuffer_t* rb, size_t length) {
+  CHECK(rb);
+
+  const uint64_t tail = rb->tail.load(std::memory_order_relaxed);
+  CHECK(tail + length - rb->producer_head <= rb->total);
+  rb->tail.store(tail + length, std::memory_order_release);
+}
+
+size_t spsc_ringbuffer_insert(spsc_ringbuffer_t* rb, const uint8_t* p,
+                              size_t length) {
+  CHECK(p);
+
+  ringbuffer_span_t span;
+  length = spsc_ringbuffer_reserve(rb, length, &span);
+  memcpy(span.data[0], p, span.length[0]);
+  if (span.length[1] > 0) {
+    memcpy(span.data[1], p + span.length[0], span.length[1]);
+  }
+  spsc_ringbuffer_commit(rb, length);
+  return length;
+}
+
+size_t spsc_ringbuffer_peek(spsc_ringbuffer_t* rb, size_t length,
+                            ringbuffer_span_t* span) {
+  CHECK(rb);
+  CHECK(span);
+
+  const uint64_t head = rb->head.load(std::memory_order_relaxed);
+  size_t size = rb->consumer_tail - head;
+  if (size < length) {
+    // Pairs with the producer publishing the data once written
+    rb->consumer_tail = rb->tail.load(std::memory_order_acquire);
+    size = rb->consumer_tail - head;
+  }
+
+  length = std::min(length, size);
+  fill_span(rb, head, length, span);
+  return length;
+}
+
+void spsc_ringbuffer_consume(spsc_ringbuffer_t* rb, size_t length) {
+  CHECK(rb);
+
+  const uint64_t head = rb->head.load(std::memory_order_relaxed);
+  CHECK(head + length <= rb->consumer_tail);
+  rb->head.store(head + length, std::memory_order_release);
+}
+
+size_t spsc_ringbuffer_pop(spsc_ringbuffer_t* rb, uint8_t* p, size_t length) {
+  CHECK(p);
+
+  ringbuffer_span_t span;
+  length = spsc_ringbuffer_peek(rb, length, &span);
+  memcpy(p, span.data[0], span.length[0]);
+  if (span.length[1] > 0) {
+    memcpy(p + span.length[0], span.data[1], span.length[1]);
+  }
+  spsc_ringbuffer_consume(rb, length);
+  return length;
+}
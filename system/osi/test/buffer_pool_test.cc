@@ -0,0 +1,191 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "osi/include/buffer_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// The statistics are those of the whole process, the tests look at how they
+// change
+buffer_pool_stats_t get_stats(size_t size_class) {
+  buffer_pool_stats_t stats;
+  EXPECT_TRUE(buffer_pool_get_stats(size_class, &stats));
+  return stats;
+}
+
+size_t class_of(size_t size) {
+  for (size_t i = 0; i < buffer_pool_num_classes(); i++) {
+    if (size <= get_stats(i).block_size) return i;
+  }
+  return buffer_pool_num_classes();
+}
+
+}  // namespace
+
+class BufferPoolTest : public ::testing::Test {
+ protected:
+  void SetUp() override { buffer_pool_flush_thread_cache(); }
+  void TearDown() override { buffer_pool_flush_thread_cache(); }
+};
+
+TEST_F(BufferPoolTest, test_size_classes) {
+  ASSERT_GT(buffer_pool_num_classes(), 0u);
+  size_t previous = 0;
+  for (size_t i = 0; i < buffer_pool_num_classes(); i++) {
+    buffer_pool_stats_t stats = get_stats(i);
+    EXPECT_GT(stats.block_size, previous);
+    previous = stats.block_size;
+  }
+
+  buffer_pool_stats_t stats;
+  EXPECT_FALSE(buffer_pool_get_stats(buffer_pool_num_classes(), &stats));
+}
+
+TEST_F(BufferPoolTest, test_alloc_is_usable_and_aligned) {
+  size_t largest = get_stats(buffer_pool_num_classes() - 1).block_size;
+  for (size_t size : {size_t(0), size_t(1), size_t(64), size_t(660),
+                      size_t(1021), largest, largest + 1, size_t(65536)}) {
+    uint8_t* ptr = static_cast<uint8_t*>(buffer_pool_alloc(size));
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % alignof(max_align_t), 0u);
+    memset(ptr, 0xa5, size);
+    buffer_pool_free(ptr);
+  }
+  buffer_pool_free(nullptr);
+}
+
+TEST_F(BufferPoolTest, test_freed_buffer_is_reused) {
+  size_t size_class = class_of(660);
+  void* first = buffer_pool_alloc(660);
+  buffer_pool_free(first);
+
+  buffer_pool_stats_t before = get_stats(size_class);
+  void* second = buffer_pool_alloc(600);
+  buffer_pool_stats_t after = get_stats(size_class);
+
+  EXPECT_EQ(first, second);
+  EXPECT_EQ(after.hits, before.hits + 1);
+  EXPECT_EQ(after.misses, before.misses);
+  buffer_pool_free(second);
+}
+
+TEST_F(BufferPoolTest, test_in_use_and_high_water) {
+  size_t size_class = class_of(1021);
+  buffer_pool_stats_t before = get_stats(size_class);
+
+  std::vector<void*> buffers;
+  for (int i = 0; i < 100; i++) buffers.push_back(buffer_pool_alloc(1021));
+  buffer_pool_stats_t during = get_stats(size_class);
+  EXPECT_EQ(during.in_use, before.in_use + 100);
+  EXPECT_GE(during.high_water, during.in_use);
+  EXPECT_EQ(during.hits + during.misses, before.hits + before.misses + 100);
+
+  for (void* buffer : buffers) buffer_pool_free(buffer);
+  buffer_pool_stats_t after = get_stats(size_class);
+  EXPECT_EQ(after.in_use, before.in_use);
+  EXPECT_EQ(after.high_water, during.high_water);
+
+  // All of them come back from the pools now
+  buffers.clear();
+  for (int i = 0; i < 100; i++) buffers.push_back(buffer_pool_alloc(1021));
+  EXPECT_EQ(get_stats(size_class).misses, after.misses);
+  for (void* buffer : buffers) buffer_pool_free(buffer);
+}
+
+TEST_F(BufferPoolTest, test_large_allocations_are_not_counted) {
+  std::vector<buffer_pool_stats_t> before;
+  for (size_t i = 0; i < buffer_pool_num_classes(); i++) {
+    before.push_back(get_stats(i));
+  }
+
+  void* ptr = buffer_pool_alloc(1 << 20);
+  memset(ptr, 0, 1 << 20);
+  buffer_pool_free(ptr);
+
+  for (size_t i = 0; i < buffer_pool_num_classes(); i++) {
+    buffer_pool_stats_t after = get_stats(i);
+    EXPECT_EQ(after.hits, before[i].hits);
+    EXPECT_EQ(after.misses, before[i].misses);
+  }
+}
+
+TEST_F(BufferPoolTest, test_free_on_another_thread) {
+  size_t size_class = class_of(288);
+  buffer_pool_stats_t before = get_stats(size_class);
+
+  std::vector<void*> buffers;
+  for (int i = 0; i < 1000; i++) buffers.push_back(buffer_pool_alloc(288));
+  std::thread consumer([&buffers] {
+    for (void* buffer : buffers) buffer_pool_free(buffer);
+  });
+  consumer.join();
+
+  // The consumer handed its cache back when exiting
+  buffer_pool_stats_t after = get_stats(size_class);
+  EXPECT_EQ(after.in_use, before.in_use);
+  EXPECT_GT(after.pooled, 0u);
+
+  uint64_t misses = after.misses;
+  void* ptr = buffer_pool_alloc(288);
+  EXPECT_EQ(get_stats(size_class).misses, misses);
+  buffer_pool_free(ptr);
+}
+
+TEST_F(BufferPoolTest, test_pools_are_bounded) {
+  size_t size_class = buffer_pool_num_classes() - 1;
+  size_t size = get_stats(size_class).block_size;
+  buffer_pool_stats_t before = get_stats(size_class);
+
+  // Far more than the pool keeps
+  std::vector<void*> buffers;
+  for (int i = 0; i < 1000; i++) buffers.push_back(buffer_pool_alloc(size));
+  for (void* buffer : buffers) buffer_pool_free(buffer);
+  buffer_pool_flush_thread_cache();
+
+  buffer_pool_stats_t after = get_stats(size_class);
+  EXPECT_GT(after.released, before.released);
+  EXPECT_LT(after.pooled * size, 1000 * size);
+  EXPECT_EQ(after.pooled + after.released,
+            before.pooled + before.released +
+                (after.misses - before.misses));
+}
+
+TEST_F(BufferPoolTest, test_concurrent_alloc_and_free) {
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([t] {
+      std::vector<uint8_t*> buffers;
+      for (int i = 0; i < 10000; i++) {
+        size_t size = (i * 131 + t * 17) % 5000;
+        uint8_t* ptr = static_cast<uint8_t*>(buffer_pool_alloc(size));
+        memset(ptr, t, size);
+        buffers.push_back(ptr);
+        if (buffers.size() > 64) {
+          buffer_pool_free(buffers.front());
+          buffers.erase(buffers.begin());
+        }
+      }
+      for (uint8_t* ptr : buffers) buffer_pool_free(ptr);
+    });
+  }
+  for (auto& thread : threads) thread.join();
+}
@@ -249,6 +249,86 @@ TEST_F(ConfigTest, config_save_basic) {
   EXPECT_TRUE(config_save(*config, CONFIG_FILE));
 }
 
+TEST_F(ConfigTest, config_many_sections_and_keys) {
+  // Enough of both to be looked up through their index
+  std::unique_ptr<config_t> config = config_new_empty();
+  for (int i = 0; i < 100; i++) {
+    for (int j = 0; j < 20; j++) {
+      config_set_int(config.get(), "section" + std::to_string(i),
+                     "key" + std::to_string(j), i * 100 + j);
+    }
+  }
+  EXPECT_EQ(config_get_int(*config, "section42", "key17", -1), 4217);
+  EXPECT_FALSE(config_has_key(*config, "section42", "key20"));
+  EXPECT_FALSE(config_has_section(*config, "section100"));
+
+  EXPECT_TRUE(config_remove_key(config.get(), "section42", "key17"));
+  EXPECT_FALSE(config_has_key(*config, "section42", "key17"));
+  EXPECT_EQ(config_get_int(*config, "section42", "key18", -1), 4218);
+  EXPECT_TRUE(config_remove_section(config.get(), "section7"));
+  EXPECT_FALSE(config_has_section(*config, "section7"));
+  EXPECT_EQ(config_get_int(*config, "section8", "key0", -1), 800);
+
+  // Added back at the end
+  config_set_int(config.get(), "section7", "key0", 1);
+  EXPECT_EQ(config->sections.Find("section7")->name, "section7");
+  EXPECT_EQ(std::prev(config->sections.end())->name, "section7");
+}
+
+TEST_F(ConfigTest, config_save_keeps_order) {
+  std::unique_ptr<config_t> config = config_new_empty();
+  for (int i = 20; i > 0; i--) {
+    for (int j = 20; j > 0; j--) {
+      config_set_int(config.get(), "section" + std::to_string(i),
+                     "key" + std::to_string(j), j);
+    }
+  }
+  ASSERT_TRUE(config_save(*config, CONFIG_FILE));
+
+  std::unique_ptr<config_t> loaded = config_new(CONFIG_FILE);
+  ASSERT_NE(loaded, nullptr);
+  ASSERT_EQ(loaded->sections.size(), config->sections.size());
+  auto section = config->sections.begin();
+  for (const section_t& loaded_section : loaded->sections) {
+    EXPECT_EQ(loaded_section.name, section->name);
+    auto entry = section->entries.begin();
+    for (const entry_t& loaded_entry : loaded_section.entries) {
+      EXPECT_EQ(loaded_entry.key, entry->key);
+      EXPECT_EQ(loaded_entry.value, entry->value);
+      ++entry;
+    }
+    ++section;
+  }
+}
+
+TEST_F(ConfigTest, config_copy_is_indexed_separately) {
+  std::unique_ptr<config_t> config = config_new_empty();
+  for (int i = 0; i < 20; i++) {
+    config_set_int(config.get(), "section" + std::to_string(i), "key", i);
+  }
+  config_t copy = *config;
+  config.reset();
+
+  EXPECT_EQ(config_get_int(copy, "section13", "key", -1), 13);
+  EXPECT_TRUE(config_remove_section(&copy, "section13"));
+  EXPECT_FALSE(config_has_section(copy, "section13"));
+}
+
+TEST_F(ConfigTest, config_duplicate_sections) {
+  // The sections of the same name the config users append directly
+  config_t config;
+  for (int i = 0; i < 20; i++) {
+    config.sections.emplace_back(section_t{.name = "section"});
+    config.sections.emplace_back(
+        section_t{.name = "other" + std::to_string(i)});
+  }
+  auto first = config.Find("section");
+  EXPECT_EQ(first, config.sections.begin());
+  auto second = std::next(first, 2);
+  config.sections.erase(first);
+  EXPECT_EQ(config.Find("section"), second);
+}
+
 TEST_F(ConfigTest, checksum_read) {
   auto tmp_dir = std::filesystem::temp_directory_path();
   auto filename = tmp_dir / "test.checksum";
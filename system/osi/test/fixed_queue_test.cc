@@ -1,4 +1,5 @@
 #include <gtest/gtest.h>
+#include <pthread.h>
 
 #include <climits>
 
@@ -230,6 +231,86 @@ TEST_F(FixedQueueTest, test_fixed_queue_enqueue_dequeue) {
   fixed_queue_free(queue, NULL);
 }
 
+TEST_F(FixedQueueTest, test_fixed_queue_order_across_growth) {
+  fixed_queue_t* queue = fixed_queue_new(SIZE_MAX);
+  ASSERT_TRUE(queue != NULL);
+
+  // Wrap around the ring before making it grow, many times over
+  uintptr_t next_in = 1;
+  uintptr_t next_out = 1;
+  for (size_t round = 1; round <= 20; round++) {
+    for (size_t i = 0; i < round * 7; i++) {
+      EXPECT_TRUE(fixed_queue_try_enqueue(queue, (void*)next_in++));
+    }
+    for (size_t i = 0; i < round * 5; i++) {
+      EXPECT_EQ((void*)next_out++, fixed_queue_try_dequeue(queue));
+    }
+  }
+  EXPECT_EQ(next_in - next_out, fixed_queue_length(queue));
+
+  // Remove from the middle, the rest keeps its order
+  uintptr_t removed = next_out + 3;
+  EXPECT_EQ((void*)removed,
+            fixed_queue_try_remove_from_queue(queue, (void*)removed));
+  while (!fixed_queue_is_empty(queue)) {
+    if (next_out == removed) next_out++;
+    EXPECT_EQ((void*)next_out++, fixed_queue_try_dequeue(queue));
+  }
+  EXPECT_EQ(next_in, next_out);
+
+  fixed_queue_free(queue, NULL);
+}
+
+TEST_F(FixedQueueTest, test_fixed_queue_get_list) {
+  fixed_queue_t* queue = fixed_queue_new(TEST_QUEUE_SIZE);
+  ASSERT_TRUE(queue != NULL);
+
+  EXPECT_TRUE(list_is_empty(fixed_queue_get_list(queue)));
+
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING1);
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING2);
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING3);
+  list_t* list = fixed_queue_get_list(queue);
+  EXPECT_EQ((size_t)3, list_length(list));
+  EXPECT_EQ(DUMMY_DATA_STRING1, list_front(list));
+  EXPECT_EQ(DUMMY_DATA_STRING3, list_back(list));
+
+  // Removing an element while walking the list leaves the walk unaffected
+  size_t walked = 0;
+  for (const list_node_t* node = list_begin(list); node != list_end(list);
+       node = list_next(node)) {
+    fixed_queue_try_remove_from_queue(queue, list_node(node));
+    walked++;
+  }
+  EXPECT_EQ((size_t)3, walked);
+  EXPECT_TRUE(fixed_queue_is_empty(queue));
+
+  fixed_queue_free(queue, NULL);
+}
+
+static void* blocking_producer(void* context) {
+  fixed_queue_t* queue = static_cast<fixed_queue_t*>(context);
+  for (uintptr_t i = 1; i <= 10000; i++) fixed_queue_enqueue(queue, (void*)i);
+  return NULL;
+}
+
+TEST_F(FixedQueueTest, test_fixed_queue_blocking_across_threads) {
+  // A small queue has the producer block on a full queue and the consumer on
+  // an empty one, both many times over
+  fixed_queue_t* queue = fixed_queue_new(2);
+  ASSERT_TRUE(queue != NULL);
+
+  pthread_t producer;
+  ASSERT_EQ(0, pthread_create(&producer, NULL, blocking_producer, queue));
+  for (uintptr_t i = 1; i <= 10000; i++) {
+    EXPECT_EQ((void*)i, fixed_queue_dequeue(queue));
+  }
+  pthread_join(producer, NULL);
+  EXPECT_TRUE(fixed_queue_is_empty(queue));
+
+  fixed_queue_free(queue, NULL);
+}
+
 TEST_F(FixedQueueTest, test_fixed_queue_try_peek_first_last) {
   fixed_queue_t* queue = fixed_queue_new(TEST_QUEUE_SIZE);
   ASSERT_TRUE(queue != NULL);
@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <thread>
+
 #include "osi/include/osi.h"
 #include "osi/include/ringbuffer.h"
 
@@ -137,3 +140,127 @@ TEST(RingbufferTest, test_multi_insert_delete) {
 
   ringbuffer_free(rb);
 }
+
+TEST(RingbufferTest, test_spsc_new_simple) {
+  spsc_ringbuffer_t* rb = spsc_ringbuffer_init(4096);
+  ASSERT_TRUE(rb != NULL);
+  EXPECT_EQ((size_t)4096, spsc_ringbuffer_available(rb));
+  EXPECT_EQ((size_t)0, spsc_ringbuffer_size(rb));
+  spsc_ringbuffer_free(rb);
+  spsc_ringbuffer_free(NULL);
+}
+
+TEST(RingbufferTest, test_spsc_reserve_commit) {
+  spsc_ringbuffer_t* rb = spsc_ringbuffer_init(16);
+  ringbuffer_span_t span;
+
+  EXPECT_EQ((size_t)10, spsc_ringbuffer_reserve(rb, 10, &span));
+  EXPECT_EQ((size_t)10, span.length[0]);
+  EXPECT_EQ((size_t)0, span.length[1]);
+  memset(span.data[0], 0xAA, 6);
+  // Nothing is seen before being committed
+  EXPECT_EQ((size_t)0, spsc_ringbuffer_size(rb));
+  spsc_ringbuffer_commit(rb, 6);
+  EXPECT_EQ((size_t)6, spsc_ringbuffer_size(rb));
+  EXPECT_EQ((size_t)10, spsc_ringbuffer_available(rb));
+
+  // Only what is left
+  EXPECT_EQ((size_t)10, spsc_ringbuffer_reserve(rb, 20, &span));
+  spsc_ringbuffer_commit(rb, 10);
+  EXPECT_EQ((size_t)0, spsc_ringbuffer_reserve(rb, 1, &span));
+  EXPECT_EQ((size_t)0, spsc_ringbuffer_available(rb));
+
+  spsc_ringbuffer_free(rb);
+}
+
+TEST(RingbufferTest, test_spsc_peek_consume) {
+  spsc_ringbuffer_t* rb = spsc_ringbuffer_init(16);
+  ringbuffer_span_t span;
+
+  uint8_t buffer[10] = {0x01, 0x02, 0x03, 0x04, 0x05,
+                        0x06, 0x07, 0x08, 0x09, 0x0A};
+  EXPECT_EQ((size_t)10, spsc_ringbuffer_insert(rb, buffer, 10));
+
+  EXPECT_EQ((size_t)10, spsc_ringbuffer_peek(rb, 16, &span));
+  EXPECT_EQ((size_t)10, span.length[0]);
+  EXPECT_EQ((size_t)0, span.length[1]);
+  ASSERT_TRUE(0 == memcmp(buffer, span.data[0], 10));
+  // Peeking does not remove anything
+  EXPECT_EQ((size_t)10, spsc_ringbuffer_size(rb));
+
+  spsc_ringbuffer_consume(rb, 4);
+  EXPECT_EQ((size_t)6, spsc_ringbuffer_size(rb));
+  EXPECT_EQ((size_t)6, spsc_ringbuffer_peek(rb, 16, &span));
+  ASSERT_TRUE(0 == memcmp(buffer + 4, span.data[0], 6));
+
+  spsc_ringbuffer_free(rb);
+}
+
+TEST(RingbufferTest, test_spsc_spans_split_at_wrap) {
+  spsc_ringbuffer_t* rb = spsc_ringbuffer_init(16);
+  ringbuffer_span_t span;
+  uint8_t aa[12];
+  memset(aa, 0xAA, sizeof(aa));
+  uint8_t out[12];
+
+  EXPECT_EQ((size_t)12, spsc_ringbuffer_insert(rb, aa, 12));
+  EXPECT_EQ((size_t)12, spsc_ringbuffer_pop(rb, out, 12));
+
+  // 4 bytes before the end, 6 at the beginning
+  EXPECT_EQ((size_t)10, spsc_ringbuffer_reserve(rb, 10, &span));
+  EXPECT_EQ((size_t)4, span.length[0]);
+  EXPECT_EQ((size_t)6, span.length[1]);
+  EXPECT_EQ(span.data[0] + 4, span.data[1] + 16);
+  for (size_t i = 0; i < span.length[0]; i++) span.data[0][i] = i;
+  for (size_t i = 0; i < span.length[1]; i++) span.data[1][i] = 4 + i;
+  spsc_ringbuffer_commit(rb, 10);
+
+  EXPECT_EQ((size_t)10, spsc_ringbuffer_peek(rb, 10, &span));
+  EXPECT_EQ((size_t)4, span.length[0]);
+  EXPECT_EQ((size_t)6, span.length[1]);
+
+  uint8_t content[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+  EXPECT_EQ((size_t)10, spsc_ringbuffer_pop(rb, out, sizeof(out)));
+  ASSERT_TRUE(0 == memcmp(content, out, sizeof(content)));
+  EXPECT_EQ((size_t)0, spsc_ringbuffer_size(rb));
+
+  spsc_ringbuffer_free(rb);
+}
+
+TEST(RingbufferTest, test_spsc_concurrent_producer_consumer) {
+  spsc_ringbuffer_t* rb = spsc_ringbuffer_init(1000);
+  const size_t kTotal = 1000 * 1000;
+
+  std::thread producer([rb, kTotal] {
+    size_t produced = 0;
+    while (produced < kTotal) {
+      ringbuffer_span_t span;
+      size_t length = spsc_ringbuffer_reserve(
+          rb, std::min<size_t>(kTotal - produced, 1 + produced % 333), &span);
+      for (int piece = 0; piece < 2; piece++) {
+        for (size_t i = 0; i < span.length[piece]; i++) {
+          span.data[piece][i] = static_cast<uint8_t>(produced++ % 251);
+        }
+      }
+      spsc_ringbuffer_commit(rb, length);
+    }
+  });
+
+  size_t consumed = 0;
+  bool in_order = true;
+  while (consumed < kTotal) {
+    ringbuffer_span_t span;
+    size_t length = spsc_ringbuffer_peek(rb, 1 + consumed % 517, &span);
+    for (int piece = 0; piece < 2; piece++) {
+      for (size_t i = 0; i < span.length[piece]; i++) {
+        in_order &= span.data[piece][i] == consumed++ % 251;
+      }
+    }
+    spsc_ringbuffer_consume(rb, length);
+  }
+  producer.join();
+
+  EXPECT_TRUE(in_order);
+  EXPECT_EQ((size_t)0, spsc_ringbuffer_size(rb));
+  spsc_ringbuffer_free(rb);
+}
@@ -470,18 +470,14 @@ void Device::TrackChangedNotificationResponse(uint8_t label, bool interim,
     return;
   }
 
-  // Anytime we use the now playing list, update our map so that its always
-  // current
-  now_playing_ids_.clear();
-  uint64_t uid = 0;
-  for (const SongInfo& song : song_list) {
-    now_playing_ids_.insert(song.media_id);
-    if (curr_song_id == song.media_id) {
-      DEVICE_VLOG(3) << __func__ << ": Found media ID match for "
-                     << song.media_id;
-      uid = now_playing_ids_.get_uid(curr_song_id);
-    }
+  MapNowPlayingIds(song_list);
+  uint64_t uid = now_playing_ids_.get_uid(curr_song_id);
+  if (uid != 0) {
+    DEVICE_VLOG(3) << __func__ << ": Found media ID match for "
+                   << curr_song_id;
   }
+  now_playing_cache_.Set(GetBrowseCacheKey(Scope::NOW_PLAYING),
+                         std::move(song_list));
 
   if (uid == 0) {
     // uid 0 is not valid here when browsing is supported
@@ -850,17 +846,38 @@ void Device::HandleGetFolderItems(uint8_t label,
           base::Bind(&Device::GetMediaPlayerListResponse,
                      weak_ptr_factory_.GetWeakPtr(), label, pkt));
       break;
-    case Scope::VFS:
+    case Scope::VFS: {
+      // Head units page through large folders one browse MTU at a time, so
+      // the pages that follow the first one are served from the list read
+      // for it. The media service does not always tell when a folder
+      // changes, so a listing starting over from the first item reads it
+      // again.
+      auto key = GetBrowseCacheKey(Scope::VFS);
+      if (pkt->GetStartItem() != 0 && vfs_cache_.Matches(key)) {
+        browse_cache_hits_++;
+        SendVFSListPage(label, pkt, vfs_cache_.items);
+        break;
+      }
+      browse_cache_misses_++;
       media_interface_->GetFolderItems(
           curr_browsed_player_id_, CurrentFolder(),
           base::Bind(&Device::GetVFSListResponse,
-                     weak_ptr_factory_.GetWeakPtr(), label, pkt));
+                     weak_ptr_factory_.GetWeakPtr(), label, pkt, key));
       break;
-    case Scope::NOW_PLAYING:
+    }
+    case Scope::NOW_PLAYING: {
+      auto key = GetBrowseCacheKey(Scope::NOW_PLAYING);
+      if (now_playing_cache_.Matches(key)) {
+        browse_cache_hits_++;
+        SendNowPlayingListPage(label, pkt, now_playing_cache_.items);
+        break;
+      }
+      browse_cache_misses_++;
       media_interface_->GetNowPlayingList(
           base::Bind(&Device::GetNowPlayingListResponse,
-                     weak_ptr_factory_.GetWeakPtr(), label, pkt));
+                     weak_ptr_factory_.GetWeakPtr(), label, pkt, key));
       break;
+    }
     default:
       DEVICE_LOG(ERROR) << __func__ << ": " << pkt->GetScope();
       auto response = GetFolderItemsResponseBuilder::MakePlayerListBuilder(Status::INVALID_PARAMETER, 0, browse_mtu_);
@@ -1197,13 +1214,11 @@ std::set<AttributeEntry> filter_attributes_requested(
 
 void Device::GetVFSListResponse(uint8_t label,
                                 std::shared_ptr<GetFolderItemsRequest> pkt,
+                                BrowseCacheKey key,
                                 std::vector<ListItem> items) {
   DEVICE_VLOG(2) << __func__ << ": start_item=" << pkt->GetStartItem()
-                 << " end_item=" << pkt->GetEndItem();
-
-  // The builder will automatically correct the status if there are zero items
-  auto builder = GetFolderItemsResponseBuilder::MakeVFSBuilder(
-      Status::NO_ERROR, 0x0000, browse_mtu_);
+                 << " end_item=" << pkt->GetEndItem()
+                 << " num_items=" << items.size();
 
   // TODO (apanicke): Add test that checks if vfs_ids_ is the correct size after
   // an operation.
@@ -1215,6 +1230,24 @@ void Device::GetVFSListResponse(uint8_t label,
     }
   }
 
+  // Don't keep a list that was read from a folder the device has since left,
+  // or before the UIDs changed.
+  if (!(key == GetBrowseCacheKey(Scope::VFS))) {
+    SendVFSListPage(label, pkt, items);
+    return;
+  }
+
+  vfs_cache_.Set(key, std::move(items));
+  SendVFSListPage(label, pkt, vfs_cache_.items);
+}
+
+void Device::SendVFSListPage(uint8_t label,
+                             const std::shared_ptr<GetFolderItemsRequest>& pkt,
+                             const std::vector<ListItem>& items) {
+  // The builder will automatically correct the status if there are zero items
+  auto builder = GetFolderItemsResponseBuilder::MakeVFSBuilder(
+      Status::NO_ERROR, 0x0000, browse_mtu_);
+
   // Add the elements retrieved in the last get folder items request and map
   // them to UIDs The maps will be cleared every time a directory change
   // happens. These items do not need to correspond with the now playing list as
@@ -1261,16 +1294,36 @@ void Device::GetVFSListResponse(uint8_t label,
 
 void Device::GetNowPlayingListResponse(
     uint8_t label, std::shared_ptr<GetFolderItemsRequest> pkt,
-    std::string /* unused curr_song_id */, std::vector<SongInfo> song_list) {
-  DEVICE_VLOG(2) << __func__;
-  auto builder = GetFolderItemsResponseBuilder::MakeNowPlayingBuilder(
-      Status::NO_ERROR, 0x0000, browse_mtu_);
+    BrowseCacheKey key, std::string /* unused curr_song_id */,
+    std::vector<SongInfo> song_list) {
+  DEVICE_VLOG(2) << __func__ << ": num_items=" << song_list.size();
 
-  now_playing_ids_.clear();
-  for (const SongInfo& song : song_list) {
-    now_playing_ids_.insert(song.media_id);
+  // A newer list may have come in while this one was read, in which case the
+  // UIDs already follow it.
+  auto current_key = GetBrowseCacheKey(Scope::NOW_PLAYING);
+  if (now_playing_cache_.Matches(current_key)) {
+    SendNowPlayingListPage(label, pkt, now_playing_cache_.items);
+    return;
+  }
+
+  MapNowPlayingIds(song_list);
+
+  // Don't keep a list that was read before the now playing list changed
+  if (!(key == current_key)) {
+    SendNowPlayingListPage(label, pkt, song_list);
+    return;
   }
 
+  now_playing_cache_.Set(key, std::move(song_list));
+  SendNowPlayingListPage(label, pkt, now_playing_cache_.items);
+}
+
+void Device::SendNowPlayingListPage(
+    uint8_t label, const std::shared_ptr<GetFolderItemsRequest>& pkt,
+    const std::vector<SongInfo>& song_list) {
+  auto builder = GetFolderItemsResponseBuilder::MakeNowPlayingBuilder(
+      Status::NO_ERROR, 0x0000, browse_mtu_);
+
   for (size_t i = pkt->GetStartItem();
        i <= pkt->GetEndItem() && i < song_list.size(); i++) {
     auto song = song_list[i];
@@ -1338,6 +1391,7 @@ void Device::SetBrowsedPlayerResponse(
   }
 
   curr_browsed_player_id_ = pkt->GetPlayerId();
+  InvalidateBrowseCache(true, false);
 
   // Clear the path and push the new root.
   current_path_ = std::stack<std::string>();
@@ -1357,6 +1411,7 @@ void Device::SendMediaUpdate(bool metadata, bool play_status, bool queue) {
                  << " ; is_silence=" << is_silence;
 
   if (queue) {
+    InvalidateBrowseCache(false, true);
     HandleNowPlayingUpdate();
   }
 
@@ -1375,6 +1430,10 @@ void Device::SendFolderUpdate(bool available_players, bool addressed_player,
   CHECK(media_interface_);
   DEVICE_VLOG(4) << __func__;
 
+  if (uids) {
+    InvalidateBrowseCache(true, true);
+  }
+
   if (available_players) {
     HandleAvailablePlayerUpdate();
   }
@@ -1431,10 +1490,9 @@ void Device::HandleNowPlayingNotificationResponse(
     return;
   }
 
-  now_playing_ids_.clear();
-  for (const SongInfo& song : song_list) {
-    now_playing_ids_.insert(song.media_id);
-  }
+  MapNowPlayingIds(song_list);
+  now_playing_cache_.Set(GetBrowseCacheKey(Scope::NOW_PLAYING),
+                         std::move(song_list));
 
   auto response =
       RegisterNotificationResponseBuilder::MakeNowPlayingBuilder(interim);
@@ -1492,6 +1550,7 @@ void Device::HandleAddressedPlayerUpdate() {
 void Device::DeviceDisconnected() {
   DEVICE_LOG(INFO) << "Device was disconnected";
   play_pos_update_cb_.Cancel();
+  InvalidateBrowseCache(true, true);
 
   // TODO (apanicke): Once the interfaces are set in the Device construction,
   // remove these conditionals.
@@ -1499,6 +1558,33 @@ void Device::DeviceDisconnected() {
     volume_interface_->DeviceDisconnected(GetAddress());
 }
 
+BrowseCacheKey Device::GetBrowseCacheKey(Scope scope) const {
+  if (scope == Scope::NOW_PLAYING) {
+    // The now playing list belongs to the addressed player, not to a folder
+    return BrowseCacheKey{scope, -1, "", now_playing_uid_counter_};
+  }
+  return BrowseCacheKey{scope, curr_browsed_player_id_, CurrentFolder(),
+                        vfs_uid_counter_};
+}
+
+void Device::InvalidateBrowseCache(bool vfs, bool now_playing) {
+  if (vfs) {
+    vfs_uid_counter_++;
+    vfs_cache_.Clear();
+  }
+  if (now_playing) {
+    now_playing_uid_counter_++;
+    now_playing_cache_.Clear();
+  }
+}
+
+void Device::MapNowPlayingIds(const std::vector<SongInfo>& song_list) {
+  now_playing_ids_.clear();
+  for (const SongInfo& song : song_list) {
+    now_playing_ids_.insert(song.media_id);
+  }
+}
+
 static std::string volumeToStr(int8_t volume) {
   if (volume == VOL_NOT_SUPPORTED) return "Absolute Volume not supported";
   if (volume == VOL_REGISTRATION_FAILED)
@@ -1531,6 +1617,11 @@ std::ostream& operator<<(std::ostream& out, const Device& d) {
   out << "Current Folder: \"" << d.CurrentFolder() << "\"\n";
   out << "MTU Sizes: CTRL=" << d.ctrl_mtu_ << " BROWSE=" << d.browse_mtu_
       << std::endl;
+  out << "Browse Cache: hits=" << d.browse_cache_hits_
+      << " misses=" << d.browse_cache_misses_
+      << " vfs_items=" << d.vfs_cache_.items.size()
+      << " now_playing_items=" << d.now_playing_cache_.items.size()
+      << std::endl;
   // TODO (apanicke): Add supported features as well as media keys
   return out;
 }
@@ -18,6 +18,7 @@
 
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <stack>
 
 #include <base/bind.h>
@@ -44,6 +45,23 @@
 namespace bluetooth {
 namespace avrcp {
 
+/**
+ * Identifies a list fetched from the media interface for browsing: its scope,
+ * the browsed player and folder it was read from for the virtual filesystem,
+ * and the browse UID counter of the device when it was asked for.
+ */
+struct BrowseCacheKey {
+  Scope scope;
+  int player_id;
+  std::string folder;
+  uint16_t uid_counter;
+
+  bool operator==(const BrowseCacheKey& other) const {
+    return scope == other.scope && player_id == other.player_id &&
+           folder == other.folder && uid_counter == other.uid_counter;
+  }
+};
+
 /**
  * A class representing a connection with a remote AVRCP device. It holds all
  * the state and message handling for the device that it represents.
@@ -210,10 +228,12 @@ class Device {
       uint16_t curr_player, std::vector<MediaPlayerInfo> players);
   virtual void GetVFSListResponse(uint8_t label,
                                   std::shared_ptr<GetFolderItemsRequest> pkt,
+                                  BrowseCacheKey key,
                                   std::vector<ListItem> items);
   virtual void GetNowPlayingListResponse(
       uint8_t label, std::shared_ptr<GetFolderItemsRequest> pkt,
-      std::string curr_song_id, std::vector<SongInfo> song_list);
+      BrowseCacheKey key, std::string curr_song_id,
+      std::vector<SongInfo> song_list);
 
   // GET TOTAL NUMBER OF ITEMS
   virtual void HandleGetTotalNumberOfItems(
@@ -296,6 +316,45 @@ class Device {
     active_labels_.erase(label);
     send_message_cb_.Run(label, browse, std::move(message));
   }
+
+  // The last list read for a browsing scope, which pages of GetFolderItems
+  // are served from for as long as its key is current. A VFS listing from
+  // the first item always reads the folder again.
+  template <typename T>
+  struct BrowseCache {
+    std::optional<BrowseCacheKey> key;
+    std::vector<T> items;
+
+    bool Matches(const BrowseCacheKey& other) const {
+      return key.has_value() && *key == other;
+    }
+    void Set(const BrowseCacheKey& new_key, std::vector<T> new_items) {
+      key = new_key;
+      items = std::move(new_items);
+    }
+    void Clear() {
+      key.reset();
+      items = std::vector<T>();
+    }
+  };
+
+  BrowseCacheKey GetBrowseCacheKey(Scope scope) const;
+
+  // Drops the browse caches and moves on the UID counter, so that lists that
+  // are still being read when the UIDs change are not cached either.
+  void InvalidateBrowseCache(bool vfs, bool now_playing);
+
+  // Anytime we use the now playing list, update our map so that its always
+  // current
+  void MapNowPlayingIds(const std::vector<SongInfo>& song_list);
+
+  // Build a GetFolderItems response out of the requested window of a list.
+  void SendVFSListPage(uint8_t label,
+                       const std::shared_ptr<GetFolderItemsRequest>& pkt,
+                       const std::vector<ListItem>& items);
+  void SendNowPlayingListPage(uint8_t label,
+                              const std::shared_ptr<GetFolderItemsRequest>& pkt,
+                              const std::vector<SongInfo>& song_list);
   base::WeakPtrFactory<Device> weak_ptr_factory_;
 
   // TODO (apanicke): Initialize all the variables in the constructor.
@@ -328,6 +387,17 @@ class Device {
   MediaIdMap vfs_ids_;
   MediaIdMap now_playing_ids_;
 
+  // Bumped whenever the media interface reports that the UIDs, or for the
+  // second the now playing list, changed. Only used to key the browse caches,
+  // the responses keep reporting a UID counter of 0 as the database is not UID
+  // aware.
+  uint16_t vfs_uid_counter_ = 0;
+  uint16_t now_playing_uid_counter_ = 0;
+  BrowseCache<ListItem> vfs_cache_;
+  BrowseCache<SongInfo> now_playing_cache_;
+  uint32_t browse_cache_hits_ = 0;
+  uint32_t browse_cache_misses_ = 0;
+
   uint32_t play_pos_interval_ = 0;
 
   SongInfo last_song_info_;
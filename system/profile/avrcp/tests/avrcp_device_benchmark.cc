@@ -0,0 +1,191 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <base/bind.h>
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+#include "avrcp_packet.h"
+#include "device.h"
+#include "packet_test_helper.h"
+#include "stack_config.h"
+#include "types/raw_address.h"
+
+using ::benchmark::State;
+
+namespace bluetooth {
+namespace avrcp {
+namespace {
+
+// Browse MTU of a typical head unit, and the window it asks for at a time
+constexpr uint16_t kBrowseMtu = 1024;
+constexpr uint32_t kPageItems = 20;
+
+using TestBrowsePacket = TestPacketType<BrowsePacket>;
+
+SongInfo MakeSong(int i) {
+  std::string id = std::to_string(i);
+  return SongInfo{"song_" + id,
+                  {AttributeEntry(Attribute::TITLE, "Song Title " + id),
+                   AttributeEntry(Attribute::ARTIST_NAME, "Artist " + id),
+                   AttributeEntry(Attribute::ALBUM_NAME, "Album " + id),
+                   AttributeEntry(Attribute::TRACK_NUMBER, id),
+                   AttributeEntry(Attribute::PLAYING_TIME, "180000")}};
+}
+
+// Answers right away out of a synthetic library, which stands for the media
+// service handing the whole folder or queue over on each request.
+class LibraryMediaInterface : public MediaInterface {
+ public:
+  explicit LibraryMediaInterface(int num_items) {
+    for (int i = 0; i < num_items; i++) {
+      songs_.push_back(MakeSong(i));
+      folder_.push_back(ListItem{ListItem::SONG, FolderInfo(), songs_.back()});
+    }
+  }
+
+  void SendKeyEvent(uint8_t key, KeyState state) override {}
+  void GetSongInfo(SongInfoCallback info_cb) override {}
+  void GetPlayStatus(PlayStatusCallback status_cb) override {}
+  void GetNowPlayingList(NowPlayingCallback now_playing_cb) override {
+    fetches_++;
+    now_playing_cb.Run(songs_.front().media_id, songs_);
+  }
+  void GetMediaPlayerList(MediaListCallback list_cb) override {}
+  void GetFolderItems(uint16_t player_id, std::string media_id,
+                      FolderItemsCallback folder_cb) override {
+    fetches_++;
+    folder_cb.Run(folder_);
+  }
+  void SetBrowsedPlayer(uint16_t player_id,
+                        SetBrowsedPlayerCallback browse_cb) override {}
+  void PlayItem(uint16_t player_id, bool now_playing,
+                std::string media_id) override {}
+  void SetActiveDevice(const RawAddress& address) override {}
+  void RegisterUpdateCallback(MediaCallbacks* callback) override {}
+  void UnregisterUpdateCallback(MediaCallbacks* callback) override {}
+
+  int fetches() const { return fetches_; }
+
+ private:
+  std::vector<SongInfo> songs_;
+  std::vector<ListItem> folder_;
+  int fetches_ = 0;
+};
+
+class FakeA2dpInterface : public A2dpInterface {
+ public:
+  RawAddress active_peer() override { return RawAddress(); }
+  bool is_peer_in_silence_mode(const RawAddress& peer_address) override {
+    return false;
+  }
+};
+
+bool get_pts_avrcp_test(void) { return false; }
+
+const stack_config_t interface = {nullptr, get_pts_avrcp_test,
+                                  nullptr, nullptr,
+                                  nullptr, nullptr,
+                                  nullptr, nullptr,
+                                  nullptr, nullptr,
+                                  nullptr, nullptr,
+                                  nullptr, nullptr,
+                                  nullptr, nullptr,
+                                  nullptr, nullptr,
+                                  nullptr, nullptr,
+                                  nullptr, nullptr,
+                                  nullptr};
+
+// Time for a page of GetFolderItems to be answered while paging through a
+// library of range(0) items, with range(1) == 1 letting the device keep the
+// list between pages and range(1) == 0 having the UIDs change before each
+// page, which is what every page cost before the browse cache.
+void BrowsePages(State& state, Scope scope) {
+  int num_items = state.range(0);
+  bool cached = state.range(1);
+
+  LibraryMediaInterface media_interface(num_items);
+  FakeA2dpInterface a2dp_interface;
+  size_t response_size = 0;
+  Device device(
+      RawAddress::kAny, false,
+      base::Bind(
+          [](size_t* size, uint8_t, bool,
+             std::unique_ptr<::bluetooth::PacketBuilder> message) {
+            *size = message->size();
+          },
+          &response_size),
+      0xFFFF, kBrowseMtu);
+  device.RegisterInterfaces(&media_interface, &a2dp_interface, nullptr);
+
+  uint32_t start = 0;
+  for (auto _ : state) {
+    if (!cached) {
+      state.PauseTiming();
+      if (scope == Scope::VFS) {
+        device.SendFolderUpdate(false, false, true);
+      } else {
+        device.SendMediaUpdate(false, false, true);
+      }
+      state.ResumeTiming();
+    }
+
+    auto request = TestBrowsePacket::Make();
+    GetFolderItemsRequestBuilder::MakeBuilder(scope, start,
+                                              start + kPageItems - 1, {})
+        ->Serialize(request);
+    device.BrowseMessageReceived(1, request);
+    ::benchmark::DoNotOptimize(response_size);
+
+    start += kPageItems;
+    if (start >= (uint32_t)num_items) start = 0;
+  }
+
+  state.counters["fetches"] = media_interface.fetches();
+}
+
+void BM_GetFolderItemsVFS(State& state) { BrowsePages(state, Scope::VFS); }
+
+void BM_GetFolderItemsNowPlaying(State& state) {
+  BrowsePages(state, Scope::NOW_PLAYING);
+}
+
+BENCHMARK(BM_GetFolderItemsVFS)
+    ->ArgNames({"items", "cached"})
+    ->ArgsProduct({{1000, 10000, 50000}, {0, 1}})
+    ->Unit(::benchmark::kMicrosecond);
+BENCHMARK(BM_GetFolderItemsNowPlaying)
+    ->ArgNames({"items", "cached"})
+    ->ArgsProduct({{1000, 10000, 50000}, {0, 1}})
+    ->Unit(::benchmark::kMicrosecond);
+
+}  // namespace
+}  // namespace avrcp
+}  // namespace bluetooth
+
+const stack_config_t* stack_config_get_interface(void) {
+  return &bluetooth::avrcp::interface;
+}
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
@@ -1061,6 +1061,140 @@ TEST_F(AvrcpDeviceTest, changePathTest) {
   SendBrowseMessage(5, request);
 }
 
+TEST_F(AvrcpDeviceTest, getFolderItemsVFSCacheTest) {
+  MockMediaInterface interface;
+  NiceMock<MockA2dpInterface> a2dp_interface;
+
+  test_device->RegisterInterfaces(&interface, &a2dp_interface, nullptr);
+
+  FolderInfo info0 = {"test_id0", true, "Test Folder0"};
+  FolderInfo info1 = {"test_id1", true, "Test Folder1"};
+  FolderInfo info2 = {"test_id2", true, "Test Folder2"};
+  std::vector<ListItem> list = {{ListItem::FOLDER, info0, SongInfo()},
+                                {ListItem::FOLDER, info1, SongInfo()},
+                                {ListItem::FOLDER, info2, SongInfo()}};
+
+  // Both pages are served from a single read of the folder
+  EXPECT_CALL(interface, GetFolderItems(_, "", _))
+      .Times(1)
+      .WillOnce(InvokeCb<2>(list));
+
+  auto first_page = GetFolderItemsResponseBuilder::MakeVFSBuilder(
+      Status::NO_ERROR, 0x0000, 0xFFFF);
+  first_page->AddFolder(FolderItem(1, 0, true, "Test Folder0"));
+  EXPECT_CALL(response_cb, Call(1, true, matchPacket(std::move(first_page))))
+      .Times(1);
+  auto request = TestBrowsePacket::Make();
+  GetFolderItemsRequestBuilder::MakeBuilder(Scope::VFS, 0, 0, {})
+      ->Serialize(request);
+  SendBrowseMessage(1, request);
+
+  auto second_page = GetFolderItemsResponseBuilder::MakeVFSBuilder(
+      Status::NO_ERROR, 0x0000, 0xFFFF);
+  second_page->AddFolder(FolderItem(2, 0, true, "Test Folder1"));
+  second_page->AddFolder(FolderItem(3, 0, true, "Test Folder2"));
+  EXPECT_CALL(response_cb, Call(2, true, matchPacket(std::move(second_page))))
+      .Times(1);
+  request = TestBrowsePacket::Make();
+  GetFolderItemsRequestBuilder::MakeBuilder(Scope::VFS, 1, 2, {})
+      ->Serialize(request);
+  SendBrowseMessage(2, request);
+  Mock::VerifyAndClearExpectations(&interface);
+
+  // The folder is read again once the UIDs changed
+  std::vector<ListItem> new_list = {{ListItem::FOLDER, info2, SongInfo()}};
+  EXPECT_CALL(interface, GetFolderItems(_, "", _))
+      .Times(1)
+      .WillOnce(InvokeCb<2>(new_list));
+  test_device->SendFolderUpdate(false, false, true);
+
+  auto new_page = GetFolderItemsResponseBuilder::MakeVFSBuilder(
+      Status::NO_ERROR, 0x0000, 0xFFFF);
+  new_page->AddFolder(FolderItem(3, 0, true, "Test Folder2"));
+  EXPECT_CALL(response_cb, Call(3, true, matchPacket(std::move(new_page))))
+      .Times(1);
+  request = TestBrowsePacket::Make();
+  GetFolderItemsRequestBuilder::MakeBuilder(Scope::VFS, 0, 2, {})
+      ->Serialize(request);
+  SendBrowseMessage(3, request);
+  Mock::VerifyAndClearExpectations(&interface);
+
+  // And when a listing starts over from the first item, as the folder may
+  // have changed without the UIDs changing, the pages after it being served
+  // from that new read
+  EXPECT_CALL(interface, GetFolderItems(_, "", _))
+      .Times(1)
+      .WillOnce(InvokeCb<2>(list));
+
+  first_page = GetFolderItemsResponseBuilder::MakeVFSBuilder(Status::NO_ERROR,
+                                                             0x0000, 0xFFFF);
+  first_page->AddFolder(FolderItem(1, 0, true, "Test Folder0"));
+  EXPECT_CALL(response_cb, Call(4, true, matchPacket(std::move(first_page))))
+      .Times(1);
+  request = TestBrowsePacket::Make();
+  GetFolderItemsRequestBuilder::MakeBuilder(Scope::VFS, 0, 0, {})
+      ->Serialize(request);
+  SendBrowseMessage(4, request);
+
+  second_page = GetFolderItemsResponseBuilder::MakeVFSBuilder(Status::NO_ERROR,
+                                                              0x0000, 0xFFFF);
+  second_page->AddFolder(FolderItem(2, 0, true, "Test Folder1"));
+  second_page->AddFolder(FolderItem(3, 0, true, "Test Folder2"));
+  EXPECT_CALL(response_cb, Call(5, true, matchPacket(std::move(second_page))))
+      .Times(1);
+  request = TestBrowsePacket::Make();
+  GetFolderItemsRequestBuilder::MakeBuilder(Scope::VFS, 1, 2, {})
+      ->Serialize(request);
+  SendBrowseMessage(5, request);
+}
+
+TEST_F(AvrcpDeviceTest, getFolderItemsNowPlayingCacheTest) {
+  MockMediaInterface interface;
+  NiceMock<MockA2dpInterface> a2dp_interface;
+
+  test_device->RegisterInterfaces(&interface, &a2dp_interface, nullptr);
+
+  SongInfo info0 = {"test_id0", {AttributeEntry(Attribute::TITLE, "Song0")}};
+  SongInfo info1 = {"test_id1", {AttributeEntry(Attribute::TITLE, "Song1")}};
+  std::vector<SongInfo> list = {info0, info1};
+
+  EXPECT_CALL(interface, GetNowPlayingList(_))
+      .Times(1)
+      .WillOnce(InvokeCb<0>("test_id0", list));
+
+  for (uint8_t i = 0; i < 2; i++) {
+    auto page = GetFolderItemsResponseBuilder::MakeNowPlayingBuilder(
+        Status::NO_ERROR, 0x0000, 0xFFFF);
+    const SongInfo& info = i == 0 ? info0 : info1;
+    page->AddSong(MediaElementItem(i + 1, "Song" + std::to_string(i),
+                                   info.attributes));
+    EXPECT_CALL(response_cb, Call(i, true, matchPacket(std::move(page))))
+        .Times(1);
+    auto request = TestBrowsePacket::Make();
+    GetFolderItemsRequestBuilder::MakeBuilder(Scope::NOW_PLAYING, i, i, {})
+        ->Serialize(request);
+    SendBrowseMessage(i, request);
+  }
+  Mock::VerifyAndClearExpectations(&interface);
+
+  // A queue change drops the cached list
+  std::vector<SongInfo> new_list = {info1};
+  EXPECT_CALL(interface, GetNowPlayingList(_))
+      .Times(1)
+      .WillOnce(InvokeCb<0>("test_id1", new_list));
+  test_device->SendMediaUpdate(false, false, true);
+
+  auto page = GetFolderItemsResponseBuilder::MakeNowPlayingBuilder(
+      Status::NO_ERROR, 0x0000, 0xFFFF);
+  page->AddSong(MediaElementItem(1, "Song1", info1.attributes));
+  EXPECT_CALL(response_cb, Call(2, true, matchPacket(std::move(page))))
+      .Times(1);
+  auto request = TestBrowsePacket::Make();
+  GetFolderItemsRequestBuilder::MakeBuilder(Scope::NOW_PLAYING, 0, 1, {})
+      ->Serialize(request);
+  SendBrowseMessage(2, request);
+}
+
 TEST_F(AvrcpDeviceTest, getItemAttributesNowPlayingTest) {
   MockMediaInterface interface;
   NiceMock<MockA2dpInterface> a2dp_interface;
@@ -197,25 +197,32 @@ static tBTM_SEC_DEV_REC* btm_find_dev_by_identity_addr(
     const RawAddress& bd_addr, uint8_t addr_type) {
   if (btm_cb.sec_dev_rec == nullptr) return nullptr;
 
-  list_node_t* end = list_end(btm_cb.sec_dev_rec);
-  for (list_node_t* node = list_begin(btm_cb.sec_dev_rec); node != end;
-       node = list_next(node)) {
-    tBTM_SEC_DEV_REC* p_dev_rec =
-        static_cast<tBTM_SEC_DEV_REC*>(list_node(node));
-    if (p_dev_rec->ble.identity_address_with_type.bda == bd_addr) {
-      if ((p_dev_rec->ble.identity_address_with_type.type &
-           (~BLE_ADDR_TYPE_ID_BIT)) != (addr_type & (~BLE_ADDR_TYPE_ID_BIT)))
-        BTM_TRACE_WARNING(
-            "%s find pseudo->random match with diff addr type: %d vs %d",
-            __func__, p_dev_rec->ble.identity_address_with_type.type,
-            addr_type);
-
-      /* found the match */
-      return p_dev_rec;
+  tBTM_SEC_DEV_REC* p_dev_rec =
+      btm_cb.sec_dev_rec_index.FindByIdentityAddress(bd_addr);
+
+  if (p_dev_rec == nullptr) {
+    list_node_t* end = list_end(btm_cb.sec_dev_rec);
+    for (list_node_t* node = list_begin(btm_cb.sec_dev_rec); node != end;
+         node = list_next(node)) {
+      tBTM_SEC_DEV_REC* p_rec = static_cast<tBTM_SEC_DEV_REC*>(list_node(node));
+      if (p_rec->ble.identity_address_with_type.bda == bd_addr) {
+        btm_cb.sec_dev_rec_index.AddIdentityAddress(bd_addr, p_rec);
+        p_dev_rec = p_rec;
+        break;
+      }
     }
   }
 
-  return NULL;
+  if (p_dev_rec == nullptr) return NULL;
+
+  if ((p_dev_rec->ble.identity_address_with_type.type &
+       (~BLE_ADDR_TYPE_ID_BIT)) != (addr_type & (~BLE_ADDR_TYPE_ID_BIT)))
+    BTM_TRACE_WARNING(
+        "%s find pseudo->random match with diff addr type: %d vs %d", __func__,
+        p_dev_rec->ble.identity_address_with_type.type, addr_type);
+
+  /* found the match */
+  return p_dev_rec;
 }
 
 /*******************************************************************************
@@ -134,6 +134,7 @@ bool BTM_SecAddDevice(const RawAddress& bd_addr, DEV_CLASS dev_class,
 void wipe_secrets_and_remove(tBTM_SEC_DEV_REC* p_dev_rec) {
   p_dev_rec->link_key.fill(0);
   memset(&p_dev_rec->ble.keys, 0, sizeof(tBTM_SEC_BLE_KEYS));
+  btm_cb.sec_dev_rec_index.Remove(p_dev_rec);
   list_remove(btm_cb.sec_dev_rec, p_dev_rec);
 }
 
@@ -329,14 +330,22 @@ bool is_handle_equal(void* data, void* context) {
  * Function         btm_find_dev_by_handle
  *
  * Description      Look for the record in the device database for the record
- *                  with specified handle
+ *                  with specified handle. The handle index is tried first and
+ *                  updated with the result of the walk on a miss.
  *
  * Returns          Pointer to the record or NULL
  *
  ******************************************************************************/
 tBTM_SEC_DEV_REC* btm_find_dev_by_handle(uint16_t handle) {
+  tBTM_SEC_DEV_REC* p_dev_rec = btm_cb.sec_dev_rec_index.FindByHandle(handle);
+  if (p_dev_rec) return p_dev_rec;
+
   list_node_t* n = list_foreach(btm_cb.sec_dev_rec, is_handle_equal, &handle);
-  if (n) return static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+  if (n) {
+    p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+    btm_cb.sec_dev_rec_index.AddHandle(handle, p_dev_rec);
+    return p_dev_rec;
+  }
 
   return NULL;
 }
@@ -358,7 +367,10 @@ bool is_address_equal(void* data, void* context) {
  * Function         btm_find_dev
  *
  * Description      Look for the record in the device database for the record
- *                  with specified BD address
+ *                  with specified BD address. A record whose BD address or LE
+ *                  pseudo address is bd_addr is served from the address index;
+ *                  otherwise the records are walked, resolving bd_addr against
+ *                  their IRKs, and the index is updated with the result.
  *
  * Returns          Pointer to the record or NULL
  *
@@ -366,9 +378,18 @@ bool is_address_equal(void* data, void* context) {
 tBTM_SEC_DEV_REC* btm_find_dev(const RawAddress& bd_addr) {
   if (btm_cb.sec_dev_rec == nullptr) return nullptr;
 
+  tBTM_SEC_DEV_REC* p_dev_rec = btm_cb.sec_dev_rec_index.FindByAddress(bd_addr);
+  if (p_dev_rec) return p_dev_rec;
+
   list_node_t* n =
       list_foreach(btm_cb.sec_dev_rec, is_address_equal, (void*)&bd_addr);
-  if (n) return static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+  if (n) {
+    p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+    /* A resolved RPA has been stored as the pseudo address by now */
+    if (p_dev_rec->bd_addr == bd_addr || p_dev_rec->ble.pseudo_addr == bd_addr)
+      btm_cb.sec_dev_rec_index.AddAddress(bd_addr, p_dev_rec);
+    return p_dev_rec;
+  }
 
   return NULL;
 }
@@ -31,6 +31,7 @@
 #include "stack/btm/btm_sco.h"
 #include "stack/btm/neighbor_inquiry.h"
 #include "stack/btm/security_device_record.h"
+#include "stack/btm/security_device_record_index.h"
 #include "stack/include/bt_octets.h"
 #include "stack/include/btm_ble_api_types.h"
 #include "stack/include/security_client_callbacks.h"
@@ -279,6 +280,7 @@ typedef struct tBTM_CB {
   uint8_t disc_reason{0};           /* for legacy devices */
   tBTM_SEC_SERV_REC sec_serv_rec[BTM_SEC_MAX_SERVICE_RECORDS];
   list_t* sec_dev_rec{nullptr}; /* list of tBTM_SEC_DEV_REC */
+  tBTM_SEC_DEV_REC_INDEX sec_dev_rec_index; /* lookup hints into sec_dev_rec */
   tBTM_SEC_SERV_REC* p_out_serv{nullptr};
   tBTM_MKEY_CALLBACK* mkey_cback{nullptr};
 
@@ -342,6 +344,7 @@ typedef struct tBTM_CB {
     security_mode = initial_security_mode;
     pairing_bda = RawAddress::kAny;
     sec_dev_rec = list_new(osi_free);
+    sec_dev_rec_index.Clear();
 
     /* Initialize BTM component structures */
     btm_inq_vars.Init(); /* Inquiry Database and Structures */
@@ -368,6 +371,7 @@ typedef struct tBTM_CB {
     fixed_queue_free(sec_pending_q, nullptr);
     sec_pending_q = nullptr;
 
+    sec_dev_rec_index.Clear();
     list_free(sec_dev_rec);
     sec_dev_rec = nullptr;
 
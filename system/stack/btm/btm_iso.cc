@@ -102,6 +102,10 @@ void IsoManager::SendIsoData(uint16_t iso_handle, const uint8_t* data,
   pimpl_->iso_impl_->send_iso_data(iso_handle, data, data_len);
 }
 
+void IsoManager::SendIsoSdu(uint16_t iso_handle, BT_HDR* p_sdu) {
+  pimpl_->iso_impl_->send_iso_sdu(iso_handle, p_sdu);
+}
+
 void IsoManager::CreateBig(uint8_t big_id,
                            struct iso_manager::big_create_params big_params) {
   pimpl_->iso_impl_->create_big(big_id, std::move(big_params));
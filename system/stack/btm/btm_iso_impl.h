@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <algorithm>
+#include <deque>
 #include <map>
 #include <memory>
 #include <set>
@@ -44,6 +46,8 @@ namespace iso_manager {
 static constexpr uint8_t kIsoDataInTsBtHdrOffset = 0x0C;
 static constexpr uint8_t kIsoHeaderWithTsLen = 12;
 static constexpr uint8_t kIsoHeaderWithoutTsLen = 8;
+static_assert(kIsoSduOffset >= kIsoHeaderWithTsLen,
+              "No room for the ISO header in front of SDUs");
 
 static constexpr uint8_t kStateFlagsNone = 0x00;
 static constexpr uint8_t kStateFlagIsConnecting = 0x01;
@@ -51,14 +55,27 @@ static constexpr uint8_t kStateFlagIsConnected = 0x02;
 static constexpr uint8_t kStateFlagHasDataPathSet = 0x04;
 static constexpr uint8_t kStateFlagIsBroadcast = 0x10;
 
+/* SDUs waiting for an ISO credit, per CIS/BIS. The oldest ones are dropped
+ * when there is no room left. */
+static constexpr size_t kIsoTxQueueMaxLen = 4;
+/* SDUs are dropped once waiting for longer than the transport latency, and
+ * at least this many SDU intervals */
+static constexpr uint32_t kIsoTxMinFlushTimeoutSduItvs = 2;
+
 constexpr char kBtmLogTag[] = "ISO";
 
 struct iso_sync_info {
   uint32_t first_sync_ts;
   uint16_t seq_nb;
+  /* Whether an SDU was sent since the time reference was set */
+  bool tx_started = false;
 };
 
 struct iso_base {
+  ~iso_base() {
+    for (auto& sdu : tx_queue) osi_free(sdu.packet);
+  }
+
   union {
     uint8_t cig_id;
     uint8_t big_handle;
@@ -69,6 +86,15 @@ struct iso_base {
   uint32_t sdu_itv;
   std::atomic_uint16_t used_credits;
 
+  /* ISO data packet ready to be sent, waiting for a credit */
+  struct tx_sdu {
+    BT_HDR* packet;
+    uint16_t data_len;
+    uint64_t enqueued_us;
+  };
+  std::deque<tx_sdu> tx_queue;
+  uint32_t tx_flush_timeout_us = 0;
+
   struct credits_stats {
     size_t credits_underflow_bytes = 0;
     size_t credits_underflow_count = 0;
@@ -81,8 +107,20 @@ struct iso_base {
     uint64_t evt_last_lost_us = 0;
   };
 
+  struct tx_queue_stats {
+    size_t queued_count = 0;
+    size_t max_queue_len = 0;
+    size_t dequeued_count = 0;
+    uint64_t queue_latency_sum_us = 0;
+    uint64_t queue_latency_max_us = 0;
+    size_t dropped_queue_full_count = 0;
+    size_t dropped_flush_timeout_count = 0;
+    size_t flushed_count = 0;
+  };
+
   credits_stats cr_stats;
   event_stats evt_stats;
+  tx_queue_stats txq_stats;
 };
 
 typedef iso_base iso_cis;
@@ -388,7 +426,10 @@ struct iso_impl {
                        "handle:0x%04x, status:%s", conn_handle,
                        hci_status_code_text((tHCI_STATUS)(status)).c_str()));
 
-    if (status == HCI_SUCCESS) iso->state_flags &= ~kStateFlagHasDataPathSet;
+    if (status == HCI_SUCCESS) {
+      iso->state_flags &= ~kStateFlagHasDataPathSet;
+      flush_iso_tx_queue(iso);
+    }
 
     if (iso->state_flags & kStateFlagIsBroadcast) {
       LOG_ASSERT(big_callbacks_ != nullptr) << "Invalid BIG callbacks";
@@ -507,8 +548,9 @@ struct iso_impl {
     bte_main_hci_send(packet, MSG_STACK_TO_HC_HCI_ISO | 0x0001);
   }
 
-  void send_iso_data(uint16_t iso_handle, const uint8_t* data,
-                     uint16_t data_len) {
+  /* Returns the ISO connection if SDUs can be sent on it. Its sequence number
+   * is then set for an SDU sent now, with the timestamp returned in |ts|. */
+  iso_base* get_iso_for_tx(uint16_t iso_handle, uint32_t* ts) {
     iso_base* iso = GetIsoIfKnown(iso_handle);
     LOG_ASSERT(iso != nullptr)
         << "No such iso connection handle: " << loghex(iso_handle);
@@ -517,41 +559,182 @@ struct iso_impl {
       if (!(iso->state_flags & kStateFlagIsConnected)) {
         LOG(WARNING) << __func__ << "Cis handle: " << loghex(iso_handle)
                      << " not established";
-        return;
+        return nullptr;
       }
     }
 
     if (!(iso->state_flags & kStateFlagHasDataPathSet)) {
       LOG_WARN("Data path not set for handle: 0x%04x", iso_handle);
-      return;
+      return nullptr;
     }
 
     /* Calculate sequence number for the ISO data packet.
-     * It should be incremented by 1 every SDU Interval.
+     * It should be incremented by 1 every SDU Interval. An SDU sent in the
+     * same interval as the previous one, e.g. when the source catches up on a
+     * late frame, takes the next interval rather than reusing its number. SDUs
+     * waiting for a credit keep the sequence number they were sent with.
+     *
+     * The SDUs are not held back until their interval: the sources already
+     * send them once per SDU interval, and the queue only bridges the times
+     * the controller runs out of buffers.
      */
-    uint32_t ts = bluetooth::common::time_get_os_boottime_us();
-    iso->sync_info.seq_nb = (ts - iso->sync_info.first_sync_ts) / iso->sdu_itv;
+    *ts = bluetooth::common::time_get_os_boottime_us();
+    uint16_t seq_nb = (*ts - iso->sync_info.first_sync_ts) / iso->sdu_itv;
+    if (iso->sync_info.tx_started &&
+        static_cast<int16_t>(seq_nb - iso->sync_info.seq_nb) <= 0) {
+      seq_nb = iso->sync_info.seq_nb + 1;
+    }
+    iso->sync_info.seq_nb = seq_nb;
+    iso->sync_info.tx_started = true;
+    return iso;
+  }
 
-    if (iso_credits_ == 0 || data_len > iso_buffer_size_) {
-      iso->cr_stats.credits_underflow_bytes += data_len;
-      iso->cr_stats.credits_underflow_count++;
-      iso->cr_stats.credits_last_underflow_us =
-          bluetooth::common::time_get_os_boottime_us();
+  /* Counts an SDU dropped for the lack of a controller buffer */
+  void count_credits_underflow(iso_base* iso, uint16_t data_len) {
+    iso->cr_stats.credits_underflow_bytes += data_len;
+    iso->cr_stats.credits_underflow_count++;
+    iso->cr_stats.credits_last_underflow_us = bluetooth::common::time_get_os_boottime_us();
+  }
+
+  void send_iso_packet_with_credit(iso_base* iso, BT_HDR* packet) {
+    iso_credits_--;
+    iso->used_credits++;
+    send_iso_data_hci_packet(packet);
+  }
+
+  /* Sends the ISO data packet if there is an ISO credit for it, queues it
+   * until there is one otherwise */
+  void send_or_queue_iso_packet(uint16_t iso_handle, iso_base* iso,
+                                BT_HDR* packet, uint16_t data_len) {
+    if (iso->tx_queue.empty() && iso_credits_ > 0) {
+      send_iso_packet_with_credit(iso, packet);
+      return;
+    }
+
+    uint64_t now_us = bluetooth::common::time_get_os_boottime_us();
+    drop_expired_iso_packets(iso, now_us);
+    if (iso->tx_queue.size() >= kIsoTxQueueMaxLen) {
+      LOG(WARNING) << __func__ << ", dropping oldest ISO packet, iso handle: "
+                   << loghex(iso_handle);
+      count_credits_underflow(iso, iso->tx_queue.front().data_len);
+      osi_free(iso->tx_queue.front().packet);
+      iso->tx_queue.pop_front();
+      iso->txq_stats.dropped_queue_full_count++;
+    }
+
+    iso->tx_queue.push_back(
+        {.packet = packet, .data_len = data_len, .enqueued_us = now_us});
+    iso->txq_stats.queued_count++;
+    iso->txq_stats.max_queue_len =
+        std::max(iso->txq_stats.max_queue_len, iso->tx_queue.size());
+  }
+
+  /* Drops the queued SDUs which have been waiting for longer than their flush
+   * timeout */
+  void drop_expired_iso_packets(iso_base* iso, uint64_t now_us) {
+    while (!iso->tx_queue.empty() &&
+           now_us - iso->tx_queue.front().enqueued_us >
+               iso->tx_flush_timeout_us) {
+      count_credits_underflow(iso, iso->tx_queue.front().data_len);
+      osi_free(iso->tx_queue.front().packet);
+      iso->tx_queue.pop_front();
+      iso->txq_stats.dropped_flush_timeout_count++;
+    }
+  }
+
+  /* Sends the queued SDUs with the ISO credits available, one SDU per CIS/BIS
+   * in turn */
+  void send_queued_iso_packets() {
+    uint64_t now_us = bluetooth::common::time_get_os_boottime_us();
+    bool sent = true;
+
+    while (sent && iso_credits_ > 0) {
+      sent = false;
+      for (auto* iso_map : {&conn_hdl_to_cis_map_, &conn_hdl_to_bis_map_}) {
+        for (auto& iso_pair : *iso_map) {
+          iso_base* iso = iso_pair.second.get();
+          drop_expired_iso_packets(iso, now_us);
+          if (iso->tx_queue.empty() || iso_credits_ == 0) continue;
+
+          auto sdu = iso->tx_queue.front();
+          iso->tx_queue.pop_front();
+
+          uint64_t latency_us = now_us - sdu.enqueued_us;
+          iso->txq_stats.dequeued_count++;
+          iso->txq_stats.queue_latency_sum_us += latency_us;
+          iso->txq_stats.queue_latency_max_us =
+              std::max(iso->txq_stats.queue_latency_max_us, latency_us);
+
+          send_iso_packet_with_credit(iso, sdu.packet);
+          sent = true;
+        }
+      }
+    }
+  }
 
+  /* Frees the SDUs still queued, e.g. once the CIS is gone */
+  void flush_iso_tx_queue(iso_base* iso) {
+    iso->txq_stats.flushed_count += iso->tx_queue.size();
+    for (auto& sdu : iso->tx_queue) osi_free(sdu.packet);
+    iso->tx_queue.clear();
+  }
+
+  void send_iso_data(uint16_t iso_handle, const uint8_t* data,
+                     uint16_t data_len) {
+    uint32_t ts;
+    iso_base* iso = get_iso_for_tx(iso_handle, &ts);
+    if (iso == nullptr) return;
+
+    if (data_len > iso_buffer_size_) {
+      count_credits_underflow(iso, data_len);
       LOG(WARNING) << __func__ << ", dropping ISO packet, len: "
                    << static_cast<int>(data_len)
-                   << ", iso credits: " << static_cast<int>(iso_credits_)
                    << ", iso handle: " << loghex(iso_handle);
       return;
     }
 
-    iso_credits_--;
-    iso->used_credits++;
-
     BT_HDR* packet =
         prepare_ts_hci_packet(iso_handle, ts, iso->sync_info.seq_nb, data_len);
     memcpy(packet->data + kIsoDataInTsBtHdrOffset, data, data_len);
-    send_iso_data_hci_packet(packet);
+    send_or_queue_iso_packet(iso_handle, iso, packet, data_len);
+  }
+
+  void send_iso_sdu(uint16_t iso_handle, BT_HDR* sdu) {
+    LOG_ASSERT(sdu->offset >= kIsoHeaderWithTsLen)
+        << "No room for the ISO header, offset: " << +sdu->offset;
+
+    uint32_t ts;
+    uint16_t data_len = sdu->len;
+    iso_base* iso = get_iso_for_tx(iso_handle, &ts);
+    if (iso == nullptr) {
+      osi_free(sdu);
+      return;
+    }
+
+    if (data_len > iso_buffer_size_) {
+      count_credits_underflow(iso, data_len);
+      LOG(WARNING) << __func__ << ", dropping ISO packet, len: "
+                   << static_cast<int>(data_len)
+                   << ", iso handle: " << loghex(iso_handle);
+      osi_free(sdu);
+      return;
+    }
+
+    /* Write the header of the ISO data packet in front of the SDU */
+    sdu->offset -= kIsoHeaderWithTsLen;
+    sdu->len += kIsoHeaderWithTsLen;
+    sdu->event = MSG_STACK_TO_HC_HCI_ISO;
+    sdu->layer_specific = BT_ISO_HDR_CONTAINS_TS;
+
+    uint8_t* packet_data = sdu->data + sdu->offset;
+    UINT16_TO_STREAM(packet_data, iso_handle);
+    /* Add 2 for packet seq., 2 for length, 4 for the timestamp */
+    UINT16_TO_STREAM(packet_data, data_len + 8);
+    UINT32_TO_STREAM(packet_data, ts);
+    UINT16_TO_STREAM(packet_data, iso->sync_info.seq_nb);
+    UINT16_TO_STREAM(packet_data, data_len);
+
+    send_or_queue_iso_packet(iso_handle, iso, sdu, data_len);
   }
 
   void process_cis_est_pkt(uint8_t len, uint8_t* data) {
@@ -573,6 +756,7 @@ struct iso_impl {
                        hci_error_code_text((tHCI_STATUS)(evt.status)).c_str()));
 
     cis->sync_info.first_sync_ts = bluetooth::common::time_get_os_boottime_us();
+    cis->sync_info.tx_started = false;
 
     STREAM_TO_UINT24(evt.cig_sync_delay, data);
     STREAM_TO_UINT24(evt.cis_sync_delay, data);
@@ -591,6 +775,8 @@ struct iso_impl {
 
     if (evt.status == HCI_SUCCESS) {
       cis->state_flags |= kStateFlagIsConnected;
+      cis->tx_flush_timeout_us = std::max(
+          evt.trans_lat_mtos, kIsoTxMinFlushTimeoutSduItvs * cis->sdu_itv);
     } else {
       cis_hdl_to_addr.erase(evt.cis_conn_hdl);
     }
@@ -629,6 +815,8 @@ struct iso_impl {
       /* return used credits */
       iso_credits_ += cis->used_credits;
       cis->used_credits = 0;
+      flush_iso_tx_queue(cis);
+      send_queued_iso_packets();
 
       /* Data path is considered still valid, but can be reconfigured only once
        * CIS is reestablished.
@@ -663,6 +851,8 @@ struct iso_impl {
         continue;
       }
     }
+
+    send_queued_iso_packets();
   }
 
   void handle_gd_num_completed_pkts(uint16_t handle, uint16_t credits) {
@@ -670,14 +860,15 @@ struct iso_impl {
     if (iter != conn_hdl_to_cis_map_.end()) {
       iter->second->used_credits -= credits;
       iso_credits_ += credits;
-      return;
-    }
+    } else {
+      iter = conn_hdl_to_bis_map_.find(handle);
+      if (iter == conn_hdl_to_bis_map_.end()) return;
 
-    iter = conn_hdl_to_bis_map_.find(handle);
-    if (iter != conn_hdl_to_bis_map_.end()) {
       iter->second->used_credits -= credits;
       iso_credits_ += credits;
     }
+
+    send_queued_iso_packets();
   }
 
   void process_create_big_cmpl_pkt(uint8_t len, uint8_t* data) {
@@ -718,6 +909,9 @@ struct iso_impl {
         bis->sdu_itv = last_big_create_req_sdu_itv_;
         bis->sync_info = {.first_sync_ts = ts, .seq_nb = 0};
         bis->used_credits = 0;
+        bis->tx_flush_timeout_us =
+            std::max(evt.transport_latency_big,
+                     kIsoTxMinFlushTimeoutSduItvs * bis->sdu_itv);
         bis->state_flags = kStateFlagIsBroadcast;
         conn_hdl_to_bis_map_[conn_handle] = std::move(bis);
       }
@@ -841,8 +1035,7 @@ struct iso_impl {
       evt.evt_lost = new_calc_seq_nb - iso->sync_info.seq_nb - 1;
       if (evt.evt_lost > 0) {
         iso->evt_stats.evt_lost_count += evt.evt_lost;
-        iso->evt_stats.evt_last_lost_us =
-            bluetooth::common::time_get_os_boottime_us();
+        iso->evt_stats.evt_last_lost_us = bluetooth::common::time_get_os_boottime_us();
 
         LOG(WARNING) << evt.evt_lost << " packets possibly lost.";
       }
@@ -928,6 +1121,29 @@ struct iso_impl {
                  : 0llu));
   }
 
+  static void dump_tx_queue_stats(int fd, const iso_base& iso) {
+    const iso_base::tx_queue_stats& stats = iso.txq_stats;
+
+    dprintf(fd, "        Tx Queue Stats:\n");
+    dprintf(fd, "          Queued SDUs (now/max): %zu/%zu\n",
+            iso.tx_queue.size(), stats.max_queue_len);
+    dprintf(fd, "          Flush timeout (us): %u\n", iso.tx_flush_timeout_us);
+    dprintf(fd, "          Queued for a credit (count): %zu\n",
+            stats.queued_count);
+    dprintf(fd, "          Queue latency avg/max (us): %llu/%llu\n",
+            (stats.dequeued_count > 0
+                 ? (unsigned long long)(stats.queue_latency_sum_us /
+                                        stats.dequeued_count)
+                 : 0llu),
+            (unsigned long long)stats.queue_latency_max_us);
+    dprintf(fd, "          Dropped, queue full (count): %zu\n",
+            stats.dropped_queue_full_count);
+    dprintf(fd, "          Dropped, flush timeout (count): %zu\n",
+            stats.dropped_flush_timeout_count);
+    dprintf(fd, "          Flushed (count): %zu\n",
+            stats.flushed_count);
+  }
+
   void dump(int fd) const {
     dprintf(fd, "  ----------------\n ");
     dprintf(fd, "  ISO Manager:\n");
@@ -943,6 +1159,7 @@ struct iso_impl {
       dprintf(fd, "        State Flags: 0x%02hx\n",
               cis_pair.second->state_flags.load());
       dump_credits_stats(fd, cis_pair.second->cr_stats);
+      dump_tx_queue_stats(fd, *cis_pair.second);
       dump_event_stats(fd, cis_pair.second->evt_stats);
     }
     dprintf(fd, "    BISes:\n");
@@ -955,6 +1172,7 @@ struct iso_impl {
       dprintf(fd, "        State Flags: 0x%02hx\n",
               cis_pair.second->state_flags.load());
       dump_credits_stats(fd, cis_pair.second->cr_stats);
+      dump_tx_queue_stats(fd, *cis_pair.second);
       dump_event_stats(fd, cis_pair.second->evt_stats);
     }
     dprintf(fd, "  ----------------\n ");
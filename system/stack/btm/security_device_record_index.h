@@ -0,0 +1,125 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+
+#include "stack/btm/security_device_record.h"
+#include "stack/include/hcidefs.h"
+#include "types/raw_address.h"
+
+/*
+ * Secondary indexes into the list of security device records, keyed by
+ * address (BD address or LE pseudo address), LE identity address and ACL
+ * handle (BR/EDR or LE).
+ *
+ * Record fields are updated in place all over the stack, so an entry is only a
+ * hint: it is checked against the record on every hit and erased once stale,
+ * and callers fall back to walking the list on a miss and then store what they
+ * found. The list stays the owner of the records and the only way to iterate
+ * over them.
+ *
+ * An address entry only ever holds an exact BD or pseudo address match, so a
+ * record found through it is returned even when a record earlier in the list
+ * would resolve the address with its IRK.
+ */
+struct tBTM_SEC_DEV_REC_INDEX {
+  tBTM_SEC_DEV_REC* FindByAddress(const RawAddress& bd_addr) {
+    auto it = by_address_.find(bd_addr);
+    if (it == by_address_.end()) return nullptr;
+    tBTM_SEC_DEV_REC* p_dev_rec = it->second;
+    if (p_dev_rec->bd_addr != bd_addr &&
+        p_dev_rec->ble.pseudo_addr != bd_addr) {
+      by_address_.erase(it);
+      return nullptr;
+    }
+    return p_dev_rec;
+  }
+
+  tBTM_SEC_DEV_REC* FindByIdentityAddress(const RawAddress& bd_addr) {
+    auto it = by_identity_address_.find(bd_addr);
+    if (it == by_identity_address_.end()) return nullptr;
+    tBTM_SEC_DEV_REC* p_dev_rec = it->second;
+    if (p_dev_rec->ble.identity_address_with_type.bda != bd_addr) {
+      by_identity_address_.erase(it);
+      return nullptr;
+    }
+    return p_dev_rec;
+  }
+
+  tBTM_SEC_DEV_REC* FindByHandle(uint16_t handle) {
+    auto it = by_handle_.find(handle);
+    if (it == by_handle_.end()) return nullptr;
+    tBTM_SEC_DEV_REC* p_dev_rec = it->second;
+    if (p_dev_rec->hci_handle != handle &&
+        p_dev_rec->ble_hci_handle != handle) {
+      by_handle_.erase(it);
+      return nullptr;
+    }
+    return p_dev_rec;
+  }
+
+  void AddAddress(const RawAddress& bd_addr, tBTM_SEC_DEV_REC* p_dev_rec) {
+    by_address_[bd_addr] = p_dev_rec;
+  }
+
+  void AddIdentityAddress(const RawAddress& bd_addr,
+                          tBTM_SEC_DEV_REC* p_dev_rec) {
+    by_identity_address_[bd_addr] = p_dev_rec;
+  }
+
+  void AddHandle(uint16_t handle, tBTM_SEC_DEV_REC* p_dev_rec) {
+    /* Every disconnected record shares the invalid handle */
+    if (handle == HCI_INVALID_HANDLE) return;
+    by_handle_[handle] = p_dev_rec;
+  }
+
+  /* Drops every entry pointing to |p_dev_rec|, including stale ones, before
+   * the record is freed */
+  void Remove(const tBTM_SEC_DEV_REC* p_dev_rec) {
+    EraseRecord(by_address_, p_dev_rec);
+    EraseRecord(by_identity_address_, p_dev_rec);
+    EraseRecord(by_handle_, p_dev_rec);
+  }
+
+  void Clear() {
+    by_address_.clear();
+    by_identity_address_.clear();
+    by_handle_.clear();
+  }
+
+  size_t Size() const {
+    return by_address_.size() + by_identity_address_.size() +
+           by_handle_.size();
+  }
+
+ private:
+  template <typename Map>
+  static void EraseRecord(Map& map, const tBTM_SEC_DEV_REC* p_dev_rec) {
+    for (auto it = map.begin(); it != map.end();) {
+      if (it->second == p_dev_rec)
+        it = map.erase(it);
+      else
+        ++it;
+    }
+  }
+
+  std::unordered_map<RawAddress, tBTM_SEC_DEV_REC*> by_address_;
+  std::unordered_map<RawAddress, tBTM_SEC_DEV_REC*> by_identity_address_;
+  std::unordered_map<uint16_t, tBTM_SEC_DEV_REC*> by_handle_;
+};
@@ -32,6 +32,7 @@
 #include <base/logging.h>
 
 #include <cstdint>
+#include <vector>
 
 #include "btif/include/btif_config.h"
 #include "common/metrics.h"
@@ -894,6 +895,48 @@ void btu_hcif_send_cmd_with_cb(const base::Location& posted_from,
       btu_hcif_command_status_evt_with_cb, (void*)cb_wrapper);
 }
 
+/*******************************************************************************
+ *
+ * Function         btu_hcif_send_cmd_params
+ *
+ * Description      This function is called to send a command to the Host
+ *                  Controller from its encoded parameters, which are handed
+ *                  to the HCI layer as they are instead of being copied out
+ *                  of a BT_HDR. Only for commands answered by a Command
+ *                  Complete event.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btu_hcif_send_cmd_params(uint16_t opcode, std::vector<uint8_t> params) {
+  btu_hcif_log_command_metrics(opcode, params.data(),
+                               android::bluetooth::hci::STATUS_UNKNOWN, false);
+
+  bluetooth::shim::hci_layer_get_interface()->transmit_command_params(
+      opcode, std::move(params), btu_hcif_command_complete_evt, nullptr);
+}
+
+/* Same as btu_hcif_send_cmd_with_cb() for commands answered by a Command
+ * Complete event, without building a BT_HDR for the command. */
+void btu_hcif_send_cmd_params_with_cb(const base::Location& posted_from,
+                                      uint16_t opcode,
+                                      std::vector<uint8_t> params,
+                                      hci_cmd_cb cb) {
+  btu_hcif_log_command_metrics(opcode, params.data(),
+                               android::bluetooth::hci::STATUS_UNKNOWN, false);
+
+  cmd_with_cb_data* cb_wrapper =
+      (cmd_with_cb_data*)osi_malloc(sizeof(cmd_with_cb_data));
+
+  cmd_with_cb_data_init(cb_wrapper);
+  cb_wrapper->cb = std::move(cb);
+  cb_wrapper->posted_from = posted_from;
+
+  bluetooth::shim::hci_layer_get_interface()->transmit_command_params(
+      opcode, std::move(params), btu_hcif_command_complete_evt_with_cb,
+      (void*)cb_wrapper);
+}
+
 /*******************************************************************************
  *
  * Function         btu_hcif_inquiry_comp_evt
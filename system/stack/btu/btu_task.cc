@@ -35,6 +35,7 @@
 #include "osi/include/allocator.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/properties.h"
 #include "stack/include/acl_hci_link_interface.h"
 #include "stack/include/bt_hdr.h"
 #include "stack/include/btu.h"
@@ -116,6 +117,11 @@ void post_on_bt_main(BtMainClosure closure) {
 }
 
 void main_thread_start_up() {
+  // Before the first task, so that enabling does not skew the first results
+  if (osi_property_get_bool("persist.bluetooth.task_latency_tracing.enabled",
+                            false)) {
+    main_thread.EnableTaskLatencyTracing(true);
+  }
   main_thread.StartUp();
   if (!main_thread.IsRunning()) {
     LOG(FATAL) << __func__ << ": unable to start btu message loop thread.";
@@ -136,7 +136,9 @@ static void gatt_update_last_srv_info() {
 
 /** Update database hash and client status */
 static void gatt_update_for_database_change() {
-  gatt_cb.database_hash = gatts_calculate_database_hash(gatt_cb.srv_list_info);
+  // Services are usually added one after the other, compute the hash once
+  // when it is needed rather than on each of them
+  gatts_invalidate_database_hash();
 
   uint8_t i = 0;
   for (i = 0; i < GATT_MAX_PHY_CHANNEL; i++) {
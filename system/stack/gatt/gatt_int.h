@@ -295,6 +295,8 @@ typedef struct {
   uint16_t e_hdl;      /* service ending handle */
   tGATT_IF gatt_if;    /* this service is belong to which application */
   bool is_primary;
+  /* byte reversed database hash input of this service, built on first use */
+  std::vector<uint8_t> hash_segment;
 } tGATT_SRV_LIST_ELEM;
 
 typedef struct {
@@ -441,7 +443,9 @@ typedef struct {
   uint8_t gatt_cl_supported_feat_mask;
 
   uint16_t handle_of_database_hash;
-  Octet16 database_hash;
+  Octet16 database_hash; /* only up to date if database_hash_valid is set,
+                            use gatts_get_database_hash() */
+  bool database_hash_valid;
 
   tGATT_APPL_INFO cb_info;
 
@@ -684,5 +688,7 @@ extern bluetooth::Uuid* gatts_get_service_uuid(tGATT_SVC_DB* p_db);
 /* gatt_sr_hash.cc */
 extern Octet16 gatts_calculate_database_hash(
     std::list<tGATT_SRV_LIST_ELEM>* lst_ptr);
+extern const Octet16& gatts_get_database_hash();
+extern void gatts_invalidate_database_hash();
 
 #endif
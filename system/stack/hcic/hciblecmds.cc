@@ -28,6 +28,7 @@
 #include <string.h>
 
 #include <bitset>
+#include <vector>
 
 #include "bt_target.h"
 #include "btu.h"
@@ -259,19 +260,13 @@ void btsnd_hcic_ble_set_scan_params(uint8_t scan_type, uint16_t scan_int,
 }
 
 void btsnd_hcic_ble_set_scan_enable(uint8_t scan_enable, uint8_t duplicate) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
-  uint8_t* pp = (uint8_t*)(p + 1);
-
-  p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_BLE_WRITE_SCAN_ENABLE;
-  p->offset = 0;
-
-  UINT16_TO_STREAM(pp, HCI_BLE_WRITE_SCAN_ENABLE);
-  UINT8_TO_STREAM(pp, HCIC_PARAM_SIZE_BLE_WRITE_SCAN_ENABLE);
+  std::vector<uint8_t> params(HCIC_PARAM_SIZE_BLE_WRITE_SCAN_ENABLE);
+  uint8_t* pp = params.data();
 
   UINT8_TO_STREAM(pp, scan_enable);
   UINT8_TO_STREAM(pp, duplicate);
 
-  btu_hcif_send_cmd(LOCAL_BR_EDR_CONTROLLER_ID, p);
+  btu_hcif_send_cmd_params(HCI_BLE_WRITE_SCAN_ENABLE, std::move(params));
 }
 
 /* link layer connection management commands */
@@ -655,20 +650,14 @@ void btsnd_hcic_ble_set_rand_priv_addr_timeout(uint16_t rpa_timout) {
 
 void btsnd_hcic_ble_set_data_length(uint16_t conn_handle, uint16_t tx_octets,
                                     uint16_t tx_time) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
-  uint8_t* pp = (uint8_t*)(p + 1);
-
-  p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_BLE_SET_DATA_LENGTH;
-  p->offset = 0;
-
-  UINT16_TO_STREAM(pp, HCI_BLE_SET_DATA_LENGTH);
-  UINT8_TO_STREAM(pp, HCIC_PARAM_SIZE_BLE_SET_DATA_LENGTH);
+  std::vector<uint8_t> params(HCIC_PARAM_SIZE_BLE_SET_DATA_LENGTH);
+  uint8_t* pp = params.data();
 
   UINT16_TO_STREAM(pp, conn_handle);
   UINT16_TO_STREAM(pp, tx_octets);
   UINT16_TO_STREAM(pp, tx_time);
 
-  btu_hcif_send_cmd(LOCAL_BR_EDR_CONTROLLER_ID, p);
+  btu_hcif_send_cmd_params(HCI_BLE_SET_DATA_LENGTH, std::move(params));
 }
 
 void btsnd_hcic_ble_enh_rx_test(uint8_t rx_chan, uint8_t phy,
@@ -741,22 +730,16 @@ void btsnd_hcic_ble_set_extended_scan_enable(uint8_t enable,
                                              uint8_t filter_duplicates,
                                              uint16_t duration,
                                              uint16_t period) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
-  uint8_t* pp = (uint8_t*)(p + 1);
-
   const int param_len = 6;
-  p->len = HCIC_PREAMBLE_SIZE + param_len;
-  p->offset = 0;
-
-  UINT16_TO_STREAM(pp, HCI_LE_SET_EXTENDED_SCAN_ENABLE);
-  UINT8_TO_STREAM(pp, param_len);
+  std::vector<uint8_t> params(param_len);
+  uint8_t* pp = params.data();
 
   UINT8_TO_STREAM(pp, enable);
   UINT8_TO_STREAM(pp, filter_duplicates);
   UINT16_TO_STREAM(pp, duration);
   UINT16_TO_STREAM(pp, period);
 
-  btu_hcif_send_cmd(LOCAL_BR_EDR_CONTROLLER_ID, p);
+  btu_hcif_send_cmd_params(HCI_LE_SET_EXTENDED_SCAN_ENABLE, std::move(params));
 }
 
 void btsnd_hcic_ble_ext_create_conn(uint8_t init_filter_policy,
@@ -1023,8 +1006,8 @@ void btsnd_hcic_setup_iso_data_path(
     std::vector<uint8_t> codec_conf,
     base::OnceCallback<void(uint8_t*, uint16_t)> cb) {
   const int params_len = 13 + codec_conf.size();
-  uint8_t param[params_len];
-  uint8_t* pp = param;
+  std::vector<uint8_t> params(params_len);
+  uint8_t* pp = params.data();
 
   UINT16_TO_STREAM(pp, iso_handle);
   UINT8_TO_STREAM(pp, data_path_dir);
@@ -1036,22 +1019,22 @@ void btsnd_hcic_setup_iso_data_path(
   UINT8_TO_STREAM(pp, codec_conf.size());
   ARRAY_TO_STREAM(pp, codec_conf.data(), static_cast<int>(codec_conf.size()));
 
-  btu_hcif_send_cmd_with_cb(FROM_HERE, HCI_LE_SETUP_ISO_DATA_PATH, param,
-                            params_len, std::move(cb));
+  btu_hcif_send_cmd_params_with_cb(FROM_HERE, HCI_LE_SETUP_ISO_DATA_PATH,
+                                   std::move(params), std::move(cb));
 }
 
 void btsnd_hcic_remove_iso_data_path(
     uint16_t iso_handle, uint8_t data_path_dir,
     base::OnceCallback<void(uint8_t*, uint16_t)> cb) {
   const int params_len = 3;
-  uint8_t param[params_len];
-  uint8_t* pp = param;
+  std::vector<uint8_t> params(params_len);
+  uint8_t* pp = params.data();
 
   UINT16_TO_STREAM(pp, iso_handle);
   UINT8_TO_STREAM(pp, data_path_dir);
 
-  btu_hcif_send_cmd_with_cb(FROM_HERE, HCI_LE_REMOVE_ISO_DATA_PATH, param,
-                            params_len, std::move(cb));
+  btu_hcif_send_cmd_params_with_cb(FROM_HERE, HCI_LE_REMOVE_ISO_DATA_PATH,
+                                   std::move(params), std::move(cb));
 }
 
 void btsnd_hcic_read_iso_link_quality(
@@ -27,6 +27,8 @@
 #include <stddef.h>
 #include <string.h>
 
+#include <vector>
+
 #include "bt_target.h"
 #include "btu.h"
 #include "device/include/esco_parameters.h"
@@ -1726,18 +1728,12 @@ void btsnd_hcic_get_link_quality(uint16_t handle) {
 }
 
 void btsnd_hcic_read_rssi(uint16_t handle) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
-  uint8_t* pp = (uint8_t*)(p + 1);
-
-  p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_CMD_HANDLE;
-  p->offset = 0;
-
-  UINT16_TO_STREAM(pp, HCI_READ_RSSI);
-  UINT8_TO_STREAM(pp, HCIC_PARAM_SIZE_CMD_HANDLE);
+  std::vector<uint8_t> params(HCIC_PARAM_SIZE_CMD_HANDLE);
+  uint8_t* pp = params.data();
 
   UINT16_TO_STREAM(pp, handle);
 
-  btu_hcif_send_cmd(LOCAL_BR_EDR_CONTROLLER_ID, p);
+  btu_hcif_send_cmd_params(HCI_READ_RSSI, std::move(params));
 }
 
 static void read_encryption_key_size_complete(ReadEncKeySizeCb cb, uint8_t* return_parameters,
@@ -165,6 +165,16 @@ class IsoManager {
   virtual void SendIsoData(uint16_t conn_handle, const uint8_t* data,
                            uint16_t data_len);
 
+  /**
+   * Sends iso data to the controller without copying it
+   *
+   * @param conn_handle handle of BIS or CIS connection
+   * @param p_sdu buffer holding the SDU at p_sdu->offset, which must leave at
+   * least iso_manager::kIsoSduOffset bytes for the ISO data packet header. The
+   * ownership of the buffer is transferred.
+   */
+  virtual void SendIsoSdu(uint16_t conn_handle, BT_HDR* p_sdu);
+
   /**
    * Creates the Broadcast Isochronous Group
    *
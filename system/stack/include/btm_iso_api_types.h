@@ -60,6 +60,10 @@ constexpr uint8_t kIsoSca31To50Ppm = 0x05;
 constexpr uint8_t kIsoSca21To30Ppm = 0x06;
 constexpr uint8_t kIsoSca0To20Ppm = 0x07;
 
+/* Room to leave in front of an SDU handed over with SendIsoSdu(), for the
+ * header of the ISO data packet with timestamp */
+constexpr uint16_t kIsoSduOffset = 12;
+
 constexpr uint8_t kIsoEventCisDataAvailable = 0x00;
 constexpr uint8_t kIsoEventCisEstablishCmpl = 0x01;
 constexpr uint8_t kIsoEventCisDisconnected = 0x02;
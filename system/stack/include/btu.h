@@ -32,6 +32,7 @@
 #include <base/threading/thread.h>
 
 #include <cstdint>
+#include <vector>
 
 #include "bt_target.h"
 #include "common/message_loop_thread.h"
@@ -53,6 +54,11 @@ void btu_hcif_send_cmd_with_cb(const base::Location& posted_from,
                                uint16_t opcode, uint8_t* params,
                                uint8_t params_len,
                                base::OnceCallback<void(uint8_t*, uint16_t)> cb);
+void btu_hcif_send_cmd_params(uint16_t opcode, std::vector<uint8_t> params);
+void btu_hcif_send_cmd_params_with_cb(
+    const base::Location& posted_from, uint16_t opcode,
+    std::vector<uint8_t> params,
+    base::OnceCallback<void(uint8_t*, uint16_t)> cb);
 namespace bluetooth::legacy::testing {
 void btu_hcif_hdl_command_status(uint16_t opcode, uint8_t status,
                                  const uint8_t* p_cmd,
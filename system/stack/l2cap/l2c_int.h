@@ -574,6 +574,10 @@ typedef struct t_l2c_linkcb {
   }
 } tL2C_LCB;
 
+/* HCI connection handles are 12 bits, see HCI_DATA_HANDLE_MASK
+*/
+#define L2C_NUM_HCI_HANDLES 0x1000
+
 /* Define the L2CAP control structure
 */
 typedef struct {
@@ -597,6 +601,12 @@ typedef struct {
   bool is_cong_cback_context;
 
   tL2C_LCB lcb_pool[MAX_L2CAP_LINKS];    /* Link Control Block pool */
+  /* Index + 1 in lcb_pool of the link using each HCI handle, 0 if none. Keeps
+   * the per packet lookup from scanning the pool */
+  uint8_t lcb_index_by_handle[L2C_NUM_HCI_HANDLES];
+  /* The LCBs in use, in pool order, for the lookups and the round robin */
+  tL2C_LCB* p_active_lcbs[MAX_L2CAP_LINKS];
+  uint16_t num_active_lcbs;
   tL2C_CCB ccb_pool[MAX_L2CAP_CHANNELS]; /* Channel Control Block pool */
   tL2C_RCB rcb_pool[MAX_L2CAP_CLIENTS];  /* Registration info pool */
 
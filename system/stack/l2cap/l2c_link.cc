@@ -911,16 +911,26 @@ void l2c_link_check_send_pkts(tL2C_LCB* p_lcb, uint16_t local_cid,
   */
   if ((p_lcb == NULL) || (p_lcb->link_xmit_quota == 0)) {
     LOG_DEBUG("Round robin");
-    if (p_lcb == NULL) {
-      p_lcb = l2cb.lcb_pool;
-    } else if (!single_write) {
-      p_lcb++;
+    /* Only the active links are visited, in pool order */
+    uint16_t num_active_lcbs = l2cb.num_active_lcbs;
+    uint16_t start = 0;
+    if (p_lcb != NULL) {
+      while (start < num_active_lcbs &&
+             (l2cb.p_active_lcbs[start] < p_lcb ||
+              (!single_write && l2cb.p_active_lcbs[start] == p_lcb))) {
+        start++;
+      }
+    } else if (num_active_lcbs > 0) {
+      p_lcb = l2cb.p_active_lcbs[0];
+    } else {
+      return;
     }
+    tL2C_LCB* p_first_lcb = p_lcb;
 
     /* Loop through, starting at the next */
-    for (int xx = 0; xx < MAX_L2CAP_LINKS; xx++, p_lcb++) {
-      /* Check for wraparound */
-      if (p_lcb == &l2cb.lcb_pool[MAX_L2CAP_LINKS]) p_lcb = &l2cb.lcb_pool[0];
+    for (uint16_t yy = 0; yy < num_active_lcbs; yy++) {
+      uint16_t xx = (start + yy) % num_active_lcbs;
+      p_lcb = l2cb.p_active_lcbs[xx];
 
       /* If controller window is full, nothing to do */
       if (((l2cb.controller_xmit_window == 0 ||
@@ -963,6 +973,7 @@ void l2c_link_check_send_pkts(tL2C_LCB* p_lcb, uint16_t local_cid,
     }
 
     /* If we finished without using up our quota, no need for a safety check */
+    p_lcb = p_first_lcb;
     if ((l2cb.controller_xmit_window > 0) &&
         (l2cb.round_robin_unacked < l2cb.round_robin_quota) &&
         (p_lcb->transport == BT_TRANSPORT_BR_EDR))
@@ -45,6 +45,54 @@
 
 tL2C_CCB* l2cu_get_next_channel_in_rr(tL2C_LCB* p_lcb); // TODO Move
 
+static_assert(MAX_L2CAP_LINKS < UINT8_MAX,
+              "lcb_index_by_handle can't index the LCB pool");
+
+/*******************************************************************************
+ *
+ * Function         l2cu_add_active_lcb
+ *
+ * Description      Add an LCB to the active links, which are kept in pool
+ *                  order for the round robin
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void l2cu_add_active_lcb(tL2C_LCB* p_lcb) {
+  uint16_t xx = l2cb.num_active_lcbs;
+  while (xx > 0 && l2cb.p_active_lcbs[xx - 1] > p_lcb) {
+    l2cb.p_active_lcbs[xx] = l2cb.p_active_lcbs[xx - 1];
+    xx--;
+  }
+  l2cb.p_active_lcbs[xx] = p_lcb;
+  l2cb.num_active_lcbs++;
+}
+
+/*******************************************************************************
+ *
+ * Function         l2cu_remove_active_lcb
+ *
+ * Description      Remove an LCB from the active links, and its HCI handle
+ *                  from the handle index
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void l2cu_remove_active_lcb(tL2C_LCB* p_lcb) {
+  uint16_t xx = 0;
+  while (xx < l2cb.num_active_lcbs && l2cb.p_active_lcbs[xx] != p_lcb) xx++;
+  if (xx == l2cb.num_active_lcbs) return;
+
+  for (l2cb.num_active_lcbs--; xx < l2cb.num_active_lcbs; xx++) {
+    l2cb.p_active_lcbs[xx] = l2cb.p_active_lcbs[xx + 1];
+  }
+
+  uint8_t& index =
+      l2cb.lcb_index_by_handle[p_lcb->Handle() & (L2C_NUM_HCI_HANDLES - 1)];
+  if (index == (p_lcb - l2cb.lcb_pool) + 1) index = 0;
+}
+
+
 /*******************************************************************************
  *
  * Function         l2cu_allocate_lcb
@@ -68,6 +116,7 @@ tL2C_LCB* l2cu_allocate_lcb(const RawAddress& p_bd_addr, bool is_bonding,
       p_lcb->remote_bd_addr = p_bd_addr;
 
       p_lcb->in_use = true;
+      l2cu_add_active_lcb(p_lcb);
       p_lcb->with_active_local_clients = false;
       p_lcb->link_state = LST_DISCONNECTED;
       p_lcb->InvalidateHandle();
@@ -107,6 +156,8 @@ void l2cu_set_lcb_handle(struct t_l2c_linkcb& p_lcb, uint16_t handle) {
              p_lcb.Handle(), handle);
   }
   p_lcb.SetHandle(handle);
+  l2cb.lcb_index_by_handle[handle & (L2C_NUM_HCI_HANDLES - 1)] =
+      (&p_lcb - l2cb.lcb_pool) + 1;
 }
 
 /*******************************************************************************
@@ -152,6 +203,7 @@ void l2cu_release_lcb(tL2C_LCB* p_lcb) {
   tL2C_CCB* p_ccb;
 
   p_lcb->in_use = false;
+  l2cu_remove_active_lcb(p_lcb);
   p_lcb->ResetBonding();
 
   /* Stop and free timers */
@@ -239,12 +291,9 @@ void l2cu_release_lcb(tL2C_LCB* p_lcb) {
  ******************************************************************************/
 tL2C_LCB* l2cu_find_lcb_by_bd_addr(const RawAddress& p_bd_addr,
                                    tBT_TRANSPORT transport) {
-  int xx;
-  tL2C_LCB* p_lcb = &l2cb.lcb_pool[0];
-
-  for (xx = 0; xx < MAX_L2CAP_LINKS; xx++, p_lcb++) {
-    if ((p_lcb->in_use) && p_lcb->transport == transport &&
-        (p_lcb->remote_bd_addr == p_bd_addr)) {
+  for (uint16_t xx = 0; xx < l2cb.num_active_lcbs; xx++) {
+    tL2C_LCB* p_lcb = l2cb.p_active_lcbs[xx];
+    if (p_lcb->transport == transport && p_lcb->remote_bd_addr == p_bd_addr) {
       return (p_lcb);
     }
   }
@@ -3281,20 +3330,20 @@ void l2cu_send_peer_ble_credit_based_disconn_req(tL2C_CCB* p_ccb) {
  *
  * Function         l2cu_find_lcb_by_handle
  *
- * Description      Look through all active LCBs for a match based on the
- *                  HCI handle.
+ * Description      Look up the active LCB using an HCI handle.
  *
  * Returns          pointer to matched LCB, or NULL if no match
  *
  ******************************************************************************/
 tL2C_LCB* l2cu_find_lcb_by_handle(uint16_t handle) {
-  int xx;
-  tL2C_LCB* p_lcb = &l2cb.lcb_pool[0];
-
-  for (xx = 0; xx < MAX_L2CAP_LINKS; xx++, p_lcb++) {
-    if ((p_lcb->in_use) && (p_lcb->Handle() == handle)) {
-      return (p_lcb);
-    }
+  uint8_t index =
+      l2cb.lcb_index_by_handle[handle & (L2C_NUM_HCI_HANDLES - 1)];
+  if (index == 0) return (NULL);
+
+  /* The index isn't cleared when a handle is invalidated */
+  tL2C_LCB* p_lcb = &l2cb.lcb_pool[index - 1];
+  if ((p_lcb->in_use) && (p_lcb->Handle() == handle)) {
+    return (p_lcb);
   }
 
   /* If here, no match found */
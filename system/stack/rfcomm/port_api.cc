@@ -28,6 +28,7 @@
 
 #include <base/logging.h>
 
+#include <algorithm>
 #include <cstdint>
 
 #include "osi/include/allocator.h"
@@ -833,6 +834,30 @@ static int port_write(tPORT* p_port, BT_HDR* p_buf) {
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         port_tx_buf_room
+ *
+ * Description      This function returns how many more bytes can be appended
+ *                  to the last buffer of the transmit queue without exceeding
+ *                  the peer MTU or the buffer size.  Must be called with the
+ *                  global lock held.
+ *
+ * Parameters:      p_port     - pointer to address of port control block
+ *                  p_buf      - last buffer of the transmit queue, or NULL
+ *                  buf_len    - maximum data length of a buffer
+ *
+ ******************************************************************************/
+static uint16_t port_tx_buf_room(tPORT* p_port, BT_HDR* p_buf,
+                                 uint16_t buf_len) {
+  if (p_buf == NULL) return 0;
+
+  uint16_t max_len = std::min(p_port->peer_mtu, buf_len);
+  if (p_buf->len >= max_len) return 0;
+
+  return max_len - p_buf->len;
+}
+
 /*******************************************************************************
  *
  * Function         PORT_WriteDataCO
@@ -888,19 +913,19 @@ int PORT_WriteDataCO(uint16_t handle, int* p_len) {
   length = RFCOMM_DATA_BUF_SIZE -
            (uint16_t)(sizeof(BT_HDR) + L2CAP_MIN_OFFSET + RFCOMM_DATA_OVERHEAD);
 
-  /* If there are buffers scheduled for transmission check if requested */
-  /* data fits into the end of the queue */
+  /* If there are buffers scheduled for transmission fill the end of the */
+  /* queue first, so that small writes go out in frames of up to peer MTU */
   mutex_global_lock();
 
   p_buf = (BT_HDR*)fixed_queue_try_peek_last(p_port->tx.queue);
-  if ((p_buf != NULL) &&
-      (((int)p_buf->len + available) <= (int)p_port->peer_mtu) &&
-      (((int)p_buf->len + available) <= (int)length)) {
+  uint16_t room = port_tx_buf_room(p_port, p_buf, length);
+  if (room > 0) {
+    if (available < (int)room) room = (uint16_t)available;
     // if(recv(fd, (uint8_t *)(p_buf + 1) + p_buf->offset + p_buf->len,
-    // available, 0) != available)
+    // room, 0) != room)
     if (!p_port->p_data_co_callback(
-            handle, (uint8_t*)(p_buf + 1) + p_buf->offset + p_buf->len,
-            available, DATA_CO_CALLBACK_TYPE_OUTGOING))
+            handle, (uint8_t*)(p_buf + 1) + p_buf->offset + p_buf->len, room,
+            DATA_CO_CALLBACK_TYPE_OUTGOING))
 
     {
       error(
@@ -910,16 +935,16 @@ int PORT_WriteDataCO(uint16_t handle, int* p_len) {
       mutex_global_unlock();
       return (PORT_UNKNOWN_ERROR);
     }
-    // memcpy ((uint8_t *)(p_buf + 1) + p_buf->offset + p_buf->len, p_data,
-    // max_len);
-    p_port->tx.queue_size += (uint16_t)available;
+    p_port->tx.queue_size += room;
 
-    *p_len = available;
-    p_buf->len += (uint16_t)available;
+    *p_len = room;
+    p_buf->len += room;
+    available -= (int)room;
 
-    mutex_global_unlock();
-
-    return (PORT_SUCCESS);
+    if (available == 0) {
+      mutex_global_unlock();
+      return (PORT_SUCCESS);
+    }
   }
 
   mutex_global_unlock();
@@ -1039,22 +1064,26 @@ int PORT_WriteData(uint16_t handle, const char* p_data, uint16_t max_len,
   length = RFCOMM_DATA_BUF_SIZE -
            (uint16_t)(sizeof(BT_HDR) + L2CAP_MIN_OFFSET + RFCOMM_DATA_OVERHEAD);
 
-  /* If there are buffers scheduled for transmission check if requested */
-  /* data fits into the end of the queue */
+  /* If there are buffers scheduled for transmission fill the end of the */
+  /* queue first, so that small writes go out in frames of up to peer MTU */
   mutex_global_lock();
 
   p_buf = (BT_HDR*)fixed_queue_try_peek_last(p_port->tx.queue);
-  if ((p_buf != NULL) && ((p_buf->len + max_len) <= p_port->peer_mtu) &&
-      ((p_buf->len + max_len) <= length)) {
-    memcpy((uint8_t*)(p_buf + 1) + p_buf->offset + p_buf->len, p_data, max_len);
-    p_port->tx.queue_size += max_len;
-
-    *p_len = max_len;
-    p_buf->len += max_len;
-
-    mutex_global_unlock();
-
-    return (PORT_SUCCESS);
+  uint16_t room = port_tx_buf_room(p_port, p_buf, length);
+  if (room > 0) {
+    if (max_len < room) room = max_len;
+    memcpy((uint8_t*)(p_buf + 1) + p_buf->offset + p_buf->len, p_data, room);
+    p_port->tx.queue_size += room;
+
+    *p_len = room;
+    p_buf->len += room;
+    max_len -= room;
+    p_data += room;
+
+    if (max_len == 0) {
+      mutex_global_unlock();
+      return (PORT_SUCCESS);
+    }
   }
 
   mutex_global_unlock();
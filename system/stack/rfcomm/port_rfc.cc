@@ -26,6 +26,7 @@
 #include <base/logging.h>
 #include <frameworks/proto_logging/stats/enums/bluetooth/enums.pb.h>
 
+#include <algorithm>
 #include <cstdint>
 #include <string>
 
@@ -925,38 +926,53 @@ void PORT_FlowInd(tRFC_MCB* p_mcb, uint8_t dlci, bool enable_data) {
  ******************************************************************************/
 uint32_t port_rfc_send_tx_data(tPORT* p_port) {
   uint32_t events = 0;
-  BT_HDR* p_buf;
+  BT_HDR* p_bufs[PORT_TX_BATCH_SIZE];
+  size_t num_bufs;
 
   /* if there is data to be sent */
   if (p_port->tx.queue_size > 0) {
     /* while the rfcomm peer is not flow controlling us, and peer is ready */
     while (!p_port->tx.peer_fc && p_port->rfc.p_mcb &&
            p_port->rfc.p_mcb->peer_ready) {
+      /* With credit based flow control take as many frames as the peer */
+      /* granted credits for, otherwise the peer may stop us at any frame */
+      size_t max_bufs = 1;
+      if (p_port->rfc.p_mcb->flow == PORT_FC_CREDIT)
+        max_bufs = std::min<size_t>(p_port->credit_tx, PORT_TX_BATCH_SIZE);
+      if (max_bufs == 0) max_bufs = 1;
+
       /* get data from tx queue and send it */
       mutex_global_lock();
 
-      p_buf = (BT_HDR*)fixed_queue_try_dequeue(p_port->tx.queue);
-      if (p_buf != NULL) {
-        p_port->tx.queue_size -= p_buf->len;
-
-        mutex_global_unlock();
+      for (num_bufs = 0; num_bufs < max_bufs; num_bufs++) {
+        p_bufs[num_bufs] = (BT_HDR*)fixed_queue_try_dequeue(p_port->tx.queue);
+        if (p_bufs[num_bufs] == NULL) break;
+        p_port->tx.queue_size -= p_bufs[num_bufs]->len;
+      }
 
-        RFCOMM_TRACE_DEBUG("Sending RFCOMM_DataReq tx.queue_size=%d",
-                           p_port->tx.queue_size);
+      mutex_global_unlock();
 
-        RFCOMM_DataReq(p_port->rfc.p_mcb, p_port->dlci, p_buf);
+      /* queue is empty-- all data sent */
+      if (num_bufs == 0) {
+        events |= PORT_EV_TXEMPTY;
+        break;
+      }
 
-        events |= PORT_EV_TXCHAR;
+      RFCOMM_TRACE_DEBUG("Sending %zu RFCOMM_DataReq tx.queue_size=%d",
+                         num_bufs, p_port->tx.queue_size);
 
-        if (p_port->tx.queue_size == 0) {
-          events |= PORT_EV_TXEMPTY;
-          break;
+      for (size_t i = 0; i < num_bufs; i++) {
+        /* The multiplexer may go away when L2CAP fails to send a frame */
+        if (p_port->rfc.p_mcb == NULL) {
+          osi_free(p_bufs[i]);
+          continue;
         }
+        RFCOMM_DataReq(p_port->rfc.p_mcb, p_port->dlci, p_bufs[i]);
       }
-      /* queue is empty-- all data sent */
-      else {
-        mutex_global_unlock();
 
+      events |= PORT_EV_TXCHAR;
+
+      if (p_port->tx.queue_size == 0) {
         events |= PORT_EV_TXEMPTY;
         break;
       }
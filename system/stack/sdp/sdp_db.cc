@@ -173,19 +173,73 @@ tSDP_RECORD* sdp_db_find_record(uint32_t handle) {
 const tSDP_ATTRIBUTE* sdp_db_find_attr_in_rec(const tSDP_RECORD* p_rec,
                                               uint16_t start_attr,
                                               uint16_t end_attr) {
-  const tSDP_ATTRIBUTE* p_at;
-  uint16_t xx;
-
-  /* Note that the attributes in a record are assumed to be in sorted order */
-  for (xx = 0, p_at = &p_rec->attribute[0]; xx < p_rec->num_attributes;
-       xx++, p_at++) {
-    if ((p_at->id >= start_attr) && (p_at->id <= end_attr)) return (p_at);
+  uint16_t lo = 0, hi = p_rec->num_attributes;
+
+  /* The attributes in a record are kept in sorted order by SDP_AddAttribute,
+   * so binary search for the first one whose ID is not below start_attr */
+  while (lo < hi) {
+    uint16_t mid = lo + (hi - lo) / 2;
+    if (p_rec->attribute[mid].id < start_attr)
+      lo = mid + 1;
+    else
+      hi = mid;
   }
 
+  if ((lo < p_rec->num_attributes) && (p_rec->attribute[lo].id <= end_attr))
+    return (&p_rec->attribute[lo]);
+
   /* No matching attribute found */
   return (NULL);
 }
 
+/*******************************************************************************
+ *
+ * Function         sdp_db_get_serialized_attr
+ *
+ * Description      This function returns the attribute ID and value of an
+ *                  attribute of a record, serialized as they are sent in an
+ *                  attribute list. The whole attribute list of the record is
+ *                  serialized once into the record and reused by later calls
+ *                  until the record is modified.
+ *
+ * Returns          Pointer to the serialized attribute, or NULL if it does not
+ *                  fit in the cache. p_len is set to its length.
+ *
+ ******************************************************************************/
+const uint8_t* sdp_db_get_serialized_attr(const tSDP_RECORD* p_rec,
+                                          const tSDP_ATTRIBUTE* p_attr,
+                                          uint16_t* p_len) {
+  /* Records live in the (non-const) server database; the cache is refreshed
+   * in place */
+  tSDP_RECORD* p_cache = const_cast<tSDP_RECORD*>(p_rec);
+  uint16_t xx = (uint16_t)(p_attr - &p_rec->attribute[0]);
+
+  if (xx >= p_rec->num_attributes) return (NULL);
+
+  if (!p_cache->ser_valid) {
+    uint8_t* p_out = &p_cache->ser_pad[0];
+
+    for (uint16_t yy = 0; yy < p_rec->num_attributes; yy++) {
+      const tSDP_ATTRIBUTE* p_at = &p_rec->attribute[yy];
+
+      p_cache->ser_offset[yy] = (uint16_t)(p_out - &p_cache->ser_pad[0]);
+      if (p_cache->ser_offset[yy] + sdpu_get_attrib_entry_len(p_at) >
+          SDP_MAX_SER_REC_LEN) {
+        SDP_TRACE_ERROR("%s: record 0x%x does not fit in the cache", __func__,
+                        p_rec->record_handle);
+        return (NULL);
+      }
+      p_out = sdpu_build_attrib_entry(p_out, p_at);
+    }
+    p_cache->ser_offset[p_rec->num_attributes] =
+        (uint16_t)(p_out - &p_cache->ser_pad[0]);
+    p_cache->ser_valid = true;
+  }
+
+  *p_len = p_rec->ser_offset[xx + 1] - p_rec->ser_offset[xx];
+  return (&p_rec->ser_pad[p_rec->ser_offset[xx]]);
+}
+
 /*******************************************************************************
  *
  * Function         sdp_compose_proto_list
@@ -407,6 +461,8 @@ bool SDP_AddAttribute(uint32_t handle, uint16_t attr_id, uint8_t attr_type,
     if (p_rec->record_handle == handle) {
       tSDP_ATTRIBUTE* p_attr = &p_rec->attribute[0];
 
+      p_rec->ser_valid = false;
+
       // error out early, no need to look up
       if (p_rec->free_pad_ptr >= SDP_MAX_PAD_LEN) {
         SDP_TRACE_ERROR("the free pad for SDP record with handle %d is "
@@ -787,6 +843,7 @@ bool SDP_DeleteAttribute(uint32_t handle, uint16_t attr_id) {
       tSDP_ATTRIBUTE* p_attr = &p_rec->attribute[0];
 
       SDP_TRACE_API("Deleting attr_id 0x%04x for handle 0x%x", attr_id, handle);
+      p_rec->ser_valid = false;
       /* Found it. Now, find the attribute */
       for (uint16_t attribute_index = 0; attribute_index < p_rec->num_attributes; attribute_index++, p_attr++) {
         if (p_attr->id == attr_id) {
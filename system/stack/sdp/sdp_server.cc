@@ -96,6 +96,79 @@ static void process_service_search_attr_req(tCONN_CB* p_ccb, uint16_t trans_num,
 #define SDP_TEXT_BAD_MAX_RECORDS_LIST NULL
 #endif
 
+/*******************************************************************************
+ *
+ * Function         get_attr_entry
+ *
+ * Description      This function looks up the serialized form of an attribute
+ *                  in the pre-serialized attribute list of its record. Records
+ *                  of an AVRCP target are not served from the cache since their
+ *                  profile version is patched per peer device.
+ *
+ * Returns          Pointer to the serialized attribute, or NULL if it has to be
+ *                  built. p_len is set to its length in both cases.
+ *
+ ******************************************************************************/
+static const uint8_t* get_attr_entry(const tSDP_RECORD* p_rec,
+                                     const tSDP_ATTRIBUTE* p_attr,
+                                     bool is_service_avrc_target,
+                                     uint16_t* p_len) {
+  const uint8_t* p_ser = NULL;
+
+  if (!is_service_avrc_target)
+    p_ser = sdp_db_get_serialized_attr(p_rec, p_attr, p_len);
+
+  if (p_ser == NULL) *p_len = sdpu_get_attrib_entry_len(p_attr);
+
+  return (p_ser);
+}
+
+/*******************************************************************************
+ *
+ * Function         build_attr_entry
+ *
+ * Description      This function copies a whole attribute into the response,
+ *                  from its serialized form if available.
+ *
+ * Returns          Pointer to next byte in the output buffer.
+ *
+ ******************************************************************************/
+static uint8_t* build_attr_entry(uint8_t* p_out, const uint8_t* p_ser,
+                                 const tSDP_ATTRIBUTE* p_attr,
+                                 uint16_t attr_len) {
+  if (p_ser == NULL) return sdpu_build_attrib_entry(p_out, p_attr);
+
+  memcpy(p_out, p_ser, attr_len);
+  return (p_out + attr_len);
+}
+
+/*******************************************************************************
+ *
+ * Function         build_partial_attr_entry
+ *
+ * Description      This function copies up to len bytes of an attribute into
+ *                  the response, starting at offset within the attribute, from
+ *                  its serialized form if available.
+ *
+ * Returns          Pointer to next byte in the output buffer.
+ *                  offset is also updated
+ *
+ ******************************************************************************/
+static uint8_t* build_partial_attr_entry(uint8_t* p_out, const uint8_t* p_ser,
+                                         const tSDP_ATTRIBUTE* p_attr,
+                                         uint16_t attr_len, uint16_t len,
+                                         uint16_t* offset) {
+  if (p_ser == NULL)
+    return sdpu_build_partial_attrib_entry(p_out, p_attr, len, offset);
+
+  uint16_t len_to_copy =
+      ((attr_len - *offset) < len) ? (attr_len - *offset) : len;
+  memcpy(p_out, &p_ser[*offset], len_to_copy);
+  *offset += len_to_copy;
+
+  return (p_out + len_to_copy);
+}
+
 /*******************************************************************************
  *
  * Function         sdp_server_handle_client_req
@@ -320,6 +393,7 @@ static void process_service_attr_req(tCONN_CB* p_ccb, uint16_t trans_num,
   uint32_t rec_handle;
   const tSDP_RECORD* p_rec;
   const tSDP_ATTRIBUTE* p_attr;
+  const uint8_t* p_attr_ser;
   bool is_cont = false;
   uint16_t attr_len;
 
@@ -430,7 +504,8 @@ static void process_service_attr_req(tCONN_CB* p_ccb, uint16_t trans_num,
         break;
       }
 
-      attr_len = sdpu_get_attrib_entry_len(p_attr);
+      p_attr_ser = get_attr_entry(p_rec, p_attr, is_service_avrc_target,
+                                  &attr_len);
       /* if there is a partial attribute pending to be sent */
       if (p_ccb->cont_info.attr_offset) {
         if (attr_len < p_ccb->cont_info.attr_offset) {
@@ -439,8 +514,9 @@ static void process_service_attr_req(tCONN_CB* p_ccb, uint16_t trans_num,
                                   SDP_TEXT_BAD_CONT_LEN);
           return;
         }
-        p_rsp = sdpu_build_partial_attrib_entry(p_rsp, p_attr, rem_len,
-                                                &p_ccb->cont_info.attr_offset);
+        p_rsp = build_partial_attr_entry(p_rsp, p_attr_ser, p_attr, attr_len,
+                                         rem_len,
+                                         &p_ccb->cont_info.attr_offset);
 
         /* If the partial attrib could not been fully added yet */
         if (p_ccb->cont_info.attr_offset != attr_len)
@@ -458,14 +534,15 @@ static void process_service_attr_req(tCONN_CB* p_ccb, uint16_t trans_num,
         }
 
         /* add the partial attribute if possible */
-        p_rsp = sdpu_build_partial_attrib_entry(
-            p_rsp, p_attr, (uint16_t)rem_len, &p_ccb->cont_info.attr_offset);
+        p_rsp = build_partial_attr_entry(p_rsp, p_attr_ser, p_attr, attr_len,
+                                         (uint16_t)rem_len,
+                                         &p_ccb->cont_info.attr_offset);
 
         p_ccb->cont_info.next_attr_index = xx;
         p_ccb->cont_info.next_attr_start_id = p_attr->id;
         break;
       } else /* build the whole attribute */
-        p_rsp = sdpu_build_attrib_entry(p_rsp, p_attr);
+        p_rsp = build_attr_entry(p_rsp, p_attr_ser, p_attr, attr_len);
 
       /* If doing a range, stick with this one till no more attributes found */
       if (attr_seq.attr_entry[xx].start != attr_seq.attr_entry[xx].end) {
@@ -567,6 +644,7 @@ static void process_service_search_attr_req(tCONN_CB* p_ccb, uint16_t trans_num,
   const tSDP_RECORD* p_rec;
   tSDP_ATTR_SEQ attr_seq, attr_seq_sav;
   const tSDP_ATTRIBUTE* p_attr;
+  const uint8_t* p_attr_ser;
   bool maxxed_out = false, is_cont = false;
   uint8_t* p_seq_start;
   uint16_t seq_len, attr_len;
@@ -691,7 +769,8 @@ static void process_service_search_attr_req(tCONN_CB* p_ccb, uint16_t trans_num,
           break;
         }
 
-        attr_len = sdpu_get_attrib_entry_len(p_attr);
+        p_attr_ser = get_attr_entry(p_rec, p_attr, is_service_avrc_target,
+                                    &attr_len);
         /* if there is a partial attribute pending to be sent */
         if (p_ccb->cont_info.attr_offset) {
           if (attr_len < p_ccb->cont_info.attr_offset) {
@@ -700,8 +779,9 @@ static void process_service_search_attr_req(tCONN_CB* p_ccb, uint16_t trans_num,
                                     SDP_TEXT_BAD_CONT_LEN);
             return;
           }
-          p_rsp = sdpu_build_partial_attrib_entry(
-              p_rsp, p_attr, rem_len, &p_ccb->cont_info.attr_offset);
+          p_rsp = build_partial_attr_entry(p_rsp, p_attr_ser, p_attr,
+                                           attr_len, rem_len,
+                                           &p_ccb->cont_info.attr_offset);
 
           /* If the partial attrib could not been fully added yet */
           if (p_ccb->cont_info.attr_offset != attr_len) {
@@ -720,15 +800,16 @@ static void process_service_search_attr_req(tCONN_CB* p_ccb, uint16_t trans_num,
           }
 
           /* add the partial attribute if possible */
-          p_rsp = sdpu_build_partial_attrib_entry(
-              p_rsp, p_attr, (uint16_t)rem_len, &p_ccb->cont_info.attr_offset);
+          p_rsp = build_partial_attr_entry(p_rsp, p_attr_ser, p_attr,
+                                           attr_len, (uint16_t)rem_len,
+                                           &p_ccb->cont_info.attr_offset);
 
           p_ccb->cont_info.next_attr_index = xx;
           p_ccb->cont_info.next_attr_start_id = p_attr->id;
           maxxed_out = true;
           break;
         } else /* build the whole attribute */
-          p_rsp = sdpu_build_attrib_entry(p_rsp, p_attr);
+          p_rsp = build_attr_entry(p_rsp, p_attr_ser, p_attr, attr_len);
 
         /* If doing a range, stick with this one till no more attributes found
          */
@@ -62,6 +62,10 @@
 #define MAX_ATTR_LEN 256
 #endif
 
+/* Max length of a record's serialized attribute list. Each attribute adds a
+ * 3-byte attribute ID and at most a 5-byte type/length header to its value */
+#define SDP_MAX_SER_REC_LEN (SDP_MAX_PAD_LEN + (SDP_MAX_REC_ATTR * 8))
+
 /* Internal UUID sequence representation */
 typedef struct {
   uint16_t len;
@@ -99,6 +103,13 @@ typedef struct {
   uint16_t num_attributes;
   tSDP_ATTRIBUTE attribute[SDP_MAX_REC_ATTR];
   uint8_t attr_pad[SDP_MAX_PAD_LEN];
+
+  /* Attribute list pre-serialized in attribute ID order, as sent on the air.
+   * Entry xx occupies ser_pad[ser_offset[xx]..ser_offset[xx + 1]). Built on
+   * first use and invalidated whenever an attribute is added or deleted. */
+  bool ser_valid;
+  uint16_t ser_offset[SDP_MAX_REC_ATTR + 1];
+  uint8_t ser_pad[SDP_MAX_SER_REC_LEN];
 } tSDP_RECORD;
 
 /* Define the SDP database */
@@ -254,6 +265,9 @@ extern tSDP_RECORD* sdp_db_find_record(uint32_t handle);
 extern const tSDP_ATTRIBUTE* sdp_db_find_attr_in_rec(const tSDP_RECORD* p_rec,
                                                      uint16_t start_attr,
                                                      uint16_t end_attr);
+extern const uint8_t* sdp_db_get_serialized_attr(const tSDP_RECORD* p_rec,
+                                                 const tSDP_ATTRIBUTE* p_attr,
+                                                 uint16_t* p_len);
 
 /* Functions provided by sdp_server.cc
  */
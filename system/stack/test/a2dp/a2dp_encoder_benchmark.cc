@@ -0,0 +1,353 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Cost of the A2DP Source encoders, each driven the way the A2DP Source
+// worker drives it: one send_frames() per encoder interval, pulling PCM from
+// a feeding source through the read callback and handing the media packets
+// over through the enqueue callback.
+//
+// Every codec is run at each sample rate it supports and, where the codec
+// has them, at each of its bitrate modes. Besides the time per tick, each
+// run reports:
+//   cpu_per_audio_s   CPU seconds spent per second of audio encoded
+//   allocs_per_frame  heap allocations per encoded codec frame
+//   max_tick_us       worst time taken by a single tick
+//   kbps              bitrate of the media packets, as a sanity check
+//
+// Use --benchmark_format=json or --benchmark_out=<file> for output that can
+// be compared across builds.
+
+#include <benchmark/benchmark.h>
+#include <time.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "common/init_flags.h"
+#include "stack/include/a2dp_codec_api.h"
+#include "stack/include/avdt_api.h"
+#include "stack/include/bt_hdr.h"
+#include "test/mock/mock_osi_allocator.h"
+#include "test/mock/mock_osi_properties.h"
+
+using ::benchmark::State;
+
+namespace {
+
+// Heap allocations made through new and through the osi allocator
+size_t g_allocations = 0;
+
+}  // namespace
+
+void* operator new(size_t size) {
+  g_allocations++;
+  void* ptr = malloc(size);
+  if (ptr == nullptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t size) noexcept { free(ptr); }
+
+namespace {
+
+// Codec being benchmarked, for the encoders asking for the current codec
+A2dpCodecConfig* g_current_codec = nullptr;
+
+}  // namespace
+
+A2dpCodecConfig* bta_av_get_a2dp_current_codec(void) {
+  return g_current_codec;
+}
+
+namespace {
+
+constexpr uint16_t kPeerMtu = 1005;
+
+struct EncoderMode {
+  const char* name;
+  btav_a2dp_codec_index_t codec_index;
+  // Bitrate mode, where the codec has one
+  int64_t codec_specific_1;
+  // A peer without EDR restricts the SBC bitpool
+  bool is_peer_edr;
+};
+
+const EncoderMode kEncoderModes[] = {
+    {"SBC", BTAV_A2DP_CODEC_INDEX_SOURCE_SBC, 0, true},
+    {"SBC_basic_rate", BTAV_A2DP_CODEC_INDEX_SOURCE_SBC, 0, false},
+    {"AAC", BTAV_A2DP_CODEC_INDEX_SOURCE_AAC, 0, true},
+    {"aptX", BTAV_A2DP_CODEC_INDEX_SOURCE_APTX, 0, true},
+    {"aptX_HD", BTAV_A2DP_CODEC_INDEX_SOURCE_APTX_HD, 0, true},
+    {"LDAC_HQ", BTAV_A2DP_CODEC_INDEX_SOURCE_LDAC, 1000, true},
+    {"LDAC_SQ", BTAV_A2DP_CODEC_INDEX_SOURCE_LDAC, 1001, true},
+    {"LDAC_MQ", BTAV_A2DP_CODEC_INDEX_SOURCE_LDAC, 1002, true},
+    {"Opus", BTAV_A2DP_CODEC_INDEX_SOURCE_OPUS, 0, true},
+};
+
+const struct {
+  uint32_t hz;
+  btav_a2dp_codec_sample_rate_t sample_rate;
+} kSampleRates[] = {
+    {44100, BTAV_A2DP_CODEC_SAMPLE_RATE_44100},
+    {48000, BTAV_A2DP_CODEC_SAMPLE_RATE_48000},
+    {88200, BTAV_A2DP_CODEC_SAMPLE_RATE_88200},
+    {96000, BTAV_A2DP_CODEC_SAMPLE_RATE_96000},
+};
+
+// Loops over one second of two tones and some noise, which keeps the
+// encoders from taking the shortcuts they have for silence.
+struct FeedingSource {
+  std::vector<uint8_t> pcm;
+  size_t pos = 0;
+  uint64_t bytes_read = 0;
+
+  void Generate(uint32_t sample_rate, size_t bytes_per_sample,
+                int bits_per_sample) {
+    constexpr double kPi = 3.14159265358979323846;
+    const double full_scale = std::ldexp(1.0, bits_per_sample - 1) - 1;
+    uint32_t noise = 1;
+    pcm.resize(sample_rate * 2 * bytes_per_sample);
+    for (uint32_t i = 0; i < sample_rate; i++) {
+      double t = static_cast<double>(i) / sample_rate;
+      for (int channel = 0; channel < 2; channel++) {
+        noise = noise * 1664525 + 1013904223;
+        double value = 0.4 * std::sin(2 * kPi * (440 + channel * 110) * t) +
+                       0.2 * std::sin(2 * kPi * 5000 * t) +
+                       0.05 * (static_cast<int32_t>(noise) / 2147483648.0);
+        int32_t sample = static_cast<int32_t>(value * full_scale);
+        // Little endian, in the low bytes of the container
+        uint8_t* out = &pcm[(i * 2 + channel) * bytes_per_sample];
+        for (size_t byte = 0; byte < bytes_per_sample; byte++) {
+          out[byte] = byte * 8 < (size_t)bits_per_sample
+                          ? static_cast<uint8_t>(sample >> (byte * 8))
+                          : (sample < 0 ? 0xff : 0);
+        }
+      }
+    }
+    pos = 0;
+    bytes_read = 0;
+  }
+
+  uint32_t Read(uint8_t* p_buf, uint32_t len) {
+    for (uint32_t copied = 0; copied < len;) {
+      size_t chunk = std::min<size_t>(len - copied, pcm.size() - pos);
+      memcpy(p_buf + copied, &pcm[pos], chunk);
+      copied += chunk;
+      pos = (pos + chunk) % pcm.size();
+    }
+    bytes_read += len;
+    return len;
+  }
+};
+
+struct MediaSink {
+  uint64_t frames = 0;
+  uint64_t bytes = 0;
+};
+
+FeedingSource g_feeding;
+MediaSink g_media;
+
+uint32_t read_cb(uint8_t* p_buf, uint32_t len) {
+  return g_feeding.Read(p_buf, len);
+}
+
+bool enqueue_cb(BT_HDR* p_buf, size_t frames_n, uint32_t num_bytes) {
+  g_media.frames += frames_n;
+  g_media.bytes += p_buf->len;
+  osi_free(p_buf);
+  return true;
+}
+
+// Configures |codecs| for |mode| at |sample_rate| against a peer taking
+// everything the codec can do, and returns the configured codec, or nullptr
+// when the codec does not run at that rate.
+A2dpCodecConfig* ConfigureCodec(A2dpCodecs* codecs, const EncoderMode& mode,
+                                btav_a2dp_codec_sample_rate_t sample_rate) {
+  AvdtpSepConfig peer_caps;
+  if (!A2DP_InitCodecConfig(mode.codec_index, &peer_caps)) return nullptr;
+
+  btav_a2dp_codec_config_t user_config = {};
+  user_config.codec_type = mode.codec_index;
+  user_config.codec_priority = BTAV_A2DP_CODEC_PRIORITY_HIGHEST;
+  user_config.sample_rate = sample_rate;
+  user_config.bits_per_sample = BTAV_A2DP_CODEC_BITS_PER_SAMPLE_NONE;
+  user_config.channel_mode = BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO;
+  user_config.codec_specific_1 = mode.codec_specific_1;
+
+  tA2DP_ENCODER_INIT_PEER_PARAMS peer_params = {mode.is_peer_edr, true,
+                                                kPeerMtu};
+  uint8_t result[AVDT_CODEC_SIZE];
+  bool restart_input, restart_output, config_updated;
+  if (!codecs->setCodecUserConfig(user_config, &peer_params,
+                                  peer_caps.codec_info, result,
+                                  &restart_input, &restart_output,
+                                  &config_updated)) {
+    return nullptr;
+  }
+
+  A2dpCodecConfig* codec = nullptr;
+  for (auto* source_codec : codecs->orderedSourceCodecs()) {
+    if (source_codec->codecIndex() == mode.codec_index) codec = source_codec;
+  }
+  if (codec == nullptr) return nullptr;
+  // The codec falls back on another rate rather than failing
+  if (codec->getCodecConfig().sample_rate != sample_rate) return nullptr;
+  return codec;
+}
+
+void SetUpMocks() {
+  test::mock::osi_allocator::osi_malloc.body = [](size_t size) {
+    g_allocations++;
+    return malloc(size);
+  };
+  test::mock::osi_allocator::osi_calloc.body = [](size_t size) {
+    g_allocations++;
+    return calloc(1, size);
+  };
+  test::mock::osi_allocator::osi_free.body = [](void* ptr) { free(ptr); };
+  test::mock::osi_allocator::osi_free_and_reset.body = [](void** p_ptr) {
+    free(*p_ptr);
+    *p_ptr = nullptr;
+  };
+  // Opus is behind a property, which is never set on host
+  test::mock::osi_properties::osi_property_get_bool.body =
+      [](const char* key, bool default_value) {
+        return strcmp(key, "persist.bluetooth.opus.enabled") == 0 ||
+               default_value;
+      };
+}
+
+uint64_t ThreadCpuNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// One iteration is one tick of the A2DP Source worker.
+void BM_Encode(State& state, const EncoderMode& mode,
+               btav_a2dp_codec_sample_rate_t sample_rate, uint32_t hz) {
+  A2dpCodecs codecs(std::vector<btav_a2dp_codec_config_t>{});
+  if (!codecs.init()) {
+    state.SkipWithError("Cannot initialize the codecs");
+    return;
+  }
+  A2dpCodecConfig* codec = ConfigureCodec(&codecs, mode, sample_rate);
+  uint8_t codec_info[AVDT_CODEC_SIZE];
+  if (codec == nullptr || !codec->copyOutOtaCodecConfig(codec_info)) {
+    state.SkipWithError("Cannot configure the codec");
+    return;
+  }
+  auto* encoder = A2DP_GetEncoderInterface(codec_info);
+  if (encoder == nullptr) {
+    state.SkipWithError("No encoder for the codec");
+    return;
+  }
+  g_current_codec = codec;
+
+  int bits_per_sample = codec->getAudioBitsPerSample();
+  // aptX-HD takes its 24 bit samples in 32 bit words
+  size_t bytes_per_sample =
+      mode.codec_index == BTAV_A2DP_CODEC_INDEX_SOURCE_APTX_HD
+          ? 4
+          : bits_per_sample / 8;
+  g_feeding.Generate(hz, bytes_per_sample, bits_per_sample);
+  g_media = {};
+
+  tA2DP_ENCODER_INIT_PEER_PARAMS peer_params = {mode.is_peer_edr, true,
+                                                kPeerMtu};
+  encoder->encoder_init(&peer_params, codec, read_cb, enqueue_cb);
+  if (encoder->set_transmit_queue_length != nullptr) {
+    encoder->set_transmit_queue_length(0);
+  }
+  encoder->feeding_reset();
+
+  // The encoders work out how much audio is due from the timestamps, which
+  // advance by one interval per tick as they do with the worker's alarm
+  uint64_t interval_us = encoder->get_encoder_interval_ms() * 1000;
+  uint64_t timestamp_us = 1000000;
+  for (int i = 0; i < 10; i++) {
+    encoder->send_frames(timestamp_us);
+    timestamp_us += interval_us;
+  }
+
+  g_feeding.bytes_read = 0;
+  g_media = {};
+  size_t allocations = g_allocations;
+  uint64_t cpu_start_ns = ThreadCpuNs();
+  std::chrono::steady_clock::duration max_tick{};
+  for (auto _ : state) {
+    auto start = std::chrono::steady_clock::now();
+    encoder->send_frames(timestamp_us);
+    max_tick = std::max(max_tick, std::chrono::steady_clock::now() - start);
+    timestamp_us += interval_us;
+  }
+  uint64_t cpu_ns = ThreadCpuNs() - cpu_start_ns;
+  allocations = g_allocations - allocations;
+
+  double audio_s = static_cast<double>(g_feeding.bytes_read) /
+                   (hz * 2 * bytes_per_sample);
+  state.counters["cpu_per_audio_s"] = audio_s > 0 ? cpu_ns / 1e9 / audio_s : 0;
+  state.counters["allocs_per_frame"] =
+      g_media.frames > 0 ? static_cast<double>(allocations) / g_media.frames
+                         : 0;
+  state.counters["max_tick_us"] =
+      std::chrono::duration<double, std::micro>(max_tick).count();
+  state.counters["kbps"] = audio_s > 0 ? g_media.bytes * 8 / audio_s / 1000 : 0;
+  state.counters["bits_per_sample"] = bits_per_sample;
+
+  encoder->encoder_cleanup();
+  g_current_codec = nullptr;
+}
+
+void RegisterBenchmarks() {
+  for (const auto& mode : kEncoderModes) {
+    for (const auto& rate : kSampleRates) {
+      // Only the rates the codec takes
+      A2dpCodecs codecs(std::vector<btav_a2dp_codec_config_t>{});
+      if (!codecs.init() ||
+          ConfigureCodec(&codecs, mode, rate.sample_rate) == nullptr) {
+        continue;
+      }
+      std::string name = std::string("BM_Encode/") + mode.name + "/" +
+                         std::to_string(rate.hz);
+      ::benchmark::RegisterBenchmark(name.c_str(), BM_Encode, mode,
+                                     rate.sample_rate, rate.hz)
+          ->Unit(::benchmark::kMicrosecond);
+    }
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bluetooth::common::InitFlags::SetAllForTesting();
+  SetUpMocks();
+  RegisterBenchmarks();
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "osi/include/allocator.h"
+#include "osi/include/list.h"
+#include "stack/btm/security_device_record.h"
+#include "stack/btm/security_device_record_index.h"
+#include "types/raw_address.h"
+
+using ::benchmark::State;
+
+namespace {
+
+// Same matching as btm_find_dev for non resolvable addresses
+bool is_address_equal(void* data, void* context) {
+  tBTM_SEC_DEV_REC* p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(data);
+  const RawAddress* bd_addr = static_cast<RawAddress*>(context);
+
+  if (p_dev_rec->bd_addr == *bd_addr) return false;
+  if (p_dev_rec->ble.pseudo_addr == *bd_addr) return false;
+  return true;
+}
+
+bool is_handle_equal(void* data, void* context) {
+  tBTM_SEC_DEV_REC* p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(data);
+  uint16_t* handle = static_cast<uint16_t*>(context);
+
+  if (p_dev_rec->hci_handle == *handle || p_dev_rec->ble_hci_handle == *handle)
+    return false;
+  return true;
+}
+
+RawAddress address_of(size_t index) {
+  return RawAddress({0x00, 0x11, 0x22, (uint8_t)(index >> 16),
+                     (uint8_t)(index >> 8), (uint8_t)index});
+}
+
+// Bonded devices, the first kNumConnected of which are connected over both
+// transports
+class BM_SecDevRecLookup : public ::benchmark::Fixture {
+ protected:
+  static constexpr size_t kNumConnected = 8;
+
+  void SetUp(State& st) override {
+    ::benchmark::Fixture::SetUp(st);
+    list_ = list_new(osi_free);
+    for (size_t i = 0; i < (size_t)st.range(0); i++) {
+      tBTM_SEC_DEV_REC* p_dev_rec =
+          static_cast<tBTM_SEC_DEV_REC*>(osi_calloc(sizeof(tBTM_SEC_DEV_REC)));
+      p_dev_rec->bd_addr = address_of(i);
+      p_dev_rec->hci_handle = HCI_INVALID_HANDLE;
+      p_dev_rec->ble_hci_handle = HCI_INVALID_HANDLE;
+      if (i < kNumConnected) {
+        p_dev_rec->hci_handle = 0x0001 + i;
+        p_dev_rec->ble_hci_handle = 0x0040 + i;
+      }
+      list_append(list_, p_dev_rec);
+      index_.AddAddress(p_dev_rec->bd_addr, p_dev_rec);
+      index_.AddHandle(p_dev_rec->hci_handle, p_dev_rec);
+      index_.AddHandle(p_dev_rec->ble_hci_handle, p_dev_rec);
+    }
+    // Records that are looked up, spread over the whole list
+    for (size_t i = 0; i < 16; i++) {
+      lookups_.push_back(address_of((i * st.range(0)) / 16));
+    }
+  }
+
+  void TearDown(State& st) override {
+    index_.Clear();
+    list_free(list_);
+    lookups_.clear();
+    ::benchmark::Fixture::TearDown(st);
+  }
+
+  list_t* list_ = nullptr;
+  tBTM_SEC_DEV_REC_INDEX index_;
+  std::vector<RawAddress> lookups_;
+};
+
+BENCHMARK_DEFINE_F(BM_SecDevRecLookup, address_list_walk)(State& state) {
+  for (auto _ : state) {
+    for (RawAddress& bd_addr : lookups_) {
+      benchmark::DoNotOptimize(
+          list_foreach(list_, is_address_equal, (void*)&bd_addr));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * lookups_.size());
+}
+
+BENCHMARK_DEFINE_F(BM_SecDevRecLookup, address_index)(State& state) {
+  for (auto _ : state) {
+    for (RawAddress& bd_addr : lookups_) {
+      benchmark::DoNotOptimize(index_.FindByAddress(bd_addr));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * lookups_.size());
+}
+
+BENCHMARK_DEFINE_F(BM_SecDevRecLookup, handle_list_walk)(State& state) {
+  for (auto _ : state) {
+    for (uint16_t i = 0; i < kNumConnected; i++) {
+      uint16_t handle = 0x0040 + i;
+      benchmark::DoNotOptimize(list_foreach(list_, is_handle_equal, &handle));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kNumConnected);
+}
+
+BENCHMARK_DEFINE_F(BM_SecDevRecLookup, handle_index)(State& state) {
+  for (auto _ : state) {
+    for (uint16_t i = 0; i < kNumConnected; i++) {
+      benchmark::DoNotOptimize(index_.FindByHandle(0x0040 + i));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kNumConnected);
+}
+
+BENCHMARK_REGISTER_F(BM_SecDevRecLookup, address_list_walk)
+    ->Arg(10)
+    ->Arg(500)
+    ->Arg(2000);
+BENCHMARK_REGISTER_F(BM_SecDevRecLookup, address_index)
+    ->Arg(10)
+    ->Arg(500)
+    ->Arg(2000);
+BENCHMARK_REGISTER_F(BM_SecDevRecLookup, handle_list_walk)
+    ->Arg(10)
+    ->Arg(500)
+    ->Arg(2000);
+BENCHMARK_REGISTER_F(BM_SecDevRecLookup, handle_index)
+    ->Arg(10)
+    ->Arg(500)
+    ->Arg(2000);
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
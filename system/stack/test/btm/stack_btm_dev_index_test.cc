@@ -0,0 +1,217 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+#include "stack/btm/btm_ble_int.h"
+#include "stack/btm/btm_dev.h"
+#include "stack/btm/btm_int_types.h"
+#include "stack/btm/security_device_record.h"
+#include "stack/btm/security_device_record_index.h"
+#include "stack/crypto_toolbox/crypto_toolbox.h"
+#include "stack/include/acl_api.h"
+#include "stack/include/hcidefs.h"
+#include "types/raw_address.h"
+
+extern tBTM_CB btm_cb;
+
+namespace {
+
+const RawAddress kAddress = RawAddress({0x11, 0x22, 0x33, 0x44, 0x55, 0x66});
+const RawAddress kOtherAddress =
+    RawAddress({0x11, 0x22, 0x33, 0x44, 0x55, 0x77});
+constexpr uint16_t kHandle = 0x0001;
+constexpr uint16_t kBleHandle = 0x0040;
+
+class StackBtmDevIndexTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    for (tBTM_SEC_DEV_REC& record : records_) {
+      record.hci_handle = HCI_INVALID_HANDLE;
+      record.ble_hci_handle = HCI_INVALID_HANDLE;
+    }
+  }
+
+  tBTM_SEC_DEV_REC_INDEX index_;
+  tBTM_SEC_DEV_REC records_[2] = {};
+};
+
+TEST_F(StackBtmDevIndexTest, find_after_add) {
+  tBTM_SEC_DEV_REC* p_dev_rec = &records_[0];
+  p_dev_rec->bd_addr = kAddress;
+  p_dev_rec->ble.pseudo_addr = kOtherAddress;
+  p_dev_rec->ble.identity_address_with_type.bda = kAddress;
+  p_dev_rec->hci_handle = kHandle;
+  p_dev_rec->ble_hci_handle = kBleHandle;
+
+  ASSERT_EQ(nullptr, index_.FindByAddress(kAddress));
+  ASSERT_EQ(nullptr, index_.FindByIdentityAddress(kAddress));
+  ASSERT_EQ(nullptr, index_.FindByHandle(kHandle));
+
+  index_.AddAddress(kAddress, p_dev_rec);
+  index_.AddAddress(kOtherAddress, p_dev_rec);
+  index_.AddIdentityAddress(kAddress, p_dev_rec);
+  index_.AddHandle(kHandle, p_dev_rec);
+  index_.AddHandle(kBleHandle, p_dev_rec);
+  ASSERT_EQ(5u, index_.Size());
+
+  ASSERT_EQ(p_dev_rec, index_.FindByAddress(kAddress));
+  ASSERT_EQ(p_dev_rec, index_.FindByAddress(kOtherAddress));
+  ASSERT_EQ(p_dev_rec, index_.FindByIdentityAddress(kAddress));
+  ASSERT_EQ(nullptr, index_.FindByIdentityAddress(kOtherAddress));
+  ASSERT_EQ(p_dev_rec, index_.FindByHandle(kHandle));
+  ASSERT_EQ(p_dev_rec, index_.FindByHandle(kBleHandle));
+  ASSERT_EQ(nullptr, index_.FindByHandle(kHandle + 1));
+}
+
+TEST_F(StackBtmDevIndexTest, bd_addr_changed_in_place) {
+  tBTM_SEC_DEV_REC* p_dev_rec = &records_[0];
+  p_dev_rec->bd_addr = kAddress;
+  index_.AddAddress(kAddress, p_dev_rec);
+
+  p_dev_rec->bd_addr = kOtherAddress;
+  ASSERT_EQ(nullptr, index_.FindByAddress(kAddress));
+  ASSERT_EQ(0u, index_.Size());
+
+  // Restoring the address does not bring the stale entry back
+  p_dev_rec->bd_addr = kAddress;
+  ASSERT_EQ(nullptr, index_.FindByAddress(kAddress));
+}
+
+TEST_F(StackBtmDevIndexTest, pseudo_addr_changed_in_place) {
+  tBTM_SEC_DEV_REC* p_dev_rec = &records_[0];
+  p_dev_rec->bd_addr = kAddress;
+  p_dev_rec->ble.pseudo_addr = kOtherAddress;
+  index_.AddAddress(kAddress, p_dev_rec);
+  index_.AddAddress(kOtherAddress, p_dev_rec);
+
+  p_dev_rec->ble.pseudo_addr = RawAddress::kEmpty;
+  ASSERT_EQ(nullptr, index_.FindByAddress(kOtherAddress));
+  ASSERT_EQ(p_dev_rec, index_.FindByAddress(kAddress));
+  ASSERT_EQ(1u, index_.Size());
+}
+
+TEST_F(StackBtmDevIndexTest, identity_address_changed_in_place) {
+  tBTM_SEC_DEV_REC* p_dev_rec = &records_[0];
+  p_dev_rec->ble.identity_address_with_type.bda = kAddress;
+  index_.AddIdentityAddress(kAddress, p_dev_rec);
+
+  p_dev_rec->ble.identity_address_with_type.bda = kOtherAddress;
+  ASSERT_EQ(nullptr, index_.FindByIdentityAddress(kAddress));
+  ASSERT_EQ(0u, index_.Size());
+}
+
+TEST_F(StackBtmDevIndexTest, handle_changed_in_place) {
+  tBTM_SEC_DEV_REC* p_dev_rec = &records_[0];
+  p_dev_rec->hci_handle = kHandle;
+  p_dev_rec->ble_hci_handle = kBleHandle;
+  index_.AddHandle(kHandle, p_dev_rec);
+  index_.AddHandle(kBleHandle, p_dev_rec);
+
+  // Disconnected
+  p_dev_rec->hci_handle = HCI_INVALID_HANDLE;
+  ASSERT_EQ(nullptr, index_.FindByHandle(kHandle));
+  ASSERT_EQ(p_dev_rec, index_.FindByHandle(kBleHandle));
+  ASSERT_EQ(1u, index_.Size());
+
+  // The handle is handed out again, to another record
+  records_[1].hci_handle = kHandle;
+  index_.AddHandle(kHandle, &records_[1]);
+  ASSERT_EQ(&records_[1], index_.FindByHandle(kHandle));
+}
+
+TEST_F(StackBtmDevIndexTest, invalid_handle_is_ignored) {
+  tBTM_SEC_DEV_REC* p_dev_rec = &records_[0];
+  index_.AddHandle(HCI_INVALID_HANDLE, p_dev_rec);
+  ASSERT_EQ(0u, index_.Size());
+  ASSERT_EQ(nullptr, index_.FindByHandle(HCI_INVALID_HANDLE));
+}
+
+TEST_F(StackBtmDevIndexTest, remove_drops_every_entry_of_the_record) {
+  tBTM_SEC_DEV_REC* p_dev_rec = &records_[0];
+  p_dev_rec->bd_addr = kAddress;
+  p_dev_rec->hci_handle = kHandle;
+  index_.AddAddress(kAddress, p_dev_rec);
+  index_.AddIdentityAddress(kAddress, p_dev_rec);
+  index_.AddHandle(kHandle, p_dev_rec);
+  // A stale entry, never looked up since
+  index_.AddAddress(kOtherAddress, p_dev_rec);
+
+  records_[1].bd_addr = kOtherAddress;
+  records_[1].hci_handle = kBleHandle;
+  index_.AddHandle(kBleHandle, &records_[1]);
+
+  index_.Remove(p_dev_rec);
+  ASSERT_EQ(1u, index_.Size());
+  ASSERT_EQ(nullptr, index_.FindByAddress(kAddress));
+  ASSERT_EQ(nullptr, index_.FindByIdentityAddress(kAddress));
+  ASSERT_EQ(nullptr, index_.FindByHandle(kHandle));
+  ASSERT_EQ(&records_[1], index_.FindByHandle(kBleHandle));
+}
+
+class StackBtmDevFindTest : public ::testing::Test {
+ protected:
+  void SetUp() override { btm_cb.Init(BTM_SEC_MODE_SC); }
+  void TearDown() override { btm_cb.Free(); }
+
+  // A resolvable private address of |irk|, as generated by the peer
+  static RawAddress Rpa(const Octet16& irk) {
+    uint8_t prand[3] = {0x11, 0x22, 0x33};
+    prand[2] &= ~BLE_RESOLVE_ADDR_MASK;
+    prand[2] |= BLE_RESOLVE_ADDR_MSB;
+    Octet16 hash = crypto_toolbox::aes_128(irk, prand, 3);
+    return RawAddress(
+        {prand[2], prand[1], prand[0], hash[2], hash[1], hash[0]});
+  }
+};
+
+TEST_F(StackBtmDevFindTest, exact_match_is_preferred_over_resolving) {
+  const Octet16 irk = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+                       0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10};
+  const RawAddress rpa = Rpa(irk);
+
+  tBTM_SEC_DEV_REC* p_bonded = btm_sec_allocate_dev_rec();
+  p_bonded->bd_addr = kAddress;
+  p_bonded->device_type = BT_DEVICE_TYPE_BLE;
+
+  tBTM_SEC_DEV_REC* p_other = btm_sec_allocate_dev_rec();
+  p_other->bd_addr = rpa;
+  p_other->device_type = BT_DEVICE_TYPE_BLE;
+
+  // Nothing resolves the address yet, the exact match is found and indexed
+  ASSERT_EQ(p_other, btm_find_dev(rpa));
+
+  // The earlier record learns the IRK, and would now resolve the address
+  p_bonded->ble.key_type |= BTM_LE_KEY_PID;
+  p_bonded->ble.keys.irk = irk;
+  ASSERT_TRUE(btm_ble_addr_resolvable(rpa, p_bonded));
+  p_bonded->ble.pseudo_addr = RawAddress::kEmpty;
+
+  // The indexed exact match still wins
+  ASSERT_EQ(p_other, btm_find_dev(rpa));
+  ASSERT_TRUE(p_bonded->ble.pseudo_addr.IsEmpty());
+
+  // Without it, the walk resolves the address against the earlier record
+  wipe_secrets_and_remove(p_other);
+  ASSERT_EQ(p_bonded, btm_find_dev(rpa));
+  ASSERT_EQ(rpa, p_bonded->ble.pseudo_addr);
+
+  wipe_secrets_and_remove(p_bonded);
+}
+
+}  // namespace
@@ -25,11 +25,14 @@
 #include "mock_hcic_layer.h"
 #include "osi/include/allocator.h"
 #include "stack/btm/btm_dev.h"
+#include "stack/btm/btm_iso_impl.h"
 #include "stack/include/bt_hdr.h"
 #include "stack/include/hci_error_code.h"
 #include "stack/include/hcidefs.h"
+#include "test/mock/mock_common_time_util.h"
 
 using bluetooth::hci::IsoManager;
+using bluetooth::hci::iso_manager::kIsoTxQueueMaxLen;
 using testing::_;
 using testing::AnyNumber;
 using testing::AtLeast;
@@ -137,6 +140,7 @@ class IsoManagerTest : public Test {
 
   void TearDown() override {
     CleanupIsoManager();
+    test::mock::common_time_util::time_get_os_boottime_us = {};
 
     big_callbacks_.reset();
     cig_callbacks_.reset();
@@ -292,11 +296,41 @@ class IsoManagerTest : public Test {
         });
   }
 
+  // Makes the ISO data path run on a clock which only moves with AdvanceClock()
+  static void UseFakeClock() {
+    fake_clock_us_ = 1000000;
+    test::mock::common_time_util::time_get_os_boottime_us.body = [] {
+      return fake_clock_us_;
+    };
+  }
+  static void AdvanceClock(uint64_t us) { fake_clock_us_ += us; }
+
+  // Sequence number of an ISO data packet with a timestamp
+  static uint16_t GetSeqNb(BT_HDR* p_msg) {
+    uint8_t* p = p_msg->data + p_msg->offset + 8;
+    uint16_t seq_nb;
+    STREAM_TO_UINT16(seq_nb, p);
+    return seq_nb;
+  }
+
+  // Number of completed packets event for a single handle
+  void ReturnCredits(uint16_t handle, uint16_t num_credits) {
+    uint8_t mock_rsp[5];
+    uint8_t* p = mock_rsp;
+    UINT8_TO_STREAM(p, 1);
+    UINT16_TO_STREAM(p, handle);
+    UINT16_TO_STREAM(p, num_credits);
+    IsoManager::GetInstance()->HandleNumComplDataPkts(mock_rsp,
+                                                      sizeof(mock_rsp));
+  }
+
   virtual void CleanupIsoManager() {
     manager_instance_->Stop();
     manager_instance_ = nullptr;
   }
 
+  static inline uint64_t fake_clock_us_ = 0;
+
   static const bluetooth::hci::iso_manager::big_create_params kDefaultBigParams;
   static const bluetooth::hci::iso_manager::cig_create_params kDefaultCigParams;
   static const bluetooth::hci::iso_manager::cig_create_params
@@ -1891,6 +1925,61 @@ TEST_F(IsoManagerTest, SendIsoDataCigValid) {
   }
 }
 
+TEST_F(IsoManagerTest, SendIsoSduCigValid) {
+  IsoManager::GetInstance()->CreateCig(
+      volatile_test_cig_create_cmpl_evt_.cig_id, kDefaultCigParams);
+
+  bluetooth::hci::iso_manager::cis_establish_params params;
+  for (auto& handle : volatile_test_cig_create_cmpl_evt_.conn_handles) {
+    params.conn_pairs.push_back({handle, 1});
+  }
+  IsoManager::GetInstance()->EstablishCis(params);
+
+  for (auto& handle : volatile_test_cig_create_cmpl_evt_.conn_handles) {
+    bluetooth::hci::iso_manager::iso_data_path_params path_params =
+        kDefaultIsoDataPathParams;
+    path_params.data_path_dir =
+        bluetooth::hci::iso_manager::kIsoDataPathDirectionOut;
+    IsoManager::GetInstance()->SetupIsoDataPath(handle, path_params);
+
+    constexpr uint8_t data_len = 108;
+    BT_HDR* p_sdu = (BT_HDR*)osi_malloc(
+        sizeof(BT_HDR) + bluetooth::hci::iso_manager::kIsoSduOffset + data_len);
+    p_sdu->offset = bluetooth::hci::iso_manager::kIsoSduOffset;
+    p_sdu->len = data_len;
+    memset(p_sdu->data + p_sdu->offset, 0xa5, data_len);
+
+    // The SDU is sent in the buffer it was written to
+    EXPECT_CALL(bte_interface_, HciSend)
+        .WillOnce([handle, p_sdu](BT_HDR* p_msg, uint16_t event) {
+          ASSERT_EQ(p_msg, p_sdu);
+          ASSERT_TRUE((event & MSG_STACK_TO_HC_HCI_ISO) != 0);
+          ASSERT_TRUE(p_msg->layer_specific & BT_ISO_HDR_CONTAINS_TS);
+          ASSERT_EQ(p_msg->len, data_len + 12);
+
+          uint8_t* p = p_msg->data + p_msg->offset;
+          uint16_t msg_handle;
+          uint16_t iso_load_len;
+          uint16_t msg_data_len;
+
+          STREAM_TO_UINT16(msg_handle, p);
+          ASSERT_EQ(msg_handle, handle);
+          STREAM_TO_UINT16(iso_load_len, p);
+          ASSERT_EQ(iso_load_len, data_len + 8);
+          STREAM_SKIP_UINT16(p);  // skip ts LSB halfword
+          STREAM_SKIP_UINT16(p);  // skip ts MSB halfword
+          STREAM_SKIP_UINT16(p);  // skip seq_nb
+          STREAM_TO_UINT16(msg_data_len, p);
+          ASSERT_EQ(msg_data_len, data_len);
+          ASSERT_EQ(*p, 0xa5);
+          osi_free(p_msg);
+        })
+        .RetiresOnSaturation();
+
+    IsoManager::GetInstance()->SendIsoSdu(handle, p_sdu);
+  }
+}
+
 TEST_F(IsoManagerTest, SendIsoDataBigValid) {
   IsoManager::GetInstance()->CreateBig(volatile_test_big_params_evt_.big_id,
                                        kDefaultBigParams);
@@ -1963,7 +2052,7 @@ TEST_F(IsoManagerTest, SendIsoDataNoCredits) {
       kDefaultIsoDataPathParams);
 
   /* Try sending twice as much data as we can ignoring the credit limits and
-   * expect the redundant packets to be ignored and not propagated down to the
+   * expect the redundant packets to be queued and not propagated down to the
    * HCI.
    */
   EXPECT_CALL(bte_interface_, HciSend).Times(num_buffers).RetiresOnSaturation();
@@ -1973,13 +2062,14 @@ TEST_F(IsoManagerTest, SendIsoDataNoCredits) {
         data_vec.size());
   }
 
-  // Return all credits for this one handle
-  uint8_t mock_rsp[5];
-  uint8_t* p = mock_rsp;
-  UINT8_TO_STREAM(p, 1);
-  UINT16_TO_STREAM(p, volatile_test_cig_create_cmpl_evt_.conn_handles[0]);
-  UINT16_TO_STREAM(p, num_buffers);
-  IsoManager::GetInstance()->HandleNumComplDataPkts(mock_rsp, sizeof(mock_rsp));
+  // Return all credits for this one handle and expect the queued packets sent
+  EXPECT_CALL(bte_interface_, HciSend)
+      .Times(kIsoTxQueueMaxLen)
+      .RetiresOnSaturation();
+  ReturnCredits(volatile_test_cig_create_cmpl_evt_.conn_handles[0],
+                num_buffers);
+  ReturnCredits(volatile_test_cig_create_cmpl_evt_.conn_handles[0],
+                kIsoTxQueueMaxLen);
 
   // Check on BIG
   IsoManager::GetInstance()->CreateBig(volatile_test_big_params_evt_.big_id,
@@ -1988,7 +2078,7 @@ TEST_F(IsoManagerTest, SendIsoDataNoCredits) {
       volatile_test_big_params_evt_.conn_handles[0], kDefaultIsoDataPathParams);
 
   /* Try sending twice as much data as we can ignoring the credit limits and
-   * expect the redundant packets to be ignored and not propagated down to the
+   * expect the redundant packets to be queued and not propagated down to the
    * HCI.
    */
   EXPECT_CALL(bte_interface_, HciSend).Times(num_buffers);
@@ -2017,39 +2107,35 @@ TEST_F(IsoManagerTest, SendIsoDataCreditsReturned) {
       volatile_test_cig_create_cmpl_evt_.conn_handles[0],
       kDefaultIsoDataPathParams);
 
-  /* Try sending twice as much data as we can, ignoring the credits limit and
-   * expect the redundant packets to be ignored and not propagated down to the
-   * HCI.
+  /* Use all the credits, then send one more packet and expect it to wait for
+   * a credit.
    */
   EXPECT_CALL(bte_interface_, HciSend).Times(num_buffers).RetiresOnSaturation();
-  for (uint8_t i = 0; i < (2 * num_buffers); i++) {
+  for (uint8_t i = 0; i < (num_buffers + 1); i++) {
     IsoManager::GetInstance()->SendIsoData(
         volatile_test_cig_create_cmpl_evt_.conn_handles[0], data_vec.data(),
         data_vec.size());
   }
 
+  // Return a single credit and expect the queued packet go down the HCI
+  EXPECT_CALL(bte_interface_, HciSend).Times(1).RetiresOnSaturation();
+  ReturnCredits(volatile_test_cig_create_cmpl_evt_.conn_handles[0], 1);
+
   // Return all credits for this one handle
-  uint8_t mock_rsp[5];
-  uint8_t* p = mock_rsp;
-  UINT8_TO_STREAM(p, 1);
-  UINT16_TO_STREAM(p, volatile_test_cig_create_cmpl_evt_.conn_handles[0]);
-  UINT16_TO_STREAM(p, num_buffers);
-  IsoManager::GetInstance()->HandleNumComplDataPkts(mock_rsp, sizeof(mock_rsp));
+  ReturnCredits(volatile_test_cig_create_cmpl_evt_.conn_handles[0],
+                num_buffers);
 
   // Expect some more events go down the HCI
   EXPECT_CALL(bte_interface_, HciSend).Times(num_buffers).RetiresOnSaturation();
-  for (uint8_t i = 0; i < (2 * num_buffers); i++) {
+  for (uint8_t i = 0; i < num_buffers; i++) {
     IsoManager::GetInstance()->SendIsoData(
         volatile_test_cig_create_cmpl_evt_.conn_handles[0], data_vec.data(),
         data_vec.size());
   }
 
   // Return all credits for this one handle
-  p = mock_rsp;
-  UINT8_TO_STREAM(p, 1);
-  UINT16_TO_STREAM(p, volatile_test_cig_create_cmpl_evt_.conn_handles[0]);
-  UINT16_TO_STREAM(p, num_buffers);
-  IsoManager::GetInstance()->HandleNumComplDataPkts(mock_rsp, sizeof(mock_rsp));
+  ReturnCredits(volatile_test_cig_create_cmpl_evt_.conn_handles[0],
+                num_buffers);
 
   // Check on BIG
   IsoManager::GetInstance()->CreateBig(volatile_test_big_params_evt_.big_id,
@@ -2057,33 +2143,143 @@ TEST_F(IsoManagerTest, SendIsoDataCreditsReturned) {
   IsoManager::GetInstance()->SetupIsoDataPath(
       volatile_test_big_params_evt_.conn_handles[0], kDefaultIsoDataPathParams);
 
-  /* Try sending twice as much data as we can, ignoring the credits limit and
-   * expect the redundant packets to be ignored and not propagated down to the
-   * HCI.
-   */
   EXPECT_CALL(bte_interface_, HciSend).Times(num_buffers).RetiresOnSaturation();
-  for (uint8_t i = 0; i < (2 * num_buffers); i++) {
+  for (uint8_t i = 0; i < (num_buffers + 1); i++) {
     IsoManager::GetInstance()->SendIsoData(
         volatile_test_big_params_evt_.conn_handles[0], data_vec.data(),
         data_vec.size());
   }
 
+  // Return a single credit and expect the queued packet go down the HCI
+  EXPECT_CALL(bte_interface_, HciSend).Times(1).RetiresOnSaturation();
+  ReturnCredits(volatile_test_big_params_evt_.conn_handles[0], 1);
+
   // Return all credits for this one handle
-  p = mock_rsp;
-  UINT8_TO_STREAM(p, 1);
-  UINT16_TO_STREAM(p, volatile_test_big_params_evt_.conn_handles[0]);
-  UINT16_TO_STREAM(p, num_buffers);
-  IsoManager::GetInstance()->HandleNumComplDataPkts(mock_rsp, sizeof(mock_rsp));
+  ReturnCredits(volatile_test_big_params_evt_.conn_handles[0], num_buffers);
 
   // Expect some more events go down the HCI
   EXPECT_CALL(bte_interface_, HciSend).Times(num_buffers).RetiresOnSaturation();
-  for (uint8_t i = 0; i < (2 * num_buffers); i++) {
+  for (uint8_t i = 0; i < num_buffers; i++) {
     IsoManager::GetInstance()->SendIsoData(
         volatile_test_big_params_evt_.conn_handles[0], data_vec.data(),
         data_vec.size());
   }
 }
 
+TEST_F(IsoManagerTest, SendIsoDataQueueDropsOldest) {
+  uint8_t num_buffers = controller_interface_.GetIsoBufferCount();
+  std::vector<uint8_t> data_vec(108, 0);
+
+  IsoManager::GetInstance()->CreateCig(
+      volatile_test_cig_create_cmpl_evt_.cig_id, kDefaultCigParams);
+
+  auto handle = volatile_test_cig_create_cmpl_evt_.conn_handles[0];
+  IsoManager::GetInstance()->EstablishCis({{{handle, 1}}});
+  IsoManager::GetInstance()->SetupIsoDataPath(handle,
+                                              kDefaultIsoDataPathParams);
+
+  EXPECT_CALL(bte_interface_, HciSend).Times(num_buffers).RetiresOnSaturation();
+  for (uint8_t i = 0; i < num_buffers; i++) {
+    IsoManager::GetInstance()->SendIsoData(handle, data_vec.data(),
+                                           data_vec.size());
+  }
+
+  /* Queue more packets than there is room for, each with its index as the
+   * payload */
+  const uint8_t num_queued = kIsoTxQueueMaxLen + 2;
+  for (uint8_t i = 0; i < num_queued; i++) {
+    data_vec[0] = i;
+    IsoManager::GetInstance()->SendIsoData(handle, data_vec.data(),
+                                           data_vec.size());
+  }
+
+  // Expect the newest packets, in order, once there are credits
+  std::vector<uint8_t> sent_payloads;
+  EXPECT_CALL(bte_interface_, HciSend)
+      .Times(kIsoTxQueueMaxLen)
+      .WillRepeatedly([&sent_payloads](BT_HDR* p_msg, uint16_t event) {
+        sent_payloads.push_back(p_msg->data[p_msg->offset + 12]);
+      })
+      .RetiresOnSaturation();
+  ReturnCredits(handle, num_buffers);
+
+  std::vector<uint8_t> expected_payloads;
+  for (uint8_t i = num_queued - kIsoTxQueueMaxLen; i < num_queued; i++) {
+    expected_payloads.push_back(i);
+  }
+  ASSERT_EQ(sent_payloads, expected_payloads);
+}
+
+TEST_F(IsoManagerTest, SendIsoDataQueueFlushTimeout) {
+  uint8_t num_buffers = controller_interface_.GetIsoBufferCount();
+  std::vector<uint8_t> data_vec(108, 0);
+  UseFakeClock();
+
+  IsoManager::GetInstance()->CreateCig(
+      volatile_test_cig_create_cmpl_evt_.cig_id, kDefaultCigParams);
+
+  auto handle = volatile_test_cig_create_cmpl_evt_.conn_handles[0];
+  IsoManager::GetInstance()->EstablishCis({{{handle, 1}}});
+  IsoManager::GetInstance()->SetupIsoDataPath(handle,
+                                              kDefaultIsoDataPathParams);
+
+  EXPECT_CALL(bte_interface_, HciSend).Times(num_buffers).RetiresOnSaturation();
+  for (uint8_t i = 0; i < (num_buffers + 1); i++) {
+    IsoManager::GetInstance()->SendIsoData(handle, data_vec.data(),
+                                           data_vec.size());
+  }
+
+  /* The transport latency is short, so the queued packet is still sent within
+   * two SDU intervals */
+  AdvanceClock(2 * kDefaultCigParams.sdu_itv_mtos);
+  EXPECT_CALL(bte_interface_, HciSend).Times(1).RetiresOnSaturation();
+  ReturnCredits(handle, 1);
+
+  // And expires after that
+  IsoManager::GetInstance()->SendIsoData(handle, data_vec.data(),
+                                         data_vec.size());
+  AdvanceClock(2 * kDefaultCigParams.sdu_itv_mtos + 1);
+  EXPECT_CALL(bte_interface_, HciSend).Times(0);
+  ReturnCredits(handle, num_buffers);
+}
+
+TEST_F(IsoManagerTest, SendIsoDataSeqNbPacedOnSduInterval) {
+  std::vector<uint8_t> data_vec(108, 0);
+  UseFakeClock();
+
+  IsoManager::GetInstance()->CreateCig(
+      volatile_test_cig_create_cmpl_evt_.cig_id, kDefaultCigParams);
+
+  auto handle = volatile_test_cig_create_cmpl_evt_.conn_handles[0];
+  IsoManager::GetInstance()->EstablishCis({{{handle, 1}}});
+  IsoManager::GetInstance()->SetupIsoDataPath(handle,
+                                              kDefaultIsoDataPathParams);
+
+  std::vector<uint16_t> seq_nbs;
+  EXPECT_CALL(bte_interface_, HciSend)
+      .WillRepeatedly([&seq_nbs](BT_HDR* p_msg, uint16_t event) {
+        seq_nbs.push_back(GetSeqNb(p_msg));
+      });
+  auto send = [&](uint64_t advance_us) {
+    AdvanceClock(advance_us);
+    IsoManager::GetInstance()->SendIsoData(handle, data_vec.data(),
+                                           data_vec.size());
+    ReturnCredits(handle, 1);
+  };
+
+  const uint32_t sdu_itv = kDefaultCigParams.sdu_itv_mtos;
+  // One SDU per interval
+  send(0);
+  send(sdu_itv);
+  // A late SDU followed by the one of the next interval, sent right after it
+  send(sdu_itv + sdu_itv / 2);
+  send(0);
+  // The source stalled for three intervals
+  send(4 * sdu_itv);
+
+  ASSERT_EQ(seq_nbs, std::vector<uint16_t>({0, 1, 2, 3, 6}));
+}
+
 TEST_F(IsoManagerTest, SendIsoDataCreditsReturnedByDisconnection) {
   uint8_t num_buffers = controller_interface_.GetIsoBufferCount();
   std::vector<uint8_t> data_vec(108, 0);
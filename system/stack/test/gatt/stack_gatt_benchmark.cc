@@ -0,0 +1,114 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "stack/gatt/gatt_int.h"
+#include "stack/include/gatt_api.h"
+#include "types/bluetooth/uuid.h"
+#include "types/raw_address.h"
+
+using ::benchmark::State;
+using bluetooth::Uuid;
+
+std::map<std::string, int> mock_function_count_map;
+
+void LogMsg(uint32_t trace_set_mask, const char* fmt_str, ...) {}
+
+namespace {
+
+void tGATT_CONN_CBACK(tGATT_IF gatt_if, const RawAddress& bda, uint16_t conn_id,
+                      bool connected, tGATT_DISCONN_REASON reason,
+                      tBT_TRANSPORT transport) {}
+void tGATT_REQ_CBACK(uint16_t conn_id, uint32_t trans_id, tGATTS_REQ_TYPE type,
+                     tGATTS_DATA* p_data) {}
+
+tGATT_CBACK gatt_callbacks = {
+    .p_conn_cb = tGATT_CONN_CBACK,
+    .p_req_cb = tGATT_REQ_CBACK,
+};
+
+// Registers a server application the way apps do at startup, one service at
+// a time, each with a readable, a writable and a notifying characteristic,
+// then has a client read the database hash.
+void BM_GattServerBringUp(State& state) {
+  const int num_services = state.range(0);
+  const Uuid app_uuid = Uuid::From16Bit(0xBEEF);
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    gatt_init();
+    state.ResumeTiming();
+
+    tGATT_IF gatt_if =
+        GATT_Register(app_uuid, "benchmark", &gatt_callbacks, false);
+    for (int i = 0; i < num_services; i++) {
+      btgatt_db_element_t service[] = {
+          {
+              .uuid = Uuid::From16Bit(0xA000 + i),
+              .type = BTGATT_DB_PRIMARY_SERVICE,
+          },
+          {
+              .uuid = Uuid::From16Bit(0xB000 + 3 * i),
+              .type = BTGATT_DB_CHARACTERISTIC,
+              .properties = GATT_CHAR_PROP_BIT_READ,
+              .permissions = GATT_PERM_READ,
+          },
+          {
+              .uuid = Uuid::From16Bit(0xB001 + 3 * i),
+              .type = BTGATT_DB_CHARACTERISTIC,
+              .properties = GATT_CHAR_PROP_BIT_WRITE,
+              .permissions = GATT_PERM_WRITE,
+          },
+          {
+              .uuid = Uuid::From16Bit(0xB002 + 3 * i),
+              .type = BTGATT_DB_CHARACTERISTIC,
+              .properties = GATT_CHAR_PROP_BIT_NOTIFY,
+              .permissions = GATT_PERM_READ,
+          },
+          {
+              .uuid = Uuid::From16Bit(GATT_UUID_CHAR_CLIENT_CONFIG),
+              .type = BTGATT_DB_DESCRIPTOR,
+              .permissions = GATT_PERM_READ | GATT_PERM_WRITE,
+          }};
+      GATTS_AddService(gatt_if, service,
+                       sizeof(service) / sizeof(btgatt_db_element_t));
+    }
+    benchmark::DoNotOptimize(gatts_get_database_hash());
+
+    state.PauseTiming();
+    GATT_Deregister(gatt_if);
+    gatt_free();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * num_services);
+}
+
+BENCHMARK(BM_GattServerBringUp)->Arg(10)->Arg(50);
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
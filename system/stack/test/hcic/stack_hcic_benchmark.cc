@@ -0,0 +1,196 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <base/bind.h>
+#include <base/callback.h>
+#include <base/location.h>
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include "hci/hci_packets.h"
+#include "packet/bit_inserter.h"
+#include "packet/raw_builder.h"
+#include "stack/include/bt_hdr.h"
+#include "stack/include/bt_types.h"
+#include "stack/include/btu.h"
+#include "stack/include/hcimsgs.h"
+#include "test/mock/mock_osi_allocator.h"
+#include "types/raw_address.h"
+
+using ::benchmark::State;
+using bluetooth::hci::CommandBuilder;
+using bluetooth::hci::OpCode;
+using bluetooth::packet::BitInserter;
+using bluetooth::packet::RawBuilder;
+
+namespace {
+
+// Heap allocations made through new and through the osi allocator
+size_t g_allocations = 0;
+
+}  // namespace
+
+void* operator new(size_t size) {
+  g_allocations++;
+  void* ptr = malloc(size);
+  if (ptr == nullptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t size) noexcept { free(ptr); }
+
+namespace {
+
+// Serializes the Gd command as the HCI layer does before handing it to the
+// HAL
+void send_to_controller(std::unique_ptr<CommandBuilder> packet) {
+  std::vector<uint8_t> bytes;
+  BitInserter bi(bytes);
+  packet->Serialize(bi);
+  benchmark::DoNotOptimize(bytes.data());
+}
+
+}  // namespace
+
+// Same work as the legacy HCI shim for a command in a BT_HDR: the parameters
+// are copied out of it into the Gd command and the BT_HDR is freed
+void btu_hcif_send_cmd(uint8_t controller_id, const BT_HDR* p_buf) {
+  const uint8_t* data = p_buf->data + p_buf->offset;
+  uint16_t opcode = data[1] << 8 | data[0];
+
+  std::vector<uint8_t> bytes(data + HCIC_PREAMBLE_SIZE, data + p_buf->len);
+  auto payload = std::make_unique<RawBuilder>();
+  payload->AddOctets(bytes);
+  send_to_controller(
+      CommandBuilder::Create(static_cast<OpCode>(opcode), std::move(payload)));
+  osi_free(const_cast<BT_HDR*>(p_buf));
+}
+
+void btu_hcif_send_cmd_with_cb(const base::Location& posted_from,
+                               uint16_t opcode, uint8_t* params,
+                               uint8_t params_len,
+                               base::OnceCallback<void(uint8_t*, uint16_t)> cb) {
+  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  uint8_t* pp = (uint8_t*)(p + 1);
+
+  p->len = HCIC_PREAMBLE_SIZE + params_len;
+  p->offset = 0;
+
+  UINT16_TO_STREAM(pp, opcode);
+  UINT8_TO_STREAM(pp, params_len);
+  memcpy(pp, params, params_len);
+
+  btu_hcif_send_cmd(0, p);
+}
+
+// Same work as the legacy HCI shim for a command from its parameters: they
+// become the payload of the Gd command
+void btu_hcif_send_cmd_params(uint16_t opcode, std::vector<uint8_t> params) {
+  send_to_controller(CommandBuilder::Create(
+      static_cast<OpCode>(opcode),
+      std::make_unique<RawBuilder>(std::move(params))));
+}
+
+void btu_hcif_send_cmd_params_with_cb(
+    const base::Location& posted_from, uint16_t opcode,
+    std::vector<uint8_t> params,
+    base::OnceCallback<void(uint8_t*, uint16_t)> cb) {
+  btu_hcif_send_cmd_params(opcode, std::move(params));
+}
+
+void btm_acl_paging(BT_HDR* p, const RawAddress& dest) { osi_free(p); }
+
+namespace {
+
+constexpr uint16_t kAclHandle = 0x0040;
+constexpr uint16_t kCisHandle = 0x0060;
+
+class BM_HciCommand : public ::benchmark::Fixture {
+ protected:
+  void SetUp(State& st) override {
+    ::benchmark::Fixture::SetUp(st);
+    test::mock::osi_allocator::osi_malloc.body = [](size_t size) {
+      g_allocations++;
+      return malloc(size);
+    };
+    test::mock::osi_allocator::osi_free.body = [](void* ptr) { free(ptr); };
+  }
+
+  void TearDown(State& st) override {
+    test::mock::osi_allocator::osi_malloc = {};
+    test::mock::osi_allocator::osi_free = {};
+    ::benchmark::Fixture::TearDown(st);
+  }
+
+  template <typename Send>
+  void Run(State& state, Send send) {
+    size_t allocations = g_allocations;
+    for (auto _ : state) {
+      send();
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["allocations"] = ::benchmark::Counter(
+        g_allocations - allocations, ::benchmark::Counter::kAvgIterations);
+  }
+};
+
+// Get Link Quality takes the same parameters as Read RSSI and is still built
+// in a BT_HDR, which gives the cost of the previous path
+BENCHMARK_F(BM_HciCommand, get_link_quality_bt_hdr)(State& state) {
+  Run(state, [] { btsnd_hcic_get_link_quality(kAclHandle); });
+}
+
+BENCHMARK_F(BM_HciCommand, read_rssi)(State& state) {
+  Run(state, [] { btsnd_hcic_read_rssi(kAclHandle); });
+}
+
+BENCHMARK_F(BM_HciCommand, ble_set_scan_enable)(State& state) {
+  Run(state, [] { btsnd_hcic_ble_set_scan_enable(1, 0); });
+}
+
+BENCHMARK_F(BM_HciCommand, ble_set_data_length)(State& state) {
+  Run(state, [] { btsnd_hcic_ble_set_data_length(kAclHandle, 251, 2120); });
+}
+
+// Answered by Command Status, so still built in a BT_HDR
+BENCHMARK_F(BM_HciCommand, ble_upd_ll_conn_params_bt_hdr)(State& state) {
+  Run(state, [] {
+    btsnd_hcic_ble_upd_ll_conn_params(kAclHandle, 6, 12, 0, 500, 0, 0);
+  });
+}
+
+BENCHMARK_F(BM_HciCommand, setup_iso_data_path)(State& state) {
+  Run(state, [] {
+    btsnd_hcic_setup_iso_data_path(kCisHandle, 0, 0, 0x03, 0, 0, 0, {},
+                                   base::DoNothing());
+  });
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
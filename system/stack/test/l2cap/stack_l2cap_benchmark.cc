@@ -0,0 +1,146 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "common/init_flags.h"
+#include "device/include/controller.h"
+#include "internal_include/bt_trace.h"
+#include "osi/include/allocator.h"
+#include "stack/btm/btm_int_types.h"
+#include "stack/include/bt_hdr.h"
+#include "stack/include/bt_types.h"
+#include "stack/include/l2cdefs.h"
+#include "stack/l2cap/l2c_int.h"
+#include "types/raw_address.h"
+
+using ::benchmark::State;
+
+tBTM_CB btm_cb;
+
+// Global trace level referred in the code under test
+uint8_t appl_trace_level = BT_TRACE_LEVEL_NONE;
+
+extern "C" void LogMsg(uint32_t trace_set_mask, const char* fmt_str, ...) {}
+
+namespace {
+
+constexpr uint16_t kFixedCid = L2CAP_SMP_BR_CID;
+constexpr uint16_t kPayloadSize = 64;
+constexpr uint16_t kAclBufferCount = 8;
+
+controller_t controller = {
+    .get_ble_default_data_packet_length = []() -> uint16_t { return 27; },
+};
+
+// The buffers are handed back to the benchmark instead of being freed
+void fixed_data_cb(uint16_t cid, const RawAddress& bd_addr, BT_HDR* p_buf) {
+  benchmark::DoNotOptimize(p_buf);
+}
+
+void fixed_conn_cb(uint16_t cid, const RawAddress& bd_addr, bool connected,
+                   uint16_t reason, tBT_TRANSPORT transport) {}
+
+// An ACL packet for the fixed channel, as received from the controller
+BT_HDR* make_acl_packet(uint16_t handle) {
+  BT_HDR* p_buf = (BT_HDR*)osi_calloc(sizeof(BT_HDR) + HCI_DATA_PREAMBLE_SIZE +
+                                      L2CAP_PKT_OVERHEAD + kPayloadSize);
+  p_buf->len = HCI_DATA_PREAMBLE_SIZE + L2CAP_PKT_OVERHEAD + kPayloadSize;
+  uint8_t* p = p_buf->data;
+  UINT16_TO_STREAM(p, handle | (L2CAP_PKT_START << L2CAP_PKT_TYPE_SHIFT));
+  UINT16_TO_STREAM(p, L2CAP_PKT_OVERHEAD + kPayloadSize);
+  UINT16_TO_STREAM(p, kPayloadSize);
+  UINT16_TO_STREAM(p, kFixedCid);
+  return p_buf;
+}
+
+// Connected classic links, with handles far apart so that a lookup touches
+// a different part of the handle index each time
+class Links {
+ public:
+  explicit Links(int num_links) {
+    bluetooth::common::InitFlags::SetAllForTesting();
+    l2c_init();
+    l2cb.num_lm_acl_bufs = l2cb.controller_xmit_window = kAclBufferCount;
+    l2cb.fixed_reg[kFixedCid - L2CAP_FIRST_FIXED_CHNL].pL2CA_FixedData_Cb =
+        fixed_data_cb;
+    l2cb.fixed_reg[kFixedCid - L2CAP_FIRST_FIXED_CHNL].pL2CA_FixedConn_Cb =
+        fixed_conn_cb;
+    for (int i = 0; i < num_links; i++) {
+      RawAddress bd_addr({0x00, 0x11, 0x22, 0x33, 0x44, (uint8_t)i});
+      tL2C_LCB* p_lcb =
+          l2cu_allocate_lcb(bd_addr, false, BT_TRANSPORT_BR_EDR);
+      uint16_t handle = 0x0040 + i * 0x0101;
+      l2cu_set_lcb_handle(*p_lcb, handle);
+      p_lcb->link_state = LST_CONNECTED;
+      lcbs_.push_back(p_lcb);
+      packets_.push_back(make_acl_packet(handle));
+    }
+  }
+
+  ~Links() {
+    for (tL2C_LCB* p_lcb : lcbs_) {
+      p_lcb->link_state = LST_DISCONNECTED;
+      l2cu_release_lcb(p_lcb);
+    }
+    for (BT_HDR* p_buf : packets_) osi_free(p_buf);
+    l2c_free();
+  }
+
+  // Receive one packet on each link
+  void ReceiveOnEach() {
+    for (BT_HDR* p_buf : packets_) {
+      p_buf->offset = 0;
+      p_buf->len = HCI_DATA_PREAMBLE_SIZE + L2CAP_PKT_OVERHEAD + kPayloadSize;
+      p_buf->layer_specific = 0;
+      l2c_rcv_acl_data(p_buf);
+    }
+  }
+
+  const std::vector<tL2C_LCB*>& lcbs() const { return lcbs_; }
+
+ private:
+  std::vector<tL2C_LCB*> lcbs_;
+  std::vector<BT_HDR*> packets_;
+};
+
+}  // namespace
+
+const controller_t* controller_get_interface() { return &controller; }
+
+// range(0): number of connected links
+static void BM_ReceiveAclData(State& state) {
+  Links links(state.range(0));
+  for (auto _ : state) {
+    links.ReceiveOnEach();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ReceiveAclData)->Arg(1)->Arg(4)->Arg(MAX_L2CAP_LINKS);
+
+// range(0): number of connected links
+static void BM_FindLcbByBdAddr(State& state) {
+  Links links(state.range(0));
+  const RawAddress bd_addr = links.lcbs().back()->remote_bd_addr;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        l2cu_find_lcb_by_bd_addr(bd_addr, BT_TRANSPORT_BR_EDR));
+  }
+}
+BENCHMARK(BM_FindLcbByBdAddr)->Arg(1)->Arg(4)->Arg(MAX_L2CAP_LINKS);
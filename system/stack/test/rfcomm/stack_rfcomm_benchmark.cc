@@ -0,0 +1,205 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <gmock/gmock.h>
+
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+#include "bt_target.h"
+#include "mock_l2cap_layer.h"
+#include "osi/include/allocator.h"
+#include "osi/include/fixed_queue.h"
+#include "stack/include/bt_hdr.h"
+#include "stack/include/port_api.h"
+#include "stack/include/rfcdefs.h"
+#include "stack/rfcomm/port_int.h"
+#include "stack/rfcomm/rfc_int.h"
+#include "types/raw_address.h"
+
+using ::benchmark::State;
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::NiceMock;
+
+namespace {
+
+constexpr uint16_t kLcid = 0x0040;
+constexpr uint8_t kTxDlci = 2;
+constexpr uint8_t kRxDlci = 3;
+constexpr size_t kBytesPerIteration = 64 * 1024;
+
+const RawAddress kPeerAddress = {{0xAA, 0x00, 0x11, 0x22, 0x33, 0x44}};
+
+// Frames written to L2CAP, delivered back to the other port of the mux once
+// the writer returns, as they would be by the peer
+std::deque<BT_HDR*> g_frames;
+size_t g_frames_sent = 0;
+
+uint8_t loopback_write(uint16_t cid, BT_HDR* p_buf) {
+  g_frames.push_back(p_buf);
+  g_frames_sent++;
+  return L2CAP_DW_SUCCESS;
+}
+
+// Serial port emulation over an RFCOMM multiplexer whose L2CAP channel loops
+// back: data sent on the TX port is received on the RX port, and the credits
+// the RX port grants come back to the TX port. The user of the TX port writes
+// as fast as the flow control allows and the user of the RX port reads
+// everything it has received between writes.
+class BM_RfcommSppLoopback : public ::benchmark::Fixture {
+ protected:
+  void SetUp(State& st) override {
+    ::benchmark::Fixture::SetUp(st);
+    ON_CALL(l2cap_interface_, DataWrite(_, _))
+        .WillByDefault(Invoke(loopback_write));
+    bluetooth::l2cap::SetMockInterface(&l2cap_interface_);
+
+    RFCOMM_Init();
+
+    p_mcb_ = &rfc_cb.port.rfc_mcb[0];
+    p_mcb_->bd_addr = kPeerAddress;
+    p_mcb_->lcid = kLcid;
+    p_mcb_->state = RFC_MX_STATE_CONNECTED;
+    p_mcb_->is_initiator = true;
+    p_mcb_->peer_ready = true;
+    p_mcb_->flow = PORT_FC_CREDIT;
+    p_mcb_->peer_l2cap_mtu = L2CAP_MTU_SIZE;
+    p_mcb_->cmd_q = fixed_queue_new(SIZE_MAX);
+
+    p_tx_port_ = OpenPort(kTxDlci);
+    p_rx_port_ = OpenPort(kRxDlci);
+
+    write_data_.assign(st.range(0), 0x5a);
+    read_data_.resize(L2CAP_MTU_SIZE);
+    bytes_read_ = 0;
+    g_frames_sent = 0;
+  }
+
+  void TearDown(State& st) override {
+    DeliverFrames();
+    ClosePort(p_tx_port_);
+    ClosePort(p_rx_port_);
+    fixed_queue_free(p_mcb_->cmd_q, osi_free);
+    memset(&rfc_cb, 0, sizeof(rfc_cb));
+    bluetooth::l2cap::SetMockInterface(nullptr);
+    ::benchmark::Fixture::TearDown(st);
+  }
+
+  tPORT* OpenPort(uint8_t dlci) {
+    tPORT* p_port = port_allocate_port(dlci, kPeerAddress);
+    p_port->rfc.p_mcb = p_mcb_;
+    p_port->rfc.state = RFC_STATE_OPENED;
+    p_port->state = PORT_CONNECTION_STATE_OPENED;
+    p_port->port_ctrl = PORT_CTRL_REQ_SENT | PORT_CTRL_IND_RECEIVED;
+    p_port->mtu = BTA_RFC_MTU_SIZE;
+    p_port->peer_mtu = BTA_RFC_MTU_SIZE;
+    p_port->credit_rx_max = PORT_RX_BUF_HIGH_WM;
+    p_port->credit_rx_low = PORT_RX_BUF_LOW_WM;
+    p_port->rx_buf_critical = PORT_RX_BUF_CRITICAL_WM;
+    p_port->credit_rx = p_port->credit_rx_max;
+    p_port->credit_tx = PORT_RX_BUF_HIGH_WM;
+    p_mcb_->port_handles[dlci] = p_port->handle;
+    return p_port;
+  }
+
+  void ClosePort(tPORT* p_port) {
+    fixed_queue_free(p_port->tx.queue, osi_free);
+    fixed_queue_free(p_port->rx.queue, osi_free);
+    alarm_free(p_port->rfc.port_timer);
+  }
+
+  // Plays the peer: hands the payload of UIH frames to the port on the other
+  // DLCI and credits to the port it grants them to
+  void DeliverFrames() {
+    while (!g_frames.empty()) {
+      BT_HDR* p_buf = g_frames.front();
+      g_frames.pop_front();
+
+      uint8_t* p = (uint8_t*)(p_buf + 1) + p_buf->offset;
+      uint8_t dlci = *p++ >> RFCOMM_SHIFT_DLCI;
+      bool has_credits = (*p++ & RFCOMM_PF) != 0;
+      uint16_t len = *p >> 1;
+      if (!(*p++ & RFCOMM_EA)) len |= (uint16_t)(*p++) << 7;
+      uint8_t credits = has_credits ? *p++ : 0;
+
+      tPORT* p_peer_port = port_find_mcb_dlci_port(p_mcb_, dlci ^ 1);
+      if (credits) rfc_inc_credit(p_peer_port, credits);
+      if (len == 0) {
+        osi_free(p_buf);
+        continue;
+      }
+      p_buf->offset = p - (uint8_t*)(p_buf + 1);
+      p_buf->len = len;
+      PORT_DataInd(p_mcb_, p_peer_port->dlci, p_buf);
+    }
+  }
+
+  void ReadAll() {
+    while (!fixed_queue_is_empty(p_rx_port_->rx.queue)) {
+      uint16_t len = 0;
+      PORT_ReadData(p_rx_port_->handle, read_data_.data(), read_data_.size(),
+                    &len);
+      bytes_read_ += len;
+    }
+  }
+
+  tRFC_MCB* p_mcb_ = nullptr;
+  tPORT* p_tx_port_ = nullptr;
+  tPORT* p_rx_port_ = nullptr;
+  NiceMock<bluetooth::l2cap::MockL2capInterface> l2cap_interface_;
+  std::vector<char> write_data_;
+  std::vector<char> read_data_;
+  size_t bytes_read_ = 0;
+};
+
+BENCHMARK_DEFINE_F(BM_RfcommSppLoopback, write_read)(State& state) {
+  for (auto _ : state) {
+    size_t written = 0;
+    while (written < kBytesPerIteration) {
+      uint16_t len = 0;
+      PORT_WriteData(p_tx_port_->handle, write_data_.data(),
+                     (uint16_t)write_data_.size(), &len);
+      written += len;
+      DeliverFrames();
+      ReadAll();
+      DeliverFrames();
+    }
+  }
+  state.SetBytesProcessed(bytes_read_);
+  state.counters["frames"] =
+      ::benchmark::Counter(g_frames_sent, ::benchmark::Counter::kIsRate);
+}
+
+// Write sizes of an AT command channel, a small record based protocol and
+// bulk transfers of a full MTU
+BENCHMARK_REGISTER_F(BM_RfcommSppLoopback, write_read)
+    ->Arg(16)
+    ->Arg(128)
+    ->Arg(BTA_RFC_MTU_SIZE);
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
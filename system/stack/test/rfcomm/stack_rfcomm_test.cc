@@ -23,12 +23,15 @@
 #include "mock_btm_layer.h"
 #include "mock_l2cap_layer.h"
 #include "osi/include/allocator.h"
+#include "osi/include/fixed_queue.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
 #include "stack/include/bt_hdr.h"
 #include "stack/include/btm_api.h"
 #include "stack/include/l2c_api.h"
 #include "stack/include/port_api.h"
+#include "stack/include/rfcdefs.h"
+#include "stack/rfcomm/port_int.h"
 #include "stack/rfcomm/rfc_int.h"
 #include "stack_rfcomm_test_utils.h"
 #include "stack_test_packet_utils.h"
@@ -63,6 +66,7 @@ namespace {
 
 using testing::_;
 using testing::DoAll;
+using testing::NiceMock;
 using testing::Return;
 using testing::Test;
 using testing::StrictMock;
@@ -889,4 +893,188 @@ TEST_F(StackRfcommTest, DISABLED_TestConnectionCollision) {
   l2cap_appl_info_.pL2CA_DataInd_Cb(new_lcid, uih_msc_rsp_from_peer);
 }
 
+// Data path of a port opened on a connected multiplexer, set up directly in
+// the control blocks. Frames written to L2CAP are kept along with the number
+// of frames left in the transmit queue when they were written.
+class StackRfcommPortDataTest : public Test {
+ protected:
+  static constexpr uint16_t kLcid = 0x0040;
+  static constexpr uint8_t kDlci = 2;
+  static constexpr uint16_t kPeerMtu = 100;
+
+  void SetUp() override {
+    Test::SetUp();
+    bluetooth::l2cap::SetMockInterface(&l2cap_interface_);
+    ON_CALL(l2cap_interface_, DataWrite(kLcid, _))
+        .WillByDefault([this](uint16_t cid, BT_HDR* p_buf) {
+          frame_lens_.push_back(p_buf->len);
+          queue_lens_.push_back(fixed_queue_length(p_port_->tx.queue));
+          osi_free(p_buf);
+          return L2CAP_DW_SUCCESS;
+        });
+    RFCOMM_Init();
+
+    p_mcb_ = &rfc_cb.port.rfc_mcb[0];
+    p_mcb_->bd_addr = GetTestAddress(0);
+    p_mcb_->lcid = kLcid;
+    p_mcb_->state = RFC_MX_STATE_CONNECTED;
+    p_mcb_->is_initiator = true;
+    p_mcb_->peer_ready = true;
+    p_mcb_->flow = PORT_FC_CREDIT;
+    p_mcb_->cmd_q = fixed_queue_new(SIZE_MAX);
+
+    p_port_ = port_allocate_port(kDlci, p_mcb_->bd_addr);
+    p_port_->rfc.p_mcb = p_mcb_;
+    p_port_->rfc.state = RFC_STATE_OPENED;
+    p_port_->state = PORT_CONNECTION_STATE_OPENED;
+    p_port_->port_ctrl = PORT_CTRL_REQ_SENT | PORT_CTRL_IND_RECEIVED;
+    p_port_->mtu = kPeerMtu;
+    p_port_->peer_mtu = kPeerMtu;
+    p_port_->credit_rx_max = PORT_RX_BUF_HIGH_WM;
+    p_port_->credit_rx = p_port_->credit_rx_max;
+    p_mcb_->port_handles[kDlci] = p_port_->handle;
+  }
+
+  void TearDown() override {
+    fixed_queue_free(p_port_->tx.queue, osi_free);
+    fixed_queue_free(p_port_->rx.queue, osi_free);
+    alarm_free(p_port_->rfc.port_timer);
+    fixed_queue_free(p_mcb_->cmd_q, osi_free);
+    memset(&rfc_cb, 0, sizeof(rfc_cb));
+    bluetooth::l2cap::SetMockInterface(nullptr);
+    Test::TearDown();
+  }
+
+  // Lengths of the buffers waiting in the transmit queue
+  std::vector<uint16_t> QueuedLens() {
+    std::vector<uint16_t> lens;
+    list_t* list = fixed_queue_get_list(p_port_->tx.queue);
+    for (const list_node_t* node = list_begin(list); node != list_end(list);
+         node = list_next(node)) {
+      lens.push_back(static_cast<BT_HDR*>(list_node(node))->len);
+    }
+    return lens;
+  }
+
+  // Queues |num_frames| frames of peer MTU size while the peer stops the flow
+  void QueueFrames(size_t num_frames) {
+    p_port_->tx.peer_fc = true;
+    std::vector<char> data(num_frames * kPeerMtu, 'a');
+    uint16_t len = 0;
+    ASSERT_EQ(PORT_WriteData(p_port_->handle, data.data(), data.size(), &len),
+              PORT_SUCCESS);
+    ASSERT_EQ(len, data.size());
+    ASSERT_EQ(fixed_queue_length(p_port_->tx.queue), num_frames);
+  }
+
+  static int DataCoCallback(uint16_t port_handle, uint8_t* p_buf, uint16_t len,
+                            int type) {
+    if (type == DATA_CO_CALLBACK_TYPE_OUTGOING_SIZE) {
+      *(int*)p_buf = co_data_.size();
+      return true;
+    }
+    if (type != DATA_CO_CALLBACK_TYPE_OUTGOING || len > co_data_.size()) {
+      return false;
+    }
+    memcpy(p_buf, co_data_.data(), len);
+    co_data_.erase(co_data_.begin(), co_data_.begin() + len);
+    return true;
+  }
+
+  static inline std::vector<uint8_t> co_data_;
+
+  NiceMock<bluetooth::l2cap::MockL2capInterface> l2cap_interface_;
+  tRFC_MCB* p_mcb_ = nullptr;
+  tPORT* p_port_ = nullptr;
+  std::vector<uint16_t> frame_lens_;
+  std::vector<size_t> queue_lens_;
+};
+
+TEST_F(StackRfcommPortDataTest, WriteDataFillsQueuedBuffersUpToPeerMtu) {
+  p_port_->tx.peer_fc = true;
+
+  // Small writes behind flow control go out in frames of the peer MTU
+  char data[30];
+  for (size_t i = 0; i < 10; i++) {
+    memset(data, 'a' + i, sizeof(data));
+    uint16_t len = 0;
+    ASSERT_EQ(PORT_WriteData(p_port_->handle, data, sizeof(data), &len),
+              PORT_SUCCESS);
+    ASSERT_EQ(len, sizeof(data));
+  }
+  ASSERT_EQ(QueuedLens(), std::vector<uint16_t>({100, 100, 100}));
+  ASSERT_EQ(p_port_->tx.queue_size, 300u);
+
+  // The bytes are kept in order across buffers
+  BT_HDR* p_buf = (BT_HDR*)list_back(fixed_queue_get_list(p_port_->tx.queue));
+  uint8_t* p_data = (uint8_t*)(p_buf + 1) + p_buf->offset;
+  ASSERT_EQ(p_data[0], 'a' + 6);
+  ASSERT_EQ(p_data[9], 'a' + 6);
+  ASSERT_EQ(p_data[10], 'a' + 7);
+  ASSERT_EQ(p_data[99], 'a' + 9);
+
+  // A write larger than the room left fills it and starts a new buffer
+  char large_data[150] = {};
+  uint16_t len = 0;
+  ASSERT_EQ(PORT_WriteData(p_port_->handle, large_data, sizeof(large_data),
+                           &len),
+            PORT_SUCCESS);
+  ASSERT_EQ(len, sizeof(large_data));
+  ASSERT_EQ(QueuedLens(), std::vector<uint16_t>({100, 100, 100, 100, 50}));
+  ASSERT_TRUE(frame_lens_.empty());
+}
+
+TEST_F(StackRfcommPortDataTest, WriteDataCoFillsQueuedBuffersUpToPeerMtu) {
+  p_port_->tx.peer_fc = true;
+  p_port_->p_data_co_callback = DataCoCallback;
+
+  for (size_t i = 0; i < 5; i++) {
+    co_data_.assign(40, 'a' + i);
+    int len = 0;
+    ASSERT_EQ(PORT_WriteDataCO(p_port_->handle, &len), PORT_SUCCESS);
+    ASSERT_EQ(len, 40);
+    ASSERT_TRUE(co_data_.empty());
+  }
+  ASSERT_EQ(QueuedLens(), std::vector<uint16_t>({100, 100}));
+  ASSERT_EQ(p_port_->tx.queue_size, 200u);
+  ASSERT_TRUE(frame_lens_.empty());
+}
+
+TEST_F(StackRfcommPortDataTest, SendTxDataTakesFramesTheCreditsAllow) {
+  QueueFrames(5);
+
+  // All the frames the credits allow are taken from the queue at once
+  rfc_inc_credit(p_port_, 3);
+  ASSERT_EQ(queue_lens_, std::vector<size_t>({2, 2, 2}));
+  ASSERT_TRUE(p_port_->tx.peer_fc);
+  ASSERT_EQ(p_port_->credit_tx, 0);
+
+  rfc_inc_credit(p_port_, 10);
+  ASSERT_EQ(queue_lens_, std::vector<size_t>({2, 2, 2, 0, 0}));
+  ASSERT_FALSE(p_port_->tx.peer_fc);
+  ASSERT_EQ(p_port_->credit_tx, 8);
+  ASSERT_EQ(p_port_->tx.queue_size, 0u);
+}
+
+TEST_F(StackRfcommPortDataTest, SendTxDataBatchIsBounded) {
+  QueueFrames(PORT_TX_BUF_HIGH_WM);
+
+  rfc_inc_credit(p_port_, PORT_TX_BUF_HIGH_WM + 1);
+  std::vector<size_t> expected(PORT_TX_BATCH_SIZE,
+                               PORT_TX_BUF_HIGH_WM - PORT_TX_BATCH_SIZE);
+  expected.resize(PORT_TX_BUF_HIGH_WM, 0);
+  ASSERT_EQ(queue_lens_, expected);
+  ASSERT_EQ(frame_lens_.size(), (size_t)PORT_TX_BUF_HIGH_WM);
+}
+
+TEST_F(StackRfcommPortDataTest, SendTxDataOneFrameAtATimeWithTs0710) {
+  p_mcb_->flow = PORT_FC_TS710;
+  QueueFrames(4);
+
+  // The peer may stop the flow at any frame, so frames are taken one by one
+  PORT_FlowInd(p_mcb_, kDlci, true);
+  ASSERT_EQ(queue_lens_, std::vector<size_t>({3, 2, 1, 0}));
+  ASSERT_EQ(p_port_->tx.queue_size, 0u);
+}
+
 }  // namespace
@@ -0,0 +1,262 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <string.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "stack/include/bt_types.h"
+#include "stack/include/sdp_api.h"
+#include "stack/include/sdpdefs.h"
+#include "stack/sdp/sdpint.h"
+#include "test/mock/mock_osi_allocator.h"
+#include "test/mock/mock_stack_l2cap_api.h"
+
+using ::benchmark::State;
+
+namespace {
+
+constexpr uint16_t kConnectionId = 0x40;
+constexpr uint16_t kRemoteMtu = 672;
+
+// Continuation state of the last response, and how many response bytes were
+// returned to the client in total
+std::vector<uint8_t> g_cont_state;
+size_t g_rsp_bytes = 0;
+
+// One request as issued by a remote client: the UUID searched for, the
+// attributes asked for (a single ID when start == end) and the maximum byte
+// count it accepts per response
+struct SdpQuery {
+  uint16_t uuid;
+  std::vector<tATT_ENT> attrs;
+  uint16_t max_list_len;
+};
+
+// Queries observed from car head units and desktop hosts on reconnection.
+// Head units ask for a few attributes of each profile they support, desktop
+// hosts typically browse the whole database with a small byte count which
+// results in many continuation requests.
+const std::vector<SdpQuery> kCarKitQueries = {
+    {UUID_SERVCLASS_AG_HANDSFREE,
+     {{ATTR_ID_PROTOCOL_DESC_LIST, ATTR_ID_PROTOCOL_DESC_LIST},
+      {ATTR_ID_BT_PROFILE_DESC_LIST, ATTR_ID_BT_PROFILE_DESC_LIST},
+      {ATTR_ID_SUPPORTED_FEATURES, ATTR_ID_SUPPORTED_FEATURES}},
+     0x00ff},
+    {UUID_SERVCLASS_AUDIO_SOURCE, {{0x0000, 0xffff}}, 0x0200},
+    {UUID_SERVCLASS_PBAP_PSE, {{0x0000, 0xffff}}, 0x0200},
+    {UUID_SERVCLASS_MESSAGE_ACCESS, {{0x0000, 0xffff}}, 0x0200},
+    {UUID_SERVCLASS_PNP_INFORMATION, {{0x0000, 0xffff}}, 0x0200},
+};
+
+const std::vector<SdpQuery> kDesktopQueries = {
+    {UUID_PROTOCOL_L2CAP, {{0x0000, 0xffff}}, 0x0040},
+};
+
+uint8_t* build_request(uint8_t* p, const SdpQuery& query) {
+  uint8_t* p_param_len;
+  uint8_t* p_start;
+  uint8_t num_attrs = (uint8_t)query.attrs.size();
+  uint8_t attrs_len = 0;
+
+  UINT8_TO_BE_STREAM(p, SDP_PDU_SERVICE_SEARCH_ATTR_REQ);
+  UINT16_TO_BE_STREAM(p, 0x0001);
+  p_param_len = p;
+  p += 2;
+  p_start = p;
+
+  UINT8_TO_BE_STREAM(p, (DATA_ELE_SEQ_DESC_TYPE << 3) | SIZE_IN_NEXT_BYTE);
+  UINT8_TO_BE_STREAM(p, 3);
+  UINT8_TO_BE_STREAM(p, (UUID_DESC_TYPE << 3) | SIZE_TWO_BYTES);
+  UINT16_TO_BE_STREAM(p, query.uuid);
+
+  UINT16_TO_BE_STREAM(p, query.max_list_len);
+
+  for (uint8_t xx = 0; xx < num_attrs; xx++)
+    attrs_len += (query.attrs[xx].start == query.attrs[xx].end) ? 3 : 5;
+  UINT8_TO_BE_STREAM(p, (DATA_ELE_SEQ_DESC_TYPE << 3) | SIZE_IN_NEXT_BYTE);
+  UINT8_TO_BE_STREAM(p, attrs_len);
+  for (const tATT_ENT& attr : query.attrs) {
+    if (attr.start == attr.end) {
+      UINT8_TO_BE_STREAM(p, (UINT_DESC_TYPE << 3) | SIZE_TWO_BYTES);
+      UINT16_TO_BE_STREAM(p, attr.start);
+    } else {
+      UINT8_TO_BE_STREAM(p, (UINT_DESC_TYPE << 3) | SIZE_FOUR_BYTES);
+      UINT16_TO_BE_STREAM(p, attr.start);
+      UINT16_TO_BE_STREAM(p, attr.end);
+    }
+  }
+
+  UINT8_TO_BE_STREAM(p, g_cont_state.size());
+  ARRAY_TO_BE_STREAM(p, g_cont_state.data(), (int)g_cont_state.size());
+
+  UINT16_TO_BE_STREAM(p_param_len, p - p_start);
+  return p;
+}
+
+uint8_t capture_response(uint16_t cid, BT_HDR* p_buf) {
+  uint8_t* p = (uint8_t*)(p_buf + 1) + p_buf->offset;
+  uint8_t pdu_id;
+  uint16_t trans_num, param_len, byte_count;
+  uint8_t cont_len;
+
+  g_cont_state.clear();
+  BE_STREAM_TO_UINT8(pdu_id, p);
+  BE_STREAM_TO_UINT16(trans_num, p);
+  BE_STREAM_TO_UINT16(param_len, p);
+  if (pdu_id == SDP_PDU_SERVICE_SEARCH_ATTR_RSP) {
+    BE_STREAM_TO_UINT16(byte_count, p);
+    p += byte_count;
+    g_rsp_bytes += byte_count;
+    BE_STREAM_TO_UINT8(cont_len, p);
+    g_cont_state.assign(p, p + cont_len);
+  }
+  (void)trans_num;
+  (void)param_len;
+
+  osi_free(p_buf);
+  return L2CAP_DW_SUCCESS;
+}
+
+void add_rfcomm_record(uint16_t service_uuid, uint16_t profile_uuid,
+                       uint8_t scn, const char* name) {
+  uint32_t handle = SDP_CreateRecord();
+  tSDP_PROTOCOL_ELEM proto_list[2] = {};
+
+  proto_list[0].protocol_uuid = UUID_PROTOCOL_L2CAP;
+  proto_list[1].protocol_uuid = UUID_PROTOCOL_RFCOMM;
+  proto_list[1].num_params = 1;
+  proto_list[1].params[0] = scn;
+
+  SDP_AddServiceClassIdList(handle, 1, &service_uuid);
+  SDP_AddProtocolList(handle, 2, proto_list);
+  SDP_AddProfileDescriptorList(handle, profile_uuid, 0x0108);
+  SDP_AddAttribute(handle, ATTR_ID_SERVICE_NAME, TEXT_STR_DESC_TYPE,
+                   strlen(name) + 1, (uint8_t*)name);
+}
+
+// Populates the server database with the records of a typical phone
+void add_phone_records() {
+  uint16_t supported_features = 0x0f2f;
+  uint8_t features[2];
+  uint8_t* p = features;
+  UINT16_TO_BE_STREAM(p, supported_features);
+
+  add_rfcomm_record(UUID_SERVCLASS_AG_HANDSFREE, UUID_SERVCLASS_HF_HANDSFREE,
+                    2, "Handsfree Gateway");
+  SDP_AddAttribute(sdp_cb.server_db.record[0].record_handle,
+                   ATTR_ID_SUPPORTED_FEATURES, UINT_DESC_TYPE, 2, features);
+  add_rfcomm_record(UUID_SERVCLASS_PBAP_PSE, UUID_SERVCLASS_PHONE_ACCESS, 19,
+                    "OBEX Phonebook Access Server");
+  add_rfcomm_record(UUID_SERVCLASS_MESSAGE_ACCESS,
+                    UUID_SERVCLASS_MESSAGE_ACCESS, 26, "SMS/MMS Message Access");
+
+  uint32_t handle = SDP_CreateRecord();
+  uint16_t a2dp_uuid = UUID_SERVCLASS_AUDIO_SOURCE;
+  tSDP_PROTOCOL_ELEM proto_list[2] = {};
+  proto_list[0].protocol_uuid = UUID_PROTOCOL_L2CAP;
+  proto_list[0].num_params = 1;
+  proto_list[0].params[0] = BT_PSM_AVDTP;
+  proto_list[1].protocol_uuid = UUID_PROTOCOL_AVDTP;
+  proto_list[1].num_params = 1;
+  proto_list[1].params[0] = 0x0103;
+  SDP_AddServiceClassIdList(handle, 1, &a2dp_uuid);
+  SDP_AddProtocolList(handle, 2, proto_list);
+  SDP_AddProfileDescriptorList(handle, UUID_SERVCLASS_ADV_AUDIO_DISTRIBUTION,
+                               0x0103);
+
+  handle = SDP_CreateRecord();
+  uint16_t pnp_uuid = UUID_SERVCLASS_PNP_INFORMATION;
+  SDP_AddServiceClassIdList(handle, 1, &pnp_uuid);
+  for (uint16_t attr_id = 0x0200; attr_id <= 0x0205; attr_id++) {
+    SDP_AddAttribute(handle, attr_id, UINT_DESC_TYPE, 2, features);
+  }
+}
+
+class BM_SdpServer : public ::benchmark::Fixture {
+ protected:
+  void SetUp(State& st) override {
+    ::benchmark::Fixture::SetUp(st);
+    test::mock::osi_allocator::osi_malloc.body = [](size_t size) {
+      return malloc(size);
+    };
+    test::mock::osi_allocator::osi_free.body = [](void* ptr) { free(ptr); };
+    test::mock::stack_l2cap_api::L2CA_DataWrite.body = capture_response;
+
+    sdp_init();
+    add_phone_records();
+
+    p_ccb_ = &sdp_cb.ccb[0];
+    p_ccb_->con_state = SDP_STATE_CONNECTED;
+    p_ccb_->connection_id = kConnectionId;
+    p_ccb_->rem_mtu_size = kRemoteMtu;
+    p_req_ = (BT_HDR*)malloc(SDP_DATA_BUF_SIZE);
+  }
+
+  void TearDown(State& st) override {
+    free(p_req_);
+    osi_free(p_ccb_->rsp_list);
+    p_ccb_->rsp_list = nullptr;
+    sdp_free();
+    test::mock::stack_l2cap_api::L2CA_DataWrite = {};
+    test::mock::osi_allocator::osi_malloc = {};
+    test::mock::osi_allocator::osi_free = {};
+    ::benchmark::Fixture::TearDown(st);
+  }
+
+  // Issues the query and all its continuation requests
+  void Replay(const SdpQuery& query) {
+    g_cont_state.clear();
+    do {
+      uint8_t* p_start = (uint8_t*)(p_req_ + 1);
+      uint8_t* p_end = build_request(p_start, query);
+      p_req_->offset = 0;
+      p_req_->len = p_end - p_start;
+      sdp_server_handle_client_req(p_ccb_, p_req_);
+    } while (!g_cont_state.empty());
+  }
+
+  void Run(State& state, const std::vector<SdpQuery>& queries) {
+    g_rsp_bytes = 0;
+    for (auto _ : state) {
+      for (const SdpQuery& query : queries) Replay(query);
+    }
+    state.SetBytesProcessed(g_rsp_bytes);
+  }
+
+  tCONN_CB* p_ccb_ = nullptr;
+  BT_HDR* p_req_ = nullptr;
+};
+
+BENCHMARK_F(BM_SdpServer, car_kit_reconnection)(State& state) {
+  Run(state, kCarKitQueries);
+}
+
+BENCHMARK_F(BM_SdpServer, desktop_browse_with_continuations)(State& state) {
+  Run(state, kDesktopQueries);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
@@ -17,10 +17,12 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <cstddef>
 
 #include "stack/include/sdp_api.h"
+#include "stack/include/sdpdefs.h"
 #include "stack/sdp/sdpint.h"
 #include "test/mock/mock_osi_allocator.h"
 #include "test/mock/mock_stack_l2cap_api.h"
@@ -172,3 +174,52 @@ TEST_F(StackSdpMainTest, sdp_service_search_request_queuing_race_condition) {
 
   sdp_disconnect(p_ccb2, SDP_SUCCESS);
 }
+
+TEST_F(StackSdpMainTest, sdp_db_serialized_attr_cache) {
+  uint32_t handle = SDP_CreateRecord();
+  ASSERT_NE(handle, 0u);
+  uint16_t service_uuid = UUID_SERVCLASS_AUDIO_SOURCE;
+  ASSERT_TRUE(SDP_AddServiceClassIdList(handle, 1, &service_uuid));
+  ASSERT_TRUE(SDP_AddProfileDescriptorList(
+      handle, UUID_SERVCLASS_ADV_AUDIO_DISTRIBUTION, 0x0103));
+
+  const tSDP_RECORD* p_rec = sdp_db_find_record(handle);
+  ASSERT_NE(p_rec, nullptr);
+
+  // Every cached attribute matches the one built from the database
+  for (uint16_t xx = 0; xx < p_rec->num_attributes; xx++) {
+    uint8_t built[SDP_MAX_ATTR_LEN];
+    uint16_t len = 0;
+    const uint8_t* p_ser =
+        sdp_db_get_serialized_attr(p_rec, &p_rec->attribute[xx], &len);
+    ASSERT_NE(p_ser, nullptr);
+    uint8_t* p_end = sdpu_build_attrib_entry(built, &p_rec->attribute[xx]);
+    ASSERT_EQ(len, (uint16_t)(p_end - built));
+    ASSERT_EQ(0, memcmp(p_ser, built, len));
+  }
+  ASSERT_TRUE(p_rec->ser_valid);
+
+  // Replacing an attribute invalidates the cache
+  ASSERT_TRUE(SDP_AddProfileDescriptorList(
+      handle, UUID_SERVCLASS_ADV_AUDIO_DISTRIBUTION, 0x0104));
+  ASSERT_FALSE(p_rec->ser_valid);
+
+  const tSDP_ATTRIBUTE* p_attr = sdp_db_find_attr_in_rec(
+      p_rec, ATTR_ID_BT_PROFILE_DESC_LIST, ATTR_ID_BT_PROFILE_DESC_LIST);
+  ASSERT_NE(p_attr, nullptr);
+  uint16_t len = 0;
+  const uint8_t* p_ser = sdp_db_get_serialized_attr(p_rec, p_attr, &len);
+  ASSERT_NE(p_ser, nullptr);
+  ASSERT_EQ(len, sdpu_get_attrib_entry_len(p_attr));
+  // Version is the last two bytes of the profile descriptor list
+  ASSERT_EQ(0x01, p_ser[len - 2]);
+  ASSERT_EQ(0x04, p_ser[len - 1]);
+
+  ASSERT_TRUE(SDP_DeleteAttribute(handle, ATTR_ID_BT_PROFILE_DESC_LIST));
+  ASSERT_FALSE(p_rec->ser_valid);
+  ASSERT_EQ(sdp_db_find_attr_in_rec(p_rec, ATTR_ID_BT_PROFILE_DESC_LIST,
+                                    ATTR_ID_BT_PROFILE_DESC_LIST),
+            nullptr);
+
+  ASSERT_TRUE(SDP_DeleteRecord(handle));
+}
@@ -87,3 +87,54 @@ TEST(GattDatabaseTest, matchExampleInBtSpecV52) {
 
   ASSERT_EQ(result_hash, expected_hash);
 }
+
+static void init_service(tGATT_SVC_DB& db, uint16_t uuid, uint16_t s_hdl) {
+  gatts_init_service_db(db, Uuid::From16Bit(uuid), true, s_hdl, 5);
+  gatts_add_characteristic(db, GATT_PERM_READ, GATT_CHAR_PROP_BIT_READ,
+    Uuid::From16Bit(0x2A00));
+  gatts_add_characteristic(db, GATT_PERM_READ, GATT_CHAR_PROP_BIT_NOTIFY,
+    Uuid::From16Bit(0x2A01));
+}
+
+TEST(GattDatabaseTest, cachedSegmentsAfterServiceRemoval) {
+  tGATT_SVC_DB local_db[3];
+  for (int i=0; i<3; i++) local_db[i] = tGATT_SVC_DB();
+  std::list<tGATT_SRV_LIST_ELEM> srv_list_info;
+
+  for (int i=0; i<3; i++) {
+    add_item_to_list(srv_list_info, &local_db[i], true);
+    init_service(local_db[i], 0x1810 + i, 0x0001 + 5 * i);
+  }
+  gatts_calculate_database_hash(&srv_list_info);
+  srv_list_info.erase(std::next(srv_list_info.begin()));
+
+  std::list<tGATT_SRV_LIST_ELEM> fresh_srv_list_info;
+  add_item_to_list(fresh_srv_list_info, &local_db[0], true);
+  add_item_to_list(fresh_srv_list_info, &local_db[2], true);
+
+  ASSERT_EQ(gatts_calculate_database_hash(&srv_list_info),
+            gatts_calculate_database_hash(&fresh_srv_list_info));
+}
+
+TEST(GattDatabaseTest, hashComputedOnceUntilInvalidated) {
+  tGATT_SVC_DB local_db[2];
+  for (int i=0; i<2; i++) local_db[i] = tGATT_SVC_DB();
+  std::list<tGATT_SRV_LIST_ELEM> srv_list_info;
+  gatt_cb.srv_list_info = &srv_list_info;
+  gatts_invalidate_database_hash();
+
+  add_item_to_list(srv_list_info, &local_db[0], true);
+  init_service(local_db[0], 0x1810, 0x0001);
+  Octet16 one_service_hash = gatts_get_database_hash();
+
+  add_item_to_list(srv_list_info, &local_db[1], true);
+  init_service(local_db[1], 0x1811, 0x0006);
+  ASSERT_EQ(gatts_get_database_hash(), one_service_hash);
+
+  gatts_invalidate_database_hash();
+  ASSERT_NE(gatts_get_database_hash(), one_service_hash);
+  ASSERT_EQ(gatts_get_database_hash(),
+            gatts_calculate_database_hash(&srv_list_info));
+
+  gatt_cb.srv_list_info = nullptr;
+}
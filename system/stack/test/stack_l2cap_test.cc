@@ -16,12 +16,16 @@
 
 #include <gtest/gtest.h>
 
+#include <vector>
+
 #include "common/init_flags.h"
 #include "device/include/controller.h"
 #include "internal_include/bt_trace.h"
+#include "osi/include/allocator.h"
 #include "stack/btm/btm_int_types.h"
 #include "stack/include/l2cap_hci_link_interface.h"
 #include "stack/l2cap/l2c_int.h"
+#include "test/mock/mock_stack_acl.h"
 #include "types/raw_address.h"
 
 tBTM_CB btm_cb;
@@ -39,8 +43,12 @@ namespace {
 constexpr uint16_t kAclBufferCountClassic = 123;
 constexpr uint8_t kAclBufferCountBle = 45;
 
+const controller_t* controller = nullptr;
+
 }  // namespace
 
+const controller_t* controller_get_interface() { return controller; }
+
 class StackL2capTest : public ::testing::Test {
  protected:
   void SetUp() override {
@@ -50,11 +58,16 @@ class StackL2capTest : public ::testing::Test {
     };
     controller_.get_acl_buffer_count_ble = []() { return kAclBufferCountBle; };
     controller_.supports_ble = []() -> bool { return true; };
+    controller_.get_ble_default_data_packet_length = []() -> uint16_t {
+      return 27;
+    };
+    controller = &controller_;
     l2c_init();
   }
 
   void TearDown() override {
     l2c_free();
+    controller = nullptr;
     controller_ = {};
   }
 
@@ -81,6 +94,185 @@ TEST_F(StackL2capTest, l2cble_process_data_length_change_event) {
   ASSERT_EQ(0x001b, l2cb.lcb_pool[0].tx_data_len);
 }
 
+TEST_F(StackL2capTest, l2cu_find_lcb_by_handle) {
+  l2cb.lcb_pool[1].in_use = true;
+  l2cu_set_lcb_handle(l2cb.lcb_pool[1], 0x0123);
+  ASSERT_EQ(&l2cb.lcb_pool[1], l2cu_find_lcb_by_handle(0x0123));
+  ASSERT_EQ(nullptr, l2cu_find_lcb_by_handle(0x0124));
+
+  // A new handle for the link
+  l2cu_set_lcb_handle(l2cb.lcb_pool[1], 0x0456);
+  ASSERT_EQ(nullptr, l2cu_find_lcb_by_handle(0x0123));
+  ASSERT_EQ(&l2cb.lcb_pool[1], l2cu_find_lcb_by_handle(0x0456));
+
+  l2cb.lcb_pool[1].InvalidateHandle();
+  ASSERT_EQ(nullptr, l2cu_find_lcb_by_handle(0x0456));
+  ASSERT_EQ(nullptr, l2cu_find_lcb_by_handle(HCI_INVALID_HANDLE));
+}
+
+class StackL2capLinkTest : public StackL2capTest {
+ protected:
+  void SetUp() override {
+    StackL2capTest::SetUp();
+    test::mock::stack_acl::acl_send_data_packet_br_edr.body =
+        [this](const RawAddress& bd_addr, BT_HDR* p_buf) {
+          sent_.push_back(bd_addr);
+          osi_free(p_buf);
+        };
+  }
+
+  void TearDown() override {
+    for (int xx = 0; xx < MAX_L2CAP_LINKS; xx++) {
+      if (l2cb.lcb_pool[xx].in_use) l2cu_release_lcb(&l2cb.lcb_pool[xx]);
+    }
+    test::mock::stack_acl::acl_send_data_packet_br_edr = {};
+    StackL2capTest::TearDown();
+  }
+
+  static RawAddress Address(uint8_t xx) {
+    RawAddress bd_addr = RawAddress::kEmpty;
+    bd_addr.address[5] = xx;
+    return bd_addr;
+  }
+
+  tL2C_LCB* Allocate(uint8_t xx) {
+    return l2cu_allocate_lcb(Address(xx), false, BT_TRANSPORT_BR_EDR);
+  }
+
+  std::vector<tL2C_LCB*> ActiveLcbs() const {
+    return std::vector<tL2C_LCB*>(l2cb.p_active_lcbs,
+                                  l2cb.p_active_lcbs + l2cb.num_active_lcbs);
+  }
+
+  // Connect the first |num_links| links of the pool, all sharing the
+  // controller buffers round robin, with |num_bufs| buffers queued on each
+  void ConnectRoundRobinLinks(uint8_t num_links, int num_bufs) {
+    for (uint8_t xx = 0; xx < num_links; xx++) {
+      tL2C_LCB* p_lcb = Allocate(xx);
+      ASSERT_EQ(&l2cb.lcb_pool[xx], p_lcb);
+      p_lcb->link_state = LST_CONNECTED;
+      for (int yy = 0; yy < num_bufs; yy++) {
+        list_append(p_lcb->link_xmit_data_q, osi_calloc(sizeof(BT_HDR)));
+      }
+    }
+    for (uint8_t xx = 0; xx < num_links; xx++) {
+      l2cb.lcb_pool[xx].link_xmit_quota = 0;
+    }
+    l2cb.controller_xmit_window = 100;
+    l2cb.round_robin_unacked = 0;
+  }
+
+  std::vector<RawAddress> sent_;
+};
+
+TEST_F(StackL2capLinkTest, l2cu_allocate_lcb__active_lcbs_in_pool_order) {
+  tL2C_LCB* p_lcb[4];
+  for (uint8_t xx = 0; xx < 4; xx++) {
+    p_lcb[xx] = Allocate(xx);
+    ASSERT_EQ(&l2cb.lcb_pool[xx], p_lcb[xx]);
+  }
+  ASSERT_EQ(4, l2cb.num_active_lcbs);
+  ASSERT_EQ(std::vector<tL2C_LCB*>({p_lcb[0], p_lcb[1], p_lcb[2], p_lcb[3]}),
+            ActiveLcbs());
+
+  l2cu_release_lcb(p_lcb[1]);
+  ASSERT_EQ(std::vector<tL2C_LCB*>({p_lcb[0], p_lcb[2], p_lcb[3]}),
+            ActiveLcbs());
+  ASSERT_EQ(nullptr, l2cu_find_lcb_by_bd_addr(Address(1), BT_TRANSPORT_BR_EDR));
+
+  // The freed LCB is reused, and goes back in the middle of the list
+  ASSERT_EQ(p_lcb[1], Allocate(4));
+  ASSERT_EQ(std::vector<tL2C_LCB*>({p_lcb[0], p_lcb[1], p_lcb[2], p_lcb[3]}),
+            ActiveLcbs());
+  ASSERT_EQ(p_lcb[1],
+            l2cu_find_lcb_by_bd_addr(Address(4), BT_TRANSPORT_BR_EDR));
+
+  l2cu_release_lcb(p_lcb[3]);
+  l2cu_release_lcb(p_lcb[0]);
+  ASSERT_EQ(std::vector<tL2C_LCB*>({p_lcb[1], p_lcb[2]}), ActiveLcbs());
+
+  ASSERT_EQ(p_lcb[0], Allocate(5));
+  ASSERT_EQ(std::vector<tL2C_LCB*>({p_lcb[0], p_lcb[1], p_lcb[2]}),
+            ActiveLcbs());
+}
+
+TEST_F(StackL2capLinkTest, l2cu_find_lcb_by_handle__handle_reused) {
+  tL2C_LCB* p_lcb_a = Allocate(0);
+  tL2C_LCB* p_lcb_b = Allocate(1);
+
+  l2cu_set_lcb_handle(*p_lcb_a, 0x0001);
+  ASSERT_EQ(p_lcb_a, l2cu_find_lcb_by_handle(0x0001));
+
+  // The controller hands out the handle again, before the old link is released
+  l2cu_set_lcb_handle(*p_lcb_b, 0x0001);
+  ASSERT_EQ(p_lcb_b, l2cu_find_lcb_by_handle(0x0001));
+
+  // Releasing the old link keeps the index of the new one
+  l2cu_release_lcb(p_lcb_a);
+  ASSERT_EQ(p_lcb_b, l2cu_find_lcb_by_handle(0x0001));
+
+  // A handle that shares the index slot is not matched
+  ASSERT_EQ(nullptr, l2cu_find_lcb_by_handle(0x0001 + L2C_NUM_HCI_HANDLES));
+
+  l2cu_release_lcb(p_lcb_b);
+  ASSERT_EQ(nullptr, l2cu_find_lcb_by_handle(0x0001));
+
+  // Handed out again, to a link allocated after the release
+  tL2C_LCB* p_lcb_c = Allocate(2);
+  ASSERT_EQ(p_lcb_a, p_lcb_c);
+  ASSERT_EQ(nullptr, l2cu_find_lcb_by_handle(0x0001));
+  l2cu_set_lcb_handle(*p_lcb_c, 0x0001);
+  ASSERT_EQ(p_lcb_c, l2cu_find_lcb_by_handle(0x0001));
+}
+
+TEST_F(StackL2capLinkTest, l2c_link_check_send_pkts__round_robin_from_first) {
+  ConnectRoundRobinLinks(3, 2);
+  l2cb.round_robin_quota = 2;
+
+  l2c_link_check_send_pkts(nullptr, 0, nullptr);
+  ASSERT_EQ(std::vector<RawAddress>({Address(0), Address(1)}), sent_);
+}
+
+TEST_F(StackL2capLinkTest, l2c_link_check_send_pkts__round_robin_after_link) {
+  ConnectRoundRobinLinks(3, 2);
+  l2cb.round_robin_quota = 2;
+
+  // Not a single write, so the round robin starts at the link after this one
+  // and wraps around to the start of the list
+  l2c_link_check_send_pkts(&l2cb.lcb_pool[1], 0, nullptr);
+  ASSERT_EQ(std::vector<RawAddress>({Address(2), Address(0)}), sent_);
+
+  sent_.clear();
+  l2cb.round_robin_unacked = 0;
+  l2c_link_check_send_pkts(&l2cb.lcb_pool[2], 0, nullptr);
+  ASSERT_EQ(std::vector<RawAddress>({Address(0), Address(1)}), sent_);
+
+  // Every link gets its turn when the quota allows it
+  sent_.clear();
+  l2cb.round_robin_unacked = 0;
+  l2cb.round_robin_quota = 3;
+  BT_HDR* p_buf = (BT_HDR*)osi_calloc(sizeof(BT_HDR));
+  l2c_link_check_send_pkts(&l2cb.lcb_pool[0], 0, p_buf);
+  ASSERT_EQ(std::vector<RawAddress>({Address(1), Address(2), Address(0)}),
+            sent_);
+}
+
+TEST_F(StackL2capLinkTest, l2c_link_check_send_pkts__round_robin_single_write) {
+  ConnectRoundRobinLinks(3, 2);
+  l2cb.round_robin_quota = 2;
+
+  // A single write starts the round robin at the link it is queued on
+  BT_HDR* p_buf = (BT_HDR*)osi_calloc(sizeof(BT_HDR));
+  l2c_link_check_send_pkts(&l2cb.lcb_pool[1], 0x0040, p_buf);
+  ASSERT_EQ(std::vector<RawAddress>({Address(1), Address(2)}), sent_);
+
+  sent_.clear();
+  l2cb.round_robin_unacked = 0;
+  p_buf = (BT_HDR*)osi_calloc(sizeof(BT_HDR));
+  l2c_link_check_send_pkts(&l2cb.lcb_pool[2], 0x0040, p_buf);
+  ASSERT_EQ(std::vector<RawAddress>({Address(2), Address(0)}), sent_);
+}
+
 class StackL2capChannelTest : public StackL2capTest {
  protected:
   void SetUp() override { StackL2capTest::SetUp(); }
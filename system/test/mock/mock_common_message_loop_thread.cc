@@ -208,6 +208,8 @@ bool MessageLoopThread::EnableRealTimeScheduling() {
   return true;
 }
 
+void MessageLoopThread::EnableTaskLatencyTracing(bool enable) {}
+
 base::WeakPtr<MessageLoopThread> MessageLoopThread::GetWeakPtr() {
   std::lock_guard<std::recursive_mutex> api_lock(api_mutex_);
   return weak_ptr_factory_.GetWeakPtr();
@@ -17,36 +17,66 @@
 /*
  * Generated mock file from original source file
  *   Functions generated:3
+ *
+ *  mockcify.pl ver 0.3.0
  */
 
+#include <cstdint>
+#include <functional>
 #include <map>
 #include <string>
 
 extern std::map<std::string, int> mock_function_count_map;
 
-#include <sys/time.h>
-#include <time.h>
-#include "common/time_util.h"
+// Mock include file to share data between tests and mock
+#include "test/mock/mock_common_time_util.h"
+
+// Mocked internal structures, if any
+
+namespace test {
+namespace mock {
+namespace common_time_util {
+
+// Function state capture and return values, if needed
+struct time_get_os_boottime_ms time_get_os_boottime_ms;
+struct time_get_os_boottime_us time_get_os_boottime_us;
+struct time_gettimeofday_us time_gettimeofday_us;
+
+}  // namespace common_time_util
+}  // namespace mock
+}  // namespace test
+
+// Mocked function return values, if any
+namespace test {
+namespace mock {
+namespace common_time_util {
+
+uint64_t time_get_os_boottime_ms::return_value = 0;
+uint64_t time_get_os_boottime_us::return_value = 0;
+uint64_t time_gettimeofday_us::return_value = 0;
 
-#ifndef UNUSED_ATTR
-#define UNUSED_ATTR
-#endif
+}  // namespace common_time_util
+}  // namespace mock
+}  // namespace test
 
+// Mocked functions, if any
 namespace bluetooth {
 namespace common {
 
 uint64_t time_get_os_boottime_ms() {
   mock_function_count_map[__func__]++;
-  return 0;
+  return test::mock::common_time_util::time_get_os_boottime_ms();
 }
 uint64_t time_get_os_boottime_us() {
   mock_function_count_map[__func__]++;
-  return 0;
+  return test::mock::common_time_util::time_get_os_boottime_us();
 }
 uint64_t time_gettimeofday_us() {
   mock_function_count_map[__func__]++;
-  return 0;
+  return test::mock::common_time_util::time_gettimeofday_us();
 }
 
 }  // namespace common
 }  // namespace bluetooth
+// Mocked functions complete
+// END mockcify generation
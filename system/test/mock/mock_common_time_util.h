@@ -0,0 +1,82 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+/*
+ * Generated mock file from original source file
+ *   Functions generated:3
+ *
+ *  mockcify.pl ver 0.3.0
+ */
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+
+extern std::map<std::string, int> mock_function_count_map;
+
+// Original included files, if any
+// NOTE: Since this is a mock file with mock definitions some number of
+//       include files may not be required.  The include-what-you-use
+//       still applies, but crafting proper inclusion is out of scope
+//       for this effort.  This compilation unit may compile as-is, or
+//       may need attention to prune from (or add to ) the inclusion set.
+#include "common/time_util.h"
+
+// Mocked compile conditionals, if any
+
+namespace test {
+namespace mock {
+namespace common_time_util {
+
+// Shared state between mocked functions and tests
+// Name: time_get_os_boottime_ms
+// Params:
+// Return: uint64_t
+struct time_get_os_boottime_ms {
+  static uint64_t return_value;
+  std::function<uint64_t()> body{[]() { return return_value; }};
+  uint64_t operator()() { return body(); };
+};
+extern struct time_get_os_boottime_ms time_get_os_boottime_ms;
+
+// Name: time_get_os_boottime_us
+// Params:
+// Return: uint64_t
+struct time_get_os_boottime_us {
+  static uint64_t return_value;
+  std::function<uint64_t()> body{[]() { return return_value; }};
+  uint64_t operator()() { return body(); };
+};
+extern struct time_get_os_boottime_us time_get_os_boottime_us;
+
+// Name: time_gettimeofday_us
+// Params:
+// Return: uint64_t
+struct time_gettimeofday_us {
+  static uint64_t return_value;
+  std::function<uint64_t()> body{[]() { return return_value; }};
+  uint64_t operator()() { return body(); };
+};
+extern struct time_gettimeofday_us time_gettimeofday_us;
+
+}  // namespace common_time_util
+}  // namespace mock
+}  // namespace test
+
+// END mockcify generation
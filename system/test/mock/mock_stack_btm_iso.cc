@@ -30,6 +30,7 @@ void IsoManager::RemoveIsoDataPath(uint16_t iso_handle, uint8_t data_path_dir) {
 void IsoManager::ReadIsoLinkQuality(uint16_t iso_handle) {}
 void IsoManager::SendIsoData(uint16_t iso_handle, const uint8_t* data,
                              uint16_t data_len) {}
+void IsoManager::SendIsoSdu(uint16_t iso_handle, BT_HDR* p_sdu) {}
 void IsoManager::CreateBig(uint8_t big_id,
                            struct iso_manager::big_create_params big_params) {}
 void IsoManager::TerminateBig(uint8_t big_id, uint8_t reason) {}
@@ -16,12 +16,13 @@
 
 /*
  * Generated mock file from original source file
- *   Functions generated:9
+ *   Functions generated:11
  */
 
 #include <cstdint>
 #include <map>
 #include <string>
+#include <vector>
 
 extern std::map<std::string, int> mock_function_count_map;
 
@@ -58,6 +59,15 @@ void btu_hcif_send_cmd_with_cb(const base::Location& posted_from,
                                uint8_t params_len, hci_cmd_cb cb) {
   mock_function_count_map[__func__]++;
 }
+void btu_hcif_send_cmd_params(uint16_t opcode, std::vector<uint8_t> params) {
+  mock_function_count_map[__func__]++;
+}
+void btu_hcif_send_cmd_params_with_cb(const base::Location& posted_from,
+                                      uint16_t opcode,
+                                      std::vector<uint8_t> params,
+                                      hci_cmd_cb cb) {
+  mock_function_count_map[__func__]++;
+}
 void cmd_with_cb_data_cleanup(cmd_with_cb_data* cb_wrapper) {
   mock_function_count_map[__func__]++;
 }
@@ -89,6 +89,12 @@ tSDP_ATTRIBUTE* sdp_db_find_attr_in_rec(tSDP_RECORD* p_rec, uint16_t start_attr,
   mock_function_count_map[__func__]++;
   return nullptr;
 }
+const uint8_t* sdp_db_get_serialized_attr(const tSDP_RECORD* p_rec,
+                                          const tSDP_ATTRIBUTE* p_attr,
+                                          uint16_t* p_len) {
+  mock_function_count_map[__func__]++;
+  return nullptr;
+}
 tSDP_RECORD* sdp_db_find_record(uint32_t handle) {
   mock_function_count_map[__func__]++;
   return nullptr;
@@ -20,6 +20,7 @@
 
 #include <sys/socket.h>
 
+#include <cstdlib>
 #include <list>
 #include <map>
 #include <string>
@@ -299,15 +300,24 @@ char* osi_strndup(const char* str, size_t len) {
   mock_function_count_map[__func__]++;
   return nullptr;
 }
-void osi_free(void* ptr) { mock_function_count_map[__func__]++; }
-void osi_free_and_reset(void** p_ptr) { mock_function_count_map[__func__]++; }
+// Callers write to the buffers they get, so hand out real memory, and give it
+// back when they are done with it.
+void osi_free(void* ptr) {
+  mock_function_count_map[__func__]++;
+  free(ptr);
+}
+void osi_free_and_reset(void** p_ptr) {
+  mock_function_count_map[__func__]++;
+  free(*p_ptr);
+  *p_ptr = nullptr;
+}
 void* osi_calloc(size_t size) {
   mock_function_count_map[__func__]++;
-  return nullptr;
+  return calloc(1, size);
 }
 void* osi_malloc(size_t size) {
   mock_function_count_map[__func__]++;
-  return nullptr;
+  return calloc(1, size);
 }
 
 bool fixed_queue_is_empty(fixed_queue_t* queue) {
@@ -24,6 +24,7 @@
 #include <mutex>
 
 #include "stack/include/bt_hdr.h"
+#include "uipc_ring.h"
 
 #define UIPC_CH_ID_AV_CTRL 0
 #define UIPC_CH_ID_AV_AUDIO 1
@@ -33,6 +34,10 @@
 
 #define DEFAULT_READ_POLL_TMO_MS 100
 
+/* Size of each of the shared memory rings offered on audio channels opened
+ * with them, in place of the socket buffer */
+#define UIPC_RING_SIZE (32 * 1024)
+
 typedef uint8_t tUIPC_CH_ID;
 
 /* Events generated */
@@ -51,6 +56,7 @@ typedef enum {
 #define UIPC_REQ_RX_FLUSH 1
 #define UIPC_REG_REMOVE_ACTIVE_READSET 3
 #define UIPC_SET_READ_POLL_TMO 4
+#define UIPC_GET_RING_STATS 5 /* param is a tUIPC_RING_STATS* */
 
 typedef void(tUIPC_RCV_CBACK)(
     tUIPC_CH_ID ch_id,
@@ -61,12 +67,21 @@ typedef void(tUIPC_RCV_CBACK)(
 
 const char* dump_uipc_event(tUIPC_EVENT event);
 
+typedef struct {
+  bluetooth::uipc::RingStats upstream;   /* from the client */
+  bluetooth::uipc::RingStats downstream; /* to the client */
+} tUIPC_RING_STATS;
+
 typedef struct {
   int srvfd;
   int fd;
   int read_poll_tmo_ms;
   int task_evt_flags; /* event flags pending to be processed in read task */
   tUIPC_RCV_CBACK* cback;
+  size_t ring_size; /* 0 if the channel only streams over the socket */
+  std::shared_ptr<bluetooth::uipc::SharedRings> rings; /* once negotiated */
+  /* while the client may still ask for the rings */
+  std::unique_ptr<bluetooth::uipc::RingAcceptor> acceptor;
 } tUIPC_CHAN;
 
 struct tUIPC_STATE {
@@ -92,13 +107,19 @@ std::unique_ptr<tUIPC_STATE> UIPC_Init();
 /**
  * Open a UIPC channel
  *
+ * With |offer_rings|, clients of the audio channel may ask for shared memory
+ * rings right after connecting, which then carry the audio in place of the
+ * socket. Only channels whose clients never read audio from the socket
+ * should offer them.
+ *
  * @param ch_id Channel ID
  * @param p_cback Callback handler
  * @param socket_path Path to the socket
+ * @param offer_rings Whether clients of the audio channel may ask for rings
  * @return true on success, otherwise false
  */
 bool UIPC_Open(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id, tUIPC_RCV_CBACK* p_cback,
-               const char* socket_path);
+               const char* socket_path, bool offer_rings = false);
 
 /**
  * Closes a channel in UIPC or the entire UIPC module
@@ -0,0 +1,184 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace bluetooth {
+namespace uipc {
+
+struct RingHeader;
+
+struct RingStats {
+  uint32_t size = 0;     /* capacity in bytes */
+  uint32_t fill = 0;     /* bytes waiting to be read */
+  uint32_t max_fill = 0; /* highest fill seen after a write */
+  uint32_t avg_fill = 0; /* average fill seen after a write */
+  uint64_t bytes_written = 0;
+  uint64_t bytes_read = 0;
+  uint64_t underruns = 0; /* reads which timed out short of data */
+  uint64_t overruns = 0;  /* writes which timed out short of space */
+};
+
+/* Lock-free single producer, single consumer byte ring laid out in memory
+ * shared between two processes. Blocked readers and writers sleep on a futex
+ * in the shared mapping, and are only woken up when the other side sees they
+ * are waiting, so a steady stream costs no system call at all.
+ */
+class Ring {
+ public:
+  Ring(const Ring&) = delete;
+  Ring& operator=(const Ring&) = delete;
+
+  /* Copies up to |len| bytes in, waiting at most |timeout_ms| for the reader
+   * to make room. Returns the number of bytes written; a short write is
+   * counted as an overrun. */
+  size_t Write(const uint8_t* data, size_t len, int timeout_ms);
+
+  /* Copies up to |len| bytes out, waiting at most |timeout_ms| for the writer
+   * to provide them. Returns the number of bytes read; a short read is
+   * counted as an underrun. */
+  size_t Read(uint8_t* data, size_t len, int timeout_ms);
+
+  /* Drops the bytes waiting to be read, and returns how many were dropped. */
+  size_t Flush();
+
+  /* Wakes up both sides, and fails any further write or wait. */
+  void Shutdown();
+  bool IsShutdown() const;
+
+  size_t Size() const { return size_; }
+  size_t Fill() const;
+  RingStats GetStats() const;
+
+ private:
+  friend class SharedRings;
+  Ring(RingHeader* header, uint8_t* data, uint32_t size)
+      : header_(header), data_(data), size_(size) {}
+
+  RingHeader* header_;
+  uint8_t* data_;
+  const uint32_t size_;
+};
+
+/* A pair of rings in one memfd mapping: the upstream one carries audio from
+ * the client (the audio HAL) to the stack and the downstream one carries
+ * audio from the stack to the client.
+ */
+class SharedRings {
+ public:
+  ~SharedRings();
+  SharedRings(const SharedRings&) = delete;
+  SharedRings& operator=(const SharedRings&) = delete;
+
+  /* Creates rings of |ring_size| bytes each, rounded up to a power of two. */
+  static std::unique_ptr<SharedRings> Create(size_t ring_size);
+
+  /* Maps rings created by the other side. Takes ownership of |fd|. */
+  static std::unique_ptr<SharedRings> Map(int fd);
+
+  int Fd() const { return fd_; }
+  Ring& Upstream() { return *upstream_; }
+  Ring& Downstream() { return *downstream_; }
+
+  /* Shuts down both rings, releasing the other side. */
+  void Shutdown();
+
+ private:
+  SharedRings(int fd, void* base, size_t length);
+
+  int fd_;
+  void* base_;
+  size_t length_;
+  std::unique_ptr<Ring> upstream_;
+  std::unique_ptr<Ring> downstream_;
+};
+
+/* Negotiation of the rings over a freshly connected UIPC stream socket.
+ *
+ * A three-way handshake, so that both sides always agree on the transport:
+ * 1. A client which supports the rings sends a hello right after connecting.
+ * 2. The server answers with an offer carrying the memfd of the rings, or
+ *    with an empty offer if it cannot set them up.
+ * 3. The client confirms whether it mapped the rings, and always sends that
+ *    confirmation before any audio, even when it gave up on the offer.
+ * Either side only switches to the rings once the client confirmed them.
+ *
+ * The server tells a hello apart from audio by the very first bytes sent on
+ * the connection, and leaves anything else in place to be read as audio.
+ * Both sides wait at most kRingNegotiationTimeoutMs: the client for the
+ * offer, and the server for the hello from the connection on, then for the
+ * confirmation. A client which sent nothing by then, such as one reading
+ * before it writes, stays on the socket.
+ *
+ * Audio the server sends before the offer goes down the socket, and the
+ * client takes it in place of an offer: no offer is sent any more, and a
+ * client asking for the rings confirms that it stays on the socket.
+ */
+constexpr int kRingNegotiationTimeoutMs = 100;
+
+/* Server side of the negotiation on |fd|, driven without ever blocking by
+ * the poll loop of the server. */
+class RingAcceptor {
+ public:
+  enum class State {
+    kWaitingForHello,   /* waiting for the client to send first */
+    kWaitingForConfirm, /* offer sent, waiting for the client to confirm */
+    kRings,             /* the client streams over the rings */
+    kSocket,            /* the client streams over the socket */
+    kFailed,            /* the client broke the protocol or went silent */
+  };
+
+  RingAcceptor(int fd, size_t ring_size);
+  RingAcceptor(const RingAcceptor&) = delete;
+  RingAcceptor& operator=(const RingAcceptor&) = delete;
+
+  /* Handles whatever the client sent so far, and returns the new state. */
+  State Continue();
+
+  /* Milliseconds left to wait for the client, or -1 once settled. The poll
+   * loop should call Continue() again by then. */
+  int TimeoutMs() const;
+
+  /* Tells that the server sent audio down the socket, which it does until
+   * the negotiation settles. */
+  void OnSendOverSocket();
+
+  /* The rings, once in the kRings state. */
+  std::unique_ptr<SharedRings> TakeRings();
+
+ private:
+  const int fd_;
+  const size_t ring_size_;
+  State state_ = State::kWaitingForHello;
+  uint64_t deadline_ns_;
+  bool sent_over_socket_ = false;
+  std::unique_ptr<SharedRings> rings_;
+};
+
+/* Client side: asks for the rings on |fd| and waits at most |timeout_ms| for
+ * them, then confirms the outcome to the server. Returns null if the server
+ * does not support them, did not answer in time, sent audio first or they
+ * cannot be mapped; the audio then goes over the socket. A late offer is
+ * left unread on the socket, so only clients which never read audio from
+ * the socket should call this. */
+std::unique_ptr<SharedRings> ConnectSharedRings(int fd, int timeout_ms);
+
+}  // namespace uipc
+}  // namespace bluetooth
@@ -0,0 +1,211 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "osi/include/osi.h"
+#include "osi/include/socket_utils/sockets.h"
+#include "udrv/include/uipc.h"
+#include "udrv/include/uipc_ring.h"
+
+using ::benchmark::State;
+using bluetooth::uipc::ConnectSharedRings;
+using bluetooth::uipc::kRingNegotiationTimeoutMs;
+using bluetooth::uipc::SharedRings;
+
+namespace {
+
+// 10 ms of 48 kHz 16 bit stereo audio
+constexpr size_t kFrameBytes = 1920;
+constexpr double kFrameSeconds = 0.01;
+constexpr intptr_t kReadPollMs = 1000;
+constexpr int kConnectTimeoutMs = 1000;
+
+#if defined(OS_GENERIC)
+constexpr int kSocketNamespace = ANDROID_SOCKET_NAMESPACE_FILESYSTEM;
+#else
+constexpr int kSocketNamespace = ANDROID_SOCKET_NAMESPACE_ABSTRACT;
+#endif
+
+std::unique_ptr<tUIPC_STATE> uipc;
+std::atomic<bool> audio_open;
+
+void audio_cb(tUIPC_CH_ID ch_id, tUIPC_EVENT event) {
+  if (event != UIPC_OPEN_EVT) return;
+
+  // Same set up as the A2DP source: the reads block on the channel directly
+  UIPC_Ioctl(*uipc, ch_id, UIPC_REG_REMOVE_ACTIVE_READSET, nullptr);
+  UIPC_Ioctl(*uipc, ch_id, UIPC_SET_READ_POLL_TMO,
+             reinterpret_cast<void*>(kReadPollMs));
+  audio_open = true;
+}
+
+uint64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// CPU time of the whole process: the stack side, the audio HAL side and the
+// UIPC thread
+uint64_t CpuNs() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000ull +
+         (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000ull;
+}
+
+// Streams frames from a fake audio HAL to the stack over a UIPC audio channel,
+// over the socket with range(0) == 0 and over the shared memory rings
+// otherwise. Each frame carries the time it was sent, and is sent once the
+// previous one was read, so the latency is the one of an idle transport.
+void BM_UipcLoopback(State& state) {
+  const bool use_rings = state.range(0);
+  const std::string path =
+      "/tmp/.uipc_loopback_" + std::to_string(getpid());
+
+  audio_open = false;
+  uipc = UIPC_Init();
+  UIPC_Open(*uipc, UIPC_CH_ID_AV_AUDIO, audio_cb, path.c_str(),
+            true /* offer_rings */);
+
+  int fd = socket(AF_LOCAL, SOCK_STREAM, 0);
+  std::unique_ptr<SharedRings> rings;
+  if (osi_socket_local_client_connect(fd, path.c_str(), kSocketNamespace,
+                                      SOCK_STREAM) < 0) {
+    state.SkipWithError("Cannot connect to the UIPC server");
+  } else if (use_rings &&
+             !(rings = ConnectSharedRings(fd, kRingNegotiationTimeoutMs))) {
+    state.SkipWithError("The UIPC server did not offer the rings");
+  }
+  for (int i = 0; i < kConnectTimeoutMs && !audio_open; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  uint64_t frames_read = 0;
+  bool done = false;
+
+  std::thread hal([&] {
+    std::vector<uint8_t> frame(kFrameBytes, 0x5a);
+    for (uint64_t sent = 0;; sent++) {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&] { return done || frames_read == sent; });
+        if (done) return;
+      }
+      const uint64_t now_ns = NowNs();
+      memcpy(frame.data(), &now_ns, sizeof(now_ns));
+      if (rings) {
+        rings->Upstream().Write(frame.data(), frame.size(), kConnectTimeoutMs);
+      } else {
+        ssize_t ret;
+        OSI_NO_INTR(ret = send(fd, frame.data(), frame.size(), MSG_NOSIGNAL));
+      }
+    }
+  });
+
+  std::vector<uint8_t> frame(kFrameBytes);
+  std::vector<uint64_t> latencies_ns;
+  const uint64_t cpu_start_ns = CpuNs();
+
+  for (auto _ : state) {
+    if (!audio_open) break;
+    uint32_t len =
+        UIPC_Read(*uipc, UIPC_CH_ID_AV_AUDIO, frame.data(), frame.size());
+    // Nothing is read until the server has settled on the transport
+    for (int i = 0; len == 0 && latencies_ns.empty() && i < kConnectTimeoutMs;
+         i++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      len = UIPC_Read(*uipc, UIPC_CH_ID_AV_AUDIO, frame.data(), frame.size());
+    }
+    const uint64_t now_ns = NowNs();
+    if (len != kFrameBytes) {
+      state.SkipWithError("Short read");
+      break;
+    }
+
+    uint64_t sent_ns;
+    memcpy(&sent_ns, frame.data(), sizeof(sent_ns));
+    latencies_ns.push_back(now_ns - sent_ns);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      frames_read++;
+    }
+    cv.notify_one();
+  }
+
+  const uint64_t cpu_ns = CpuNs() - cpu_start_ns;
+  tUIPC_RING_STATS ring_stats = {};
+  UIPC_Ioctl(*uipc, UIPC_CH_ID_AV_AUDIO, UIPC_GET_RING_STATS, &ring_stats);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    done = true;
+  }
+  cv.notify_one();
+  hal.join();
+  rings.reset();
+  close(fd);
+  UIPC_Close(*uipc, UIPC_CH_ID_ALL);
+  uipc.reset();
+  unlink(path.c_str());
+
+  if (latencies_ns.empty()) return;
+  std::sort(latencies_ns.begin(), latencies_ns.end());
+  const double audio_seconds = latencies_ns.size() * kFrameSeconds;
+  state.SetBytesProcessed(latencies_ns.size() * kFrameBytes);
+  state.counters["latency_p50_us"] =
+      latencies_ns[latencies_ns.size() / 2] / 1000.0;
+  state.counters["latency_p99_us"] =
+      latencies_ns[latencies_ns.size() * 99 / 100] / 1000.0;
+  state.counters["latency_max_us"] = latencies_ns.back() / 1000.0;
+  state.counters["cpu_ms_per_audio_s"] = cpu_ns / 1e6 / audio_seconds;
+  state.counters["underruns"] = ring_stats.upstream.underruns;
+  state.counters["overruns"] = ring_stats.upstream.overruns;
+}
+
+BENCHMARK(BM_UipcLoopback)
+    ->ArgName("rings")
+    ->Arg(0)
+    ->Arg(1)
+    ->UseRealTime()
+    ->Unit(::benchmark::kMicrosecond);
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
@@ -0,0 +1,376 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "udrv/include/uipc_ring.h"
+
+#include <gtest/gtest.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using bluetooth::uipc::ConnectSharedRings;
+using bluetooth::uipc::kRingNegotiationTimeoutMs;
+using bluetooth::uipc::Ring;
+using bluetooth::uipc::RingAcceptor;
+using bluetooth::uipc::SharedRings;
+
+namespace {
+
+constexpr size_t kRingSize = 4096;
+
+std::vector<uint8_t> Pattern(size_t len, uint8_t seed) {
+  std::vector<uint8_t> data(len);
+  for (size_t i = 0; i < len; i++) data[i] = seed + i * 7;
+  return data;
+}
+
+TEST(UipcRingTest, CreateRoundsUpToPowerOfTwo) {
+  auto rings = SharedRings::Create(5000);
+  ASSERT_NE(rings, nullptr);
+  ASSERT_EQ(rings->Upstream().Size(), 8192u);
+  ASSERT_EQ(rings->Downstream().Size(), 8192u);
+}
+
+TEST(UipcRingTest, WriteReadAcrossTheEnd) {
+  auto rings = SharedRings::Create(kRingSize);
+  ASSERT_NE(rings, nullptr);
+  Ring& ring = rings->Upstream();
+
+  /* 1000 bytes chunks do not divide the ring, so they end up wrapping */
+  for (int i = 0; i < 20; i++) {
+    auto data = Pattern(1000, i);
+    std::vector<uint8_t> out(1000);
+    ASSERT_EQ(ring.Write(data.data(), data.size(), 0), 1000u);
+    ASSERT_EQ(ring.Fill(), 1000u);
+    ASSERT_EQ(ring.Read(out.data(), out.size(), 0), 1000u);
+    ASSERT_EQ(out, data);
+  }
+
+  auto stats = ring.GetStats();
+  ASSERT_EQ(stats.bytes_written, 20000u);
+  ASSERT_EQ(stats.bytes_read, 20000u);
+  ASSERT_EQ(stats.max_fill, 1000u);
+  ASSERT_EQ(stats.avg_fill, 1000u);
+  ASSERT_EQ(stats.underruns, 0u);
+  ASSERT_EQ(stats.overruns, 0u);
+}
+
+TEST(UipcRingTest, ShortWriteIsOverrun) {
+  auto rings = SharedRings::Create(kRingSize);
+  Ring& ring = rings->Upstream();
+
+  auto data = Pattern(kRingSize + 100, 0);
+  ASSERT_EQ(ring.Write(data.data(), data.size(), 0), kRingSize);
+  ASSERT_EQ(ring.GetStats().overruns, 1u);
+  ASSERT_EQ(ring.GetStats().max_fill, kRingSize);
+
+  ASSERT_EQ(ring.Write(data.data(), 1, 5), 0u);
+  ASSERT_EQ(ring.GetStats().overruns, 2u);
+}
+
+TEST(UipcRingTest, ShortReadIsUnderrun) {
+  auto rings = SharedRings::Create(kRingSize);
+  Ring& ring = rings->Upstream();
+
+  auto data = Pattern(100, 0);
+  std::vector<uint8_t> out(200);
+  ring.Write(data.data(), data.size(), 0);
+  ASSERT_EQ(ring.Read(out.data(), out.size(), 5), 100u);
+  ASSERT_EQ(ring.GetStats().underruns, 1u);
+  ASSERT_EQ(ring.Read(out.data(), out.size(), 0), 0u);
+  ASSERT_EQ(ring.GetStats().underruns, 2u);
+}
+
+TEST(UipcRingTest, Flush) {
+  auto rings = SharedRings::Create(kRingSize);
+  Ring& ring = rings->Upstream();
+
+  auto data = Pattern(300, 0);
+  ring.Write(data.data(), data.size(), 0);
+  ASSERT_EQ(ring.Flush(), 300u);
+  ASSERT_EQ(ring.Fill(), 0u);
+}
+
+TEST(UipcRingTest, ShutdownWakesBlockedReader) {
+  auto rings = SharedRings::Create(kRingSize);
+  Ring& ring = rings->Downstream();
+
+  auto start = std::chrono::steady_clock::now();
+  std::thread reader([&ring] {
+    uint8_t out[16];
+    ASSERT_EQ(ring.Read(out, sizeof(out), 10000), 0u);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  rings->Shutdown();
+  reader.join();
+
+  ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+  ASSERT_TRUE(ring.IsShutdown());
+  ASSERT_EQ(ring.GetStats().underruns, 0u);
+}
+
+TEST(UipcRingTest, MappedAgainSharesTheRings) {
+  auto rings = SharedRings::Create(kRingSize);
+  auto peer = SharedRings::Map(dup(rings->Fd()));
+  ASSERT_NE(peer, nullptr);
+
+  auto data = Pattern(500, 3);
+  std::vector<uint8_t> out(500);
+  rings->Downstream().Write(data.data(), data.size(), 0);
+  ASSERT_EQ(peer->Downstream().Read(out.data(), out.size(), 0), 500u);
+  ASSERT_EQ(out, data);
+  ASSERT_EQ(rings->Downstream().Fill(), 0u);
+}
+
+TEST(UipcRingTest, StreamBetweenThreads) {
+  auto rings = SharedRings::Create(kRingSize);
+  Ring& ring = rings->Upstream();
+  static constexpr size_t kTotal = 1 << 20;
+  static constexpr size_t kChunk = 1920;
+
+  std::thread writer([&ring] {
+    std::vector<uint8_t> chunk(kChunk);
+    for (size_t sent = 0; sent < kTotal; sent += kChunk) {
+      const size_t len = std::min(kChunk, kTotal - sent);
+      for (size_t i = 0; i < len; i++) chunk[i] = (sent + i) & 0xff;
+      ASSERT_EQ(ring.Write(chunk.data(), len, 5000), len);
+    }
+  });
+
+  std::vector<uint8_t> chunk(1000);
+  for (size_t received = 0; received < kTotal;) {
+    const size_t len = std::min(chunk.size(), kTotal - received);
+    ASSERT_EQ(ring.Read(chunk.data(), len, 5000), len);
+    for (size_t i = 0; i < len; i++) {
+      ASSERT_EQ(chunk[i], (received + i) & 0xff);
+    }
+    received += len;
+  }
+  writer.join();
+
+  ASSERT_EQ(ring.GetStats().underruns, 0u);
+  ASSERT_EQ(ring.GetStats().overruns, 0u);
+}
+
+class UipcRingNegotiationTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds_), 0);
+  }
+  void TearDown() override {
+    close(fds_[0]);
+    close(fds_[1]);
+  }
+
+  int server_fd() const { return fds_[0]; }
+  int client_fd() const { return fds_[1]; }
+
+  /* Drives |acceptor| the way the UIPC read task does, until it settles or
+   * about a second went by */
+  RingAcceptor::State Negotiate(RingAcceptor& acceptor) {
+    using State = RingAcceptor::State;
+    State state = acceptor.Continue();
+    for (int i = 0; i < 100 && (state == State::kWaitingForHello ||
+                                state == State::kWaitingForConfirm);
+         i++) {
+      struct pollfd pfd = {.fd = server_fd(), .events = POLLIN, .revents = 0};
+      int timeout_ms = acceptor.TimeoutMs();
+      poll(&pfd, 1, timeout_ms < 0 ? 10 : timeout_ms);
+      state = acceptor.Continue();
+    }
+    return state;
+  }
+
+  /* A hello as sent by ConnectSharedRings() */
+  void SendHello() {
+    const uint32_t hello[] = {0x55524e47, 2, 1, 0};
+    ASSERT_EQ(write(client_fd(), hello, sizeof(hello)),
+              (ssize_t)sizeof(hello));
+  }
+
+  int fds_[2];
+};
+
+TEST_F(UipcRingNegotiationTest, ClientGetsRings) {
+  RingAcceptor acceptor(server_fd(), kRingSize);
+  std::unique_ptr<SharedRings> client_rings;
+  std::thread client([&] {
+    client_rings = ConnectSharedRings(client_fd(), kRingNegotiationTimeoutMs);
+  });
+  ASSERT_EQ(Negotiate(acceptor), RingAcceptor::State::kRings);
+  client.join();
+
+  auto server_rings = acceptor.TakeRings();
+  ASSERT_NE(server_rings, nullptr);
+  ASSERT_NE(client_rings, nullptr);
+
+  auto data = Pattern(64, 1);
+  std::vector<uint8_t> out(64);
+  client_rings->Upstream().Write(data.data(), data.size(), 0);
+  ASSERT_EQ(server_rings->Upstream().Read(out.data(), out.size(), 0), 64u);
+  ASSERT_EQ(out, data);
+
+  /* The whole negotiation was consumed */
+  ASSERT_EQ(recv(server_fd(), out.data(), out.size(), MSG_DONTWAIT), -1);
+}
+
+TEST_F(UipcRingNegotiationTest, LegacyClientKeepsSocket) {
+  auto data = Pattern(64, 1);
+  ASSERT_EQ(write(client_fd(), data.data(), data.size()), 64);
+
+  RingAcceptor acceptor(server_fd(), kRingSize);
+  ASSERT_EQ(acceptor.Continue(), RingAcceptor::State::kSocket);
+  ASSERT_EQ(acceptor.TakeRings(), nullptr);
+
+  /* The audio is left in place */
+  std::vector<uint8_t> out(64);
+  ASSERT_EQ(read(server_fd(), out.data(), out.size()), 64);
+  ASSERT_EQ(out, data);
+}
+
+TEST_F(UipcRingNegotiationTest, SilentClientKeepsSocket) {
+  RingAcceptor acceptor(server_fd(), kRingSize);
+  ASSERT_EQ(acceptor.Continue(), RingAcceptor::State::kWaitingForHello);
+  ASSERT_GE(acceptor.TimeoutMs(), 0);
+  ASSERT_LE(acceptor.TimeoutMs(), kRingNegotiationTimeoutMs);
+  ASSERT_EQ(Negotiate(acceptor), RingAcceptor::State::kSocket);
+  ASSERT_EQ(acceptor.TimeoutMs(), -1);
+}
+
+TEST_F(UipcRingNegotiationTest, ClientReadingFirstKeepsSocket) {
+  RingAcceptor acceptor(server_fd(), kRingSize);
+  ASSERT_EQ(acceptor.Continue(), RingAcceptor::State::kWaitingForHello);
+
+  /* The server streams down the socket before the client sent anything */
+  auto down = Pattern(64, 1);
+  acceptor.OnSendOverSocket();
+  ASSERT_EQ(write(server_fd(), down.data(), down.size()), 64);
+
+  std::vector<uint8_t> out(64);
+  ASSERT_EQ(read(client_fd(), out.data(), out.size()), 64);
+  ASSERT_EQ(out, down);
+  ASSERT_EQ(Negotiate(acceptor), RingAcceptor::State::kSocket);
+
+  /* Then writes, and its audio is left in place */
+  auto up = Pattern(64, 2);
+  ASSERT_EQ(write(client_fd(), up.data(), up.size()), 64);
+  ASSERT_EQ(read(server_fd(), out.data(), out.size()), 64);
+  ASSERT_EQ(out, up);
+}
+
+TEST_F(UipcRingNegotiationTest, AudioBeforeOfferKeepsSocket) {
+  RingAcceptor acceptor(server_fd(), kRingSize);
+  auto down = Pattern(64, 1);
+  acceptor.OnSendOverSocket();
+  ASSERT_EQ(write(server_fd(), down.data(), down.size()), 64);
+
+  std::unique_ptr<SharedRings> client_rings;
+  std::thread client([&] {
+    client_rings = ConnectSharedRings(client_fd(), kRingNegotiationTimeoutMs);
+  });
+  ASSERT_EQ(Negotiate(acceptor), RingAcceptor::State::kSocket);
+  client.join();
+  ASSERT_EQ(client_rings, nullptr);
+  ASSERT_EQ(acceptor.TakeRings(), nullptr);
+
+  /* No offer follows the audio */
+  std::vector<uint8_t> out(128);
+  ASSERT_EQ(recv(client_fd(), out.data(), out.size(), MSG_DONTWAIT), 64);
+  out.resize(64);
+  ASSERT_EQ(out, down);
+  ASSERT_EQ(recv(server_fd(), out.data(), out.size(), MSG_DONTWAIT), -1);
+}
+
+TEST_F(UipcRingNegotiationTest, LateHelloIsNotAudio) {
+  RingAcceptor acceptor(server_fd(), kRingSize);
+  ASSERT_EQ(acceptor.Continue(), RingAcceptor::State::kWaitingForHello);
+
+  std::unique_ptr<SharedRings> client_rings;
+  std::thread client([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    client_rings = ConnectSharedRings(client_fd(), kRingNegotiationTimeoutMs);
+  });
+  ASSERT_EQ(Negotiate(acceptor), RingAcceptor::State::kRings);
+  client.join();
+
+  ASSERT_NE(acceptor.TakeRings(), nullptr);
+  ASSERT_NE(client_rings, nullptr);
+}
+
+TEST_F(UipcRingNegotiationTest, ClientGivingUpKeepsSocket) {
+  /* The client gives up before the server even sees the hello */
+  ASSERT_EQ(ConnectSharedRings(client_fd(), 0), nullptr);
+  auto data = Pattern(64, 1);
+  ASSERT_EQ(write(client_fd(), data.data(), data.size()), 64);
+
+  RingAcceptor acceptor(server_fd(), kRingSize);
+  ASSERT_EQ(Negotiate(acceptor), RingAcceptor::State::kSocket);
+  ASSERT_EQ(acceptor.TakeRings(), nullptr);
+
+  /* Only the audio is left */
+  std::vector<uint8_t> out(128);
+  ASSERT_EQ(recv(server_fd(), out.data(), out.size(), MSG_DONTWAIT), 64);
+  out.resize(64);
+  ASSERT_EQ(out, data);
+}
+
+TEST_F(UipcRingNegotiationTest, MissingConfirmFails) {
+  SendHello();
+
+  RingAcceptor acceptor(server_fd(), kRingSize);
+  ASSERT_EQ(acceptor.Continue(), RingAcceptor::State::kWaitingForConfirm);
+  ASSERT_GE(acceptor.TimeoutMs(), 0);
+  ASSERT_LE(acceptor.TimeoutMs(), kRingNegotiationTimeoutMs);
+  ASSERT_EQ(Negotiate(acceptor), RingAcceptor::State::kFailed);
+  ASSERT_EQ(acceptor.TakeRings(), nullptr);
+}
+
+TEST_F(UipcRingNegotiationTest, AudioInPlaceOfConfirmFails) {
+  SendHello();
+  auto data = Pattern(64, 1);
+  ASSERT_EQ(write(client_fd(), data.data(), data.size()), 64);
+
+  RingAcceptor acceptor(server_fd(), kRingSize);
+  ASSERT_EQ(Negotiate(acceptor), RingAcceptor::State::kFailed);
+}
+
+TEST_F(UipcRingNegotiationTest, ClientClosingFails) {
+  SendHello();
+  shutdown(client_fd(), SHUT_WR);
+
+  RingAcceptor acceptor(server_fd(), kRingSize);
+  ASSERT_EQ(Negotiate(acceptor), RingAcceptor::State::kFailed);
+}
+
+TEST_F(UipcRingNegotiationTest, LegacyServerKeepsSocket) {
+  auto data = Pattern(64, 1);
+  ASSERT_EQ(write(server_fd(), data.data(), data.size()), 64);
+
+  ASSERT_EQ(ConnectSharedRings(client_fd(), 20), nullptr);
+
+  std::vector<uint8_t> out(64);
+  ASSERT_EQ(read(client_fd(), out.data(), out.size()), 64);
+  ASSERT_EQ(out, data);
+}
+
+}  // namespace
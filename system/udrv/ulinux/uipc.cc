@@ -45,6 +45,7 @@
 #include "bt_utils.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/properties.h"
 #include "osi/include/socket_utils/sockets.h"
 #include "uipc.h"
 
@@ -64,6 +65,8 @@
 
 #define UIPC_FLUSH_BUFFER_SIZE 1024
 
+static const char* kUipcRingProperty = "persist.bluetooth.uipc.shm_ring";
+
 /*****************************************************************************
  *  Local type definitions
  *****************************************************************************/
@@ -182,7 +185,6 @@ static int uipc_main_init(tUIPC_STATE& uipc) {
   memset(&uipc.read_set, 0, sizeof(uipc.read_set));
   uipc.max_fd = 0;
   memset(&uipc.signal_fds, 0, sizeof(uipc.signal_fds));
-  memset(&uipc.ch, 0, sizeof(uipc.ch));
 
   /* setup interrupt socket pair */
   if (socketpair(AF_UNIX, SOCK_STREAM, 0, uipc.signal_fds) < 0) {
@@ -196,8 +198,12 @@ static int uipc_main_init(tUIPC_STATE& uipc) {
     tUIPC_CHAN* p = &uipc.ch[i];
     p->srvfd = UIPC_DISCONNECTED;
     p->fd = UIPC_DISCONNECTED;
+    p->read_poll_tmo_ms = 0;
     p->task_evt_flags = 0;
     p->cback = NULL;
+    p->ring_size = 0;
+    p->rings.reset();
+    p->acceptor.reset();
   }
 
   return 0;
@@ -215,6 +221,42 @@ void uipc_main_cleanup(tUIPC_STATE& uipc) {
   for (i = 0; i < UIPC_CH_NUM; i++) uipc_close_ch_locked(uipc, i);
 }
 
+/* Releases the rings of a channel, waking up the client if it waits on them.
+ * Readers still holding them finish with the shared memory before it goes. */
+static void uipc_release_rings_locked(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id) {
+  if (!uipc.ch[ch_id].rings) return;
+
+  LOG_DEBUG("RELEASE RINGS OF CH %d", ch_id);
+  uipc.ch[ch_id].rings->Shutdown();
+  uipc.ch[ch_id].rings.reset();
+}
+
+/* Moves the negotiation of the rings on, without blocking the read task.
+ * Audio is neither read nor signalled on the channel until it settles. */
+static void uipc_continue_negotiation_locked(tUIPC_STATE& uipc,
+                                             tUIPC_CH_ID ch_id) {
+  using State = bluetooth::uipc::RingAcceptor::State;
+
+  switch (uipc.ch[ch_id].acceptor->Continue()) {
+    case State::kWaitingForHello:
+    case State::kWaitingForConfirm:
+      return;
+    case State::kRings:
+      uipc.ch[ch_id].rings = uipc.ch[ch_id].acceptor->TakeRings();
+      LOG_INFO("CH %d streams over shared memory rings", ch_id);
+      break;
+    case State::kSocket:
+      LOG_INFO("CH %d streams over the socket", ch_id);
+      break;
+    case State::kFailed:
+      LOG_WARN("CH %d failed to negotiate its transport", ch_id);
+      uipc.ch[ch_id].acceptor.reset();
+      uipc_close_ch_locked(uipc, ch_id);
+      return;
+  }
+  uipc.ch[ch_id].acceptor.reset();
+}
+
 /* check pending events in read task */
 static void uipc_check_task_flags_locked(tUIPC_STATE& uipc) {
   int i;
@@ -242,11 +284,20 @@ static int uipc_check_fd_locked(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id) {
       FD_CLR(uipc.ch[ch_id].fd, &uipc.active_set);
       uipc.ch[ch_id].fd = UIPC_DISCONNECTED;
     }
+    uipc_release_rings_locked(uipc, ch_id);
+    uipc.ch[ch_id].acceptor.reset();
 
     uipc.ch[ch_id].fd = accept_server_socket(uipc.ch[ch_id].srvfd);
 
     LOG_DEBUG("NEW FD %d", uipc.ch[ch_id].fd);
 
+    /* The socket stays open to tell when the client goes away. The read task
+     * drives the negotiation from here on. */
+    if ((uipc.ch[ch_id].fd >= 0) && uipc.ch[ch_id].ring_size) {
+      uipc.ch[ch_id].acceptor = std::make_unique<bluetooth::uipc::RingAcceptor>(
+          uipc.ch[ch_id].fd, uipc.ch[ch_id].ring_size);
+    }
+
     if ((uipc.ch[ch_id].fd >= 0) && uipc.ch[ch_id].cback) {
       /*  if we have a callback we should add this fd to the active set
           and notify user with callback event */
@@ -263,7 +314,13 @@ static int uipc_check_fd_locked(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id) {
     if (uipc.ch[ch_id].cback) uipc.ch[ch_id].cback(ch_id, UIPC_OPEN_EVT);
   }
 
-  if (SAFE_FD_ISSET(uipc.ch[ch_id].fd, &uipc.read_set)) {
+  if (uipc.ch[ch_id].acceptor) {
+    uipc_continue_negotiation_locked(uipc, ch_id);
+    return 0;
+  }
+
+  if (SAFE_FD_ISSET(uipc.ch[ch_id].fd, &uipc.read_set) &&
+      FD_ISSET(uipc.ch[ch_id].fd, &uipc.active_set)) {
 
     if (uipc.ch[ch_id].cback)
       uipc.ch[ch_id].cback(ch_id, UIPC_RX_DATA_READY_EVT);
@@ -287,7 +344,8 @@ static inline void uipc_wakeup_locked(tUIPC_STATE& uipc) {
 }
 
 static int uipc_setup_server_locked(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id,
-                                    const char* name, tUIPC_RCV_CBACK* cback) {
+                                    const char* name, tUIPC_RCV_CBACK* cback,
+                                    bool offer_rings) {
   int fd;
 
   LOG_DEBUG("SETUP CHANNEL SERVER %d", ch_id);
@@ -310,6 +368,11 @@ static int uipc_setup_server_locked(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id,
   uipc.ch[ch_id].srvfd = fd;
   uipc.ch[ch_id].cback = cback;
   uipc.ch[ch_id].read_poll_tmo_ms = DEFAULT_READ_POLL_TMO_MS;
+  uipc.ch[ch_id].ring_size =
+      (offer_rings && ch_id == UIPC_CH_ID_AV_AUDIO &&
+       osi_property_get_bool(kUipcRingProperty, true))
+          ? UIPC_RING_SIZE
+          : 0;
 
   /* trigger main thread to update read set */
   uipc_wakeup_locked(uipc);
@@ -324,6 +387,17 @@ static void uipc_flush_ch_locked(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id) {
   pfd.events = POLLIN;
   pfd.fd = uipc.ch[ch_id].fd;
 
+  if (uipc.ch[ch_id].rings) {
+    size_t flushed = uipc.ch[ch_id].rings->Upstream().Flush();
+    LOG_VERBOSE("%s() - flushed %zu bytes from the ring", __func__, flushed);
+  }
+
+  /* Nothing to flush yet, and the socket still carries the negotiation */
+  if (uipc.ch[ch_id].acceptor) {
+    LOG_DEBUG("%s() - transport not negotiated yet. Exiting", __func__);
+    return;
+  }
+
   if (uipc.ch[ch_id].fd == UIPC_DISCONNECTED) {
     LOG_DEBUG("%s() - fd disconnected. Exiting", __func__);
     return;
@@ -390,6 +464,8 @@ static int uipc_close_ch_locked(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id) {
     uipc.ch[ch_id].fd = UIPC_DISCONNECTED;
     wakeup = 1;
   }
+  uipc_release_rings_locked(uipc, ch_id);
+  uipc.ch[ch_id].acceptor.reset();
 
   /* notify this connection is closed */
   if (uipc.ch[ch_id].cback) uipc.ch[ch_id].cback(ch_id, UIPC_CLOSE_EVT);
@@ -421,14 +497,32 @@ static void* uipc_read_task(void* arg) {
   raise_priority_a2dp(TASK_UIPC_READ);
 
   while (uipc.running) {
-    uipc.read_set = uipc.active_set;
-
-    result = select(uipc.max_fd + 1, &uipc.read_set, NULL, NULL, NULL);
+    int max_fd;
+    int timeout_ms = -1;
+    {
+      std::lock_guard<std::recursive_mutex> guard(uipc.mutex);
 
-    if (result == 0) {
-      LOG_DEBUG("select timeout");
-      continue;
+      /* Connections still negotiating are watched even when their owner
+       * reads them directly */
+      uipc.read_set = uipc.active_set;
+      max_fd = uipc.max_fd;
+      for (ch_id = 0; ch_id < UIPC_CH_NUM; ch_id++) {
+        if (!uipc.ch[ch_id].acceptor) continue;
+        FD_SET(uipc.ch[ch_id].fd, &uipc.read_set);
+        max_fd = MAX(max_fd, uipc.ch[ch_id].fd);
+        int acceptor_timeout_ms = uipc.ch[ch_id].acceptor->TimeoutMs();
+        if (acceptor_timeout_ms >= 0 &&
+            (timeout_ms < 0 || acceptor_timeout_ms < timeout_ms)) {
+          timeout_ms = acceptor_timeout_ms;
+        }
+      }
     }
+
+    struct timeval timeout = {.tv_sec = timeout_ms / 1000,
+                              .tv_usec = (timeout_ms % 1000) * 1000};
+    result = select(max_fd + 1, &uipc.read_set, NULL, NULL,
+                    timeout_ms >= 0 ? &timeout : NULL);
+
     if (result < 0) {
       if (errno != EINTR) {
         LOG_DEBUG("select failed %s", strerror(errno));
@@ -525,7 +619,7 @@ std::unique_ptr<tUIPC_STATE> UIPC_Init() {
  **
  ******************************************************************************/
 bool UIPC_Open(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id, tUIPC_RCV_CBACK* p_cback,
-               const char* socket_path) {
+               const char* socket_path, bool offer_rings) {
   LOG_DEBUG("UIPC_Open : ch_id %d", ch_id);
 
   std::lock_guard<std::recursive_mutex> lock(uipc.mutex);
@@ -539,7 +633,7 @@ bool UIPC_Open(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id, tUIPC_RCV_CBACK* p_cback,
     return 0;
   }
 
-  uipc_setup_server_locked(uipc, ch_id, socket_path, p_cback);
+  uipc_setup_server_locked(uipc, ch_id, socket_path, p_cback, offer_rings);
 
   return true;
 }
@@ -584,6 +678,18 @@ bool UIPC_Send(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id,
 
   std::lock_guard<std::recursive_mutex> lock(uipc.mutex);
 
+  /* Until the negotiation settles the audio goes down the socket, which
+   * a client switching to the rings then leaves unread */
+  if (ch_id < UIPC_CH_NUM && uipc.ch[ch_id].acceptor) {
+    uipc.ch[ch_id].acceptor->OnSendOverSocket();
+  }
+
+  /* Never block the stack on a client which is not keeping up */
+  if (ch_id < UIPC_CH_NUM && uipc.ch[ch_id].rings) {
+    return uipc.ch[ch_id].rings->Downstream().Write(p_buf, msglen, 0) ==
+           msglen;
+  }
+
   ssize_t ret;
   OSI_NO_INTR(ret = write(uipc.ch[ch_id].fd, p_buf, msglen));
   if (ret < 0) {
@@ -593,6 +699,31 @@ bool UIPC_Send(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id,
   return false;
 }
 
+/* Reads from the rings of a channel, which were taken under the lock */
+static uint32_t uipc_read_rings(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id,
+                                bluetooth::uipc::SharedRings& rings, int fd,
+                                uint8_t* p_buf, uint32_t len) {
+  uint32_t n_read =
+      rings.Upstream().Read(p_buf, len, uipc.ch[ch_id].read_poll_tmo_ms);
+  if (n_read == len) return n_read;
+
+  /* Running short may mean the client is gone */
+  struct pollfd pfd = {.fd = fd, .events = POLLIN, .revents = 0};
+  int poll_ret;
+  OSI_NO_INTR(poll_ret = poll(&pfd, 1, 0));
+  if (poll_ret > 0 && (pfd.revents & (POLLHUP | POLLNVAL))) {
+    LOG_WARN("UIPC_Read : channel detached remotely");
+    std::lock_guard<std::recursive_mutex> lock(uipc.mutex);
+    uipc_close_locked(uipc, ch_id);
+    return 0;
+  }
+
+  if (n_read == 0) {
+    LOG_WARN("ring read timeout (%d ms)", uipc.ch[ch_id].read_poll_tmo_ms);
+  }
+  return n_read;
+}
+
 /*******************************************************************************
  **
  ** Function         UIPC_Read
@@ -619,6 +750,15 @@ uint32_t UIPC_Read(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id, uint8_t* p_buf,
     return 0;
   }
 
+  std::shared_ptr<bluetooth::uipc::SharedRings> rings;
+  {
+    std::lock_guard<std::recursive_mutex> lock(uipc.mutex);
+    /* The first bytes may still be a request for the rings */
+    if (uipc.ch[ch_id].acceptor) return 0;
+    rings = uipc.ch[ch_id].rings;
+  }
+  if (rings) return uipc_read_rings(uipc, ch_id, *rings, fd, p_buf, len);
+
   while (n_read < (int)len) {
     pfd.fd = fd;
     pfd.events = POLLIN | POLLHUP;
@@ -703,6 +843,14 @@ extern bool UIPC_Ioctl(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id, uint32_t request,
                 uipc.ch[ch_id].read_poll_tmo_ms);
       break;
 
+    case UIPC_GET_RING_STATS:
+      if (ch_id >= UIPC_CH_NUM || !uipc.ch[ch_id].rings || !param) break;
+      ((tUIPC_RING_STATS*)param)->upstream =
+          uipc.ch[ch_id].rings->Upstream().GetStats();
+      ((tUIPC_RING_STATS*)param)->downstream =
+          uipc.ch[ch_id].rings->Downstream().GetStats();
+      return true;
+
     default:
       LOG_DEBUG("UIPC_Ioctl : request not handled (%d)", request);
       break;
@@ -0,0 +1,618 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "uipc_ring.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstring>
+#include <new>
+
+namespace bluetooth {
+namespace uipc {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x55524e47; /* "URNG" */
+constexpr uint32_t kVersion = 2;
+constexpr size_t kMinRingSize = 4096;
+constexpr size_t kMaxRingSize = 1 << 24;
+
+/* Head of the shared mapping */
+struct Hello {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t ring_size;
+};
+
+/* Negotiation message */
+enum MessageType : uint32_t {
+  kHello = 1,   /* client to server */
+  kOffer = 2,   /* server to client: ring size, the memfd when not zero */
+  kConfirm = 3, /* client to server: 1 when it switched to the rings */
+};
+
+struct Message {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t type;
+  uint32_t value;
+};
+
+}  // namespace
+
+struct RingHeader {
+  /* Written by the producer only */
+  alignas(64) std::atomic<uint64_t> write_pos;
+  std::atomic<uint32_t> write_seq; /* futex readers sleep on */
+  std::atomic<uint32_t> writer_waiting;
+  std::atomic<uint64_t> overruns;
+  std::atomic<uint64_t> fill_sum;
+  std::atomic<uint64_t> fill_samples;
+  std::atomic<uint32_t> max_fill;
+
+  /* Written by the consumer only */
+  alignas(64) std::atomic<uint64_t> read_pos;
+  std::atomic<uint32_t> read_seq; /* futex writers sleep on */
+  std::atomic<uint32_t> reader_waiting;
+  std::atomic<uint64_t> underruns;
+
+  /* Written by either side */
+  alignas(64) std::atomic<uint32_t> shutdown;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "The ring is shared between processes");
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+              "The ring is shared between processes");
+
+namespace {
+
+struct alignas(64) MappingHeader {
+  Hello hello;
+};
+
+size_t MappingLength(uint32_t ring_size) {
+  size_t length = sizeof(MappingHeader) + 2 * sizeof(RingHeader) +
+                  2 * (size_t)ring_size;
+  const size_t page = sysconf(_SC_PAGESIZE);
+  return (length + page - 1) / page * page;
+}
+
+uint64_t NowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* The mapping is shared between processes, so the futexes are not private */
+void FutexWait(std::atomic<uint32_t>* word, uint32_t expected,
+               uint64_t timeout_ns) {
+  struct timespec ts = {
+      .tv_sec = (time_t)(timeout_ns / 1000000000),
+      .tv_nsec = (long)(timeout_ns % 1000000000),
+  };
+  syscall(SYS_futex, word, FUTEX_WAIT, expected, &ts, nullptr, 0);
+}
+
+void FutexWake(std::atomic<uint32_t>* word) {
+  syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+/* Sleeps until |seq| moves on from |seq_value|, the deadline passes or the
+ * ring is shut down. Returns false once the deadline has passed. */
+bool WaitFor(RingHeader* header, std::atomic<uint32_t>& seq,
+             uint32_t seq_value, std::atomic<uint32_t>& waiting,
+             uint64_t deadline_ns) {
+  const uint64_t now_ns = NowNs();
+  if (now_ns >= deadline_ns) return false;
+  if (header->shutdown.load()) return false;
+
+  FutexWait(&seq, seq_value, deadline_ns - now_ns);
+  waiting.store(0);
+  return true;
+}
+
+}  // namespace
+
+size_t Ring::Fill() const {
+  return header_->write_pos.load(std::memory_order_acquire) -
+         header_->read_pos.load(std::memory_order_acquire);
+}
+
+bool Ring::IsShutdown() const { return header_->shutdown.load() != 0; }
+
+size_t Ring::Write(const uint8_t* data, size_t len, int timeout_ms) {
+  const uint64_t deadline_ns = NowNs() + (uint64_t)timeout_ms * 1000000;
+  const uint32_t mask = size_ - 1;
+  size_t written = 0;
+
+  while (written < len && !IsShutdown()) {
+    const uint64_t write_pos =
+        header_->write_pos.load(std::memory_order_relaxed);
+    const uint64_t read_pos = header_->read_pos.load(std::memory_order_acquire);
+    const size_t n =
+        std::min<size_t>(size_ - (write_pos - read_pos), len - written);
+
+    if (n > 0) {
+      const uint32_t index = write_pos & mask;
+      const size_t first = std::min<size_t>(n, size_ - index);
+      memcpy(data_ + index, data + written, first);
+      memcpy(data_, data + written + first, n - first);
+      header_->write_pos.store(write_pos + n, std::memory_order_release);
+      written += n;
+
+      header_->write_seq.fetch_add(1);
+      if (header_->reader_waiting.load()) FutexWake(&header_->write_seq);
+      continue;
+    }
+
+    /* Full: announce the wait, then check again for room before sleeping so
+     * that a read in between is either seen here or wakes us up. */
+    const uint32_t seq = header_->read_seq.load();
+    header_->writer_waiting.store(1);
+    if (header_->read_pos.load() != read_pos) {
+      header_->writer_waiting.store(0);
+      continue;
+    }
+    if (!WaitFor(header_, header_->read_seq, seq, header_->writer_waiting,
+                 deadline_ns)) {
+      header_->writer_waiting.store(0);
+      break;
+    }
+  }
+
+  if (written < len && !IsShutdown()) {
+    header_->overruns.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  if (written > 0) {
+    const uint32_t fill = Fill();
+    header_->fill_sum.fetch_add(fill, std::memory_order_relaxed);
+    header_->fill_samples.fetch_add(1, std::memory_order_relaxed);
+    if (fill > header_->max_fill.load(std::memory_order_relaxed)) {
+      header_->max_fill.store(fill, std::memory_order_relaxed);
+    }
+  }
+  return written;
+}
+
+size_t Ring::Read(uint8_t* data, size_t len, int timeout_ms) {
+  const uint64_t deadline_ns = NowNs() + (uint64_t)timeout_ms * 1000000;
+  const uint32_t mask = size_ - 1;
+  size_t read = 0;
+
+  while (read < len) {
+    const uint64_t read_pos = header_->read_pos.load(std::memory_order_relaxed);
+    const uint64_t write_pos =
+        header_->write_pos.load(std::memory_order_acquire);
+    const size_t n = std::min<size_t>(write_pos - read_pos, len - read);
+
+    if (n > 0) {
+      const uint32_t index = read_pos & mask;
+      const size_t first = std::min<size_t>(n, size_ - index);
+      memcpy(data + read, data_ + index, first);
+      memcpy(data + read + first, data_, n - first);
+      header_->read_pos.store(read_pos + n, std::memory_order_release);
+      read += n;
+
+      header_->read_seq.fetch_add(1);
+      if (header_->writer_waiting.load()) FutexWake(&header_->read_seq);
+      continue;
+    }
+
+    /* Empty: same dance as the writer, on the other futex */
+    const uint32_t seq = header_->write_seq.load();
+    header_->reader_waiting.store(1);
+    if (header_->write_pos.load() != write_pos) {
+      header_->reader_waiting.store(0);
+      continue;
+    }
+    if (!WaitFor(header_, header_->write_seq, seq, header_->reader_waiting,
+                 deadline_ns)) {
+      header_->reader_waiting.store(0);
+      break;
+    }
+  }
+
+  if (read < len && !IsShutdown()) {
+    header_->underruns.fetch_add(1, std::memory_order_relaxed);
+  }
+  return read;
+}
+
+size_t Ring::Flush() {
+  const uint64_t read_pos = header_->read_pos.load(std::memory_order_relaxed);
+  const uint64_t write_pos = header_->write_pos.load(std::memory_order_acquire);
+  header_->read_pos.store(write_pos, std::memory_order_release);
+
+  header_->read_seq.fetch_add(1);
+  if (header_->writer_waiting.load()) FutexWake(&header_->read_seq);
+  return write_pos - read_pos;
+}
+
+void Ring::Shutdown() {
+  header_->shutdown.store(1);
+  header_->write_seq.fetch_add(1);
+  header_->read_seq.fetch_add(1);
+  FutexWake(&header_->write_seq);
+  FutexWake(&header_->read_seq);
+}
+
+RingStats Ring::GetStats() const {
+  RingStats stats;
+  const uint64_t samples = header_->fill_samples.load();
+
+  stats.size = size_;
+  stats.fill = Fill();
+  stats.max_fill = header_->max_fill.load();
+  stats.avg_fill = samples ? header_->fill_sum.load() / samples : 0;
+  stats.bytes_written = header_->write_pos.load();
+  stats.bytes_read = header_->read_pos.load();
+  stats.underruns = header_->underruns.load();
+  stats.overruns = header_->overruns.load();
+  return stats;
+}
+
+SharedRings::SharedRings(int fd, void* base, size_t length)
+    : fd_(fd), base_(base), length_(length) {
+  auto* mapping = static_cast<uint8_t*>(base);
+  const uint32_t size = static_cast<MappingHeader*>(base)->hello.ring_size;
+  auto* headers =
+      reinterpret_cast<RingHeader*>(mapping + sizeof(MappingHeader));
+  uint8_t* data = mapping + sizeof(MappingHeader) + 2 * sizeof(RingHeader);
+
+  upstream_.reset(new Ring(&headers[0], data, size));
+  downstream_.reset(new Ring(&headers[1], data + size, size));
+}
+
+SharedRings::~SharedRings() {
+  munmap(base_, length_);
+  close(fd_);
+}
+
+std::unique_ptr<SharedRings> SharedRings::Create(size_t ring_size) {
+  ring_size = std::clamp(ring_size, kMinRingSize, kMaxRingSize);
+  size_t size = kMinRingSize;
+  while (size < ring_size) size <<= 1;
+
+  int fd = syscall(SYS_memfd_create, "bt_uipc_ring", MFD_CLOEXEC);
+  if (fd < 0) return nullptr;
+
+  const size_t length = MappingLength(size);
+  if (ftruncate(fd, length) < 0) {
+    close(fd);
+    return nullptr;
+  }
+
+  void* base =
+      mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED) {
+    close(fd);
+    return nullptr;
+  }
+
+  auto* header = new (base) MappingHeader();
+  header->hello = {
+      .magic = kMagic, .version = kVersion, .ring_size = (uint32_t)size};
+  auto* rings = reinterpret_cast<uint8_t*>(base) + sizeof(MappingHeader);
+  new (rings) RingHeader();
+  new (rings + sizeof(RingHeader)) RingHeader();
+
+  return std::unique_ptr<SharedRings>(new SharedRings(fd, base, length));
+}
+
+std::unique_ptr<SharedRings> SharedRings::Map(int fd) {
+  struct stat st;
+  if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(MappingHeader)) {
+    close(fd);
+    return nullptr;
+  }
+
+  void* base =
+      mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED) {
+    close(fd);
+    return nullptr;
+  }
+
+  /* Never trust the layout the other side claims beyond what is mapped */
+  const Hello& hello = static_cast<MappingHeader*>(base)->hello;
+  const uint32_t size = hello.ring_size;
+  if (hello.magic != kMagic || hello.version != kVersion ||
+      size < kMinRingSize || size > kMaxRingSize || (size & (size - 1)) ||
+      MappingLength(size) > (size_t)st.st_size) {
+    munmap(base, st.st_size);
+    close(fd);
+    return nullptr;
+  }
+
+  return std::unique_ptr<SharedRings>(new SharedRings(fd, base, st.st_size));
+}
+
+void SharedRings::Shutdown() {
+  upstream_->Shutdown();
+  downstream_->Shutdown();
+}
+
+namespace {
+
+enum class Peek {
+  kEmpty,      /* nothing received yet */
+  kIncomplete, /* the start of a message */
+  kMessage,    /* a whole message */
+  kOther,      /* bytes which are not a message */
+  kClosed,     /* the other side is gone */
+};
+
+/* Peeks at the first bytes of the stream without blocking, and tells whether
+ * they are a message, without consuming them. */
+Peek PeekMessage(int fd, Message* message) {
+  ssize_t n;
+  do {
+    n = recv(fd, message, sizeof(*message), MSG_PEEK | MSG_DONTWAIT);
+  } while (n < 0 && errno == EINTR);
+  if (n < 0) {
+    return (errno == EAGAIN || errno == EWOULDBLOCK) ? Peek::kEmpty
+                                                     : Peek::kClosed;
+  }
+  if (n == 0) return Peek::kClosed;
+  if (memcmp(message, &kMagic, std::min((size_t)n, sizeof(kMagic)))) {
+    return Peek::kOther;
+  }
+  return (size_t)n == sizeof(*message) ? Peek::kMessage : Peek::kIncomplete;
+}
+
+/* Consumes the message peeked at, and the fd passed along with it if any. */
+bool RecvMessage(int fd, Message* message, int* shm_fd) {
+  char control[CMSG_SPACE(sizeof(int))] = {};
+  struct iovec iov = {.iov_base = message, .iov_len = sizeof(*message)};
+  struct msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  ssize_t n;
+  do {
+    n = recvmsg(fd, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+  } while (n < 0 && errno == EINTR);
+
+  *shm_fd = -1;
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  if (n > 0 && cmsg && cmsg->cmsg_level == SOL_SOCKET &&
+      cmsg->cmsg_type == SCM_RIGHTS) {
+    memcpy(shm_fd, CMSG_DATA(cmsg), sizeof(int));
+  }
+  return n == sizeof(*message);
+}
+
+bool SendMessage(int fd, uint32_t type, uint32_t value, int shm_fd) {
+  Message message = {
+      .magic = kMagic, .version = kVersion, .type = type, .value = value};
+  struct iovec iov = {.iov_base = &message, .iov_len = sizeof(message)};
+  char control[CMSG_SPACE(sizeof(int))] = {};
+  struct msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+
+  if (shm_fd >= 0) {
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &shm_fd, sizeof(int));
+  }
+
+  /* The socket is fresh, so a message this small never has to wait */
+  ssize_t n;
+  do {
+    n = sendmsg(fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+  } while (n < 0 && errno == EINTR);
+  return n == sizeof(message);
+}
+
+/* Waits up to |deadline_ns| for a whole |type| message at the head of the
+ * stream. */
+bool WaitForMessage(int fd, uint32_t type, uint64_t deadline_ns) {
+  while (true) {
+    Message message;
+    switch (PeekMessage(fd, &message)) {
+      case Peek::kMessage:
+        return message.type == type;
+      case Peek::kEmpty:
+      case Peek::kIncomplete:
+        break;
+      case Peek::kOther:
+      case Peek::kClosed:
+        return false;
+    }
+
+    const uint64_t now_ns = NowNs();
+    if (now_ns >= deadline_ns) return false;
+    struct pollfd pfd = {.fd = fd, .events = POLLIN, .revents = 0};
+    int ret;
+    do {
+      ret = poll(&pfd, 1, (deadline_ns - now_ns + 999999) / 1000000);
+    } while (ret < 0 && errno == EINTR);
+    if (ret < 0) return false;
+    /* Readable but still short of a whole message: let the rest arrive */
+    if (ret > 0 && !(pfd.revents & (POLLHUP | POLLERR | POLLNVAL))) {
+      usleep(100);
+    }
+  }
+}
+
+}  // namespace
+
+RingAcceptor::RingAcceptor(int fd, size_t ring_size)
+    : fd_(fd),
+      ring_size_(ring_size),
+      deadline_ns_(NowNs() + kRingNegotiationTimeoutMs * 1000000ull) {}
+
+RingAcceptor::State RingAcceptor::Continue() {
+  Message message;
+  int shm_fd = -1;
+
+  switch (state_) {
+    case State::kWaitingForHello:
+      switch (PeekMessage(fd_, &message)) {
+        case Peek::kEmpty:
+          /* A client which does not ask right away streams over the socket */
+          if (NowNs() >= deadline_ns_) state_ = State::kSocket;
+          return state_;
+        case Peek::kIncomplete:
+          /* Do not wait forever for the rest of a hello */
+          if (NowNs() >= deadline_ns_) state_ = State::kFailed;
+          return state_;
+        case Peek::kOther:
+          /* A legacy client: its first bytes are audio, left in place */
+          state_ = State::kSocket;
+          return state_;
+        case Peek::kClosed:
+          state_ = State::kFailed;
+          return state_;
+        case Peek::kMessage:
+          break;
+      }
+      if (message.type != kHello || !RecvMessage(fd_, &message, &shm_fd)) {
+        if (shm_fd >= 0) close(shm_fd);
+        state_ = State::kFailed;
+        return state_;
+      }
+      if (shm_fd >= 0) close(shm_fd);
+
+      /* The client already got audio in place of the offer, and confirms
+       * that it stays on the socket */
+      if (sent_over_socket_) {
+        state_ = State::kWaitingForConfirm;
+        deadline_ns_ = NowNs() + kRingNegotiationTimeoutMs * 1000000ull;
+        return state_;
+      }
+
+      /* An empty offer tells the client to stay on the socket */
+      if (message.version == kVersion) {
+        rings_ = SharedRings::Create(ring_size_);
+      }
+      if (!SendMessage(fd_, kOffer, rings_ ? rings_->Upstream().Size() : 0,
+                       rings_ ? rings_->Fd() : -1)) {
+        rings_.reset();
+        state_ = State::kFailed;
+        return state_;
+      }
+      state_ = State::kWaitingForConfirm;
+      deadline_ns_ = NowNs() + kRingNegotiationTimeoutMs * 1000000ull;
+      return state_;
+
+    case State::kWaitingForConfirm:
+      switch (PeekMessage(fd_, &message)) {
+        case Peek::kEmpty:
+        case Peek::kIncomplete:
+          if (NowNs() >= deadline_ns_) {
+            rings_.reset();
+            state_ = State::kFailed;
+          }
+          return state_;
+        case Peek::kOther:
+        case Peek::kClosed:
+          rings_.reset();
+          state_ = State::kFailed;
+          return state_;
+        case Peek::kMessage:
+          break;
+      }
+      if (message.type != kConfirm || !RecvMessage(fd_, &message, &shm_fd)) {
+        if (shm_fd >= 0) close(shm_fd);
+        rings_.reset();
+        state_ = State::kFailed;
+        return state_;
+      }
+      if (shm_fd >= 0) close(shm_fd);
+
+      /* The client may have given up on the offer, then so does the server */
+      if (message.value == 1 && rings_) {
+        state_ = State::kRings;
+      } else {
+        rings_.reset();
+        state_ = State::kSocket;
+      }
+      return state_;
+
+    case State::kRings:
+    case State::kSocket:
+    case State::kFailed:
+      return state_;
+  }
+  return state_;
+}
+
+int RingAcceptor::TimeoutMs() const {
+  if (state_ != State::kWaitingForHello &&
+      state_ != State::kWaitingForConfirm) {
+    return -1;
+  }
+  const uint64_t now_ns = NowNs();
+  if (now_ns >= deadline_ns_) return 0;
+  return (deadline_ns_ - now_ns + 999999) / 1000000;
+}
+
+void RingAcceptor::OnSendOverSocket() { sent_over_socket_ = true; }
+
+std::unique_ptr<SharedRings> RingAcceptor::TakeRings() {
+  if (state_ != State::kRings) return nullptr;
+  return std::move(rings_);
+}
+
+std::unique_ptr<SharedRings> ConnectSharedRings(int fd, int timeout_ms) {
+  const uint64_t deadline_ns = NowNs() + (uint64_t)timeout_ms * 1000000;
+  if (!SendMessage(fd, kHello, 0, -1)) return nullptr;
+
+  std::unique_ptr<SharedRings> rings;
+  Message offer;
+  int shm_fd = -1;
+  if (WaitForMessage(fd, kOffer, deadline_ns) &&
+      RecvMessage(fd, &offer, &shm_fd)) {
+    if (offer.value > 0 && shm_fd >= 0) {
+      rings = SharedRings::Map(shm_fd);
+    } else if (shm_fd >= 0) {
+      close(shm_fd);
+    }
+  }
+
+  /* Always confirmed before any audio, so that the server knows which
+   * transport the audio comes on. An offer arriving after the client gave up
+   * stays unread, so only clients which never read audio from the socket
+   * should ask for the rings. */
+  if (!SendMessage(fd, kConfirm, rings ? 1 : 0, -1)) return nullptr;
+  return rings;
+}
+
+}  // namespace uipc
+}  // namespace bluetooth